@@ -1,8 +1,23 @@
 #include "AdaptiveSubdivision.h"
+#include "Headless/SubdKeyTransform.h"
+#include "Headless/SubdCbtEngine.h"
+#include "Headless/SubdHeightmap.h"
+#include "Headless/SubdMeshExport.h"
+#include "Headless/SubdObjLoader.h"
+#include "Headless/SubdSnapshot.h"
+#include "Headless/SubdTexture.h"
 
 std::string ProjectName = "Adaptive Subdivision";
 std::string ModelFileName = "Suzanne.obj";
 std::string HeightMapName = "HeightMap.png";
+std::string HeightMapCacheFileName = "HeightMap.cache";
+std::string SnapshotFileName = "SubdSnapshot.bin";
+std::string MeshExportFileName = "SubdMesh.bin";
+std::string MeshExportObjFileName = "SubdMesh.obj";
+std::string CameraPathFileName = "CameraPath.txt";
+std::string BenchmarkFileName = "Benchmark.json";
+std::string BenchmarkBaselineFileName = "BenchmarkBaseline.json";
+std::string ShaderPermutationFileName = "ShaderPermutations.txt";
 
 const size_t SubdBufferSize = 1 << 20;
 
@@ -16,12 +31,38 @@ void AdaptiveSubdivision::onGuiRender(Gui* pGui)
     if (controlsGroup.open()) {
         w.checkbox("Only Render", mAppConfig.OnlyRender);
         w.checkbox("Enable Culling", mAppConfig.EnableCulling);
+        w.checkbox("Occlusion Culling", mAppConfig.OcclusionCulling);
         w.checkbox("Wireframe", mAppConfig.Wireframe);
         w.checkbox("Displace", mAppConfig.Displace);
 
         w.checkbox("Freeze Subdivision", mAppConfig.FreezeSubd);
+        w.checkbox("Key Transform Table", mAppConfig.KeyTransformTable);
+        w.checkbox("Deterministic Compaction", mAppConfig.DeterministicCompaction);
+        w.checkbox("CBT Storage", mAppConfig.CbtStorage);
+        w.checkbox("Leaf Vertex Prepass", mAppConfig.LeafVertexPrepass);
+        w.checkbox("Sort Leaves", mAppConfig.SortLeaves);
+        w.checkbox("Converge In Frame", mAppConfig.ConvergeInFrame);
+        w.slider("Max Iterations", mAppConfig.ConvergenceMaxIterations, 1, 64);
+        w.slider("Convergence Budget (ms)", mAppConfig.ConvergenceBudgetMs, 0.1f, 16.0f);
+        w.text("Iterations: " + std::to_string(mSubdStats.ConvergenceIterations) + (mSubdStats.Converged ? " (converged)" : ""));
         w.slider("Target Pixel Size", mAppConfig.TargetPixelSize, 0.3f, 20.0f);
+        if (w.checkbox("Enable Budget", mAppConfig.EnableBudget) && !mAppConfig.EnableBudget) {
+            mBudgetGovernor.Reset();
+        }
+        w.slider("Leaf Budget", mAppConfig.LeafBudget, 0, (int)SubdBufferSize);
+        w.slider("Frame Time Budget (ms)", mAppConfig.FrameTimeBudgetMs, 0.0f, 33.0f);
+        if (mAppConfig.EnableBudget) {
+            w.text("Effective Pixel Size: " + std::to_string(mBudgetGovernor.GetPixelSize()) + ", load " + std::to_string(mBudgetGovernor.GetLoad()));
+        }
+        w.slider("Patch Level", mAppConfig.PatchLevel, (int)Headless::PatchGridMinLevel, (int)Headless::PatchGridMaxLevel);
         w.slider("Displacement Factor", mAppConfig.DisplacementFactor, 0.0f, 0.5f);
+        w.checkbox("Roughness LOD", mAppConfig.RoughnessLod);
+        w.slider("Max Screen Error (px)", mAppConfig.MaxScreenError, 0.1f, 8.0f);
+        w.slider("Max LOD Offset", mAppConfig.MaxLodOffset, 0.0f, 12.0f);
+        w.checkbox("Incremental LOD", mAppConfig.IncrementalLod);
+        w.checkbox("Multi View", mAppConfig.MultiView);
+        w.slider("Extra Views", mAppConfig.ExtraViewCount, 1, (int)Headless::MaxLodViewCount - 1);
+        w.slider("View Spacing", mAppConfig.ViewSpacing, 0.0f, 1.0f);
 
         if (w.dropdown("Shading Mode", ShadingModeList, ShadingModeID)) {
             mAppConfig.SM = (ShadingMode)ShadingModeID;
@@ -29,11 +70,111 @@ void AdaptiveSubdivision::onGuiRender(Gui* pGui)
         if (w.dropdown("Tessellation Mode", TessellationModeList, TessellationModeID)) {
             mAppConfig.TM = (TessellationMode)TessellationModeID;
         }
+        if (w.dropdown("Slope Map Format", SlopeFormatList, SlopeFormatID)) {
+            mAppConfig.SlopeMapFormat = (Headless::SlopeFormat)SlopeFormatID;
+        }
+        w.text("Slope Map: " + std::to_string(mpSlopeMap ? mpSlopeMap->getWidth() * mpSlopeMap->getHeight() * Headless::GetSlopeFormatTexelBytes(mSlopeFormatActive) / (1 << 20) : 0.0) + " MB");
     }
 
     auto TestGroup = Gui::Group(pGui, "Tests");
     if (TestGroup.open()) {
         w.checkbox("Render Suzanne", mAppConfig.RenderSuzanne);
+        w.checkbox("Subdivide Suzanne", mAppConfig.SubdivideModel);
+        w.text(std::to_string(mSubdMesh.GetPrimitiveCount()) + " root triangles");
+    }
+
+    auto ShaderGroup = Gui::Group(pGui, "Shader Permutations");
+    if (ShaderGroup.open()) {
+        if (w.button("Warm Up All Permutations")) {
+            for (size_t i = 0; i < mShaderPermutations.size(); ++i) {
+                for (uint32_t Key : mShaderPermutations[i].Set.EnumerateKeys(mCbtPrimitiveBits)) {
+                    mShaderWarmUpQueue.emplace_back(i, Key);
+                }
+            }
+        }
+        w.text(std::to_string(mShaderPermutationCache.GetKeyCount()) + " used, " + std::to_string(mShaderWarmUpQueue.size()) + " queued for warm-up");
+    }
+
+    auto StatsGroup = Gui::Group(pGui, "Stats");
+    if (StatsGroup.open()) {
+        w.text("Frame " + std::to_string(mSubdStats.Frame) + " (" + std::to_string(mReadbackRing.GetLatency()) + " frames late)");
+        w.text("Leaves: " + std::to_string(mSubdStats.LeafCount) + ", visible " + std::to_string(mSubdStats.VisibleCount) + ", culled "
+            + std::to_string(mSubdStats.CulledCount) + " (" + std::to_string(mSubdStats.OccludedCount) + " occluded)");
+        w.text("Splits: " + std::to_string(mSubdStats.SplitCount) + ", merges " + std::to_string(mSubdStats.MergeCount));
+        if (IsIncrementalLodActive()) {
+            w.text("Incremental LOD: " + std::to_string(mSubdStats.DirtyCount) + " leaves evaluated in the last pass");
+        }
+        if (mAppConfig.MultiView) {
+            for (int View = 0; View < mAppConfig.ExtraViewCount; ++View) {
+                w.text("View " + std::to_string(View + 1) + ": " + std::to_string(mSubdStats.ViewVisibleCount[View]) + " leaves visible");
+            }
+        }
+        w.text("SubdBufferSize: " + std::to_string((int)(mSubdStats.GetOccupancy() * 100.0f)) + "%" + (mSubdStats.IsOverflowing() ? " (overflow)" : ""));
+    }
+
+    auto SnapshotGroup = Gui::Group(pGui, "Snapshot");
+    if (SnapshotGroup.open()) {
+        if (w.button("Save Snapshot")) {
+            std::vector<PrimitiveData> Keys = ReadBackSubdIn();
+            if (!Headless::SaveSubdSnapshot(SnapshotFileName, Keys.data(), Keys.size())) {
+                logWarning("Could not write " + SnapshotFileName);
+            }
+        }
+        if (w.button("Load Snapshot", true)) {
+            LoadSnapshot();
+            ResetSubdBuffers();
+        }
+        w.text(std::to_string(mWarmStartKeys.size()) + " warm start keys");
+    }
+
+    auto MeshExportGroup = Gui::Group(pGui, "Mesh Export");
+    if (MeshExportGroup.open()) {
+        w.checkbox("Export As OBJ", mAppConfig.ExportObj);
+        if (w.button("Export Mesh")) {
+            ExportMesh();
+        }
+        w.text(mMeshExportResult);
+    }
+
+    auto CameraPathGroup = Gui::Group(pGui, "Camera Path");
+    if (CameraPathGroup.open()) {
+        if (w.checkbox("Record Camera Path", mAppConfig.RecordCameraPath) && mAppConfig.RecordCameraPath) {
+            mCameraPath.Clear();
+            mCameraPathStartTime = gpFramework->getGlobalClock().now();
+            mAppConfig.PlayCameraPath = false;
+        }
+        if (w.checkbox("Play Camera Path", mAppConfig.PlayCameraPath) && mAppConfig.PlayCameraPath) {
+            mCameraPathStartTime = gpFramework->getGlobalClock().now();
+            mAppConfig.RecordCameraPath = false;
+        }
+        if (w.button("Save Camera Path")) {
+            if (!mCameraPath.Save(CameraPathFileName)) {
+                logWarning("Could not write " + CameraPathFileName);
+            }
+        }
+        if (w.button("Load Camera Path", true)) {
+            if (!mCameraPath.Load(CameraPathFileName)) {
+                logWarning("Could not read " + CameraPathFileName);
+            }
+        }
+        w.text(std::to_string(mCameraPath.GetKeys().size()) + " keys, " + std::to_string(mCameraPath.GetDuration()) + " s");
+    }
+
+    auto BenchmarkGroup = Gui::Group(pGui, "Benchmark");
+    if (BenchmarkGroup.open()) {
+        if (mBenchmarkRunning) {
+            w.text("Running " + mBenchmarkPaths[mBenchmarkPathIndex].Name + ", frame " + std::to_string(mBenchmarkFrame) + " of "
+                + std::to_string(mBenchmarkPaths[mBenchmarkPathIndex].GetFrameCount()));
+        }
+        else if (w.button("Run Benchmark")) {
+            StartBenchmark();
+        }
+        if (!mBenchmarkRunning && !mBenchmarkReport.Runs.empty() && w.button("Save As Baseline", true)) {
+            if (!Headless::SaveBenchmarkReport(BenchmarkBaselineFileName, mBenchmarkReport)) {
+                logWarning("Could not write " + BenchmarkBaselineFileName);
+            }
+        }
+        w.text(mBenchmarkResult);
     }
 
     gpFramework->getWindow()->setWindowTitle(ProjectName + " " +gpFramework->getFrameRate().getMsg());
@@ -62,81 +203,316 @@ void AdaptiveSubdivision::onLoad(RenderContext* pRenderContext)
         LoadLodKernel();
         LoadRenderKernel();
         LoadIndirectBatcherKernel();
+        LoadCompactionKernels();
         LoadBuffer();
+        LoadShaderPermutations();
     }
 }
 
 void AdaptiveSubdivision::LoadTexture() {
-    Texture::SharedPtr TempTexture = Texture::createFromFile(HeightMapName, false, true);
-    int w = TempTexture->getWidth();
-    int h = TempTexture->getHeight();
-    Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(HeightMapName, true);
-    uint16_t *texels = (uint16_t *)pBitmap->getData();
+    std::string HeightMapPath;
+    if (!findFileInDataDirectories(HeightMapName, HeightMapPath)) {
+        logError("Could not find " + HeightMapName);
+        return;
+    }
 
-    //Create Height Map
-    {
-        std::vector<uint16_t> dmap(w * h);
-        for (int j = 0; j < h; ++j) {
-            for (int i = 0; i < w; ++i) {
-                dmap[j*w + i] = texels[j*w + i];
-            }
+    // The heights and slopes upload straight from the mapped cache; the PNG is only decoded
+    // when the cache is missing or older than the heightmap. The cache stays mapped for
+    // ReloadSlopeMap.
+    Headless::HeightmapCache& Cache = mHeightMapCache;
+    Cache.Close();
+    mUncachedSlopes = Headless::SubdTexture();
+    if (!Cache.Open(HeightMapCacheFileName, HeightMapPath)) {
+        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(HeightMapPath, true);
+        int w = pBitmap->getWidth();
+        int h = pBitmap->getHeight();
+        const uint16_t *texels = (const uint16_t *)pBitmap->getData();
+        if (!Headless::WriteHeightmapCache(HeightMapCacheFileName, HeightMapPath, texels, w, h) || !Cache.Open(HeightMapCacheFileName, HeightMapPath)) {
+            logWarning("Could not write " + HeightMapCacheFileName);
+            mUncachedSlopes = Headless::CreateSlopeMap(texels, w, h);
+            mpHeightMap = Texture::create2D(w, h, ResourceFormat::R16Unorm, 1u, 4294967295u, texels);
+            LoadSlopeMap(mUncachedSlopes.Texels.data(), w, h);
+            LoadHeightBounds(texels, w, h);
+            LoadRoughness(texels, w, h);
+            return;
         }
-        mpHeightMap = Texture::create2D(w, h, ResourceFormat::R16Unorm, 1u, 4294967295u, &dmap[0]);
     }
 
-    //Create Slope Map
-    {
-        std::vector<float> smap(w * h * 2);
-        for (int j = 0; j < h; ++j) {
-            for (int i = 0; i < w; ++i) {
-                int i1 = std::max(0, i - 1);
-                int i2 = std::min(w - 1, i + 1);
-                int j1 = std::max(0, j - 1);
-                int j2 = std::min(h - 1, j + 1);
-                uint16_t px_l = texels[i1 + w * j];
-                uint16_t px_r = texels[i2 + w * j];
-                uint16_t px_b = texels[i + w * j1];
-                uint16_t px_t = texels[i + w * j2];
-                float z_l = (float)px_l / 65535.0f;
-                float z_r = (float)px_r / 65535.0f;
-                float z_b = (float)px_b / 65535.0f;
-                float z_t = (float)px_t / 65535.0f;
-                float slope_x = (float)w * 0.5f * (z_r - z_l);
-                float slope_y = (float)h * 0.5f * (z_t - z_b);
-
-                smap[2 * (i + w * j)] = slope_x;
-                smap[1 + 2 * (i + w * j)] = slope_y;
-            }
-        }
-        mpSlopeMap = Texture::create2D(w, h, ResourceFormat::RG32Float, 1u, 4294967295u, &smap[0]);
+    mpHeightMap = Texture::create2D(Cache.GetWidth(), Cache.GetHeight(), ResourceFormat::R16Unorm, 1u, 4294967295u, Cache.GetHeights());
+    LoadSlopeMap(Cache.GetSlopes(), Cache.GetWidth(), Cache.GetHeight());
+    LoadHeightBounds(Cache.GetHeights(), Cache.GetWidth(), Cache.GetHeight());
+    LoadRoughness(Cache.GetHeights(), Cache.GetWidth(), Cache.GetHeight());
+}
+
+// SlopeMapTexture in the "Slope Map Format", with the scale RenderKernel multiplies its
+// slopes by. "From Heightmap" creates none: SLOPE_FROM_HEIGHTMAP samples HeightMapTexture.
+// Every mip is encoded here: Falcor generates missing mips by rendering into the texture,
+// which a BC5 texture cannot be.
+void AdaptiveSubdivision::LoadSlopeMap(const float* inSlopes, uint32_t inWidth, uint32_t inHeight) {
+    mSlopeFormatActive = mAppConfig.SlopeMapFormat;
+    Headless::SlopeFormat Format = mSlopeFormatActive;
+    if (Format == Headless::SlopeFormat::BC5Snorm && (inWidth % 4 || inHeight % 4)) {
+        logWarning("BC5 needs a heightmap size that is a multiple of 4, using RG16Snorm");
+        Format = Headless::SlopeFormat::RG16Snorm;
+    }
+    std::vector<Headless::EncodedSlopeMap> Mips = Headless::EncodeSlopeMipChain(inSlopes, inWidth, inHeight, Format);
+    mpSlopeMap = nullptr;
+    mRenderKernelCB.SlopeScale = 1.0f;
+    if (Mips.empty()) {
+        return;
+    }
+    std::vector<uint8_t> MipChain;
+    for (const Headless::EncodedSlopeMap& Mip : Mips) {
+        MipChain.insert(MipChain.end(), Mip.Data.begin(), Mip.Data.end());
+    }
+    mRenderKernelCB.SlopeScale = Mips[0].Scale;
+    const ResourceFormat Formats[Headless::SlopeFormatCount] = { ResourceFormat::RG32Float, ResourceFormat::RG16Float, ResourceFormat::RG16Snorm, ResourceFormat::BC5Snorm };
+    mpSlopeMap = Texture::create2D(inWidth, inHeight, Formats[(uint32_t)Format], 1u, (uint32_t)Mips.size(), MipChain.data());
+}
+
+// A "Slope Map Format" change only re-encodes the slopes; the heights and their pyramids stay.
+void AdaptiveSubdivision::ReloadSlopeMap() {
+    if (mHeightMapCache.IsOpen()) {
+        LoadSlopeMap(mHeightMapCache.GetSlopes(), mHeightMapCache.GetWidth(), mHeightMapCache.GetHeight());
+    }
+    else if (!mUncachedSlopes.Texels.empty()) {
+        LoadSlopeMap(mUncachedSlopes.Texels.data(), mUncachedSlopes.Width, mUncachedSlopes.Height);
     }
 }
 
+// Min / max pyramid LodKernel culls displaced leaves against, one RG16Unorm mip per level.
+void AdaptiveSubdivision::LoadHeightBounds(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight) {
+    Headless::HeightBoundsPyramid Pyramid;
+    Pyramid.Build(inHeights, inWidth, inHeight);
+    std::vector<uint16_t> MipChain = Pyramid.GetMipChain();
+    mpHeightBounds = Texture::create2D(Pyramid.GetWidth(0), Pyramid.GetHeight(0), ResourceFormat::RG16Unorm, 1u, Pyramid.GetLevelCount(), MipChain.data());
+}
+
+// Max curvature pyramid for the "Roughness LOD" option, one R16Unorm mip per level.
+void AdaptiveSubdivision::LoadRoughness(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight) {
+    Headless::RoughnessPyramid Pyramid;
+    Pyramid.Build(inHeights, inWidth, inHeight);
+    std::vector<uint16_t> MipChain = Pyramid.GetMipChain();
+    mpRoughness = Texture::create2D(Pyramid.GetWidth(0), Pyramid.GetHeight(0), ResourceFormat::R16Unorm, 1u, Pyramid.GetLevelCount(), MipChain.data());
+}
+
 void AdaptiveSubdivision::LoadBuffer() {
     {
         mpSubdBuffer_0 = StructuredBuffer::create(mpLodKernelProgram.get(), "SubdIn", SubdBufferSize);
-        mpSubdBuffer_0->setBlob(InitSubdBuffer, 0, sizeof(InitSubdBuffer));
         mpSubdBuffer_1 = StructuredBuffer::create(mpLodKernelProgram.get(), "SubdOut", SubdBufferSize);
         mpSubdCulledBuffer = StructuredBuffer::create(mpLodKernelProgram.get(), "SubdCulledOut", SubdBufferSize);
-        mpSubdUV = StructuredBuffer::create(mpRenderKernelProgram.get(), "SubdInstanced", sizeof(SubdUVData) / sizeof(SubdUVData[0]));
-        mpSubdUV->setBlob(SubdUVData, 0, sizeof(SubdUVData));
+        mpSubdViewCulledBuffer = StructuredBuffer::create(mpLodKernelProgram.get(), "SubdViewCulledOut", (Headless::MaxLodViewCount - 1) * SubdBufferSize);
+        mpCompactionFlags = StructuredBuffer::create(mCompactionScatterKernel.mpComputeProgram.get(), "CompactionFlags", SubdBufferSize);
+        mpCompactionOffsets = StructuredBuffer::create(mCompactionScatterKernel.mpComputeProgram.get(), "CompactionOffsets", SubdBufferSize);
+        mpCompactionBlockSums = StructuredBuffer::create(mCompactionScatterKernel.mpComputeProgram.get(), "CompactionBlockSums", SubdBufferSize / CompactionBlockSize);
+        mpCbtTree = StructuredBuffer::create(mCbtSumReductionKernel.mpComputeProgram.get(), "CbtTree", 1u << (CbtMaxDepth - 5));
+        mpCbtBitfield_0 = StructuredBuffer::create(mCbtSumReductionKernel.mpComputeProgram.get(), "CbtBitfieldIn", 1u << (CbtMaxDepth - 5));
+        mpCbtBitfield_1 = StructuredBuffer::create(mCbtSumReductionKernel.mpComputeProgram.get(), "CbtBitfieldIn", 1u << (CbtMaxDepth - 5));
+        mpLeafVertices = StructuredBuffer::create(mLeafVertexKernel.mpComputeProgram.get(), "LeafVertices", SubdBufferSize);
+        mpLeafSortKeys_0 = StructuredBuffer::create(mLeafSortScatterKernel.mpComputeProgram.get(), "LeafSortKeysIn", SubdBufferSize);
+        mpLeafSortKeys_1 = StructuredBuffer::create(mLeafSortScatterKernel.mpComputeProgram.get(), "LeafSortKeysIn", SubdBufferSize);
+        mpLeafSortData = StructuredBuffer::create(mLeafSortScatterKernel.mpComputeProgram.get(), "LeafSortDataIn", SubdBufferSize);
+        mpLeafSortHistograms = StructuredBuffer::create(mLeafSortScatterKernel.mpComputeProgram.get(), "LeafSortHistograms",
+            (SubdBufferSize / Headless::LeafSortBlockSize + 1) * (1u << Headless::LeafSortRadixBits));
+        mpSubdState_0 = StructuredBuffer::create(mLodDirtyKernel.mpComputeProgram.get(), "SubdStateOut", SubdBufferSize);
+        mpSubdState_1 = StructuredBuffer::create(mLodDirtyKernel.mpComputeProgram.get(), "SubdStateOut", SubdBufferSize);
+        mpSubdDirty = StructuredBuffer::create(mLodDirtyKernel.mpComputeProgram.get(), "SubdDirty", SubdBufferSize);
+        mpSubdUV = StructuredBuffer::create(mpRenderKernelProgram.get(), "SubdInstanced", Headless::PatchGridSet::VertexCount);
+        mpSubdUV->setBlob(Headless::PatchGrids.Vertices, 0, sizeof(Headless::PatchGrids.Vertices));
     }
 
     {
-        mpVertexBuffer = TypedBuffer<float4>::create(4);
-        mpVertexBuffer->setBlob(VertexData, 0, sizeof(VertexData));
-        mpIndexBuffer = TypedBuffer<uint32>::create(6);
-        mpIndexBuffer->setBlob(IndexData, 0, sizeof(IndexData));
+        const Headless::KeyTransformTable &Table = Headless::KeyTransformTable::GetDefault();
+        const auto &Entries = Table.GetEntries();
+        mpKeyTransformTable = TypedBuffer<vec2>::create((uint32_t)Entries.size() * 3);
+        mpKeyTransformTable->setBlob(Entries.data(), 0, Entries.size() * sizeof(Entries[0]));
     }
 
     {
-        D3D12_DRAW_INDEXED_ARGUMENTS mdraw = { 192,0,0,0,0 };
-        mpIndirectDrawBuffer = Buffer::create(sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), Buffer::BindFlags::UnorderedAccess | Resource::BindFlags::IndirectArg, Buffer::CpuAccess::Read, &mdraw);
-        D3D12_DISPATCH_ARGUMENTS mdispatch = { 1,1,1 };
-        mpIndirectDispatchBuffer = Buffer::create(sizeof(D3D12_DISPATCH_ARGUMENTS), Buffer::BindFlags::UnorderedAccess | Resource::BindFlags::IndirectArg, Buffer::CpuAccess::Read, &mdispatch);
-        mpBufferCounter = Buffer::create(sizeof(uvec3), Buffer::BindFlags::UnorderedAccess, Buffer::CpuAccess::Read, nullptr);
-        mpBufferCounter->setBlob(&uvec3(0, 0, sizeof(InitSubdBuffer) / sizeof(InitSubdBuffer[0])), 0, sizeof(uvec3));
+        const Headless::PatchLevelOffset &Offset = Headless::PatchGrids.PatchLevelOffsets[mAppConfig.PatchLevel];
+        D3D12_DRAW_INDEXED_ARGUMENTS mdraw[Headless::MaxLodViewCount];
+        for (D3D12_DRAW_INDEXED_ARGUMENTS &Draw : mdraw) {
+            Draw = { Offset.IndexCountPerInstance,0,Offset.StartIndexLocation,Offset.BaseVertexLocation,0 };
+        }
+        mPatchLevelActive = mAppConfig.PatchLevel;
+        mpIndirectDrawBuffer = Buffer::create(sizeof(mdraw), Buffer::BindFlags::UnorderedAccess | Resource::BindFlags::IndirectArg, Buffer::CpuAccess::None, mdraw);
+        mpIndirectDispatchBuffer = Buffer::create(6 * sizeof(D3D12_DISPATCH_ARGUMENTS), Buffer::BindFlags::UnorderedAccess | Resource::BindFlags::IndirectArg, Buffer::CpuAccess::None, nullptr);
+        mpBufferCounter = Buffer::create(sizeof(SubdBufferCounter), Buffer::BindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr);
+        mReadbackBuffers.resize(mReadbackRing.GetSlotCount());
+        mConvergenceTimes.assign(mReadbackRing.GetSlotCount(), ConvergenceTime());
+        for (Buffer::SharedPtr &Readback : mReadbackBuffers) {
+            Readback = Buffer::create(sizeof(Headless::SubdReadback), Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+        }
     }
+
+    LoadSubdMesh();
+}
+
+// Uploads the quad or, with SubdivideModel, ModelFileName welded by LoadObjMesh, and restarts
+// the subdivision from its root keys, or the snapshot for the quad.
+void AdaptiveSubdivision::LoadSubdMesh() {
+    mSubdModelActive = mAppConfig.SubdivideModel;
+    mSubdMesh = Headless::SubdMesh::CreateQuad();
+    if (mSubdModelActive) {
+        std::string ModelPath;
+        Headless::SubdMesh Model;
+        Headless::ObjLoadStats Stats;
+        if (!findFileInDataDirectories(ModelFileName, ModelPath) || !Headless::LoadObjMesh(ModelPath, Model, Headless::ObjLoadConfig(), &Stats)) {
+            logWarning("Could not load " + ModelFileName);
+        } else if (2 * (size_t)Model.GetPrimitiveCount() > SubdBufferSize) {
+            logWarning(ModelFileName + " has more root keys than SubdBufferSize");
+        } else {
+            logInfo(ModelFileName + ": " + std::to_string(Stats.VertexCount) + " vertices, " + std::to_string(Stats.TriangleCount) + " triangles");
+            mSubdMesh = std::move(Model);
+        }
+    }
+
+    mpVertexBuffer = TypedBuffer<float4>::create((uint32_t)mSubdMesh.VertexData.size());
+    mpVertexBuffer->setBlob(mSubdMesh.VertexData.data(), 0, mSubdMesh.VertexData.size() * sizeof(float4));
+    mpIndexBuffer = TypedBuffer<uint32>::create((uint32_t)mSubdMesh.IndexData.size());
+    mpIndexBuffer->setBlob(mSubdMesh.IndexData.data(), 0, mSubdMesh.IndexData.size() * sizeof(uint32_t));
+    mLeafSortBounds = Headless::GetLeafSortBounds(mSubdMesh);
+
+    LoadSnapshot();
+    ResetSubdBuffers();
+}
+
+// Keys of SnapshotFileName become the starting point of ResetSubdBuffers; without a
+// (valid) snapshot the subdivision starts from the root keys of mSubdMesh. Snapshots are
+// taken on the quad, so a subdivided model always starts from its roots.
+//
+// Both storages take the keys as they are, so a snapshot that does not fit them is dropped
+// whole: more keys than SubdBuffer holds, a primitive mSubdMesh lacks, or a key deeper than
+// the CBT addresses (a truncated or collapsed set would no longer cover the mesh).
+void AdaptiveSubdivision::LoadSnapshot() {
+    mWarmStartKeys.clear();
+    if (mSubdModelActive) {
+        return;
+    }
+    std::vector<PrimitiveData> Keys;
+    if (!Headless::LoadSubdSnapshot(SnapshotFileName, Keys)) {
+        return;
+    }
+    if (Keys.size() > SubdBufferSize) {
+        logWarning(SnapshotFileName + " holds more keys than SubdBuffer, starting from the root keys");
+        return;
+    }
+    const uint32_t PrimitiveCount = mSubdMesh.GetPrimitiveCount();
+    const int MaxKeyDepth = (int)(CbtMaxDepth - Headless::GetPrimitiveBits(PrimitiveCount));
+    for (const PrimitiveData& Key : Keys) {
+        int Depth = Headless::firstbithigh(Key.SubdBinaryKey);
+        if (Key.PrimitiveIndex >= PrimitiveCount || Depth < 0 || Depth > MaxKeyDepth) {
+            logWarning(SnapshotFileName + " does not match the mesh or the CBT depth, starting from the root keys");
+            return;
+        }
+    }
+    mWarmStartKeys.swap(Keys);
+}
+
+// The keys the next LodKernel reads: SubdIn and its count, or the leaves of the current CBT bitfield.
+std::vector<PrimitiveData> AdaptiveSubdivision::ReadBackSubdIn() {
+    RenderContext* pRenderContext = gpDevice->getRenderContext();
+    if (mAppConfig.CbtStorage) {
+        StructuredBuffer::SharedPtr Bitfield = Pingping ? mpCbtBitfield_0 : mpCbtBitfield_1;
+        Buffer::SharedPtr Staging = Buffer::create(Bitfield->getSize(), Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+        pRenderContext->copyResource(Staging.get(), Bitfield.get());
+        pRenderContext->flush(true);
+        Headless::SubdCbtEngine Cbt(mSubdMesh, CbtMaxDepth);
+        Cbt.LoadBitfield((const uint32_t*)Staging->map(Buffer::MapType::Read));
+        Staging->unmap();
+        return Cbt.GetLeaves();
+    }
+
+    StructuredBuffer::SharedPtr SubdIn = Pingping ? mpSubdBuffer_0 : mpSubdBuffer_1;
+    Buffer::SharedPtr Staging = Buffer::create(SubdIn->getSize(), Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+    pRenderContext->copyResource(Staging.get(), SubdIn.get());
+    Buffer::SharedPtr CounterStaging = Buffer::create(sizeof(SubdBufferCounter), Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+    pRenderContext->copyResource(CounterStaging.get(), mpBufferCounter.get());
+    pRenderContext->flush(true);
+    const SubdBufferCounter* Counter = (const SubdBufferCounter*)CounterStaging->map(Buffer::MapType::Read);
+    size_t Count = std::min<size_t>(Counter->SubdInCount, SubdBufferSize);
+    CounterStaging->unmap();
+    const PrimitiveData* Data = (const PrimitiveData*)Staging->map(Buffer::MapType::Read);
+    std::vector<PrimitiveData> Keys(Data, Data + Count);
+    Staging->unmap();
+    return Keys;
+}
+
+// Writes the SubdIn leaves as the triangles RenderKernel draws them, to MeshExportFileName or
+// MeshExportObjFileName. The heights and the RG32Float slopes come from HeightMapCacheFileName,
+// so a compressed "Slope Map Format" exports the positions of the reference slopes.
+void AdaptiveSubdivision::ExportMesh() {
+    std::vector<PrimitiveData> Keys = ReadBackSubdIn();
+    Headless::MeshExportConfig Config;
+    Config.Render.Mesh = &mSubdMesh;
+    Config.Render.DisplacementFactor = mAppConfig.DisplacementFactor;
+    Config.Render.PhongTessellation = mAppConfig.TM == TessellationMode::Phong && !mSubdModelActive;
+    Config.Render.TransformTable = mAppConfig.KeyTransformTable ? &Headless::KeyTransformTable::GetDefault() : nullptr;
+    Config.PatchLevel = mPatchLevelActive;
+    Config.Format = mAppConfig.ExportObj ? Headless::MeshExportFormat::Obj : Headless::MeshExportFormat::Binary;
+
+    Headless::SubdTexture HeightMap;
+    Headless::SubdTexture SlopeMap;
+    if (!mSubdModelActive && (mAppConfig.Displace || Config.Render.PhongTessellation)) {
+        Headless::HeightmapCache Cache;
+        if (!Cache.Open(HeightMapCacheFileName)) {
+            mMeshExportResult = "Could not read " + HeightMapCacheFileName;
+            logWarning(mMeshExportResult);
+            return;
+        }
+        HeightMap = Headless::CreateHeightMap(Cache.GetHeights(), Cache.GetWidth(), Cache.GetHeight());
+        SlopeMap.Width = Cache.GetWidth();
+        SlopeMap.Height = Cache.GetHeight();
+        SlopeMap.ChannelCount = 2;
+        SlopeMap.Texels.assign(Cache.GetSlopes(), Cache.GetSlopes() + (size_t)SlopeMap.Width * SlopeMap.Height * 2);
+        Config.HeightMap = mAppConfig.Displace ? &HeightMap : nullptr;
+        Config.Render.SlopeMap = &SlopeMap;
+        Config.Render.SlopeHeightMap = mSlopeFormatActive == Headless::SlopeFormat::HeightMap ? &HeightMap : nullptr;
+    }
+
+    const std::string& Path = mAppConfig.ExportObj ? MeshExportObjFileName : MeshExportFileName;
+    Headless::MeshExportStats Stats;
+    if (!Headless::ExportSubdMesh(Path, Keys.data(), (uint32_t)Keys.size(), Config, &Stats)) {
+        mMeshExportResult = "Could not write " + Path;
+        logWarning(mMeshExportResult);
+        return;
+    }
+    mMeshExportResult = Path + ": " + std::to_string(Stats.TriangleCount) + " triangles, " + std::to_string(Stats.VertexCount) + " vertices in "
+        + std::to_string((int)Stats.TotalMs) + " ms";
+}
+
+// Restarts the subdivision from the warm start keys or the root keys of mSubdMesh, in the ping-pong buffers or in the CBT.
+void AdaptiveSubdivision::ResetSubdBuffers() {
+    std::vector<PrimitiveData> InitData = mWarmStartKeys;
+    if (InitData.empty()) {
+        InitData = mSubdMesh.CreateRootKeys();
+    }
+
+    Pingping = true;
+    mpSubdBuffer_0->setBlob(InitData.data(), 0, InitData.size() * sizeof(PrimitiveData));
+
+    {
+        mCbtPrimitiveBits = Headless::GetPrimitiveBits(mSubdMesh.GetPrimitiveCount());
+        Headless::SubdCbtEngine Cbt(mSubdMesh, CbtMaxDepth);
+        Cbt.LoadBuffer(InitData);
+        const auto &TreeWords = Cbt.GetTree().GetTreeWords();
+        const auto &BitfieldWords = Cbt.GetTree().GetBitfieldWords();
+        mpCbtTree->setBlob(TreeWords.data(), 0, TreeWords.size() * sizeof(uint32_t));
+        mpCbtBitfield_0->setBlob(BitfieldWords.data(), 0, BitfieldWords.size() * sizeof(uint32_t));
+    }
+
+    // [0] LodKernel / CompactionScatterKernel, [1] CompactionScanBlockKernel, [2] CbtClearKernel, [3] LeafVertexKernel,
+    // [4] LodDirtyKernel, [5] the leaf sort kernels.
+    D3D12_DISPATCH_ARGUMENTS mdispatch[6] = { { 1,1,1 },{ 1,1,1 },{ (1u << (CbtMaxDepth - 5)) / 256u,1,1 },{ 1,1,1 },{ 1,1,1 },{ 1,1,1 } };
+    mpIndirectDispatchBuffer->setBlob(mdispatch, 0, sizeof(mdispatch));
+    // No slack: IncrementalLod evaluates every new key in its first pass, whenever the
+    // reset lands in the frame.
+    std::vector<LeafLodState> InitState(InitData.size(), LeafLodState());
+    mpSubdState_0->setBlob(InitState.data(), 0, InitState.size() * sizeof(LeafLodState));
+    SubdBufferCounter Counter;
+    Counter.SubdInCount = (uint32_t)InitData.size();
+    mpBufferCounter->setBlob(&Counter, 0, sizeof(Counter));
+    mCbtStorageActive = mAppConfig.CbtStorage;
 }
 
 void AdaptiveSubdivision::LoadLodKernel() {
@@ -175,7 +551,7 @@ void AdaptiveSubdivision::LoadRenderKernel() {
 
     // create VAO
     {
-        mpPerInstancedIndex = Buffer::create(sizeof(Indexes), Resource::BindFlags::Index | ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, &Indexes);
+        mpPerInstancedIndex = Buffer::create(sizeof(Headless::PatchGrids.Indices), Resource::BindFlags::Index | ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, Headless::PatchGrids.Indices);
         Vao::SharedPtr TempVao = Vao::create(Vao::Topology::TriangleList, nullptr, Vao::BufferVec(), mpPerInstancedIndex, ResourceFormat::R16Uint);
         mpRenderKernelState->setVao(TempVao);
     }
@@ -200,6 +576,37 @@ void AdaptiveSubdivision::LoadIndirectBatcherKernel() {
     mpIndirectBatcherKernelState->setProgram(mpIndirectBatcherKernelProgram);
 }
 
+void AdaptiveSubdivision::LoadComputeKernel(ComputeShaderUtils &outKernel, const std::string &inEntryName) {
+#ifdef DEBUG
+    outKernel.mpComputeProgram = ComputeProgram::createFromFile("AdaptiveSubdivision.hlsl", inEntryName, Program::DefineList(), Shader::CompilerFlags::GenerateDebugInfo);
+#else
+    outKernel.mpComputeProgram = ComputeProgram::createFromFile("AdaptiveSubdivision.hlsl", inEntryName);
+#endif
+    outKernel.mpComputeVars = ComputeVars::create(outKernel.mpComputeProgram->getReflector());
+    outKernel.mpComputeState = ComputeState::create();
+    outKernel.mpComputeState->setProgram(outKernel.mpComputeProgram);
+}
+
+void AdaptiveSubdivision::LoadCompactionKernels() {
+    LoadComputeKernel(mCompactionScanBlockKernel, "CompactionScanBlockKernel");
+    LoadComputeKernel(mCompactionScanBlockSumsKernel, "CompactionScanBlockSumsKernel");
+    LoadComputeKernel(mCompactionScatterKernel, "CompactionScatterKernel");
+    LoadComputeKernel(mCbtSumReductionKernel, "CbtSumReductionKernel");
+    LoadComputeKernel(mCbtClearKernel, "CbtClearKernel");
+    LoadComputeKernel(mConvergenceResetKernel, "ConvergenceResetKernel");
+    LoadComputeKernel(mLeafVertexKernel, "LeafVertexKernel");
+    LoadComputeKernel(mHiZBuildKernel, "HiZBuildKernel");
+    LoadComputeKernel(mDirtyBatcherKernel, "DirtyBatcherKernel");
+    LoadComputeKernel(mLodDirtyKernel, "LodDirtyKernel");
+    LoadComputeKernel(mLeafSortKeyKernel, "LeafSortKeyKernel");
+    LoadComputeKernel(mLeafSortHistogramKernel, "LeafSortHistogramKernel");
+    LoadComputeKernel(mLeafSortScanKernel, "LeafSortScanKernel");
+    LoadComputeKernel(mLeafSortScatterKernel, "LeafSortScatterKernel");
+    mLeafVertexKernel.mpComputeVars->setConstantBuffer("RenderKernelCB", mpRenderKernelCB);
+    mLodDirtyKernel.mpComputeVars->setConstantBuffer("LodKernelCB", mpLodKernelCB);
+    mpConvergenceTimer = GpuTimer::create();
+}
+
 void AdaptiveSubdivision::RenderModel(RenderContext* pRenderContext, const Fbo::SharedPtr& pTargetFbo,ModelRendererElements &inModelRendererElements) {
     if (mpScene)
     {
@@ -214,84 +621,619 @@ void AdaptiveSubdivision::onFrameRender(RenderContext* pRenderContext, const Fbo
     const vec4 ClearColor(0.3f, 0.3f, 0.3f, 1);
     pRenderContext->clearFbo(pTargetFbo.get(), ClearColor, 1.0f, 0, FboAttachmentType::All);
 
+    if (mBenchmarkRunning) {
+        UpdateBenchmark();
+    }
+    else {
+        UpdateCameraPath();
+    }
     mpScene->update(pRenderContext, gpFramework->getGlobalClock().now());
     if (mAppConfig.RenderSuzanne) {
         RenderModel(pRenderContext, pTargetFbo, mSuzanneModelRenderer);
     }
 
-    //Setup Defines
-    {
-        mAppConfig.FreezeSubd ? mpLodKernelProgram->addDefine("FREEZE_SUBDIVISION") : mpLodKernelProgram->removeDefine("FREEZE_SUBDIVISION");
-        mAppConfig.EnableCulling ? mpLodKernelProgram->addDefine("FRUSTUM_CULLING") : mpLodKernelProgram->removeDefine("FRUSTUM_CULLING");
-        mAppConfig.Wireframe ? mpRenderKernelState->setRasterizerState(RasterizerStateGroup["WireframeNoneCull"]) : mpRenderKernelState->setRasterizerState(RasterizerStateGroup["SolidNoneCull"]);
-        mAppConfig.Displace ? mpLodKernelProgram->addDefine("DISPLACE") : mpLodKernelProgram->removeDefine("DISPLACE");
-        mAppConfig.Displace ? mpRenderKernelProgram->addDefine("DISPLACE") : mpRenderKernelProgram->removeDefine("DISPLACE");
-
-        mpRenderKernelProgram->removeDefine("SHADING_LOD");
-        mpRenderKernelProgram->removeDefine("SHADING_DIFFUSE");
-        mpRenderKernelProgram->removeDefine("SHADING_NORMAL");
-        if (mAppConfig.SM == ShadingMode::Lod) {
-            mpRenderKernelProgram->addDefine("SHADING_LOD");
-        }
-        else if (mAppConfig.SM == ShadingMode::Diffuse) {
-            mpRenderKernelProgram->addDefine("SHADING_DIFFUSE");
-        }
-        else if (mAppConfig.SM == ShadingMode::Normal) {
-            mpRenderKernelProgram->addDefine("SHADING_NORMAL");
-        }
+    mAppConfig.Wireframe ? mpRenderKernelState->setRasterizerState(RasterizerStateGroup["WireframeNoneCull"]) : mpRenderKernelState->setRasterizerState(RasterizerStateGroup["SolidNoneCull"]);
+    ApplyShaderPermutations();
+    WarmUpShaderPermutation();
 
-        if (mAppConfig.TM == TessellationMode::Phong) {
-            mpRenderKernelProgram->addDefine("PHONG_TESSELLATION");
-        }
-        else if(mAppConfig.TM == TessellationMode::None){
-            mpRenderKernelProgram->removeDefine("PHONG_TESSELLATION");
-        }
+    float TargetPixelSize = mAppConfig.TargetPixelSize;
+    if (mAppConfig.EnableBudget) {
+        Headless::SubdBudgetConfig BudgetConfig = mBudgetGovernor.GetConfig();
+        BudgetConfig.LeafBudget = (uint32_t)std::max(mAppConfig.LeafBudget, 0);
+        BudgetConfig.FrameTimeBudgetMs = mAppConfig.FrameTimeBudgetMs;
+        mBudgetGovernor.SetConfig(BudgetConfig);
+        // The frame time is the CPU-side average and includes vsync: a time budget only bites
+        // when it is below the refresh interval or the frame rate drops under it.
+        TargetPixelSize = mBudgetGovernor.Update(mReadbackFrame, mAppConfig.TargetPixelSize, mSubdStats, (float)gpFramework->getFrameRate().getAverageFrameTime());
     }
-
-    mLodKernelCB.TargetPixelSize = mAppConfig.TargetPixelSize;
+    mLodKernelCB.TargetPixelSize = Headless::GetPatchTargetPixelSize(TargetPixelSize, mAppConfig.PatchLevel);
     mLodKernelCB.DisplacementFactor = mRenderKernelCB.DisplacementFactor = mAppConfig.DisplacementFactor;
+    // MultiView: the extra views stand in for a second eye or another split-screen player, the
+    // camera shifted sideways by ViewSpacing per view. LodKernel splits for all of them and culls
+    // their leaves into SubdViewCulledOut; only the camera is drawn.
+    const Camera::SharedPtr &pCamera = mpScene->getCamera();
+    const vec3& CameraPosW = pCamera->getPosition();
+    vec3 Right = glm::normalize(glm::cross(pCamera->getTarget() - CameraPosW, pCamera->getUpVector()));
+    uint32_t ViewCount = mAppConfig.MultiView ? 1 + (uint32_t)glm::clamp(mAppConfig.ExtraViewCount, 1, (int)Headless::MaxLodViewCount - 1) : 1;
+    Headless::SubdView Views[Headless::MaxLodViewCount];
+    for (uint32_t View = 0; View < ViewCount; ++View) {
+        vec3 Offset = Right * (mAppConfig.ViewSpacing * View);
+        glm::mat4 ViewProj = pCamera->getViewProjMatrix() * glm::translate(glm::mat4(1.0f), -Offset);
+        for (int i = 0; i < 4; ++i) {
+            Views[View].Camera.ViewProjMat[i] = Headless::float4(ViewProj[i][0], ViewProj[i][1], ViewProj[i][2], ViewProj[i][3]);
+        }
+        Views[View].Camera.PosW = Headless::float3(CameraPosW.x + Offset.x, CameraPosW.y + Offset.y, CameraPosW.z + Offset.z);
+        Views[View].FovX = mLodKernelCB.FovX;
+        Views[View].ScreenResolutionWidth = mLodKernelCB.ScreenResolutionWidth;
+    }
+    const Headless::float4x4& ViewProjMat = Views[0].Camera.ViewProjMat;
+    Headless::SetLodViews(mLodKernelCB, Views, ViewCount);
+    Headless::SetHiZView(mLodKernelCB, mHiZViewProjMat, mHiZSourceSize.x, mHiZSourceSize.y);
+    Headless::SetRoughnessLod(mLodKernelCB, mAppConfig.MaxScreenError, mAppConfig.MaxLodOffset, mpHeightMap->getWidth(), mAppConfig.PatchLevel);
+    mLodTravelTracker.SetCameraTravel(mLodKernelCB, Headless::float3(CameraPosW.x, CameraPosW.y, CameraPosW.z));
+    if (mSlopeFormatActive != mAppConfig.SlopeMapFormat) {
+        ReloadSlopeMap();
+    }
     mpLodKernelCB->setBlob(&mLodKernelCB, 0, sizeof(LodKernelConfig));
     mpRenderKernelCB->setBlob(&mRenderKernelCB, 0, sizeof(RenderKernelConfig));
 
+    if (mSubdModelActive != mAppConfig.SubdivideModel) {
+        LoadSubdMesh();
+    }
+    else if (mCbtStorageActive != mAppConfig.CbtStorage) {
+        ResetSubdBuffers();
+    }
+    if (mPatchLevelActive != (uint32_t)mAppConfig.PatchLevel) {
+        SetPatchLevel(mAppConfig.PatchLevel);
+    }
+
     if (!mAppConfig.OnlyRender) {
-        //LodKernel
-        mpLodKernelVars->setParameterBlock("gScene", mpScene->getParameterBlock());
-        mpLodKernelVars->setStructuredBuffer("SubdIn", (Pingping ? mpSubdBuffer_0 : mpSubdBuffer_1));
-        mpLodKernelVars->setStructuredBuffer("SubdOut", (Pingping ? mpSubdBuffer_1 : mpSubdBuffer_0));
-        mpLodKernelVars->setTypedBuffer("VertexBuffer", mpVertexBuffer);
-        mpLodKernelVars->setTypedBuffer("IndexBuffer", mpIndexBuffer);
-        mpLodKernelVars->setStructuredBuffer("SubdCulledOut", mpSubdCulledBuffer);
-        mpLodKernelVars->setRawBuffer("IndirectDrawBuffer", mpIndirectDrawBuffer);
-        mpLodKernelVars->setRawBuffer("IndirectDispatchBuffer", mpIndirectDispatchBuffer);
-        mpLodKernelVars->setRawBuffer("BufferCounter", mpBufferCounter);
-        pRenderContext->dispatchIndirect(mpLodKernelState.get(), mpLodKernelVars.get(), mpIndirectDispatchBuffer.get(), 0);
-
-        //IndirectBatcherKernel
-        mpIndirectBatcherKernelVars->setRawBuffer("IndirectDrawBuffer", mpIndirectDrawBuffer);
-        mpIndirectBatcherKernelVars->setRawBuffer("IndirectDispatchBuffer", mpIndirectDispatchBuffer);
-        mpIndirectBatcherKernelVars->setRawBuffer("BufferCounter", mpBufferCounter);
-        pRenderContext->dispatch(mpIndirectBatcherKernelState.get(), mpIndirectBatcherKernelVars.get(), uvec3(1, 1, 1));
+        int PassCount = GetConvergencePassCount();
+
+        //ConvergenceResetKernel
+        ComputeVars::SharedPtr ResetVars = mConvergenceResetKernel.mpComputeVars;
+        ResetVars->setRawBuffer("IndirectDispatchBuffer", mpIndirectDispatchBuffer);
+        ResetVars->setRawBuffer("BufferCounter", mpBufferCounter);
+        ResetVars->setStructuredBuffer("CbtTree", mpCbtTree);
+        pRenderContext->dispatch(mConvergenceResetKernel.mpComputeState.get(), ResetVars.get(), uvec3(1, 1, 1));
+
+        mpConvergenceTimer->begin();
+        for (int Pass = 0; Pass < PassCount; ++Pass) {
+            RunSubdivisionPass(pRenderContext);
+            Pingping = !Pingping;
+        }
+        mpConvergenceTimer->end();
+        mConvergenceTimed = true;
+        mConvergenceTimedFrame = mReadbackFrame;
     }
 
+    // A list RenderKernel drew last frame is sorted already.
+    if (mAppConfig.SortLeaves && !mAppConfig.OnlyRender) {
+        SortLeaves(pRenderContext);
+    }
+
+    //LeafVertexKernel
+    if (mAppConfig.LeafVertexPrepass) {
+        ComputeVars::SharedPtr LeafVertexVars = mLeafVertexKernel.mpComputeVars;
+        LeafVertexVars->setTexture("SlopeMapTexture", mpSlopeMap);
+        LeafVertexVars->setSampler("SlopeMapSampler", SamplerGroup["Linear"]);
+        LeafVertexVars->setTexture("HeightMapTexture", mpHeightMap);
+        LeafVertexVars->setSampler("HeightMapSampler", SamplerGroup["Linear"]);
+        LeafVertexVars->setStructuredBuffer("SubdCulledOut", mpSubdCulledBuffer);
+        LeafVertexVars->setStructuredBuffer("LeafVertices", mpLeafVertices);
+        LeafVertexVars->setTypedBuffer("VertexBuffer", mpVertexBuffer);
+        LeafVertexVars->setTypedBuffer("IndexBuffer", mpIndexBuffer);
+        LeafVertexVars->setTypedBuffer("KeyTransformTable", mpKeyTransformTable);
+        LeafVertexVars->setRawBuffer("IndirectDrawBuffer", mpIndirectDrawBuffer);
+        pRenderContext->dispatchIndirect(mLeafVertexKernel.mpComputeState.get(), LeafVertexVars.get(), mpIndirectDispatchBuffer.get(), 3 * sizeof(D3D12_DISPATCH_ARGUMENTS));
+    }
+
+    UpdateSubdStats(pRenderContext);
+
     //RenderKernel
-    pRenderContext->flush();
     mpRenderKernelVars->setTexture("HeightMapTexture", mpHeightMap);
     mpRenderKernelVars->setTexture("SlopeMapTexture", mpSlopeMap);
     mpRenderKernelVars->setSampler("HeightMapSampler", SamplerGroup["Linear"]);
     mpRenderKernelVars->setSampler("SlopeMapSampler", SamplerGroup["Linear"]);
     mpRenderKernelVars->setStructuredBuffer("SubdInstanced", mpSubdUV);
     mpRenderKernelVars->setStructuredBuffer("SubdIn", mpSubdCulledBuffer);
+    mpRenderKernelVars->setStructuredBuffer("LeafVertices", mpLeafVertices);
     mpRenderKernelVars->setTypedBuffer("VertexBuffer", mpVertexBuffer);
     mpRenderKernelVars->setTypedBuffer("IndexBuffer", mpIndexBuffer);
+    mpRenderKernelVars->setTypedBuffer("KeyTransformTable", mpKeyTransformTable);
     mpRenderKernelVars->setParameterBlock("gScene", mpScene->getParameterBlock());
     mpRenderKernelState->setFbo(pTargetFbo);
+    if (mBenchmarkRunning) {
+        mRenderKernelTimer.Begin();
+    }
     pRenderContext->drawIndexedIndirect(mpRenderKernelState.get(), mpRenderKernelVars.get(), 1, mpIndirectDrawBuffer.get(), 0, nullptr, 0);
+    if (mBenchmarkRunning) {
+        mRenderKernelTimer.End();
+    }
+
+    if (mAppConfig.OcclusionCulling && mAppConfig.EnableCulling) {
+        BuildHiZ(pRenderContext, pTargetFbo, ViewProjMat);
+    }
+    else {
+        mHiZSourceSize = uvec2(0, 0);
+    }
+}
+
+// Reduces this frame's depth into mpHiZ, one HiZBuildKernel dispatch per mip, for the
+// LodKernel passes of the next frame. Leaves that were hidden last frame are culled, so a
+// disoccluded leaf shows up one frame late.
+void AdaptiveSubdivision::BuildHiZ(RenderContext* pRenderContext, const Fbo::SharedPtr& pTargetFbo, const Headless::float4x4& inViewProjMat) {
+    const Texture::SharedPtr& pDepth = pTargetFbo->getDepthStencilTexture();
+    uint32_t Width = std::max(pDepth->getWidth() / 2, 1u);
+    uint32_t Height = std::max(pDepth->getHeight() / 2, 1u);
+    if (!mpHiZ || mpHiZ->getWidth() != Width || mpHiZ->getHeight() != Height) {
+        mpHiZ = Texture::create2D(Width, Height, ResourceFormat::R32Float, 1u, Texture::kMaxPossible, nullptr,
+            Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess);
+    }
+
+    ComputeVars::SharedPtr HiZVars = mHiZBuildKernel.mpComputeVars;
+    uvec2 InSize(pDepth->getWidth(), pDepth->getHeight());
+    for (uint32_t Mip = 0; Mip < mpHiZ->getMipCount(); ++Mip) {
+        uvec2 OutSize(mpHiZ->getWidth(Mip), mpHiZ->getHeight(Mip));
+        HiZVars["HiZIn"].setSrv(Mip == 0 ? pDepth->getSRV() : mpHiZ->getSRV(Mip - 1, 1, 0, 1));
+        HiZVars["HiZOut"].setUav(mpHiZ->getUAV(Mip, 0, 1));
+        HiZVars["HiZBuildCB"]["HiZInSize"] = InSize;
+        HiZVars["HiZBuildCB"]["HiZOutSize"] = OutSize;
+        pRenderContext->dispatch(mHiZBuildKernel.mpComputeState.get(), HiZVars.get(), uvec3((OutSize.x + 7) / 8, (OutSize.y + 7) / 8, 1));
+        InSize = OutSize;
+    }
+    mHiZViewProjMat = inViewProjMat;
+    mHiZSourceSize = uvec2(pDepth->getWidth(), pDepth->getHeight());
+}
+
+// Points the indirect draws of every view at another patch of PatchGrids; the instance counts
+// IndirectBatcherKernel writes are left alone. Leaves follow over the next frames through the
+// scaled TargetPixelSize.
+void AdaptiveSubdivision::SetPatchLevel(uint32_t inPatchLevel) {
+    const Headless::PatchLevelOffset &Offset = Headless::PatchGrids.PatchLevelOffsets[inPatchLevel];
+    uint32_t Location[2] = { Offset.StartIndexLocation, (uint32_t)Offset.BaseVertexLocation };
+    for (uint32_t View = 0; View < Headless::MaxLodViewCount; ++View) {
+        size_t Record = View * sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+        mpIndirectDrawBuffer->setBlob(&Offset.IndexCountPerInstance, Record + offsetof(D3D12_DRAW_INDEXED_ARGUMENTS, IndexCountPerInstance), sizeof(uint32_t));
+        mpIndirectDrawBuffer->setBlob(Location, Record + offsetof(D3D12_DRAW_INDEXED_ARGUMENTS, StartIndexLocation), sizeof(Location));
+    }
+    mPatchLevelActive = inPatchLevel;
+}
+
+// Records the camera ten times a second, or drives it from the path in a loop. The saved
+// path replays headless in TerrainStreamBench.
+void AdaptiveSubdivision::UpdateCameraPath() {
+    float Time = (float)(gpFramework->getGlobalClock().now() - mCameraPathStartTime);
+    const Camera::SharedPtr &pCamera = mpScene->getCamera();
+    if (mAppConfig.RecordCameraPath) {
+        if (mCameraPath.IsEmpty() || Time - mCameraPath.GetKeys().back().Time >= 0.1f) {
+            Headless::CameraPathKey Key;
+            Key.Time = Time;
+            Key.PosW = Headless::float3(pCamera->getPosition().x, pCamera->getPosition().y, pCamera->getPosition().z);
+            Key.Target = Headless::float3(pCamera->getTarget().x, pCamera->getTarget().y, pCamera->getTarget().z);
+            Key.Up = Headless::float3(pCamera->getUpVector().x, pCamera->getUpVector().y, pCamera->getUpVector().z);
+            mCameraPath.AddKey(Key);
+        }
+    }
+    else if (mAppConfig.PlayCameraPath && mCameraPath.GetDuration() > 0.0f) {
+        Headless::CameraPathKey Key = mCameraPath.Evaluate(std::fmod(Time, mCameraPath.GetDuration()));
+        pCamera->setPosition(vec3(Key.PosW.x, Key.PosW.y, Key.PosW.z));
+        pCamera->setTarget(vec3(Key.Target.x, Key.Target.y, Key.Target.z));
+        pCamera->setUpVector(vec3(Key.Up.x, Key.Up.y, Key.Up.z));
+    }
+}
 
-    Pingping = !Pingping;
+void AdaptiveSubdivision::StartBenchmark() {
+    mBenchmarkPaths = Headless::GetBenchmarkPaths();
+    mBenchmarkReport = Headless::BenchmarkReport();
+    mBenchmarkReport.Source = "AdaptiveSubdivision";
+    mBenchmarkResult.clear();
+    mAppConfig.RecordCameraPath = mAppConfig.PlayCameraPath = false;
+    mBenchmarkRunning = true;
+    mBenchmarkPathIndex = 0;
+    StartBenchmarkPath();
+}
+
+// Subdivides the terrain or the model from its start keys; LoadSubdMesh resets the buffers
+// itself when onFrameRender sees SubdivideModel change.
+void AdaptiveSubdivision::StartBenchmarkPath() {
+    const Headless::BenchmarkPath& Path = mBenchmarkPaths[mBenchmarkPathIndex];
+    Headless::BenchmarkRun Run;
+    Run.Name = Path.Name;
+    Run.Frames.resize(Path.GetFrameCount());
+    mBenchmarkReport.Runs.push_back(std::move(Run));
+    mAppConfig.SubdivideModel = Path.Model;
+    if (mSubdModelActive == mAppConfig.SubdivideModel) {
+        ResetSubdBuffers();
+    }
+    mBenchmarkFrame = 0;
+    mBenchmarkReadbackStart = mReadbackFrame;
+}
+
+// Files the times of the last frame and the stats of the readback that just arrived under
+// their benchmark frames, then moves the camera to the next frame of the path.
+void AdaptiveSubdivision::UpdateBenchmark() {
+    Headless::BenchmarkRun& Run = mBenchmarkReport.Runs.back();
+    double LodKernelMs = mLodKernelTimer.Resolve();
+    double IndirectBatcherMs = mIndirectBatcherTimer.Resolve();
+    double RenderMs = mRenderKernelTimer.Resolve();
+    if (mBenchmarkFrame > 0 && mBenchmarkFrame <= Run.Frames.size()) {
+        Headless::BenchmarkFrame& Frame = Run.Frames[mBenchmarkFrame - 1];
+        Frame.LodKernelMs = (float)LodKernelMs;
+        Frame.IndirectBatcherKernelMs = (float)IndirectBatcherMs;
+        Frame.RenderMs = (float)RenderMs;
+    }
+    if (mSubdStats.Frame >= mBenchmarkReadbackStart && mSubdStats.Frame - mBenchmarkReadbackStart < Run.Frames.size()) {
+        Headless::BenchmarkFrame& Frame = Run.Frames[mSubdStats.Frame - mBenchmarkReadbackStart];
+        Frame.LeafCount = mSubdStats.LeafCount;
+        Frame.VisibleCount = mSubdStats.VisibleCount;
+        Frame.CulledCount = mSubdStats.CulledCount;
+        Frame.ConvergenceIterations = mSubdStats.ConvergenceIterations;
+        Frame.Converged = mSubdStats.Converged;
+    }
+
+    if (mBenchmarkFrame == Run.Frames.size() + mReadbackRing.GetLatency() + 1) {
+        if (++mBenchmarkPathIndex == mBenchmarkPaths.size()) {
+            FinishBenchmark();
+            return;
+        }
+        StartBenchmarkPath();
+    }
+
+    const Headless::BenchmarkPath& Path = mBenchmarkPaths[mBenchmarkPathIndex];
+    uint32_t PathFrame = std::min(mBenchmarkFrame, Path.GetFrameCount() - 1);
+    Headless::CameraPathKey Key = Path.Path.Evaluate(Path.GetFrameTime(PathFrame));
+    const Camera::SharedPtr &pCamera = mpScene->getCamera();
+    pCamera->setPosition(vec3(Key.PosW.x, Key.PosW.y, Key.PosW.z));
+    pCamera->setTarget(vec3(Key.Target.x, Key.Target.y, Key.Target.z));
+    pCamera->setUpVector(vec3(Key.Up.x, Key.Up.y, Key.Up.z));
+    ++mBenchmarkFrame;
+}
+
+// Saves the report and compares it with the baseline, when there is one.
+void AdaptiveSubdivision::FinishBenchmark() {
+    mBenchmarkRunning = false;
+    if (!Headless::SaveBenchmarkReport(BenchmarkFileName, mBenchmarkReport)) {
+        logWarning("Could not write " + BenchmarkFileName);
+    }
+    mBenchmarkResult = "Saved " + BenchmarkFileName;
+    Headless::BenchmarkReport Baseline;
+    if (Headless::LoadBenchmarkReport(BenchmarkBaselineFileName, Baseline)) {
+        std::vector<Headless::BenchmarkRegression> Regressions = Headless::CompareBenchmarkReports(Baseline, mBenchmarkReport);
+        mBenchmarkResult += ", " + std::to_string(Regressions.size()) + " regressions against " + BenchmarkBaselineFileName;
+        for (const Headless::BenchmarkRegression& Regression : Regressions) {
+            mBenchmarkResult += "\n" + Regression.Run + " " + Regression.Metric + ": " + std::to_string(Regression.Baseline) + " -> "
+                + std::to_string(Regression.Current);
+        }
+    }
+}
+
+// Copies this frame's BufferCounter and indirect arguments into the readback ring and decodes
+// the copy made GetLatency() frames ago. Device::present keeps at most kSwapChainBuffersCount
+// frames in flight, so that copy has completed and the map never waits on the GPU.
+void AdaptiveSubdivision::UpdateSubdStats(RenderContext* pRenderContext) {
+    uint32_t ReadSlot = 0;
+    if (mReadbackRing.GetReadSlot(mReadbackFrame, ReadSlot)) {
+        const Headless::SubdReadback* Readback = (const Headless::SubdReadback*)mReadbackBuffers[ReadSlot]->map(Buffer::MapType::Read);
+        mSubdStats = Headless::GetSubdStats(*Readback, SubdBufferSize, mReadbackFrame - mReadbackRing.GetLatency());
+        mReadbackBuffers[ReadSlot]->unmap();
+    }
+
+    Buffer* WriteSlot = mReadbackBuffers[mReadbackRing.GetWriteSlot(mReadbackFrame)].get();
+    pRenderContext->copyBufferRegion(WriteSlot, offsetof(Headless::SubdReadback, Counter), mpBufferCounter.get(), 0, sizeof(SubdBufferCounter));
+    pRenderContext->copyBufferRegion(WriteSlot, offsetof(Headless::SubdReadback, DrawArgs), mpIndirectDrawBuffer.get(), 0,
+        sizeof(Headless::SubdReadback::DrawArgs));
+    pRenderContext->copyBufferRegion(WriteSlot, offsetof(Headless::SubdReadback, DispatchArgs), mpIndirectDispatchBuffer.get(), 0,
+        sizeof(Headless::SubdReadback::DispatchArgs));
+    ++mReadbackFrame;
+}
+
+// Every program whose defines follow the GUI toggles. Versions used in the last session
+// (ShaderPermutationFileName) are compiled first, one per frame, then the neighbours of the
+// current configuration.
+void AdaptiveSubdivision::LoadShaderPermutations() {
+    using namespace Headless;
+    mShaderPermutations = {
+        { mpLodKernelProgram, ShaderPermutationSet("LodKernel", ShaderToggleFreezeSubdivision | ShaderToggleFrustumCulling | ShaderToggleDisplace
+            | ShaderToggleKeyTransformTable | ShaderToggleDeterministicCompaction | ShaderToggleCbtStorage | ShaderToggleOcclusionCulling
+            | ShaderToggleRoughnessLod | ShaderToggleIncrementalLod | ShaderToggleMultiView, true) },
+        { mLodDirtyKernel.mpComputeProgram, ShaderPermutationSet("LodDirtyKernel", ShaderToggleFrustumCulling | ShaderToggleDisplace | ShaderToggleKeyTransformTable
+            | ShaderToggleOcclusionCulling | ShaderToggleRoughnessLod | ShaderToggleMultiView, false) },
+        { mpRenderKernelProgram, ShaderPermutationSet("RenderKernel", ShaderToggleDisplace | ShaderToggleKeyTransformTable | ShaderToggleLeafVertexPrepass
+            | ShaderTogglePhongTessellation | ShaderToggleMeshShading | ShaderToggleShadingMask | ShaderToggleSlopeFromHeightMap, false) },
+        { mLeafVertexKernel.mpComputeProgram, ShaderPermutationSet("LeafVertexKernel", ShaderToggleKeyTransformTable | ShaderTogglePhongTessellation
+            | ShaderToggleSlopeFromHeightMap, false) },
+        { mLeafSortKeyKernel.mpComputeProgram, ShaderPermutationSet("LeafSortKeyKernel", ShaderToggleKeyTransformTable, false) },
+        { mpIndirectBatcherKernelProgram, ShaderPermutationSet("IndirectBatcherKernel", ShaderToggleCbtStorage, false) },
+        { mConvergenceResetKernel.mpComputeProgram, ShaderPermutationSet("ConvergenceResetKernel", ShaderToggleCbtStorage, false) },
+        { mCbtSumReductionKernel.mpComputeProgram, ShaderPermutationSet("CbtSumReductionKernel", 0, true) },
+    };
+    mShaderPermutationCache.Load(ShaderPermutationFileName);
+    mShaderWarmUpQueue.clear();
+    for (size_t i = 0; i < mShaderPermutations.size(); ++i) {
+        for (uint32_t Key : mShaderPermutationCache.GetKeys(mShaderPermutations[i].Set.GetProgramName())) {
+            mShaderWarmUpQueue.emplace_back(i, Key);
+        }
+    }
+    ApplyShaderPermutations();
+}
+
+uint32_t AdaptiveSubdivision::GetShaderToggles() const {
+    using namespace Headless;
+    const uint32_t ShadingToggles[] = { ShaderToggleShadingLod, ShaderToggleShadingDiffuse, ShaderToggleShadingNormal };
+    uint32_t Toggles = ShadingToggles[(uint32_t)mAppConfig.SM];
+    Toggles |= mAppConfig.FreezeSubd ? ShaderToggleFreezeSubdivision : 0;
+    Toggles |= mAppConfig.EnableCulling ? ShaderToggleFrustumCulling : 0;
+    Toggles |= mAppConfig.EnableCulling && mAppConfig.OcclusionCulling ? ShaderToggleOcclusionCulling : 0;
+    // The heightmap and slope map only cover the quad.
+    Toggles |= mAppConfig.Displace && !mSubdModelActive ? ShaderToggleDisplace : 0;
+    Toggles |= mAppConfig.RoughnessLod && mAppConfig.Displace && !mSubdModelActive ? ShaderToggleRoughnessLod : 0;
+    Toggles |= mAppConfig.KeyTransformTable ? ShaderToggleKeyTransformTable : 0;
+    Toggles |= mAppConfig.DeterministicCompaction ? ShaderToggleDeterministicCompaction : 0;
+    Toggles |= mAppConfig.CbtStorage ? ShaderToggleCbtStorage : 0;
+    Toggles |= IsIncrementalLodActive() ? ShaderToggleIncrementalLod : 0;
+    Toggles |= mAppConfig.MultiView ? ShaderToggleMultiView : 0;
+    Toggles |= mAppConfig.LeafVertexPrepass ? ShaderToggleLeafVertexPrepass : 0;
+    Toggles |= mAppConfig.TM == TessellationMode::Phong && !mSubdModelActive ? ShaderTogglePhongTessellation : 0;
+    Toggles |= mSubdModelActive ? ShaderToggleMeshShading : 0;
+    Toggles |= mAppConfig.SlopeMapFormat == Headless::SlopeFormat::HeightMap ? ShaderToggleSlopeFromHeightMap : 0;
+    return Toggles;
+}
+
+void AdaptiveSubdivision::SetShaderPermutationDefines(ShaderPermutationProgram& ioProgram, uint32_t inKey) {
+    for (const std::string& Define : ioProgram.Set.GetToggleDefines()) {
+        ioProgram.pProgram->removeDefine(Define);
+    }
+    for (const auto& Define : ioProgram.Set.GetDefines(inKey)) {
+        ioProgram.pProgram->addDefine(Define.first, Define.second);
+    }
+}
+
+// The defines of a program only change when its key does; Falcor keeps every linked
+// version, so switching back to a warm key is a lookup.
+void AdaptiveSubdivision::ApplyShaderPermutations() {
+    uint32_t Toggles = GetShaderToggles();
+    for (size_t i = 0; i < mShaderPermutations.size(); ++i) {
+        ShaderPermutationProgram& Program = mShaderPermutations[i];
+        uint32_t Key = Program.Set.GetKey(Toggles, mCbtPrimitiveBits);
+        if (Key == Program.ActiveKey) {
+            continue;
+        }
+        SetShaderPermutationDefines(Program, Key);
+        // The states were written under other defines, or not at all.
+        if (Program.pProgram == mpLodKernelProgram) {
+            mLodTravelTracker.Invalidate();
+        }
+        Program.ActiveKey = Key;
+        Program.WarmKeys.insert(Key);
+        mShaderPermutationCache.Add(Program.Set.GetProgramName(), Key);
+        for (uint32_t Neighbour : Program.Set.GetNeighbourKeys(Key)) {
+            mShaderWarmUpQueue.emplace_back(i, Neighbour);
+        }
+    }
+}
+
+// Links one queued version per frame and switches the program back to its active key.
+void AdaptiveSubdivision::WarmUpShaderPermutation() {
+    while (!mShaderWarmUpQueue.empty()) {
+        std::pair<size_t, uint32_t> Entry = mShaderWarmUpQueue.front();
+        mShaderWarmUpQueue.pop_front();
+        ShaderPermutationProgram& Program = mShaderPermutations[Entry.first];
+        if (Entry.second == Program.ActiveKey || !Program.WarmKeys.insert(Entry.second).second) {
+            continue;
+        }
+        SetShaderPermutationDefines(Program, Entry.second);
+        Program.pProgram->getActiveVersion();
+        SetShaderPermutationDefines(Program, Program.ActiveKey);
+        break;
+    }
+}
+
+// Passes to issue this frame: 1, or with ConvergeInFrame as many as the budget allows at the
+// cost per pass measured last frame. Passes after convergence are dispatched empty, so the
+// estimate divides by the passes that actually ran.
+int AdaptiveSubdivision::GetConvergencePassCount() {
+    if (!mAppConfig.ConvergeInFrame) {
+        return 1;
+    }
+    // The timer holds the loop of the last frame, its iteration count arrives GetLatency()
+    // frames later: divide the time of the frame mSubdStats describes by its own count.
+    if (mConvergenceTimed && mConvergenceTimedFrame + 1 == mReadbackFrame) {
+        mConvergenceTimes[mConvergenceTimedFrame % mConvergenceTimes.size()] = { mConvergenceTimedFrame, mpConvergenceTimer->getElapsedTime() };
+    }
+    const ConvergenceTime& Timed = mConvergenceTimes[mSubdStats.Frame % mConvergenceTimes.size()];
+    if (Timed.Frame == mSubdStats.Frame && mSubdStats.ConvergenceIterations > 0) {
+        double PassMs = Timed.Ms / mSubdStats.ConvergenceIterations;
+        mConvergencePassCount = PassMs > 0.0 ? (int)std::min(mAppConfig.ConvergenceBudgetMs / PassMs, 64.0) : mAppConfig.ConvergenceMaxIterations;
+    }
+    return std::max(1, std::min(mConvergencePassCount, mAppConfig.ConvergenceMaxIterations));
+}
+
+// INCREMENTAL_LOD stays off where LodKernel would undefine it.
+bool AdaptiveSubdivision::IsIncrementalLodActive() const {
+    return mAppConfig.IncrementalLod && !mAppConfig.FreezeSubd && !mAppConfig.DeterministicCompaction && !mAppConfig.CbtStorage;
+}
+
+// One LodKernel iteration: LodKernel (+ CBT reduction, compaction or the dirty keys) and IndirectBatcherKernel.
+void AdaptiveSubdivision::RunSubdivisionPass(RenderContext* pRenderContext) {
+    StructuredBuffer::SharedPtr CbtBitfieldIn = Pingping ? mpCbtBitfield_0 : mpCbtBitfield_1;
+    StructuredBuffer::SharedPtr CbtBitfieldOut = Pingping ? mpCbtBitfield_1 : mpCbtBitfield_0;
+    if (mBenchmarkRunning) {
+        mLodKernelTimer.Begin();
+    }
+    if (mAppConfig.CbtStorage) {
+        ComputeVars::SharedPtr ClearVars = mCbtClearKernel.mpComputeVars;
+        ClearVars->setStructuredBuffer("CbtBitfieldOut", CbtBitfieldOut);
+        pRenderContext->dispatchIndirect(mCbtClearKernel.mpComputeState.get(), ClearVars.get(), mpIndirectDispatchBuffer.get(), 2 * sizeof(D3D12_DISPATCH_ARGUMENTS));
+    }
+
+    //LodKernel
+    mpLodKernelVars->setParameterBlock("gScene", mpScene->getParameterBlock());
+    mpLodKernelVars->setStructuredBuffer("SubdIn", (Pingping ? mpSubdBuffer_0 : mpSubdBuffer_1));
+    mpLodKernelVars->setStructuredBuffer("SubdOut", (Pingping ? mpSubdBuffer_1 : mpSubdBuffer_0));
+    mpLodKernelVars->setTypedBuffer("VertexBuffer", mpVertexBuffer);
+    mpLodKernelVars->setTypedBuffer("IndexBuffer", mpIndexBuffer);
+    mpLodKernelVars->setTypedBuffer("KeyTransformTable", mpKeyTransformTable);
+    mpLodKernelVars->setTexture("HeightMapTexture", mpHeightMap);
+    mpLodKernelVars->setTexture("HeightBoundsTexture", mpHeightBounds);
+    mpLodKernelVars->setTexture("HiZTexture", mpHiZ);
+    mpLodKernelVars->setTexture("RoughnessTexture", mpRoughness);
+    mpLodKernelVars->setStructuredBuffer("SubdCulledOut", mpSubdCulledBuffer);
+    mpLodKernelVars->setStructuredBuffer("SubdViewCulledOut", mpSubdViewCulledBuffer);
+    mpLodKernelVars->setRawBuffer("IndirectDrawBuffer", mpIndirectDrawBuffer);
+    mpLodKernelVars->setRawBuffer("IndirectDispatchBuffer", mpIndirectDispatchBuffer);
+    mpLodKernelVars->setRawBuffer("BufferCounter", mpBufferCounter);
+    mpLodKernelVars->setStructuredBuffer("CompactionFlags", mpCompactionFlags);
+    mpLodKernelVars->setStructuredBuffer("CbtTree", mpCbtTree);
+    mpLodKernelVars->setStructuredBuffer("CbtBitfieldIn", CbtBitfieldIn);
+    mpLodKernelVars->setStructuredBuffer("CbtBitfieldOut", CbtBitfieldOut);
+    mpLodKernelVars->setStructuredBuffer("SubdStateIn", (Pingping ? mpSubdState_0 : mpSubdState_1));
+    mpLodKernelVars->setStructuredBuffer("SubdStateOut", (Pingping ? mpSubdState_1 : mpSubdState_0));
+    mpLodKernelVars->setStructuredBuffer("SubdDirty", mpSubdDirty);
+    pRenderContext->dispatchIndirect(mpLodKernelState.get(), mpLodKernelVars.get(), mpIndirectDispatchBuffer.get(), 0);
+
+    //DirtyBatcherKernel + LodDirtyKernel, the keys whose slack ran out
+    if (IsIncrementalLodActive()) {
+        ComputeVars::SharedPtr BatcherVars = mDirtyBatcherKernel.mpComputeVars;
+        BatcherVars->setRawBuffer("IndirectDispatchBuffer", mpIndirectDispatchBuffer);
+        BatcherVars->setRawBuffer("BufferCounter", mpBufferCounter);
+        pRenderContext->dispatch(mDirtyBatcherKernel.mpComputeState.get(), BatcherVars.get(), uvec3(1, 1, 1));
+
+        ComputeVars::SharedPtr DirtyVars = mLodDirtyKernel.mpComputeVars;
+        DirtyVars->setParameterBlock("gScene", mpScene->getParameterBlock());
+        DirtyVars->setStructuredBuffer("SubdIn", (Pingping ? mpSubdBuffer_0 : mpSubdBuffer_1));
+        DirtyVars->setStructuredBuffer("SubdOut", (Pingping ? mpSubdBuffer_1 : mpSubdBuffer_0));
+        DirtyVars->setStructuredBuffer("SubdStateOut", (Pingping ? mpSubdState_1 : mpSubdState_0));
+        DirtyVars->setStructuredBuffer("SubdDirty", mpSubdDirty);
+        DirtyVars->setStructuredBuffer("SubdCulledOut", mpSubdCulledBuffer);
+        DirtyVars->setStructuredBuffer("SubdViewCulledOut", mpSubdViewCulledBuffer);
+        DirtyVars->setTypedBuffer("VertexBuffer", mpVertexBuffer);
+        DirtyVars->setTypedBuffer("IndexBuffer", mpIndexBuffer);
+        DirtyVars->setTypedBuffer("KeyTransformTable", mpKeyTransformTable);
+        DirtyVars->setTexture("HeightMapTexture", mpHeightMap);
+        DirtyVars->setTexture("HeightBoundsTexture", mpHeightBounds);
+        DirtyVars->setTexture("HiZTexture", mpHiZ);
+        DirtyVars->setTexture("RoughnessTexture", mpRoughness);
+        DirtyVars->setRawBuffer("BufferCounter", mpBufferCounter);
+        pRenderContext->dispatchIndirect(mLodDirtyKernel.mpComputeState.get(), DirtyVars.get(), mpIndirectDispatchBuffer.get(), 4 * sizeof(D3D12_DISPATCH_ARGUMENTS));
+    }
+
+    //Sum reduction over the emitted bitfield, deepest stored level first
+    if (mAppConfig.CbtStorage) {
+        ComputeVars::SharedPtr ReductionVars = mCbtSumReductionKernel.mpComputeVars;
+        ReductionVars->setStructuredBuffer("CbtTree", mpCbtTree);
+        ReductionVars->setStructuredBuffer("CbtBitfieldIn", CbtBitfieldOut);
+        for (int Depth = (int)CbtMaxDepth - 6; Depth >= 0; --Depth) {
+            ReductionVars["CbtReductionCB"]["CbtReductionDepth"] = (uint32_t)Depth;
+            pRenderContext->dispatch(mCbtSumReductionKernel.mpComputeState.get(), ReductionVars.get(), uvec3(((1u << Depth) + 255u) / 256u, 1, 1));
+        }
+    }
+
+    //Count / Scan / Scatter, replaces the atomic appends of LodKernel
+    if (mAppConfig.DeterministicCompaction && !mAppConfig.CbtStorage) {
+        ComputeVars::SharedPtr ScanBlockVars = mCompactionScanBlockKernel.mpComputeVars;
+        ScanBlockVars->setStructuredBuffer("CompactionFlags", mpCompactionFlags);
+        ScanBlockVars->setStructuredBuffer("CompactionOffsets", mpCompactionOffsets);
+        ScanBlockVars->setStructuredBuffer("CompactionBlockSums", mpCompactionBlockSums);
+        ScanBlockVars->setRawBuffer("BufferCounter", mpBufferCounter);
+        pRenderContext->dispatchIndirect(mCompactionScanBlockKernel.mpComputeState.get(), ScanBlockVars.get(), mpIndirectDispatchBuffer.get(), sizeof(D3D12_DISPATCH_ARGUMENTS));
+
+        ComputeVars::SharedPtr ScanBlockSumsVars = mCompactionScanBlockSumsKernel.mpComputeVars;
+        ScanBlockSumsVars->setStructuredBuffer("CompactionBlockSums", mpCompactionBlockSums);
+        ScanBlockSumsVars->setRawBuffer("BufferCounter", mpBufferCounter);
+        pRenderContext->dispatch(mCompactionScanBlockSumsKernel.mpComputeState.get(), ScanBlockSumsVars.get(), uvec3(1, 1, 1));
+
+        ComputeVars::SharedPtr ScatterVars = mCompactionScatterKernel.mpComputeVars;
+        ScatterVars->setStructuredBuffer("SubdIn", (Pingping ? mpSubdBuffer_0 : mpSubdBuffer_1));
+        ScatterVars->setStructuredBuffer("SubdOut", (Pingping ? mpSubdBuffer_1 : mpSubdBuffer_0));
+        ScatterVars->setStructuredBuffer("SubdCulledOut", mpSubdCulledBuffer);
+        ScatterVars->setStructuredBuffer("CompactionFlags", mpCompactionFlags);
+        ScatterVars->setStructuredBuffer("CompactionOffsets", mpCompactionOffsets);
+        ScatterVars->setStructuredBuffer("CompactionBlockSums", mpCompactionBlockSums);
+        ScatterVars->setRawBuffer("BufferCounter", mpBufferCounter);
+        pRenderContext->dispatchIndirect(mCompactionScatterKernel.mpComputeState.get(), ScatterVars.get(), mpIndirectDispatchBuffer.get(), 0);
+    }
+
+    if (mBenchmarkRunning) {
+        mLodKernelTimer.End();
+        mIndirectBatcherTimer.Begin();
+    }
+
+    //IndirectBatcherKernel
+    mpIndirectBatcherKernelVars->setRawBuffer("IndirectDrawBuffer", mpIndirectDrawBuffer);
+    mpIndirectBatcherKernelVars->setRawBuffer("IndirectDispatchBuffer", mpIndirectDispatchBuffer);
+    mpIndirectBatcherKernelVars->setRawBuffer("BufferCounter", mpBufferCounter);
+    mpIndirectBatcherKernelVars->setStructuredBuffer("CbtTree", mpCbtTree);
+    mpIndirectBatcherKernelVars->setStructuredBuffer("CbtBitfieldIn", CbtBitfieldOut);
+    pRenderContext->dispatch(mpIndirectBatcherKernelState.get(), mpIndirectBatcherKernelVars.get(), uvec3(1, 1, 1));
+    if (mBenchmarkRunning) {
+        mIndirectBatcherTimer.End();
+    }
+}
+
+// Orders the SubdCulledOut of view 0 by the Morton key of the leaf centroids, so consecutive
+// instances of RenderKernel (and LeafVertexKernel) fetch neighbouring texels and vertices.
+// LeafSortKeyKernel moves the leaves to mpLeafSortData, then each radix pass runs histogram,
+// scan and scatter over LeafSortRadixBits of the key; the odd pass count ends in
+// mpSubdCulledBuffer. All dispatches follow the draw count through record [5].
+void AdaptiveSubdivision::SortLeaves(RenderContext* pRenderContext) {
+    static_assert(Headless::LeafSortKeyBits / Headless::LeafSortRadixBits % 2 == 1, "The last sort pass must write mpSubdCulledBuffer");
+    const uint32_t LeafSortRecord = 5 * sizeof(D3D12_DISPATCH_ARGUMENTS);
+    auto SetLeafSortCB = [this](const ComputeVars::SharedPtr& ioVars, uint32_t inShift) {
+        ioVars["LeafSortCB"]["LeafSortBoundsMin"] = vec3(mLeafSortBounds.Min.x, mLeafSortBounds.Min.y, mLeafSortBounds.Min.z);
+        ioVars["LeafSortCB"]["LeafSortDimensions"] = mLeafSortBounds.Dimensions;
+        ioVars["LeafSortCB"]["LeafSortBoundsScale"] = vec3(mLeafSortBounds.Scale.x, mLeafSortBounds.Scale.y, mLeafSortBounds.Scale.z);
+        ioVars["LeafSortCB"]["LeafSortShift"] = inShift;
+    };
+
+    ComputeVars::SharedPtr KeyVars = mLeafSortKeyKernel.mpComputeVars;
+    SetLeafSortCB(KeyVars, 0);
+    KeyVars->setStructuredBuffer("SubdCulledOut", mpSubdCulledBuffer);
+    KeyVars->setStructuredBuffer("LeafSortKeysOut", mpLeafSortKeys_0);
+    KeyVars->setStructuredBuffer("LeafSortDataOut", mpLeafSortData);
+    KeyVars->setTypedBuffer("VertexBuffer", mpVertexBuffer);
+    KeyVars->setTypedBuffer("IndexBuffer", mpIndexBuffer);
+    KeyVars->setTypedBuffer("KeyTransformTable", mpKeyTransformTable);
+    KeyVars->setRawBuffer("IndirectDrawBuffer", mpIndirectDrawBuffer);
+    pRenderContext->dispatchIndirect(mLeafSortKeyKernel.mpComputeState.get(), KeyVars.get(), mpIndirectDispatchBuffer.get(), LeafSortRecord);
+
+    bool KeysIn0 = true;
+    for (uint32_t Shift = 0; Shift < Headless::LeafSortKeyBits; Shift += Headless::LeafSortRadixBits) {
+        StructuredBuffer::SharedPtr KeysIn = KeysIn0 ? mpLeafSortKeys_0 : mpLeafSortKeys_1;
+        StructuredBuffer::SharedPtr KeysOut = KeysIn0 ? mpLeafSortKeys_1 : mpLeafSortKeys_0;
+        StructuredBuffer::SharedPtr DataIn = KeysIn0 ? mpLeafSortData : mpSubdCulledBuffer;
+        StructuredBuffer::SharedPtr DataOut = KeysIn0 ? mpSubdCulledBuffer : mpLeafSortData;
+
+        ComputeVars::SharedPtr HistogramVars = mLeafSortHistogramKernel.mpComputeVars;
+        SetLeafSortCB(HistogramVars, Shift);
+        HistogramVars->setStructuredBuffer("LeafSortKeysIn", KeysIn);
+        HistogramVars->setStructuredBuffer("LeafSortHistograms", mpLeafSortHistograms);
+        HistogramVars->setRawBuffer("IndirectDrawBuffer", mpIndirectDrawBuffer);
+        pRenderContext->dispatchIndirect(mLeafSortHistogramKernel.mpComputeState.get(), HistogramVars.get(), mpIndirectDispatchBuffer.get(), LeafSortRecord);
+
+        ComputeVars::SharedPtr ScanVars = mLeafSortScanKernel.mpComputeVars;
+        ScanVars->setStructuredBuffer("LeafSortHistograms", mpLeafSortHistograms);
+        ScanVars->setRawBuffer("IndirectDrawBuffer", mpIndirectDrawBuffer);
+        pRenderContext->dispatch(mLeafSortScanKernel.mpComputeState.get(), ScanVars.get(), uvec3(1, 1, 1));
+
+        ComputeVars::SharedPtr ScatterVars = mLeafSortScatterKernel.mpComputeVars;
+        SetLeafSortCB(ScatterVars, Shift);
+        ScatterVars->setStructuredBuffer("LeafSortKeysIn", KeysIn);
+        ScatterVars->setStructuredBuffer("LeafSortKeysOut", KeysOut);
+        ScatterVars->setStructuredBuffer("LeafSortDataIn", DataIn);
+        ScatterVars->setStructuredBuffer("LeafSortDataOut", DataOut);
+        ScatterVars->setStructuredBuffer("LeafSortHistograms", mpLeafSortHistograms);
+        ScatterVars->setRawBuffer("IndirectDrawBuffer", mpIndirectDrawBuffer);
+        pRenderContext->dispatchIndirect(mLeafSortScatterKernel.mpComputeState.get(), ScatterVars.get(), mpIndirectDispatchBuffer.get(), LeafSortRecord);
+        KeysIn0 = !KeysIn0;
+    }
 }
 
 void AdaptiveSubdivision::onShutdown()
 {
+    if (!mShaderPermutationCache.Save(ShaderPermutationFileName)) {
+        logWarning("Could not write " + ShaderPermutationFileName);
+    }
 }
 
 bool AdaptiveSubdivision::onKeyEvent(const KeyboardEvent& keyEvent)
@@ -306,7 +1248,7 @@ bool AdaptiveSubdivision::onMouseEvent(const MouseEvent& mouseEvent)
 
 void AdaptiveSubdivision::onDataReload()
 {
-
+    LoadSubdMesh();
 }
 
 void AdaptiveSubdivision::onResizeSwapChain(uint32_t width, uint32_t height)
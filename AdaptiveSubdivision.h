@@ -1,5 +1,17 @@
 #pragma once
+#include <deque>
 #include "Falcor.h"
+#include "Headless/CameraPath.h"
+#include "Headless/PatchGrid.h"
+#include "Headless/SubdBenchmark.h"
+#include "Headless/ShaderPermutation.h"
+#include "Headless/SubdBudget.h"
+#include "Headless/SubdEngine.h"
+#include "Headless/SubdHeightmap.h"
+#include "Headless/SubdLeafSort.h"
+#include "Headless/SubdShared.h"
+#include "Headless/SubdSlopeFormat.h"
+#include "Headless/SubdStats.h"
 
 using namespace Falcor;
 
@@ -16,6 +28,7 @@ enum class TessellationMode {
 
 uint32_t ShadingModeID = 1;
 uint32_t TessellationModeID = 0;
+uint32_t SlopeFormatID = 0;
 
 Gui::DropdownList ShadingModeList = {
     {(uint32_t)ShadingMode::Lod,"Lod"},
@@ -26,29 +39,50 @@ Gui::DropdownList TessellationModeList = {
     {(uint32_t)TessellationMode::Phong,"Phong"},
     {(uint32_t)TessellationMode::None,"None"}
 };
+Gui::DropdownList SlopeFormatList = {
+    {(uint32_t)Headless::SlopeFormat::RG32Float,"RG32Float"},
+    {(uint32_t)Headless::SlopeFormat::RG16Float,"RG16Float"},
+    {(uint32_t)Headless::SlopeFormat::RG16Snorm,"RG16Snorm"},
+    {(uint32_t)Headless::SlopeFormat::BC5Snorm,"BC5Snorm"},
+    {(uint32_t)Headless::SlopeFormat::HeightMap,"From Heightmap"}
+};
 
 struct AppConfig {
     bool FreezeSubd = false;
     bool RenderSuzanne = false;
+    bool SubdivideModel = false;
     float TargetPixelSize = 5.0f;
+    bool EnableBudget = false;
+    int LeafBudget = 1 << 18;
+    float FrameTimeBudgetMs = 0.0f;
     bool OnlyRender = false;
     bool EnableCulling = true;
+    bool OcclusionCulling = false;
     bool Wireframe = false;
+    bool RoughnessLod = false;
+    float MaxScreenError = 1.0f;
+    float MaxLodOffset = 4.0f;
+    bool IncrementalLod = false;
+    bool MultiView = false;
+    int ExtraViewCount = 1;
+    float ViewSpacing = 0.1f;
     float DisplacementFactor = 0.3f;
     bool Displace = true;
     ShadingMode SM = ShadingMode::Diffuse;
     TessellationMode TM = TessellationMode::Phong;
-};
-
-struct LodKernelConfig {
-    float FovX;
-    float TargetPixelSize;
-    uint ScreenResolutionWidth;
-    float DisplacementFactor;
-};
-
-struct RenderKernelConfig {
-    float DisplacementFactor;
+    Headless::SlopeFormat SlopeMapFormat = Headless::SlopeFormat::RG32Float;
+    bool KeyTransformTable = false;
+    bool DeterministicCompaction = false;
+    bool CbtStorage = false;
+    bool ConvergeInFrame = false;
+    int ConvergenceMaxIterations = 16;
+    float ConvergenceBudgetMs = 2.0f;
+    bool LeafVertexPrepass = true;
+    bool SortLeaves = false;
+    int PatchLevel = (int)Headless::DefaultPatchLevel;
+    bool ExportObj = false;
+    bool RecordCameraPath = false;
+    bool PlayCameraPath = false;
 };
 
 struct ModelRendererElements {
@@ -61,6 +95,29 @@ struct ModelRendererElements {
     GraphicsState::SharedPtr GraphicsState = nullptr;
 };
 
+// GPU time of a pass dispatched any number of times a frame: one GpuTimer per dispatch, summed
+// at the start of the next frame like mpConvergenceTimer.
+struct PassTimer {
+    std::vector<GpuTimer::SharedPtr> Timers;
+    uint32_t Used = 0;
+
+    void Begin() {
+        if (Used == Timers.size()) {
+            Timers.push_back(GpuTimer::create());
+        }
+        Timers[Used]->begin();
+    }
+    void End() { Timers[Used++]->end(); }
+    double Resolve() {
+        double Ms = 0.0;
+        for (uint32_t i = 0; i < Used; ++i) {
+            Ms += Timers[i]->getElapsedTime();
+        }
+        Used = 0;
+        return Ms;
+    }
+};
+
 class AdaptiveSubdivision : public IRenderer
 {
 public:
@@ -82,20 +139,60 @@ private:
 
     Scene::SharedPtr mpScene = nullptr;
 
-    uvec2 InitSubdBuffer[4] = { uvec2(0,2),uvec2(1,2),uvec2(0,3),uvec2(1,3) };
-    float4 VertexData[4] = { float4(-1.0f,-1.0f,0.0f,1.0f), float4(1.0f,-1.0f,0.0f,1.0f) ,float4(1.0f,1.0f,0.0f,1.0f) ,float4(-1.0f,1.0f,0.0f,1.0f) };
-    uint32 IndexData[6] = { 0,1,3,2,3,1 };
+    // The unit quad, or the model file with SubdivideModel.
+    Headless::SubdMesh mSubdMesh = Headless::SubdMesh::CreateQuad();
+    bool mSubdModelActive = false;
 
     void LoadRenderState();
     void LoadModelRenderer(ModelRendererElements &inModelRendererElements, const std::string &inRasterizerStateGroupName, const std::string &inDepthStencilStateGroupName);
 
     void LoadTexture();
+    void LoadSlopeMap(const float* inSlopes, uint32_t inWidth, uint32_t inHeight);
+    void ReloadSlopeMap();
+    void LoadHeightBounds(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight);
+    void LoadRoughness(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight);
 
     void LoadLodKernel();
     void LoadRenderKernel();
     void LoadIndirectBatcherKernel();
+    void LoadCompactionKernels();
+    void LoadComputeKernel(ComputeShaderUtils &outKernel, const std::string &inEntryName);
 
     void LoadBuffer();
+    void LoadSubdMesh();
+    void ResetSubdBuffers();
+    void LoadSnapshot();
+    std::vector<PrimitiveData> ReadBackSubdIn();
+    void ExportMesh();
+    void RunSubdivisionPass(RenderContext* pRenderContext);
+    void SortLeaves(RenderContext* pRenderContext);
+    bool IsIncrementalLodActive() const;
+    void BuildHiZ(RenderContext* pRenderContext, const Fbo::SharedPtr& pTargetFbo, const Headless::float4x4& inViewProjMat);
+    void SetPatchLevel(uint32_t inPatchLevel);
+    int GetConvergencePassCount();
+    void UpdateCameraPath();
+    void StartBenchmark();
+    void StartBenchmarkPath();
+    void UpdateBenchmark();
+    void FinishBenchmark();
+    void UpdateSubdStats(RenderContext* pRenderContext);
+
+    // A program whose defines follow the GUI toggles through its ShaderPermutationSet.
+    struct ShaderPermutationProgram {
+        Program::SharedPtr pProgram;
+        Headless::ShaderPermutationSet Set;
+        uint32_t ActiveKey = ~0u;
+        // Keys linked by the warm-up or used, which Falcor has cached.
+        std::set<uint32_t> WarmKeys;
+    };
+    void LoadShaderPermutations();
+    uint32_t GetShaderToggles() const;
+    void SetShaderPermutationDefines(ShaderPermutationProgram& ioProgram, uint32_t inKey);
+    void ApplyShaderPermutations();
+    void WarmUpShaderPermutation();
+    std::vector<ShaderPermutationProgram> mShaderPermutations;
+    Headless::ShaderPermutationCache mShaderPermutationCache;
+    std::deque<std::pair<size_t, uint32_t>> mShaderWarmUpQueue;
 
     Scene::SharedPtr GetRenderScene(ModelRendererElements &inModelRendererElements);
     void RenderModel(RenderContext* pRenderContext, const Fbo::SharedPtr& pTargetFbo, ModelRendererElements &inModelRendererElements);
@@ -104,8 +201,12 @@ private:
     StructuredBuffer::SharedPtr mpSubdBuffer_0 = nullptr;
     StructuredBuffer::SharedPtr mpSubdBuffer_1 = nullptr;
     StructuredBuffer::SharedPtr mpSubdCulledBuffer = nullptr;
+    // MultiView: the visible leaves of views 1 and up, MaxLodViewCount - 1 lists of
+    // SubdBufferSize back to back, drawn by IndirectDrawBuffer records 1 and up.
+    StructuredBuffer::SharedPtr mpSubdViewCulledBuffer = nullptr;
     TypedBuffer<float4>::SharedPtr mpVertexBuffer = nullptr;
     TypedBuffer<uint32>::SharedPtr mpIndexBuffer = nullptr;
+    TypedBuffer<vec2>::SharedPtr mpKeyTransformTable = nullptr;
     TypedBuffer<uint32>::SharedPtr mpInstanceIndexBuffer = nullptr;
     Buffer::SharedPtr mpIndirectDrawBuffer = nullptr;
     Buffer::SharedPtr mpIndirectDispatchBuffer = nullptr;
@@ -122,15 +223,114 @@ private:
     RasterizerState::SharedPtr mpRenderKernelRastState = nullptr;
     DepthStencilState::SharedPtr mpRenderKernelDepthTest = nullptr;
     StructuredBuffer::SharedPtr mpSubdUV = nullptr;
+    uint32_t mPatchLevelActive = Headless::DefaultPatchLevel;
     Buffer::SharedPtr mpPerInstancedIndex = nullptr;
     Texture::SharedPtr mpHeightMap = nullptr;
     Texture::SharedPtr mpSlopeMap = nullptr;
+    Headless::SlopeFormat mSlopeFormatActive = Headless::SlopeFormat::RG32Float;
+    // The slopes SlopeMapTexture was encoded from, kept for a "Slope Map Format" change: the
+    // mapped heightmap cache, or the slopes computed from the PNG when it could not be written.
+    Headless::HeightmapCache mHeightMapCache;
+    Headless::SubdTexture mUncachedSlopes;
+    Texture::SharedPtr mpHeightBounds = nullptr;
+    Texture::SharedPtr mpRoughness = nullptr;
     ConstantBuffer::SharedPtr mpRenderKernelCB = nullptr;
 
     ComputeProgram::SharedPtr mpIndirectBatcherKernelProgram = nullptr;
     ComputeVars::SharedPtr mpIndirectBatcherKernelVars = nullptr;
     ComputeState::SharedPtr mpIndirectBatcherKernelState = nullptr;
 
+    ComputeShaderUtils mCompactionScanBlockKernel;
+    ComputeShaderUtils mCompactionScanBlockSumsKernel;
+    ComputeShaderUtils mCompactionScatterKernel;
+    StructuredBuffer::SharedPtr mpCompactionFlags = nullptr;
+    StructuredBuffer::SharedPtr mpCompactionOffsets = nullptr;
+    StructuredBuffer::SharedPtr mpCompactionBlockSums = nullptr;
+
+    ComputeShaderUtils mCbtSumReductionKernel;
+    StructuredBuffer::SharedPtr mpCbtTree = nullptr;
+    StructuredBuffer::SharedPtr mpCbtBitfield_0 = nullptr;
+    StructuredBuffer::SharedPtr mpCbtBitfield_1 = nullptr;
+    uint32_t mCbtPrimitiveBits = 1;
+    bool mCbtStorageActive = false;
+
+    ComputeShaderUtils mCbtClearKernel;
+    ComputeShaderUtils mConvergenceResetKernel;
+    GpuTimer::SharedPtr mpConvergenceTimer = nullptr;
+    bool mConvergenceTimed = false;
+    uint64_t mConvergenceTimedFrame = 0;
+    int mConvergencePassCount = 1;
+    // GPU time of the convergence loop per frame, kept until the readback ring delivers the
+    // ConvergenceIterations of the same frame. One entry per readback slot.
+    struct ConvergenceTime {
+        uint64_t Frame = ~0ull;
+        double Ms = 0.0;
+    };
+    std::vector<ConvergenceTime> mConvergenceTimes;
+
+    // One staging copy of BufferCounter and the indirect arguments per frame in flight, plus
+    // the one being read.
+    std::vector<Buffer::SharedPtr> mReadbackBuffers;
+    Headless::ReadbackRing mReadbackRing{ Device::kSwapChainBuffersCount + 1 };
+    uint64_t mReadbackFrame = 0;
+    Headless::SubdStats mSubdStats;
+    // Coarsens TargetPixelSize when the leaves or the frame time run past their budget.
+    Headless::SubdBudgetGovernor mBudgetGovernor;
+
+    // Max depth pyramid of the last frame and the camera it was seen from, for OcclusionCulling.
+    // A zero size means there is none yet.
+    ComputeShaderUtils mHiZBuildKernel;
+    Texture::SharedPtr mpHiZ = nullptr;
+    Headless::float4x4 mHiZViewProjMat;
+    uvec2 mHiZSourceSize = uvec2(0, 0);
+
+    ComputeShaderUtils mLeafVertexKernel;
+    StructuredBuffer::SharedPtr mpLeafVertices = nullptr;
+
+    // SortLeaves: the Morton keys ping-ponged by the radix passes, the leaves of the passes
+    // that do not write mpSubdCulledBuffer, the digit histograms of all blocks, and the box
+    // of mSubdMesh the keys are quantised in.
+    ComputeShaderUtils mLeafSortKeyKernel;
+    ComputeShaderUtils mLeafSortHistogramKernel;
+    ComputeShaderUtils mLeafSortScanKernel;
+    ComputeShaderUtils mLeafSortScatterKernel;
+    StructuredBuffer::SharedPtr mpLeafSortKeys_0 = nullptr;
+    StructuredBuffer::SharedPtr mpLeafSortKeys_1 = nullptr;
+    StructuredBuffer::SharedPtr mpLeafSortData = nullptr;
+    StructuredBuffer::SharedPtr mpLeafSortHistograms = nullptr;
+    Headless::LeafSortBounds mLeafSortBounds;
+
+    // IncrementalLod: LeafLodState of every key, ping-ponged with mpSubdBuffer_0 / _1, the keys
+    // LodKernel leaves to LodDirtyKernel, and the camera travel the slacks are charged with.
+    ComputeShaderUtils mDirtyBatcherKernel;
+    ComputeShaderUtils mLodDirtyKernel;
+    StructuredBuffer::SharedPtr mpSubdState_0 = nullptr;
+    StructuredBuffer::SharedPtr mpSubdState_1 = nullptr;
+    StructuredBuffer::SharedPtr mpSubdDirty = nullptr;
+    Headless::LodTravelTracker mLodTravelTracker;
+
+    std::vector<PrimitiveData> mWarmStartKeys;
+    // What the last "Export Mesh" wrote, or why it failed.
+    std::string mMeshExportResult;
+
+    Headless::CameraPath mCameraPath;
+    double mCameraPathStartTime = 0.0;
+
+    // Benchmark mode: the paths of Headless::GetBenchmarkPaths played one after the other at
+    // BenchmarkFrameRate, each from the start keys. The counts come through the readback ring
+    // and the times through the PassTimers, so a path runs on until those of its last frame
+    // are in.
+    bool mBenchmarkRunning = false;
+    std::vector<Headless::BenchmarkPath> mBenchmarkPaths;
+    size_t mBenchmarkPathIndex = 0;
+    uint32_t mBenchmarkFrame = 0;
+    uint64_t mBenchmarkReadbackStart = 0;
+    Headless::BenchmarkReport mBenchmarkReport;
+    std::string mBenchmarkResult;
+    PassTimer mLodKernelTimer;
+    PassTimer mIndirectBatcherTimer;
+    PassTimer mRenderKernelTimer;
+
     bool Pingping = true;
 
     AppConfig mAppConfig;
@@ -142,135 +342,3 @@ private:
     std::map<std::string, DepthStencilState::SharedPtr> DepthStencilStateGroup;
     std::map<std::string, Sampler::SharedPtr> SamplerGroup;
 };
-
-const vec2 SubdUVData[] = {
-    { 0.25f*0.5f, 0.75f*0.5f + 0.5f },
-    { 0.0f*0.5f, 1.0f*0.5f + 0.5f },
-    { 0.0f*0.5f, 0.75f*0.5f + 0.5f },
-    { 0.0f*0.5f , 0.5f*0.5f + 0.5f },
-    { 0.25f*0.5f, 0.5f*0.5f + 0.5f },
-    { 0.5f*0.5f, 0.5f*0.5f + 0.5f },
-    { 0.25f*0.5f, 0.25f*0.5f + 0.5f },
-    { 0.0f*0.5f, 0.25f*0.5f + 0.5f },
-    { 0.0f*0.5f, 0.0f*0.5f + 0.5f },
-    { 0.25f*0.5f, 0.0f*0.5f + 0.5f },
-    { 0.5f*0.5f, 0.0f*0.5f + 0.5f },
-    { 0.5f*0.5f, 0.25f*0.5f + 0.5f },
-    { 0.75f*0.5f, 0.25f*0.5f + 0.5f },
-    { 0.75f*0.5f, 0.0f*0.5f + 0.5f },
-    { 1.0f*0.5f, 0.0f*0.5f + 0.5f },        //14
-
-    { 0.375f, 0.375f },
-    { 0.25f, 0.375f },
-    { 0.25f, 0.25f },
-    { 0.375f, 0.25f },
-    { 0.5f, 0.25f },
-    { 0.5f, 0.375f },    //20
-
-    { 0.125f, 0.375f },
-    { 0.0f, 0.375f },
-    { 0.0f, 0.25f },
-    { 0.125f, 0.25f },    //24
-
-    { 0.125f, 0.125f },
-    { 0.0f, 0.125f },
-    { 0.0f, 0.0f },
-    { 0.125f, 0.0f },
-    { 0.25f, 0.0f },
-    { 0.25f, 0.125f },    //30
-
-    { 0.375f, 0.125f },
-    { 0.375f, 0.0f },
-    { 0.5f, 0.0f },
-    { 0.5f, 0.125f },    //34
-
-    { 0.625f, 0.375f },
-    { 0.625f, 0.25f },
-    { 0.75f, 0.25f },    //37
-
-    { 0.625f, 0.125f },
-    { 0.625f, 0.0f },
-    { 0.75f, 0.0f },
-    { 0.75f, 0.125f },    //41
-
-    { 0.875f, 0.125f },
-    { 0.875f, 0.0f },
-    { 1.0f, 0.0f }    //44
-};
-
-const uint16_t Indexes[] = {
-    0u, 1u, 2u,
-    0u, 2u, 3u,
-    0u, 3u, 4u,
-    0u, 4u, 5u,
-
-    6u, 5u, 4u,
-    6u, 4u, 3u,
-    6u, 3u, 7u,
-    6u, 7u, 8u,
-
-    6u, 8u, 9u,
-    6u, 9u, 10u,
-    6u, 10u, 11u,
-    6u, 11u, 5u,
-
-    12u, 5u, 11u,
-    12u, 11u, 10u,
-    12u, 10u, 13u,
-    12u, 13u, 14u,
-
-    15u, 14u, 13u,
-    15u, 13u, 10u,
-    15u, 10u, 16u,
-    15u, 16u, 17u,
-    15u, 17u, 18u,
-    15u, 18u, 19u,
-    15u, 19u, 20u,
-    15u, 20u, 14u,
-
-    21u, 10u, 9u,
-    21u, 9u, 8u,
-    21u, 8u, 22u,
-    21u, 22u, 23u,
-    21u, 23u, 24u,
-    21u, 24u, 17u,
-    21u, 17u, 16u,
-    21u, 16u, 10u,
-
-    25u, 17u, 24u,
-    25u, 24u, 23u,
-    25u, 23u, 26u,
-    25u, 26u, 27u,
-    25u, 27u, 28u,
-    25u, 28u, 29u,
-    25u, 29u, 30u,
-    25u, 30u, 17u,
-
-    31u, 19u, 18u,
-    31u, 18u, 17u,
-    31u, 17u, 30u,
-    31u, 30u, 29u,
-    31u, 29u, 32u,
-    31u, 32u, 33u,
-    31u, 33u, 34u,
-    31u, 34u, 19u,
-
-    35u, 14u, 20u,
-    35u, 20u, 19u,
-    35u, 19u, 36u,
-    35u, 36u, 37u,
-
-    38u, 37u, 36u,
-    38u, 36u, 19u,
-    38u, 19u, 34u,
-    38u, 34u, 33u,
-    38u, 33u, 39u,
-    38u, 39u, 40u,
-    38u, 40u, 41u,
-    38u, 41u, 37u,
-
-    42u, 37u, 41u,
-    42u, 41u, 40u,
-    42u, 40u, 43u,
-    42u, 43u, 44u
-};
@@ -1,4 +1,123 @@
 #include "Utils.hlsl"
+#include "ConcurrentBinaryTree.hlsl"
+
+// The CBT path keeps the atomic append for SubdCulledOut.
+#ifdef CBT_STORAGE
+#undef DETERMINISTIC_COMPACTION
+#endif
+// INCREMENTAL_LOD follows the keys of the atomic appends, and a frozen tree has no lod to skip.
+#if defined(CBT_STORAGE) || defined(DETERMINISTIC_COMPACTION) || defined(FREEZE_SUBDIVISION)
+#undef INCREMENTAL_LOD
+#endif
+
+// Writes the leaves that replace inHeapIndex in the next tree. Only child 1 drops, and
+// its sibling shares the parent lod, so the pair merges unless the sibling splits.
+// Returns true when the tree changes: a split, or child 1 going away in a merge.
+bool CbtEmitUpdate(uint inHeapIndex, PrimitiveData inData, uint inOp, float4 inVertices[3])
+{
+    int KeyLod = firstbithigh(inData.SubdBinaryKey);
+    int MaxKeyLod = CbtGetMaxDepth() - CBT_PRIMITIVE_BITS;
+    if (inOp == SUBD_OP_SPLIT && KeyLod < MaxKeyLod)
+    {
+        CbtEmitLeaf(inHeapIndex);
+        CbtEmitLeaf((inHeapIndex << 1u) | 1u);
+        return true;
+    }
+    if (inOp == SUBD_OP_DROP && CbtIsLeaf(inHeapIndex ^ 1u))
+    {
+        float4 SiblingVertices[3];
+        Subd(inData.SubdBinaryKey ^ 1u, inVertices, SiblingVertices);
+        int SiblingTargetLod = ComputeLod(SiblingVertices);
+        if (!(KeyLod < SiblingTargetLod && KeyLod < MaxKeyLod))
+            return true;
+    }
+    CbtEmitLeaf(inHeapIndex);
+    return false;
+}
+
+// Dispatch records read by the passes of the next LodKernel iteration: [0] LodKernel /
+// CompactionScatterKernel, [1] CompactionScanBlockKernel, [2] CbtClearKernel. Records [3],
+// LeafVertexKernel, and [5], the leaf sort kernels, follow the draw count instead, and
+// record [4], LodDirtyKernel, the keys LodKernel left dirty (DirtyBatcherKernel).
+void StoreIndirectDispatchArgs(uint inSubdDataCount)
+{
+    IndirectDispatchBuffer.Store3(0, uint3(inSubdDataCount / 32 + 1, 1, 1));
+    IndirectDispatchBuffer.Store3(12, uint3(inSubdDataCount / COMPACTION_BLOCK_SIZE + 1, 1, 1));
+#ifdef CBT_STORAGE
+    IndirectDispatchBuffer.Store3(24, uint3((1u << (CbtGetMaxDepth() - 5u)) / 256u, 1, 1));
+#else
+    IndirectDispatchBuffer.Store3(24, uint3(0, 1, 1));
+#endif
+}
+
+
+// Counts a key that split or merged.
+void CountSubdChange(uint inOp)
+{
+    if (inOp == SUBD_OP_KEEP)
+        return;
+    BufferCounter.InterlockedAdd(COUNTER_CHANGE_OFFSET, 1u);
+    // A merged pair is counted once, by the child 1 that drops.
+    if (inOp == SUBD_OP_SPLIT)
+        BufferCounter.InterlockedAdd(COUNTER_SPLIT_OFFSET, 1u);
+    else if (inOp == SUBD_OP_DROP)
+        BufferCounter.InterlockedAdd(COUNTER_MERGE_OFFSET, 1u);
+}
+
+// The box a leaf is culled with: its triangle, raised by the heightmap bounds under it.
+void GetLeafBox(float4 inVertices[3], out float4 outMinPosition, out float4 outMaxPosition)
+{
+    outMinPosition = min(min(inVertices[0], inVertices[1]), inVertices[2]);
+    outMaxPosition = max(max(inVertices[0], inVertices[1]), inVertices[2]);
+#ifdef DISPLACE
+    float2 HeightBounds = GetHeightBounds(outMinPosition.xy * 0.5f + 0.5f, outMaxPosition.xy * 0.5f + 0.5f) * LDisplacementFactor;
+    outMinPosition.z += min(HeightBounds.x, HeightBounds.y);
+    outMaxPosition.z += max(HeightBounds.x, HeightBounds.y);
+#endif
+}
+
+// Frustum test of a leaf box, then the HiZ test with OCCLUSION_CULLING.
+bool IsLeafVisible(float4 inMinPosition, float4 inMaxPosition)
+{
+    bool Visible = FrustumCullingTest(inMinPosition, inMaxPosition);
+#ifdef OCCLUSION_CULLING
+    if (Visible && HiZOcclusionTest(inMinPosition, inMaxPosition))
+    {
+        Visible = false;
+        BufferCounter.InterlockedAdd(COUNTER_OCCLUDED_OFFSET, 1u);
+    }
+#endif
+    return Visible;
+}
+
+void WriteKeyToSubdCulledOut(PrimitiveData inData)
+{
+    uint OriginValue = 0;
+    BufferCounter.InterlockedAdd(0, 1u, OriginValue);
+    SubdCulledOut[OriginValue] = inData;
+}
+
+// MULTI_VIEW: appends the leaf to the list of each view from 1 on whose frustum holds its
+// box. An atomic append in every mode; only view 0 follows DETERMINISTIC_COMPACTION.
+void WriteKeyToViewCulledOut(PrimitiveData inData, float4 inMinPosition, float4 inMaxPosition)
+{
+#ifdef MULTI_VIEW
+    uint BufferSize, Stride;
+    SubdViewCulledOut.GetDimensions(BufferSize, Stride);
+    uint ListSize = BufferSize / (MAX_LOD_VIEW_COUNT - 1);
+    for (uint View = 1; View < GetLodViewCount(); View++)
+    {
+#ifdef FRUSTUM_CULLING
+        if (!ViewFrustumCullingTest(View, inMinPosition, inMaxPosition))
+            continue;
+#endif
+        uint OriginValue = 0;
+        BufferCounter.InterlockedAdd(COUNTER_VIEW_CULLED_OFFSET + (View - 1) * 4, 1u, OriginValue);
+        if (OriginValue < ListSize)
+            SubdViewCulledOut[(View - 1) * ListSize + OriginValue] = inData;
+    }
+#endif
+}
 
 [numthreads(32,1,1)]
 void LodKernel(uint3 DispatchThreadId : SV_DispatchThreadID)
@@ -8,7 +127,42 @@ void LodKernel(uint3 DispatchThreadId : SV_DispatchThreadID)
     if (ThreadId >= BufferCounter.Load(8))
         return;
 
-    uint PrimitiveIndex = SubdIn[ThreadId].PrimitiveIndex;
+#ifdef CBT_STORAGE
+    uint HeapIndex = CbtDecodeLeaf(ThreadId);
+    PrimitiveData InData = CbtHeapIndexToSubdData(HeapIndex);
+    uint IndexCount = 0;
+    IndexBuffer.GetDimensions(IndexCount);
+    if (InData.PrimitiveIndex >= IndexCount / 3)
+    {
+        CbtEmitLeaf(HeapIndex);
+        return;
+    }
+#else
+    PrimitiveData InData = SubdIn[ThreadId];
+#endif
+
+#ifdef INCREMENTAL_LOD
+    // A key whose slack outlasts the camera travel keeps its op and its box; the others are
+    // evaluated by LodDirtyKernel.
+    LeafLodState State = SubdStateIn[ThreadId];
+    State.Slack -= CameraTravel;
+    if (!(State.Slack > 0.0f))
+    {
+        uint DirtyIndex = 0;
+        BufferCounter.InterlockedAdd(COUNTER_DIRTY_OFFSET, 1u, DirtyIndex);
+        SubdDirty[DirtyIndex] = ThreadId;
+        return;
+    }
+    SubdStateOut[WriteKeyToSubdBuffer(InData.PrimitiveIndex, InData.SubdBinaryKey)] = State;
+    float4 BoxMin = float4(State.BoxMin, 1.0f);
+    float4 BoxMax = float4(State.BoxMax, 1.0f);
+#ifdef FRUSTUM_CULLING
+    if (IsLeafVisible(BoxMin, BoxMax))
+#endif
+        WriteKeyToSubdCulledOut(InData);
+    WriteKeyToViewCulledOut(InData, BoxMin, BoxMax);
+#else
+    uint PrimitiveIndex = InData.PrimitiveIndex;
     float4 InVertices[3] =
     {
         VertexBuffer[IndexBuffer[PrimitiveIndex*3]],
@@ -16,7 +170,7 @@ void LodKernel(uint3 DispatchThreadId : SV_DispatchThreadID)
         VertexBuffer[IndexBuffer[PrimitiveIndex*3+2]]
     };
 
-    uint SubdBinaryKey = SubdIn[ThreadId].SubdBinaryKey;
+    uint SubdBinaryKey = InData.SubdBinaryKey;
     float4 OutVertices[3],OutParentVertices[3];
     Subd(SubdBinaryKey, InVertices, OutVertices, OutParentVertices);
     int TargetLod = ComputeLod(OutVertices);
@@ -24,36 +178,512 @@ void LodKernel(uint3 DispatchThreadId : SV_DispatchThreadID)
 #ifdef FREEZE_SUBDIVISION
     TargetLod = ParentLod = firstbithigh(SubdBinaryKey);
 #endif
-    UpdateSubdBuffer(SubdBinaryKey, TargetLod, ParentLod, PrimitiveIndex);
+#if defined(CBT_STORAGE)
+    uint Op = GetSubdUpdateOp(SubdBinaryKey, TargetLod, ParentLod);
+    if (CbtEmitUpdate(HeapIndex, InData, Op, InVertices))
+        CountSubdChange(Op);
+#elif defined(DETERMINISTIC_COMPACTION)
+    uint CompactionFlag = GetSubdUpdateOp(SubdBinaryKey, TargetLod, ParentLod);
+    CountSubdChange(CompactionFlag);
+#else
+    CountSubdChange(UpdateSubdBuffer(SubdBinaryKey, TargetLod, ParentLod, PrimitiveIndex));
+#endif
 
+    float4 MinPosition = float4(0.0f, 0.0f, 0.0f, 1.0f);
+    float4 MaxPosition = float4(0.0f, 0.0f, 0.0f, 1.0f);
 #ifdef FRUSTUM_CULLING
-    float4 MinPosition = min(min(OutVertices[0], OutVertices[1]), OutVertices[2]);
-    float4 MaxPosition = max(max(OutVertices[0], OutVertices[1]), OutVertices[2]);
-#ifdef DISPLACE
-    MinPosition.z = 0;
-    MaxPosition.z = LDisplacementFactor;
+    GetLeafBox(OutVertices, MinPosition, MaxPosition);
+    if (IsLeafVisible(MinPosition, MaxPosition))
 #endif
-    float4x4 ModelViewProjectionMatrix = gScene.camera.viewProjMat;
-    if (FrustumCullingTest(ModelViewProjectionMatrix, MinPosition, MaxPosition))
     {
+#ifdef DETERMINISTIC_COMPACTION
+        CompactionFlag |= COMPACTION_VISIBLE_FLAG;
 #else
-    if (true)
+        WriteKeyToSubdCulledOut(InData);
+#endif
+    }
+    WriteKeyToViewCulledOut(InData, MinPosition, MaxPosition);
+#ifdef DETERMINISTIC_COMPACTION
+    CompactionFlags[ThreadId] = CompactionFlag;
+#endif
+#endif
+}
+
+// Sizes dispatch record [4] to the keys the LodKernel pass before it left dirty.
+[numthreads(1,1,1)]
+void DirtyBatcherKernel()
+{
+    IndirectDispatchBuffer.Store3(48, uint3(BufferCounter.Load(COUNTER_DIRTY_OFFSET) / 32 + 1, 1, 1));
+}
+
+// INCREMENTAL_LOD second half of LodKernel: the full evaluation of the keys listed in
+// SubdDirty. Every key written gets a fresh state; those of a split or merge get no slack,
+// so the next pass evaluates them as well.
+[numthreads(32,1,1)]
+void LodDirtyKernel(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    if (DispatchThreadId.x >= BufferCounter.Load(COUNTER_DIRTY_OFFSET))
+        return;
+
+    PrimitiveData InData = SubdIn[SubdDirty[DispatchThreadId.x]];
+    uint PrimitiveIndex = InData.PrimitiveIndex;
+    float4 InVertices[3] =
     {
+        VertexBuffer[IndexBuffer[PrimitiveIndex*3]],
+        VertexBuffer[IndexBuffer[PrimitiveIndex*3+1]],
+        VertexBuffer[IndexBuffer[PrimitiveIndex*3+2]]
+    };
+
+    uint SubdBinaryKey = InData.SubdBinaryKey;
+    float4 OutVertices[3],OutParentVertices[3];
+    Subd(SubdBinaryKey, InVertices, OutVertices, OutParentVertices);
+    float Distance = GetMiddlePointDistance(OutVertices);
+    float ParentDistance = GetMiddlePointDistance(OutParentVertices);
+    float Roughness = GetLodRoughness(OutVertices);
+    float ParentRoughness = GetLodRoughness(OutParentVertices);
+    int TargetLod = ComputeLod(Distance, Roughness);
+    int ParentLod = ComputeLod(ParentDistance, ParentRoughness);
+    uint Op = GetSubdUpdateOp(SubdBinaryKey, TargetLod, ParentLod);
+    CountSubdChange(Op);
+
+    LeafLodState State;
+    State.Slack = 0.0f;
+    if (Op == SUBD_OP_KEEP)
+        State.Slack = ComputeLodSlack(SubdBinaryKey, Distance, Roughness, ParentDistance, ParentRoughness);
+    float4 MinPosition = float4(0.0f, 0.0f, 0.0f, 1.0f);
+    float4 MaxPosition = float4(0.0f, 0.0f, 0.0f, 1.0f);
+#ifdef FRUSTUM_CULLING
+    GetLeafBox(OutVertices, MinPosition, MaxPosition);
 #endif
-        PrimitiveData Data = { PrimitiveIndex, SubdBinaryKey };
-        uint OriginValue = 0;
-        BufferCounter.InterlockedAdd(0, 1u, OriginValue);
-        SubdCulledOut[OriginValue] = Data;
+    State.BoxMin = MinPosition.xyz;
+    State.BoxMax = MaxPosition.xyz;
+
+    uint Keys[2];
+    uint KeyCount = GetSubdUpdateKeys(Op, SubdBinaryKey, Keys);
+    for (uint i = 0; i < KeyCount; i++)
+    {
+        SubdStateOut[WriteKeyToSubdBuffer(PrimitiveIndex, Keys[i])] = State;
     }
+
+#ifdef FRUSTUM_CULLING
+    if (IsLeafVisible(MinPosition, MaxPosition))
+#endif
+        WriteKeyToSubdCulledOut(InData);
+    WriteKeyToViewCulledOut(InData, MinPosition, MaxPosition);
+}
+
+groupshared uint2 CompactionScanShared[COMPACTION_BLOCK_SIZE];
+
+// (SubdOut, SubdCulledOut) key counts of one LodKernel thread.
+uint2 GetCompactionCount(uint inCompactionFlag)
+{
+    uint Keys[2];
+    uint OutCount = GetSubdUpdateKeys(inCompactionFlag & COMPACTION_OP_MASK, 1u, Keys);
+    return uint2(OutCount, (inCompactionFlag & COMPACTION_VISIBLE_FLAG) ? 1u : 0u);
 }
 
+// Exclusive scan across one COMPACTION_BLOCK_SIZE group.
+uint2 CompactionGroupScan(uint inGroupThreadId, uint2 inValue)
+{
+    CompactionScanShared[inGroupThreadId] = inValue;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint Offset = 1; Offset < COMPACTION_BLOCK_SIZE; Offset <<= 1)
+    {
+        uint2 Addend = inGroupThreadId >= Offset ? CompactionScanShared[inGroupThreadId - Offset] : uint2(0, 0);
+        GroupMemoryBarrierWithGroupSync();
+        CompactionScanShared[inGroupThreadId] += Addend;
+        GroupMemoryBarrierWithGroupSync();
+    }
+    return CompactionScanShared[inGroupThreadId] - inValue;
+}
+
+[numthreads(COMPACTION_BLOCK_SIZE,1,1)]
+void CompactionScanBlockKernel(uint3 GroupId : SV_GroupID, uint3 GroupThreadId : SV_GroupThreadID, uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    uint ThreadId = DispatchThreadId.x;
+    uint2 Count = ThreadId < BufferCounter.Load(8) ? GetCompactionCount(CompactionFlags[ThreadId]) : uint2(0, 0);
+    uint2 Offset = CompactionGroupScan(GroupThreadId.x, Count);
+    CompactionOffsets[ThreadId] = Offset;
+    if (GroupThreadId.x == COMPACTION_BLOCK_SIZE - 1)
+        CompactionBlockSums[GroupId.x] = Offset + Count;
+}
+
+// Single group: scans the block sums in place and writes the totals where the
+// atomic path leaves its counters.
+[numthreads(COMPACTION_BLOCK_SIZE,1,1)]
+void CompactionScanBlockSumsKernel(uint3 GroupThreadId : SV_GroupThreadID)
+{
+    // Converged passes skip the scan, the block sums already hold offsets.
+    if (IsSubdConverged())
+        return;
+
+    uint BlockCount = min(BufferCounter.Load(8) / COMPACTION_BLOCK_SIZE + 1, COMPACTION_BLOCK_SIZE);
+    uint2 BlockSum = GroupThreadId.x < BlockCount ? CompactionBlockSums[GroupThreadId.x] : uint2(0, 0);
+    uint2 Offset = CompactionGroupScan(GroupThreadId.x, BlockSum);
+    if (GroupThreadId.x < BlockCount)
+        CompactionBlockSums[GroupThreadId.x] = Offset;
+    if (GroupThreadId.x == COMPACTION_BLOCK_SIZE - 1)
+    {
+        BufferCounter.Store(0, Offset.y + BlockSum.y);
+        BufferCounter.Store(4, Offset.x + BlockSum.x);
+    }
+}
+
+[numthreads(32,1,1)]
+void CompactionScatterKernel(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    uint ThreadId = DispatchThreadId.x;
+
+    if (ThreadId >= BufferCounter.Load(8))
+        return;
+
+    uint CompactionFlag = CompactionFlags[ThreadId];
+    uint2 Offset = CompactionOffsets[ThreadId] + CompactionBlockSums[ThreadId / COMPACTION_BLOCK_SIZE];
+    PrimitiveData Data = SubdIn[ThreadId];
+
+    uint Keys[2];
+    uint KeyCount = GetSubdUpdateKeys(CompactionFlag & COMPACTION_OP_MASK, Data.SubdBinaryKey, Keys);
+    for (uint i = 0; i < KeyCount; i++)
+    {
+        PrimitiveData OutData = { Data.PrimitiveIndex, Keys[i] };
+        SubdOut[Offset.x + i] = OutData;
+    }
+    if (CompactionFlag & COMPACTION_VISIBLE_FLAG)
+        SubdCulledOut[Offset.y] = Data;
+}
+
+// One dispatch per tree level, deepest first; CbtBitfieldIn is the bitfield LodKernel just emitted.
+[numthreads(256,1,1)]
+void CbtSumReductionKernel(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    uint NodeCount = 1u << CbtReductionDepth;
+    if (DispatchThreadId.x >= NodeCount)
+        return;
+
+    uint HeapIndex = NodeCount + DispatchThreadId.x;
+    CbtTree[HeapIndex] = CbtGetNodeCount(HeapIndex << 1u) + CbtGetNodeCount((HeapIndex << 1u) | 1u);
+}
+
+// CBT_STORAGE: clears the bitfield LodKernel emits into, indirect so converged passes skip it.
+[numthreads(256,1,1)]
+void CbtClearKernel(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    CbtBitfieldOut[DispatchThreadId.x] = 0u;
+}
+
+// Start of a frame: re-arms the dispatch records a converged pass emptied.
+[numthreads(1,1,1)]
+void ConvergenceResetKernel()
+{
+    StoreIndirectDispatchArgs(BufferCounter.Load(8));
+    BufferCounter.Store3(COUNTER_CHANGE_OFFSET, uint3(0, 0, 0));
+    BufferCounter.Store2(COUNTER_SPLIT_OFFSET, uint2(0, 0));
+}
+
+// Ends one LodKernel pass. A pass that changed nothing left SubdOut equal to SubdIn, so
+// both ping-pong buffers (or bitfields) hold the final tree and the rest of the frame's
+// passes are dispatched with zero groups.
 [numthreads(1,1,1)]
 void IndirectBatcherKernel()
 {
+    if (IsSubdConverged())
+        return;
+
+#ifdef CBT_STORAGE
+    uint SubdDataCount = CbtGetLeafCount();
+#else
     uint SubdDataCount = BufferCounter.Load(4);
-    IndirectDispatchBuffer.Store3(0, uint3(SubdDataCount / 32 + 1, 1, 1));
+#endif
+    StoreIndirectDispatchArgs(SubdDataCount);
+    if (BufferCounter.Load(COUNTER_CHANGE_OFFSET) == 0u)
+    {
+        IndirectDispatchBuffer.Store3(0, uint3(0, 1, 1));
+        IndirectDispatchBuffer.Store3(12, uint3(0, 1, 1));
+        IndirectDispatchBuffer.Store3(24, uint3(0, 1, 1));
+        BufferCounter.Store(COUNTER_CONVERGED_OFFSET, 1u);
+    }
     IndirectDrawBuffer.Store(4, BufferCounter.Load(0));
+    // The draw records of the MULTI_VIEW views, D3D12_DRAW_INDEXED_ARGUMENTS each.
+    for (uint View = 1; View < MAX_LOD_VIEW_COUNT; View++)
+        IndirectDrawBuffer.Store(View * 20 + 4, BufferCounter.Load(COUNTER_VIEW_CULLED_OFFSET + (View - 1) * 4));
+    BufferCounter.Store3(COUNTER_VIEW_CULLED_OFFSET, uint3(0, 0, 0));
+    IndirectDispatchBuffer.Store3(36, uint3(BufferCounter.Load(0) / 64 + 1, 1, 1));
+    IndirectDispatchBuffer.Store3(60, uint3(BufferCounter.Load(0) / LEAF_SORT_BLOCK_SIZE + 1, 1, 1));
     BufferCounter.Store3(0, uint3(0, 0, SubdDataCount));
+    BufferCounter.Store2(COUNTER_OCCLUDED_OFFSET, uint2(0, BufferCounter.Load(COUNTER_OCCLUDED_OFFSET)));
+    BufferCounter.Store2(COUNTER_DIRTY_OFFSET, uint2(0, BufferCounter.Load(COUNTER_DIRTY_OFFSET)));
+    BufferCounter.Store(COUNTER_CHANGE_OFFSET, 0u);
+    BufferCounter.Store(COUNTER_ITERATION_OFFSET, BufferCounter.Load(COUNTER_ITERATION_OFFSET) + 1u);
+}
+
+Texture2D<float> HiZIn;
+RWTexture2D<float> HiZOut;
+
+cbuffer HiZBuildCB
+{
+    uint2 HiZInSize;
+    uint2 HiZOutSize;
+};
+
+// One mip of HiZTexture: the farthest of the 2x2 texels of the level below (the depth
+// buffer for mip 0), taking in the leftover row or column of an odd size.
+[numthreads(8,8,1)]
+void HiZBuildKernel(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    uint2 Texel = DispatchThreadId.xy;
+    if (any(Texel >= HiZOutSize))
+        return;
+
+    uint2 Child0 = min(Texel * 2u, HiZInSize - 1u);
+    uint2 Child1 = Texel == HiZOutSize - 1u ? HiZInSize - 1u : Texel * 2u + 1u;
+    float MaxDepth = 0.0f;
+    for (uint y = Child0.y; y <= Child1.y; y++)
+    {
+        for (uint x = Child0.x; x <= Child1.x; x++)
+            MaxDepth = max(MaxDepth, HiZIn.Load(int3(x, y, 0)));
+    }
+    HiZOut[Texel] = MaxDepth;
+}
+
+// LEAF_VERTEX_PREPASS: runs Subd once per drawn leaf, so RenderKernelVS interpolates the
+// stored corners instead of re-deriving them for every vertex of the instance.
+[numthreads(64,1,1)]
+void LeafVertexKernel(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    uint ThreadId = DispatchThreadId.x;
+
+    if (ThreadId >= IndirectDrawBuffer.Load(4))
+        return;
+
+    PrimitiveData InData = SubdCulledOut[ThreadId];
+    uint PrimitiveIndex = InData.PrimitiveIndex;
+    float4 InVertices[3] =
+    {
+        VertexBuffer[IndexBuffer[PrimitiveIndex * 3]],
+        VertexBuffer[IndexBuffer[PrimitiveIndex * 3 + 1]],
+        VertexBuffer[IndexBuffer[PrimitiveIndex * 3 + 2]]
+    };
+
+    float4 OutVertices[3];
+    Subd(InData.SubdBinaryKey, InVertices, OutVertices);
+
+    LeafVertexData Leaf;
+    for (uint i = 0; i < 3; i++)
+    {
+        Leaf.Position[i] = OutVertices[i].xyz;
+#ifdef PHONG_TESSELLATION
+        Leaf.NormalXY[i] = -SampleSlope(OutVertices[i].xy * 0.5f + 0.5f) * RDisplacementFactor;
+#else
+        Leaf.NormalXY[i] = float2(0.0f, 0.0f);
+#endif
+    }
+    LeafVertices[ThreadId] = Leaf;
+}
+
+// Leaves of SubdCulledOut the sort passes cover, and their blocks.
+uint GetLeafSortCount()
+{
+    return IndirectDrawBuffer.Load(4);
+}
+
+uint GetLeafSortBlockCount()
+{
+    return GetLeafSortCount() / LEAF_SORT_BLOCK_SIZE + 1;
+}
+
+// Spreads the low 16 bits to the even bits, and the low 10 bits to every third bit.
+uint Part1By1(uint inValue)
+{
+    inValue &= 0x0000ffffu;
+    inValue = (inValue | (inValue << 8)) & 0x00ff00ffu;
+    inValue = (inValue | (inValue << 4)) & 0x0f0f0f0fu;
+    inValue = (inValue | (inValue << 2)) & 0x33333333u;
+    inValue = (inValue | (inValue << 1)) & 0x55555555u;
+    return inValue;
+}
+
+uint Part1By2(uint inValue)
+{
+    inValue &= 0x000003ffu;
+    inValue = (inValue | (inValue << 16)) & 0xff0000ffu;
+    inValue = (inValue | (inValue << 8)) & 0x0300f00fu;
+    inValue = (inValue | (inValue << 4)) & 0x030c30c3u;
+    inValue = (inValue | (inValue << 2)) & 0x09249249u;
+    return inValue;
+}
+
+// Headless::GetMortonKey: 2D on a flat mesh, where displacement only moves z.
+uint GetMortonKey(float3 inPosition)
+{
+    float MaxCell = (float)((1u << (LEAF_SORT_KEY_BITS / LeafSortDimensions)) - 1u);
+    uint3 Cell = (uint3)clamp((inPosition - LeafSortBoundsMin) * LeafSortBoundsScale, 0.0f, MaxCell);
+    if (LeafSortDimensions == 2)
+        return Part1By1(Cell.x) | (Part1By1(Cell.y) << 1);
+    return Part1By2(Cell.x) | (Part1By2(Cell.y) << 1) | (Part1By2(Cell.z) << 2);
+}
+
+// Copies SubdCulledOut to LeafSortDataOut with the key of each leaf's centroid, so the odd
+// count of sort passes ends back in SubdCulledOut.
+[numthreads(LEAF_SORT_BLOCK_SIZE,1,1)]
+void LeafSortKeyKernel(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    uint ThreadId = DispatchThreadId.x;
+
+    if (ThreadId >= GetLeafSortCount())
+        return;
+
+    PrimitiveData InData = SubdCulledOut[ThreadId];
+    uint PrimitiveIndex = InData.PrimitiveIndex;
+    float4 InVertices[3] =
+    {
+        VertexBuffer[IndexBuffer[PrimitiveIndex * 3]],
+        VertexBuffer[IndexBuffer[PrimitiveIndex * 3 + 1]],
+        VertexBuffer[IndexBuffer[PrimitiveIndex * 3 + 2]]
+    };
+
+    float4 OutVertices[3];
+    Subd(InData.SubdBinaryKey, InVertices, OutVertices);
+    LeafSortKeysOut[ThreadId] = GetMortonKey((OutVertices[0].xyz + OutVertices[1].xyz + OutVertices[2].xyz) / 3.0f);
+    LeafSortDataOut[ThreadId] = InData;
+}
+
+groupshared uint LeafSortScanShared[LEAF_SORT_BLOCK_SIZE];
+groupshared uint LeafSortKeyShared[LEAF_SORT_BLOCK_SIZE];
+groupshared PrimitiveData LeafSortDataShared[LEAF_SORT_BLOCK_SIZE];
+groupshared uint LeafSortDigitShared[LEAF_SORT_DIGIT_COUNT];
+
+// Exclusive scan across one LEAF_SORT_BLOCK_SIZE group, with the group total.
+uint LeafSortGroupScan(uint inGroupThreadId, uint inValue, out uint outTotal)
+{
+    LeafSortScanShared[inGroupThreadId] = inValue;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint Offset = 1; Offset < LEAF_SORT_BLOCK_SIZE; Offset <<= 1)
+    {
+        uint Addend = inGroupThreadId >= Offset ? LeafSortScanShared[inGroupThreadId - Offset] : 0u;
+        GroupMemoryBarrierWithGroupSync();
+        LeafSortScanShared[inGroupThreadId] += Addend;
+        GroupMemoryBarrierWithGroupSync();
+    }
+    uint Result = LeafSortScanShared[inGroupThreadId] - inValue;
+    outTotal = LeafSortScanShared[LEAF_SORT_BLOCK_SIZE - 1];
+    GroupMemoryBarrierWithGroupSync();
+    return Result;
+}
+
+uint GetLeafSortDigit(uint inKey)
+{
+    return (inKey >> LeafSortShift) & (LEAF_SORT_DIGIT_COUNT - 1);
+}
+
+[numthreads(LEAF_SORT_BLOCK_SIZE,1,1)]
+void LeafSortHistogramKernel(uint3 GroupId : SV_GroupID, uint3 GroupThreadId : SV_GroupThreadID, uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    if (GroupThreadId.x < LEAF_SORT_DIGIT_COUNT)
+        LeafSortDigitShared[GroupThreadId.x] = 0u;
+    GroupMemoryBarrierWithGroupSync();
+    if (DispatchThreadId.x < GetLeafSortCount())
+        InterlockedAdd(LeafSortDigitShared[GetLeafSortDigit(LeafSortKeysIn[DispatchThreadId.x])], 1u);
+    GroupMemoryBarrierWithGroupSync();
+    if (GroupThreadId.x < LEAF_SORT_DIGIT_COUNT)
+        LeafSortHistograms[GroupThreadId.x * GetLeafSortBlockCount() + GroupId.x] = LeafSortDigitShared[GroupThreadId.x];
+}
+
+// Single group: turns the digit-major counts into offsets, each thread scanning a run of them.
+[numthreads(LEAF_SORT_BLOCK_SIZE,1,1)]
+void LeafSortScanKernel(uint3 GroupThreadId : SV_GroupThreadID)
+{
+    uint EntryCount = GetLeafSortBlockCount() * LEAF_SORT_DIGIT_COUNT;
+    uint EntriesPerThread = (EntryCount + LEAF_SORT_BLOCK_SIZE - 1) / LEAF_SORT_BLOCK_SIZE;
+    uint Begin = GroupThreadId.x * EntriesPerThread;
+    uint End = min(Begin + EntriesPerThread, EntryCount);
+
+    uint Sum = 0;
+    for (uint i = Begin; i < End; i++)
+        Sum += LeafSortHistograms[i];
+    uint Total;
+    uint Offset = LeafSortGroupScan(GroupThreadId.x, Sum, Total);
+    for (uint j = Begin; j < End; j++)
+    {
+        uint Count = LeafSortHistograms[j];
+        LeafSortHistograms[j] = Offset;
+        Offset += Count;
+    }
+}
+
+// Orders the block by digit with one stable split per digit bit, then writes each key at its
+// digit's offset plus its rank among the block's keys of that digit. Threads past the count
+// hold an all-ones key, which sorts behind every leaf of the block.
+[numthreads(LEAF_SORT_BLOCK_SIZE,1,1)]
+void LeafSortScatterKernel(uint3 GroupId : SV_GroupID, uint3 GroupThreadId : SV_GroupThreadID, uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    uint LocalId = GroupThreadId.x;
+    uint Key = 0xffffffffu;
+    PrimitiveData Data = { 0u, 0u };
+    if (DispatchThreadId.x < GetLeafSortCount())
+    {
+        Key = LeafSortKeysIn[DispatchThreadId.x];
+        Data = LeafSortDataIn[DispatchThreadId.x];
+    }
+
+    for (uint Bit = 0; Bit < LEAF_SORT_RADIX_BITS; Bit++)
+    {
+        uint One = (Key >> (LeafSortShift + Bit)) & 1u;
+        uint ZeroCount;
+        uint Position = LeafSortGroupScan(LocalId, 1u - One, ZeroCount);
+        if (One != 0u)
+            Position = ZeroCount + LocalId - Position;
+        LeafSortKeyShared[Position] = Key;
+        LeafSortDataShared[Position] = Data;
+        GroupMemoryBarrierWithGroupSync();
+        Key = LeafSortKeyShared[LocalId];
+        Data = LeafSortDataShared[LocalId];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    // Where each digit starts in the ordered block.
+    uint Digit = GetLeafSortDigit(Key);
+    bool First = LocalId == 0;
+    if (!First)
+        First = GetLeafSortDigit(LeafSortKeyShared[LocalId - 1]) != Digit;
+    if (First)
+        LeafSortDigitShared[Digit] = LocalId;
+    GroupMemoryBarrierWithGroupSync();
+
+    uint BlockBegin = GroupId.x * LEAF_SORT_BLOCK_SIZE;
+    if (BlockBegin + LocalId >= GetLeafSortCount())
+        return;
+    uint Offset = LeafSortHistograms[Digit * GetLeafSortBlockCount() + GroupId.x] + LocalId - LeafSortDigitShared[Digit];
+    LeafSortKeysOut[Offset] = Key;
+    LeafSortDataOut[Offset] = Data;
+}
+
+// Berp over a LeafVertexKernel leaf. The linear part is Berp's; Phong tessellation projects
+// onto the tangent plane of each corner's normal instead of sampling the slope map per vertex.
+float4 LeafBerp(LeafVertexData inLeaf, float2 inUV)
+{
+    float4 inVertice[3] =
+    {
+        float4(inLeaf.Position[0], 1.0f),
+        float4(inLeaf.Position[1], 1.0f),
+        float4(inLeaf.Position[2], 1.0f)
+    };
+    float4 Result = float4(inVertice[0].xyz + inUV.x * (inVertice[1] - inVertice[0]).xyz + inUV.y * (inVertice[2] - inVertice[0]).xyz, 1.0f);
+#ifdef PHONG_TESSELLATION
+    float u = inUV.x;
+    float v = inUV.y;
+    float w = 1-inUV.x-inUV.y;
+    float3 Normal[3] =
+    {
+        normalize(float3(inLeaf.NormalXY[0], 1.0f)),
+        normalize(float3(inLeaf.NormalXY[1], 1.0f)),
+        normalize(float3(inLeaf.NormalXY[2], 1.0f))
+    };
+    Result = float4(pow(u, 2) * inVertice[1].xyz + pow(v, 2) * inVertice[2].xyz + pow(w, 2) * inVertice[0].xyz
+        + u * v * (GetProjectionPlaneVertex(inVertice[2], inVertice[1], Normal[1]) + GetProjectionPlaneVertex(inVertice[1], inVertice[2], Normal[2]))
+        + v * w * (GetProjectionPlaneVertex(inVertice[2], inVertice[0], Normal[0]) + GetProjectionPlaneVertex(inVertice[0], inVertice[2], Normal[2]))
+        + w * u * (GetProjectionPlaneVertex(inVertice[1], inVertice[0], Normal[0]) + GetProjectionPlaneVertex(inVertice[0], inVertice[1], Normal[1])), 1.0f);
+#endif
+    return Result;
 }
 
 struct VSIn
@@ -67,11 +697,16 @@ struct VSOut
     float4 PosH : SV_Position;
     uint InstanceId : TEXCOORD0;
     float2 Texc : TEXCOORD1;
+    float3 PosW : TEXCOORD2;
 };
 
 VSOut RenderKernelVS(VSIn VsIn)
 {
     VSOut ret;
+    uint SubdBinaryKey = SubdIn[VsIn.InstanceId].SubdBinaryKey;
+#ifdef LEAF_VERTEX_PREPASS
+    float4 FinalVertex = LeafBerp(LeafVertices[VsIn.InstanceId], SubdInstanced[VsIn.VertexId].BerpUV);
+#else
     uint PrimitiveIndex = SubdIn[VsIn.InstanceId].PrimitiveIndex;
     float4 InVertices[3] =
     {
@@ -80,10 +715,10 @@ VSOut RenderKernelVS(VSIn VsIn)
         VertexBuffer[IndexBuffer[PrimitiveIndex * 3 + 2]]
     };
 
-    uint SubdBinaryKey = SubdIn[VsIn.InstanceId].SubdBinaryKey;
     float4 OutVertives[3];
     Subd(SubdBinaryKey, InVertices, OutVertives);
     float4 FinalVertex = Berp(OutVertives, SubdInstanced[VsIn.VertexId].BerpUV);
+#endif
 
 #ifdef DISPLACE
     FinalVertex.z += HeightMapTexture.SampleLevel(HeightMapSampler,FinalVertex.xy * 0.5f + 0.5f,0).x * RDisplacementFactor;
@@ -91,6 +726,7 @@ VSOut RenderKernelVS(VSIn VsIn)
 
     ret.PosH = mul(FinalVertex, gScene.camera.viewProjMat);
     ret.InstanceId = VsIn.InstanceId;
+    ret.PosW = FinalVertex.xyz;
 #ifdef SHADING_LOD
     ret.Texc = intValToColor2(firstbithigh(SubdBinaryKey));
 #else
@@ -99,6 +735,18 @@ VSOut RenderKernelVS(VSIn VsIn)
     return ret;
 }
 
+// MESH_SHADING: a loaded mesh has no slope map, so the facet normal comes from the screen
+// space derivatives of the position, turned towards the camera.
+float3 GetShadingNormal(VSOut PSIn)
+{
+#ifdef MESH_SHADING
+    float3 Normal = normalize(cross(ddx(PSIn.PosW), ddy(PSIn.PosW)));
+    return dot(Normal, gScene.camera.posW - PSIn.PosW) < 0.0f ? -Normal : Normal;
+#else
+    return normalize(float3(-SampleSlope(PSIn.Texc) * RDisplacementFactor,1.0f));
+#endif
+}
+
 float4 RenderKernelPS(VSOut PSIn) : SV_Target
 {
     float4 PSColor = float4(1,0,0,1);
@@ -108,13 +756,13 @@ float4 RenderKernelPS(VSOut PSIn) : SV_Target
 #endif
     
 #ifdef SHADING_DIFFUSE
-    float3 Normal = normalize(float3(-(SlopeMapTexture.SampleLevel(SlopeMapSampler,PSIn.Texc,0).xy) * RDisplacementFactor,1.0f));
+    float3 Normal = GetShadingNormal(PSIn);
     float d = clamp(Normal.z,0.0f,1.0f) / 3.1415926f;
     PSColor = float4(d,d,d,1.0f);
 #endif
     
 #ifdef SHADING_NORMAL
-    float3 Normal = normalize(float3(-(SlopeMapTexture.SampleLevel(SlopeMapSampler,PSIn.Texc,0).xy) * RDisplacementFactor,1.0f));
+    float3 Normal = GetShadingNormal(PSIn);
     PSColor = float4(abs(Normal), 1.0f);
 #endif
 
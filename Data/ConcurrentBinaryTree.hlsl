@@ -0,0 +1,89 @@
+// Concurrent binary tree storage of the subdivision (CBT_STORAGE), same layout as
+// Headless/ConcurrentBinaryTree.h. CbtTree[0] holds the max depth and CbtTree[h] the
+// number of leaves under node h down to depth max - 6; deeper nodes are counted from
+// the bitfield words. LodKernel decodes its leaf from CbtBitfieldIn and emits the next
+// tree into CbtBitfieldOut, CbtSumReductionKernel then rebuilds CbtTree over it.
+
+#ifndef CBT_PRIMITIVE_BITS
+#define CBT_PRIMITIVE_BITS 1
+#endif
+
+RWStructuredBuffer<uint> CbtTree;
+RWStructuredBuffer<uint> CbtBitfieldIn;
+RWStructuredBuffer<uint> CbtBitfieldOut;
+
+uint CbtGetMaxDepth()
+{
+    return CbtTree[0];
+}
+
+uint CbtGetSlot(uint inHeapIndex)
+{
+    uint MaxDepth = CbtGetMaxDepth();
+    return (inHeapIndex << (MaxDepth - firstbithigh(inHeapIndex))) - (1u << MaxDepth);
+}
+
+uint CbtGetNodeCount(uint inHeapIndex)
+{
+    uint MaxDepth = CbtGetMaxDepth();
+    uint WordDepth = MaxDepth - 5u;
+    uint Depth = firstbithigh(inHeapIndex);
+    if (Depth < WordDepth)
+        return CbtTree[inHeapIndex];
+
+    uint Word = CbtBitfieldIn[(inHeapIndex >> (Depth - WordDepth)) - (1u << WordDepth)];
+    uint SlotCount = 1u << (MaxDepth - Depth);
+    uint Mask = SlotCount == 32u ? 0xFFFFFFFFu : ((1u << SlotCount) - 1u) << (CbtGetSlot(inHeapIndex) & 31u);
+    return countbits(Word & Mask);
+}
+
+uint CbtGetLeafCount()
+{
+    return CbtGetNodeCount(1u);
+}
+
+bool CbtIsLeaf(uint inHeapIndex)
+{
+    uint Slot = CbtGetSlot(inHeapIndex);
+    return (CbtBitfieldIn[Slot >> 5u] & (1u << (Slot & 31u))) != 0u && CbtGetNodeCount(inHeapIndex) == 1u;
+}
+
+uint CbtDecodeLeaf(uint inLeafIndex)
+{
+    uint HeapIndex = 1u;
+    while (CbtGetNodeCount(HeapIndex) > 1u)
+    {
+        uint LeftCount = CbtGetNodeCount(HeapIndex << 1u);
+        if (inLeafIndex < LeftCount)
+        {
+            HeapIndex = HeapIndex << 1u;
+        }
+        else
+        {
+            inLeafIndex -= LeftCount;
+            HeapIndex = (HeapIndex << 1u) | 1u;
+        }
+    }
+    return HeapIndex;
+}
+
+void CbtEmitLeaf(uint inHeapIndex)
+{
+    uint Slot = CbtGetSlot(inHeapIndex);
+    InterlockedOr(CbtBitfieldOut[Slot >> 5u], 1u << (Slot & 31u));
+}
+
+// The primitive index sits between the root bit and the key.
+PrimitiveData CbtHeapIndexToSubdData(uint inHeapIndex)
+{
+    uint KeyDepth = firstbithigh(inHeapIndex) - CBT_PRIMITIVE_BITS;
+    PrimitiveData Data;
+    Data.PrimitiveIndex = (inHeapIndex >> KeyDepth) & ((1u << CBT_PRIMITIVE_BITS) - 1u);
+    Data.SubdBinaryKey = (1u << KeyDepth) | (inHeapIndex & ((1u << KeyDepth) - 1u));
+    return Data;
+}
+
+cbuffer CbtReductionCB
+{
+    uint CbtReductionDepth;
+};
@@ -11,6 +11,21 @@ struct InstancedData
     float2 BerpUV;
 };
 
+// LeafVertexKernel output, see LeafVertexData in Headless/SubdShared.h.
+struct LeafVertexData
+{
+    float3 Position[3];
+    float2 NormalXY[3];
+};
+
+// INCREMENTAL_LOD state of a SubdIn / SubdOut key, see LeafLodState in Headless/SubdShared.h.
+struct LeafLodState
+{
+    float Slack;
+    float3 BoxMin;
+    float3 BoxMax;
+};
+
 struct FrustumPlane
 {
     float3 Normal;
@@ -20,19 +35,90 @@ struct FrustumPlane
 RWStructuredBuffer<PrimitiveData> SubdIn;
 RWStructuredBuffer<PrimitiveData> SubdOut;
 RWStructuredBuffer<PrimitiveData> SubdCulledOut;
+RWStructuredBuffer<LeafVertexData> LeafVertices;
+// INCREMENTAL_LOD: states ping-ponged with SubdIn / SubdOut, and the SubdIn indices LodKernel
+// left to LodDirtyKernel.
+RWStructuredBuffer<LeafLodState> SubdStateIn;
+RWStructuredBuffer<LeafLodState> SubdStateOut;
+RWStructuredBuffer<uint> SubdDirty;
+// MULTI_VIEW: the leaves kept by each view from 1 on, one equal share of the buffer per view.
+RWStructuredBuffer<PrimitiveData> SubdViewCulledOut;
 
 Buffer<float4> VertexBuffer;
 Buffer<uint> IndexBuffer;
+Buffer<float2> KeyTransformTable;
 
 RWByteAddressBuffer IndirectDrawBuffer;
 RWByteAddressBuffer IndirectDispatchBuffer;
 RWByteAddressBuffer BufferCounter;
 
+// BufferCounter after the (culled, SubdOut, SubdIn) counts, see SubdBufferCounter.
+#define COUNTER_CHANGE_OFFSET 12
+#define COUNTER_ITERATION_OFFSET 16
+#define COUNTER_CONVERGED_OFFSET 20
+#define COUNTER_SPLIT_OFFSET 24
+#define COUNTER_MERGE_OFFSET 28
+#define COUNTER_OCCLUDED_OFFSET 32
+#define COUNTER_LAST_OCCLUDED_OFFSET 36
+#define COUNTER_DIRTY_OFFSET 40
+#define COUNTER_LAST_DIRTY_OFFSET 44
+// One count per MULTI_VIEW view from 1 on.
+#define COUNTER_VIEW_CULLED_OFFSET 48
+
+// Views of MULTI_VIEW, gScene.camera included; Headless::MaxLodViewCount.
+#define MAX_LOD_VIEW_COUNT 4
+
+bool IsSubdConverged()
+{
+    return BufferCounter.Load(COUNTER_CONVERGED_OFFSET) != 0u;
+}
+
+// DETERMINISTIC_COMPACTION: LodKernel stores one flag per SubdIn key (update op in
+// bits 0-1, COMPACTION_VISIBLE_FLAG when it survives culling), the scan kernels turn
+// them into (SubdOut, SubdCulledOut) offsets, CompactionScatterKernel writes the keys.
+#define COMPACTION_BLOCK_SIZE 1024
+#define COMPACTION_OP_MASK 3u
+#define COMPACTION_VISIBLE_FLAG 4u
+RWStructuredBuffer<uint> CompactionFlags;
+RWStructuredBuffer<uint2> CompactionOffsets;
+RWStructuredBuffer<uint2> CompactionBlockSums;
+
+// Sort Leaves: SubdCulledOut ordered by the Morton key of the leaf centroids, see
+// Headless/SubdLeafSort.h. Each pass sorts LEAF_SORT_RADIX_BITS of the key from
+// (LeafSortKeysIn, LeafSortDataIn) into (LeafSortKeysOut, LeafSortDataOut), one
+// LEAF_SORT_BLOCK_SIZE block per group.
+#define LEAF_SORT_BLOCK_SIZE 1024
+#define LEAF_SORT_KEY_BITS 24
+#define LEAF_SORT_RADIX_BITS 8
+#define LEAF_SORT_DIGIT_COUNT 256
+RWStructuredBuffer<uint> LeafSortKeysIn;
+RWStructuredBuffer<uint> LeafSortKeysOut;
+RWStructuredBuffer<PrimitiveData> LeafSortDataIn;
+RWStructuredBuffer<PrimitiveData> LeafSortDataOut;
+// Digit-major: the count of digit d in block b at d * block count + b, then its offset.
+RWStructuredBuffer<uint> LeafSortHistograms;
+
+// Box the centroids are quantised in and the key bits of the pass, see Headless::LeafSortBounds.
+cbuffer LeafSortCB
+{
+    float3 LeafSortBoundsMin;
+    uint LeafSortDimensions;
+    float3 LeafSortBoundsScale;
+    uint LeafSortShift;
+};
+
 StructuredBuffer<InstancedData> SubdInstanced;
 Texture2D HeightMapTexture;
 SamplerState HeightMapSampler;
 Texture2D SlopeMapTexture;
 SamplerState SlopeMapSampler;
+// Min / max of the heightmap, see Headless::HeightBoundsPyramid: mip i holds heightmap mip i + 1.
+Texture2D<float2> HeightBoundsTexture;
+// OCCLUSION_CULLING: max depth pyramid of the previous frame, mip i holds depth mip i + 1.
+Texture2D<float> HiZTexture;
+// ROUGHNESS_LOD: max heightmap curvature, see Headless::RoughnessPyramid; laid out like
+// HeightBoundsTexture.
+Texture2D<float> RoughnessTexture;
 
 cbuffer LodKernelCB
 {
@@ -40,11 +126,35 @@ cbuffer LodKernelCB
     float TargetPixelSize;
     uint ScreenResolutionWidth;
     float LDisplacementFactor;
+    // (Normal, Intercept) of the six planes of gScene.camera.viewProjMat, from the CPU.
+    float4 FrustumPlanes[6];
+    // Rows of the view-projection matrix HiZTexture was rendered with, and the size of its
+    // depth buffer; a zero width turns HiZOcclusionTest off.
+    float4 HiZViewProj[4];
+    uint2 HiZSize;
+    uint2 HiZPadding;
+    // Curvature to world error scale and the largest step of RoughnessToLod away from the
+    // distance lod, see Headless::SetRoughnessLod.
+    float RoughnessLodScale;
+    float MaxLodOffset;
+    uint2 RoughnessPadding;
+    // INCREMENTAL_LOD: distance the camera moved since the last frame, see
+    // Headless::LodTravelTracker.
+    float CameraTravel;
+    uint3 TravelPadding;
+    // MULTI_VIEW: views 1 .. ViewCount - 1, each with its position, its distance scale to
+    // view 0 in w, and its frustum planes (six per view). See Headless::SetLodViews.
+    uint ViewCount;
+    uint3 ViewPadding;
+    float4 ViewPosW[MAX_LOD_VIEW_COUNT - 1];
+    float4 ViewFrustumPlanes[(MAX_LOD_VIEW_COUNT - 1) * 6];
 };
 
 cbuffer RenderKernelCB
 {
     float RDisplacementFactor;
+    // What SlopeMapTexture's slopes are multiplied by, see Headless::EncodedSlopeMap.
+    float RSlopeScale;
 };
 
 static float4x4 Identitymatrix4x4 =
@@ -94,8 +204,51 @@ float4x4 BitToTransform(uint inSubdBinaryBit)
     return Mat;
 }
 
+#ifndef KEY_TRANSFORM_CHUNK_BITS
+#define KEY_TRANSFORM_CHUNK_BITS 8
+#endif
+
+// Rows of the 2x3 affine part of a key transform: (u, v, 1) -> u * [0] + v * [1] + [2]
+float3x2 LoadKeyTransform(uint inTableIndex)
+{
+    return float3x2(KeyTransformTable[inTableIndex * 3], KeyTransformTable[inTableIndex * 3 + 1], KeyTransformTable[inTableIndex * 3 + 2]);
+}
+
+float3x2 AffineMul(float3x2 A, float3x2 B)
+{
+    float3x2 Result;
+    Result[0] = A[0].x * B[0] + A[0].y * B[1];
+    Result[1] = A[1].x * B[0] + A[1].y * B[1];
+    Result[2] = A[2].x * B[0] + A[2].y * B[1] + B[2];
+    return Result;
+}
+
+float4x4 AffineToTransform(float3x2 inAffine)
+{
+    float4x4 Mat =
+    {
+        float4(inAffine[0], 0.0f, 0.0f),
+        float4(inAffine[1], 0.0f, 0.0f),
+        float4(inAffine[2], 1.0f, 0.0f),
+        float4(0.0f, 0.0f, 0.0f, 1.0f)
+    };
+    return Mat;
+}
+
 float4x4 KeyToTransform(uint inSubdBinaryKey)
 {
+#ifdef KEY_TRANSFORM_TABLE
+    // KeyTransformTable holds the composed transform of every chunk of up to
+    // KEY_TRANSFORM_CHUNK_BITS bits, indexed by the chunk with its leading one set.
+    const uint FullChunk = 1u << KEY_TRANSFORM_CHUNK_BITS;
+    float3x2 Affine = float3x2(1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+    while (inSubdBinaryKey >= (FullChunk << 1u))
+    {
+        Affine = AffineMul(Affine, LoadKeyTransform(FullChunk | (inSubdBinaryKey & (FullChunk - 1u))));
+        inSubdBinaryKey = inSubdBinaryKey >> KEY_TRANSFORM_CHUNK_BITS;
+    }
+    return AffineToTransform(AffineMul(Affine, LoadKeyTransform(inSubdBinaryKey)));
+#else
     float4x4 Mat = Identitymatrix4x4;
     while (inSubdBinaryKey > 1u)
     {
@@ -104,6 +257,7 @@ float4x4 KeyToTransform(uint inSubdBinaryKey)
     }
         
     return Mat;
+#endif
 }
 
 float4x4 KeyToTransform(uint inSubdBinaryKey,out float4x4 ParentMatrix)
@@ -117,6 +271,23 @@ float3 GetProjectionPlaneVertex(float4 inTriangleVertice0, float4 inTriangleVert
     return inTriangleVertice0.xyz - dot((inTriangleVertice0.xyz - inTriangleVertice1.xyz), inNormal) * inNormal;
 }
 
+// Slopes of the heightmap at inUV, per unit of texture space. SLOPE_FROM_HEIGHTMAP leaves
+// SlopeMapTexture out and takes the central differences of the filtered heights instead, see
+// Headless::GetHeightMapSlope.
+float2 SampleSlope(float2 inUV)
+{
+#ifdef SLOPE_FROM_HEIGHTMAP
+    float Width, Height;
+    HeightMapTexture.GetDimensions(Width, Height);
+    float2 Texel = float2(1.0f / Width, 1.0f / Height);
+    float SlopeX = HeightMapTexture.SampleLevel(HeightMapSampler, inUV + float2(Texel.x, 0.0f), 0).x - HeightMapTexture.SampleLevel(HeightMapSampler, inUV - float2(Texel.x, 0.0f), 0).x;
+    float SlopeY = HeightMapTexture.SampleLevel(HeightMapSampler, inUV + float2(0.0f, Texel.y), 0).x - HeightMapTexture.SampleLevel(HeightMapSampler, inUV - float2(0.0f, Texel.y), 0).x;
+    return float2(SlopeX * Width, SlopeY * Height) * 0.5f;
+#else
+    return SlopeMapTexture.SampleLevel(SlopeMapSampler, inUV, 0).xy * RSlopeScale;
+#endif
+}
+
 float4 Berp(float4 inVertice[3], float2 inUV)
 {
     float4 Result;
@@ -126,7 +297,7 @@ float4 Berp(float4 inVertice[3], float2 inUV)
     float u = inUV.x;
     float v = inUV.y;
     float w = 1-inUV.x-inUV.y;
-    float3 Normal = normalize(float3(-(SlopeMapTexture.SampleLevel(SlopeMapSampler, LinearPos.xy * 0.5f + 0.5f, 0).xy) * RDisplacementFactor, 1.0f));
+    float3 Normal = normalize(float3(-SampleSlope(LinearPos.xy * 0.5f + 0.5f) * RDisplacementFactor, 1.0f));
     float4 PhongTessPos = float4(pow(u, 2) * inVertice[1].xyz + pow(v, 2) * inVertice[2].xyz + pow(w, 2) * inVertice[0].xyz
         + u * v * (GetProjectionPlaneVertex(inVertice[2], inVertice[1], Normal) + GetProjectionPlaneVertex(inVertice[1], inVertice[2], Normal))
         + v * w * (GetProjectionPlaneVertex(inVertice[2], inVertice[0], Normal) + GetProjectionPlaneVertex(inVertice[0], inVertice[2], Normal))
@@ -182,45 +353,187 @@ float DistanceToLod(float inDistance)
     return -log2(clamp(ImagePlaneSize, 0.0f, 1.0f));
 }
 
+// Largest normalized heightmap curvature in the bilinear footprint of [inMinUV, inMaxUV],
+// from at most 3 x 3 texels of one RoughnessTexture level, whose texels already include
+// the ring bilinear sampling reads around them. Mirrors
+// Headless::RoughnessPyramid::GetRoughness.
+float GetRoughness(float2 inMinUV, float2 inMaxUV)
+{
+    uint SourceWidth, SourceHeight, LevelCount;
+    HeightMapTexture.GetDimensions(0, SourceWidth, SourceHeight, LevelCount);
+    float2 MaxTexel = float2(SourceWidth - 1, SourceHeight - 1);
+    float2 SourceSize = float2(SourceWidth, SourceHeight);
+    uint2 Texel0 = (uint2)clamp(floor(inMinUV * SourceSize), 0.0f, MaxTexel);
+    uint2 Texel1 = max((uint2)clamp(ceil(inMaxUV * SourceSize) - 1.0f, 0.0f, MaxTexel), Texel0);
+
+    uint Width, Height;
+    RoughnessTexture.GetDimensions(0, Width, Height, LevelCount);
+    uint2 Span = Texel1 - Texel0;
+    uint Level = (uint)clamp((int)firstbithigh(max(Span.x, Span.y)) - 1, 0, (int)LevelCount - 1);
+    uint2 LevelMax = max(uint2(Width, Height) >> Level, 1u) - 1u;
+    Texel0 = min(Texel0 >> (Level + 1u), LevelMax);
+    Texel1 = min(Texel1 >> (Level + 1u), LevelMax);
+
+    float Roughness = 0.0f;
+    for (uint y = Texel0.y; y <= Texel1.y; y++)
+    {
+        for (uint x = Texel0.x; x <= Texel1.x; x++)
+            Roughness = max(Roughness, RoughnessTexture.Load(int3(x, y, Level)));
+    }
+    return Roughness;
+}
+
+// Lod at which the patch triangles stay within the screen error over a region of roughness
+// inRoughness, at most MaxLodOffset levels from the distance lod. Mirrors
+// Headless::RoughnessToLod.
+float RoughnessToLod(float inLod, float inDistance, float inRoughness)
+{
+    float PixelWorldSize = 2 * inDistance * tan(FovX / 2) / ScreenResolutionWidth;
+    float ErrorLod = log2(max(inRoughness * RoughnessLodScale, 1e-30f)) - log2(PixelWorldSize);
+    return clamp(ErrorLod, inLod - MaxLodOffset, inLod + MaxLodOffset);
+}
+
+uint GetLodViewCount()
+{
+    return clamp(ViewCount, 1u, MAX_LOD_VIEW_COUNT);
+}
+
+// With MULTI_VIEW the smallest of the view distances scaled to view 0: the views share
+// TargetPixelSize, so its lod is the largest of theirs. Mirrors
+// Headless::GetMiddlePointDistance.
+float GetMiddlePointDistance(float4 inVertices[3])
+{
+    float4 MiddlePoint = (inVertices[1] + inVertices[2]) / 2.0f;
+    float Distance = distance(MiddlePoint, float4(gScene.camera.posW,1.0f));
+#ifdef MULTI_VIEW
+    for (uint View = 1; View < GetLodViewCount(); View++)
+        Distance = min(Distance, distance(MiddlePoint.xyz, ViewPosW[View - 1].xyz) * ViewPosW[View - 1].w);
+#endif
+    return Distance;
+}
+
+// Roughness ComputeLod reads under a triangle; zero without ROUGHNESS_LOD.
+float GetLodRoughness(float4 inVertices[3])
+{
+#if defined(ROUGHNESS_LOD) && defined(DISPLACE)
+    float4 MinPosition = min(min(inVertices[0], inVertices[1]), inVertices[2]);
+    float4 MaxPosition = max(max(inVertices[0], inVertices[1]), inVertices[2]);
+    return GetRoughness(MinPosition.xy * 0.5f + 0.5f, MaxPosition.xy * 0.5f + 0.5f);
+#else
+    return 0.0f;
+#endif
+}
+
+float ComputeLod(float inDistance, float inRoughness)
+{
+    float Lod = DistanceToLod(inDistance);
+#if defined(ROUGHNESS_LOD) && defined(DISPLACE)
+    Lod = RoughnessToLod(Lod, inDistance, inRoughness);
+#endif
+    return Lod;
+}
+
 float ComputeLod(float4 inVertices[3])
 {
-    float MiddlePointToCamera = distance((inVertices[1] + inVertices[2]) / 2.0f, float4(gScene.camera.posW,1.0f));
-    return DistanceToLod(MiddlePointToCamera);
+    return ComputeLod(GetMiddlePointDistance(inVertices), GetLodRoughness(inVertices));
+}
+
+// Largest camera distance at which ComputeLod still reaches inLod (>= 1). Mirrors
+// Headless::LodToDistance.
+float LodToDistance(float inLod, float inRoughness)
+{
+    float PixelScale = 2 * tan(FovX / 2) / ScreenResolutionWidth;
+    float Distance = exp2(-inLod) / (PixelScale * TargetPixelSize);
+#if defined(ROUGHNESS_LOD) && defined(DISPLACE)
+    float ErrorDistance = exp2(log2(max(inRoughness * RoughnessLodScale, 1e-30f)) - inLod) / PixelScale;
+    float NearDistance = exp2(-(inLod + MaxLodOffset)) / (PixelScale * TargetPixelSize);
+    float FarDistance = exp2(-(inLod - MaxLodOffset)) / (PixelScale * TargetPixelSize);
+    Distance = max(ErrorDistance, NearDistance);
+    if (inLod - MaxLodOffset > 0.0f)
+        Distance = min(Distance, FarDistance);
+#endif
+    return min(Distance, 1e30f);
+}
+
+float GetLodThresholdSlack(float inDistance, float inThreshold)
+{
+    return abs(inDistance - inThreshold) - 1e-3f * inThreshold;
+}
+
+// Distance the camera can move before the op of a kept key could change: its lod reaching
+// KeyLod + 1 or its parent's falling below KeyLod. Mirrors Headless::ComputeLodSlack.
+float ComputeLodSlack(uint inSubdBinaryKey, float inDistance, float inRoughness, float inParentDistance, float inParentRoughness)
+{
+    int KeyLod = firstbithigh(inSubdBinaryKey);
+    float Slack = 1e30f;
+    if (!IsLeafKey(inSubdBinaryKey))
+        Slack = GetLodThresholdSlack(inDistance, LodToDistance(KeyLod + 1, inRoughness));
+    if (!IsRootKey(inSubdBinaryKey))
+        Slack = min(Slack, GetLodThresholdSlack(inParentDistance, LodToDistance(KeyLod, inParentRoughness)));
+    return max(Slack, 0.0f);
 }
 
-void WriteKeyToSubdBuffer(uint inPrimitiveIndex,uint inSubdBinaryKey)
+// Returns the SubdOut index written.
+uint WriteKeyToSubdBuffer(uint inPrimitiveIndex,uint inSubdBinaryKey)
 {
     uint OriginValue = 0;
     BufferCounter.InterlockedAdd(4, 1u, OriginValue);
     PrimitiveData Data = { inPrimitiveIndex, inSubdBinaryKey };
     SubdOut[OriginValue] = Data;
+    return OriginValue;
 }
 
-void UpdateSubdBuffer(uint inSubdBinaryKey, int inTargetLod, int inParentLod, uint inPrimitiveIndex)
+#define SUBD_OP_SPLIT 0u
+#define SUBD_OP_KEEP 1u
+#define SUBD_OP_MERGE 2u
+#define SUBD_OP_DROP 3u
+
+uint GetSubdUpdateOp(uint inSubdBinaryKey, int inTargetLod, int inParentLod)
 {
     int KeyLod = firstbithigh(inSubdBinaryKey);
     if (KeyLod < inTargetLod && !IsLeafKey(inSubdBinaryKey))
     {
-        uint ChildrenKey[2];
-        GetChildrenKey(inSubdBinaryKey, ChildrenKey);
-        WriteKeyToSubdBuffer(inPrimitiveIndex, ChildrenKey[0]);
-        WriteKeyToSubdBuffer(inPrimitiveIndex, ChildrenKey[1]);
+        return SUBD_OP_SPLIT;
     }
     else if (KeyLod < (inParentLod+1))
     {
-        WriteKeyToSubdBuffer(inPrimitiveIndex, inSubdBinaryKey);
+        return SUBD_OP_KEEP;
     }
     else
     {
         if (IsRootKey(inSubdBinaryKey))
         {
-            WriteKeyToSubdBuffer(inPrimitiveIndex, inSubdBinaryKey);
+            return SUBD_OP_KEEP;
         }
         else if(IsChildZeroKey(inSubdBinaryKey))
         {
-            WriteKeyToSubdBuffer(inPrimitiveIndex, GetParentKey(inSubdBinaryKey));
+            return SUBD_OP_MERGE;
         }
     }
+    return SUBD_OP_DROP;
+}
+
+// Keys an update op writes to SubdOut, returns how many of outKeys are used.
+uint GetSubdUpdateKeys(uint inOp, uint inSubdBinaryKey, out uint outKeys[2])
+{
+    GetChildrenKey(inSubdBinaryKey, outKeys);
+    if (inOp == SUBD_OP_SPLIT)
+        return 2u;
+    outKeys[0] = inOp == SUBD_OP_MERGE ? GetParentKey(inSubdBinaryKey) : inSubdBinaryKey;
+    return inOp == SUBD_OP_DROP ? 0u : 1u;
+}
+
+// Returns the op it applied.
+uint UpdateSubdBuffer(uint inSubdBinaryKey, int inTargetLod, int inParentLod, uint inPrimitiveIndex)
+{
+    uint Op = GetSubdUpdateOp(inSubdBinaryKey, inTargetLod, inParentLod);
+    uint Keys[2];
+    uint KeyCount = GetSubdUpdateKeys(Op, inSubdBinaryKey, Keys);
+    for (uint i = 0; i < KeyCount; i++)
+    {
+        WriteKeyToSubdBuffer(inPrimitiveIndex, Keys[i]);
+    }
+    return Op;
 }
 
 float2 intValToColor2(int keyLod)
@@ -233,34 +546,101 @@ float2 intValToColor2(int keyLod)
     return float2(float(bx) / 7.0f, float(by) / 7.0f);
 }
 
-void GetFrustumPlane(float4x4 inModelViewProjection,out FrustumPlane outFrustumPlane[6])
+// Bounds of the normalized heights HeightMapTexture returns in the UV rectangle
+// [inMinUV, inMaxUV]: 2x2 texels of the finest HeightBoundsTexture mip covering the
+// bilinear footprint. Mirrors Headless::HeightBoundsPyramid::GetHeightBounds.
+float2 GetHeightBounds(float2 inMinUV, float2 inMaxUV)
 {
-    float NormalizedNormal = 0.0f;
-    for (int i = 0; i < 3; i++)
+    uint SourceWidth, SourceHeight, LevelCount;
+    HeightMapTexture.GetDimensions(0, SourceWidth, SourceHeight, LevelCount);
+    float2 MaxTexel = float2(SourceWidth - 1, SourceHeight - 1);
+    float2 SourceSize = float2(SourceWidth, SourceHeight);
+    uint2 Texel0 = (uint2)clamp(floor(inMinUV * SourceSize - 0.5f), 0.0f, MaxTexel);
+    uint2 Texel1 = (uint2)clamp(floor(inMaxUV * SourceSize - 0.5f) + 1.0f, 0.0f, MaxTexel);
+
+    uint Width, Height;
+    HeightBoundsTexture.GetDimensions(0, Width, Height, LevelCount);
+    uint2 Span = Texel1 - Texel0;
+    uint Level = (uint)clamp((int)firstbithigh(max(Span.x, Span.y)), 0, (int)LevelCount - 1);
+    uint2 LevelMax = max(uint2(Width, Height) >> Level, 1u) - 1u;
+    Texel0 = min(Texel0 >> (Level + 1u), LevelMax);
+    Texel1 = min(Texel1 >> (Level + 1u), LevelMax);
+
+    float2 Bounds00 = HeightBoundsTexture.Load(int3(Texel0.x, Texel0.y, Level));
+    float2 Bounds10 = HeightBoundsTexture.Load(int3(Texel1.x, Texel0.y, Level));
+    float2 Bounds01 = HeightBoundsTexture.Load(int3(Texel0.x, Texel1.y, Level));
+    float2 Bounds11 = HeightBoundsTexture.Load(int3(Texel1.x, Texel1.y, Level));
+    return float2(min(min(Bounds00.x, Bounds10.x), min(Bounds01.x, Bounds11.x)), max(max(Bounds00.y, Bounds10.y), max(Bounds01.y, Bounds11.y)));
+}
+
+// Box against the LodKernelCB frustum planes: lerp(Min, Max, step(0, n)) is the box
+// corner furthest along each plane normal.
+bool FrustumCullingTest(float4 MinPosition, float4 MaxPosition)
+{
+    float Result = 0.0f;
+    for (int i = 0; i < 6 && Result >= 0.0f; i++)
     {
-        for (int j = 0; j < 2; j++)
-        {
-            outFrustumPlane[i * 2 + j].Normal.x = (i == 2 && j == 0 ? 0 : inModelViewProjection[0][3]) + (j == 0 ? inModelViewProjection[0][i] : -inModelViewProjection[0][i]);
-            outFrustumPlane[i * 2 + j].Normal.y = (i == 2 && j == 0 ? 0 : inModelViewProjection[1][3]) + (j == 0 ? inModelViewProjection[1][i] : -inModelViewProjection[1][i]);
-            outFrustumPlane[i * 2 + j].Normal.z = (i == 2 && j == 0 ? 0 : inModelViewProjection[2][3]) + (j == 0 ? inModelViewProjection[2][i] : -inModelViewProjection[2][i]);
-            outFrustumPlane[i * 2 + j].Intercept = (i == 2 && j == 0 ? 0 : inModelViewProjection[3][3]) + (j == 0 ? inModelViewProjection[3][i] : -inModelViewProjection[3][i]);
-            NormalizedNormal = length(outFrustumPlane[i * 2 + j].Normal);
-            outFrustumPlane[i * 2 + j].Normal /= NormalizedNormal;
-            outFrustumPlane[i * 2 + j].Intercept /= NormalizedNormal;
-        }
+        float4 CompareResult = step(float4(0.0f, 0.0f, 0.0f, 0.0f), float4(FrustumPlanes[i].xyz, 0.0f));
+        float3 PositivePos = lerp(MinPosition, MaxPosition, CompareResult).xyz;
+        Result = dot(FrustumPlanes[i], float4(PositivePos, 1.0f));
     }
+    return (Result >= 0);
 }
 
-bool FrustumCullingTest(float4x4 inModelViewProjection,float4 MaxPosition,float4 MinPosition)
+// MULTI_VIEW: box against the frustum planes of view inView >= 1.
+bool ViewFrustumCullingTest(uint inView, float4 MinPosition, float4 MaxPosition)
 {
     float Result = 0.0f;
-    FrustumPlane mFrustumPlane[6];
-    GetFrustumPlane(inModelViewProjection, mFrustumPlane);
     for (int i = 0; i < 6 && Result >= 0.0f; i++)
     {
-        float4 CompareResult = step(float4(0.0f, 0.0f, 0.0f, 0.0f), float4(mFrustumPlane[i].Normal, 0.0f));
-        float3 NegativePos = lerp(MaxPosition, MinPosition, CompareResult).xyz;
-        Result = dot(float4(mFrustumPlane[i].Normal, mFrustumPlane[i].Intercept), float4(NegativePos, 1.0f));
+        float4 Plane = ViewFrustumPlanes[(inView - 1) * 6 + i];
+        float4 CompareResult = step(float4(0.0f, 0.0f, 0.0f, 0.0f), float4(Plane.xyz, 0.0f));
+        float3 PositivePos = lerp(MinPosition, MaxPosition, CompareResult).xyz;
+        Result = dot(Plane, float4(PositivePos, 1.0f));
     }
     return (Result >= 0);
 }
+
+// True when the box lies behind the previous frame's depth everywhere it projects to: its
+// nearest depth against the farthest HiZTexture depth over 2x2 texels of the finest mip
+// covering its screen rectangle. Boxes crossing the camera plane are never occluded.
+// Mirrors Headless::HiZOcclusionTest.
+bool HiZOcclusionTest(float4 MinPosition, float4 MaxPosition)
+{
+    if (HiZSize.x == 0u)
+        return false;
+
+    float4x4 ViewProjMat = float4x4(HiZViewProj[0], HiZViewProj[1], HiZViewProj[2], HiZViewProj[3]);
+    float2 MinUV = float2(1.0f, 1.0f);
+    float2 MaxUV = float2(0.0f, 0.0f);
+    float MinDepth = 1.0f;
+    for (uint i = 0; i < 8; i++)
+    {
+        float4 Corner = float4((i & 1u) ? MaxPosition.x : MinPosition.x, (i & 2u) ? MaxPosition.y : MinPosition.y, (i & 4u) ? MaxPosition.z : MinPosition.z, 1.0f);
+        float4 Clip = mul(Corner, ViewProjMat);
+        if (Clip.w <= 0.0f)
+            return false;
+        float2 UV = float2(Clip.x / Clip.w * 0.5f + 0.5f, 0.5f - Clip.y / Clip.w * 0.5f);
+        MinUV = min(MinUV, UV);
+        MaxUV = max(MaxUV, UV);
+        MinDepth = min(MinDepth, Clip.z / Clip.w);
+    }
+    if (any(MaxUV < 0.0f) || any(MinUV > 1.0f))
+        return false;
+
+    float2 MaxTexel = float2(HiZSize - 1u);
+    uint2 Texel0 = (uint2)clamp(floor(MinUV * float2(HiZSize)), 0.0f, MaxTexel);
+    uint2 Texel1 = (uint2)clamp(floor(MaxUV * float2(HiZSize)), 0.0f, MaxTexel);
+
+    uint Width, Height, LevelCount;
+    HiZTexture.GetDimensions(0, Width, Height, LevelCount);
+    uint2 Span = Texel1 - Texel0;
+    uint Level = (uint)clamp((int)firstbithigh(max(Span.x, Span.y)), 0, (int)LevelCount - 1);
+    uint2 LevelMax = max(uint2(Width, Height) >> Level, 1u) - 1u;
+    Texel0 = min(Texel0 >> (Level + 1u), LevelMax);
+    Texel1 = min(Texel1 >> (Level + 1u), LevelMax);
+
+    float MaxDepth = max(max(HiZTexture.Load(int3(Texel0.x, Texel0.y, Level)), HiZTexture.Load(int3(Texel1.x, Texel0.y, Level))),
+        max(HiZTexture.Load(int3(Texel0.x, Texel1.y, Level)), HiZTexture.Load(int3(Texel1.x, Texel1.y, Level))));
+    return MinDepth > MaxDepth;
+}
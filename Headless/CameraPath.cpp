@@ -0,0 +1,174 @@
+#include "CameraPath.h"
+#include "SubdEngine.h"
+#include <cstdio>
+
+namespace Headless {
+
+static float3 CatmullRom(const float3& p0, const float3& p1, const float3& p2, const float3& p3, float t) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f * (2.0f * p1 + t * (p2 - p0) + t2 * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) + t3 * (3.0f * p1 - p0 - 3.0f * p2 + p3));
+}
+
+void CameraPath::AddKey(const CameraPathKey& inKey) {
+    // Keys stay sorted by time; a key at an existing time replaces it.
+    auto It = std::lower_bound(mKeys.begin(), mKeys.end(), inKey.Time, [](const CameraPathKey& inA, float inTime) { return inA.Time < inTime; });
+    if (It != mKeys.end() && It->Time == inKey.Time) {
+        *It = inKey;
+    } else {
+        mKeys.insert(It, inKey);
+    }
+}
+
+bool CameraPath::Load(const std::string& inPath) {
+    FILE* File = fopen(inPath.c_str(), "r");
+    if (!File) {
+        return false;
+    }
+    std::vector<CameraPathKey> Keys;
+    char Line[512];
+    bool Valid = true;
+    while (Valid && fgets(Line, sizeof(Line), File)) {
+        const char* Cursor = Line;
+        while (*Cursor == ' ' || *Cursor == '\t') {
+            ++Cursor;
+        }
+        if (*Cursor == '#' || *Cursor == '\n' || *Cursor == '\r' || *Cursor == 0) {
+            continue;
+        }
+        CameraPathKey Key;
+        int Cut = 0;
+        int Count = sscanf(Cursor, "%f %f %f %f %f %f %f %f %f %f %d", &Key.Time, &Key.PosW.x, &Key.PosW.y, &Key.PosW.z, &Key.Target.x, &Key.Target.y,
+            &Key.Target.z, &Key.Up.x, &Key.Up.y, &Key.Up.z, &Cut);
+        // The up vector and the cut flag are optional.
+        Valid = Count == 7 || Count == 10 || Count == 11;
+        Key.Cut = Cut != 0;
+        Keys.push_back(Key);
+    }
+    fclose(File);
+    if (!Valid) {
+        return false;
+    }
+    mKeys.clear();
+    for (const CameraPathKey& Key : Keys) {
+        AddKey(Key);
+    }
+    return true;
+}
+
+bool CameraPath::Save(const std::string& inPath) const {
+    FILE* File = fopen(inPath.c_str(), "w");
+    if (!File) {
+        return false;
+    }
+    fprintf(File, "# time px py pz tx ty tz ux uy uz cut\n");
+    for (const CameraPathKey& Key : mKeys) {
+        fprintf(File, "%.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %d\n", Key.Time, Key.PosW.x, Key.PosW.y, Key.PosW.z, Key.Target.x, Key.Target.y,
+            Key.Target.z, Key.Up.x, Key.Up.y, Key.Up.z, Key.Cut ? 1 : 0);
+    }
+    return fclose(File) == 0;
+}
+
+CameraPathKey CameraPath::Evaluate(float inTime) const {
+    if (mKeys.size() < 2) {
+        return mKeys.empty() ? CameraPathKey() : mKeys.front();
+    }
+    float Time = clamp(mKeys.front().Time + inTime, mKeys.front().Time, mKeys.back().Time);
+    size_t i = 1;
+    while (i + 1 < mKeys.size() && mKeys[i].Time <= Time) {
+        ++i;
+    }
+    const CameraPathKey& k1 = mKeys[i - 1];
+    const CameraPathKey& k2 = mKeys[i];
+    // No tangent reaches across a cut.
+    const CameraPathKey& k0 = i >= 2 && !k1.Cut ? mKeys[i - 2] : k1;
+    const CameraPathKey& k3 = i + 1 < mKeys.size() && !mKeys[i + 1].Cut ? mKeys[i + 1] : k2;
+    float t = k2.Time > k1.Time ? (Time - k1.Time) / (k2.Time - k1.Time) : 1.0f;
+    if (k2.Cut) {
+        t = Time >= k2.Time ? 1.0f : 0.0f;
+    }
+
+    CameraPathKey Key;
+    Key.Time = Time;
+    Key.PosW = CatmullRom(k0.PosW, k1.PosW, k2.PosW, k3.PosW, t);
+    Key.Target = CatmullRom(k0.Target, k1.Target, k2.Target, k3.Target, t);
+    Key.Up = normalize(k1.Up + t * (k2.Up - k1.Up));
+    return Key;
+}
+
+SubdCamera CameraPath::GetCamera(float inTime, const CameraProjection& inProjection) const {
+    CameraPathKey Key = Evaluate(inTime);
+    SubdCamera Camera;
+    Camera.PosW = Key.PosW;
+    Camera.ViewProjMat = CreateViewProjMat(Key.PosW, Key.Target, Key.Up, inProjection.FovY, inProjection.AspectRatio, inProjection.NearZ, inProjection.FarZ);
+    return Camera;
+}
+
+CameraPath CameraPath::CreateFlyover() {
+    CameraPath Path;
+    const CameraPathKey Keys[] = {
+        { 0.0f, float3(-0.95f, -0.95f, 0.60f), float3(0.0f, 0.0f, 0.0f) },
+        { 4.0f, float3(-0.60f, -0.55f, 0.12f), float3(0.2f, 0.3f, 0.0f) },
+        { 8.0f, float3(-0.10f, -0.05f, 0.02f), float3(0.6f, 0.5f, 0.0f) },
+        { 11.0f, float3(0.35f, 0.25f, 0.01f), float3(0.6f, -0.5f, 0.0f) },
+        { 14.0f, float3(0.50f, -0.30f, 0.03f), float3(-0.3f, -0.8f, 0.0f) },
+        { 17.0f, float3(0.10f, -0.70f, 0.25f), float3(-0.6f, 0.2f, 0.0f) },
+        { 20.0f, float3(-0.40f, -0.40f, 1.20f), float3(0.0f, 0.2f, 0.0f) },
+    };
+    for (const CameraPathKey& Key : Keys) {
+        Path.AddKey(Key);
+    }
+    return Path;
+}
+
+CameraPath CameraPath::CreateGrazing() {
+    CameraPath Path;
+    const CameraPathKey Keys[] = {
+        { 0.0f, float3(-0.90f, -0.20f, 0.015f), float3(1.0f, 0.1f, 0.0f) },
+        { 4.0f, float3(-0.30f, -0.10f, 0.008f), float3(1.0f, 0.4f, 0.0f) },
+        { 8.0f, float3(0.30f, 0.20f, 0.010f), float3(0.9f, 1.0f, 0.0f) },
+        { 12.0f, float3(0.70f, 0.70f, 0.020f), float3(-0.2f, 1.0f, 0.0f) },
+    };
+    for (const CameraPathKey& Key : Keys) {
+        Path.AddKey(Key);
+    }
+    return Path;
+}
+
+CameraPath CameraPath::CreateTeleport() {
+    CameraPath Path;
+    const CameraPathKey Stops[] = {
+        { 0.0f, float3(-0.95f, -0.95f, 0.60f), float3(0.0f, 0.0f, 0.0f) },
+        { 2.0f, float3(0.35f, 0.25f, 0.01f), float3(0.6f, -0.5f, 0.0f) },
+        { 4.0f, float3(0.80f, -0.80f, 0.30f), float3(-0.2f, 0.2f, 0.0f) },
+        { 6.0f, float3(-0.10f, -0.05f, 0.02f), float3(0.6f, 0.5f, 0.0f) },
+    };
+    for (size_t i = 0; i < sizeof(Stops) / sizeof(Stops[0]); ++i) {
+        CameraPathKey Key = Stops[i];
+        Key.Cut = i > 0;
+        Path.AddKey(Key);
+    }
+    // The last view holds for two seconds as well.
+    CameraPathKey Last = Stops[sizeof(Stops) / sizeof(Stops[0]) - 1];
+    Last.Time += 2.0f;
+    Path.AddKey(Last);
+    return Path;
+}
+
+CameraPath CameraPath::CreateOrbit(const float3& inCenter, float inRadius, float inHeight, float inDuration, uint32_t inTurns) {
+    CameraPath Path;
+    // Eight keys a turn keep the spline within one percent of the circle.
+    uint32_t KeyCount = std::max(inTurns, 1u) * 8;
+    for (uint32_t i = 0; i <= KeyCount; ++i) {
+        float Angle = 6.2831853f * (float)i / 8.0f;
+        CameraPathKey Key;
+        Key.Time = inDuration * (float)i / (float)KeyCount;
+        Key.PosW = inCenter + float3(inRadius * std::sin(Angle), inHeight, inRadius * std::cos(Angle));
+        Key.Target = inCenter;
+        Key.Up = float3(0.0f, 1.0f, 0.0f);
+        Path.AddKey(Key);
+    }
+    return Path;
+}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "SubdUtils.h"
+
+namespace Headless {
+
+// Perspective the camera path is rendered with; the defaults match the benchmark tools
+// (a 42 mm lens on a 24 mm frame at 1920 x 1080, Falcor's depth range of the sample).
+struct CameraProjection {
+    float FovY = 2.0f * std::atan(24.0f / 42.0f);
+    float AspectRatio = 1920.0f / 1080.0f;
+    float NearZ = 0.0001f;
+    float FarZ = 95.0f;
+    uint32_t ScreenResolutionWidth = 1920;
+
+    float GetFovX() const { return FovY * AspectRatio; }
+};
+
+struct CameraPathKey {
+    float Time = 0.0f;
+    float3 PosW;
+    float3 Target;
+    float3 Up = float3(0.0f, 0.0f, 1.0f);
+    // The camera jumps to this key: it holds the previous key until then, and the spline
+    // starts again from here.
+    bool Cut = false;
+};
+
+// Timed camera keys, interpolated with a Catmull-Rom spline through the positions and
+// targets. Stored as text, one key per line: "time px py pz tx ty tz ux uy uz cut" (up and
+// cut optional); lines starting with '#' are comments.
+class CameraPath {
+public:
+    void AddKey(const CameraPathKey& inKey);
+    void Clear() { mKeys.clear(); }
+
+    bool Load(const std::string& inPath);
+    bool Save(const std::string& inPath) const;
+
+    bool IsEmpty() const { return mKeys.empty(); }
+    const std::vector<CameraPathKey>& GetKeys() const { return mKeys; }
+    float GetDuration() const { return mKeys.empty() ? 0.0f : mKeys.back().Time - mKeys.front().Time; }
+
+    // inTime is relative to the first key and clamped to the path.
+    CameraPathKey Evaluate(float inTime) const;
+    SubdCamera GetCamera(float inTime, const CameraProjection& inProjection = CameraProjection()) const;
+
+    // 20 second flight over the unit quad terrain: a dive from above the corner, a turn
+    // skimming the ground plane (where the leaves get deep) and a climb out.
+    static CameraPath CreateFlyover();
+    // 12 seconds skimming the ground plane at a grazing angle, towards the horizon.
+    static CameraPath CreateGrazing();
+    // Four still views of the terrain, two seconds each, with a cut between them.
+    static CameraPath CreateTeleport();
+    // inTurns turns in inDuration seconds around the y axis through inCenter (Suzanne.obj
+    // is y up), inRadius away and inHeight above it.
+    static CameraPath CreateOrbit(const float3& inCenter, float inRadius, float inHeight, float inDuration, uint32_t inTurns);
+
+private:
+    std::vector<CameraPathKey> mKeys;
+};
+
+}
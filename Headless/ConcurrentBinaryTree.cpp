@@ -0,0 +1,135 @@
+#include "ConcurrentBinaryTree.h"
+#include <algorithm>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Headless {
+
+ConcurrentBinaryTree::ConcurrentBinaryTree(uint32_t inMaxDepth)
+    : mMaxDepth(std::min(std::max(inMaxDepth, 5u), 30u)) {
+    mWordDepth = mMaxDepth - 5;
+    mBitfieldWordCount = (size_t)1 << mWordDepth;
+    mTree.assign(mBitfieldWordCount, 0u);
+    mTree[0] = mMaxDepth;
+    mBitfield[0].assign(mBitfieldWordCount, 0u);
+    mBitfield[1].assign(mBitfieldWordCount, 0u);
+}
+
+size_t ConcurrentBinaryTree::GetByteSize() const {
+    return (mTree.size() + 2 * mBitfieldWordCount) * sizeof(uint32_t);
+}
+
+void ConcurrentBinaryTree::Reset(const std::vector<uint32_t>& inLeaves, ThreadPool& inThreadPool) {
+    ClearNext(inThreadPool);
+    for (uint32_t Leaf : inLeaves) {
+        EmitLeaf(Leaf);
+    }
+    Reduce(inThreadPool);
+}
+
+void ConcurrentBinaryTree::SetBitfield(const uint32_t* inWords, ThreadPool& inThreadPool) {
+    uint32_t* Next = mBitfield[1 - mCurrent].data();
+    inThreadPool.ParallelFor(mBitfieldWordCount, 1 << 16, [=](size_t inBegin, size_t inEnd) {
+        std::copy(inWords + inBegin, inWords + inEnd, Next + inBegin);
+    });
+    Reduce(inThreadPool);
+}
+
+uint32_t ConcurrentBinaryTree::GetNodeCount(uint32_t inHeapIndex) const {
+    uint32_t Depth = (uint32_t)firstbithigh(inHeapIndex);
+    if (Depth < mWordDepth) {
+        return mTree[inHeapIndex];
+    }
+    uint32_t Word = mBitfield[mCurrent][(inHeapIndex >> (Depth - mWordDepth)) - (1u << mWordDepth)];
+    uint32_t SlotCount = 1u << (mMaxDepth - Depth);
+    uint32_t Mask = SlotCount == 32u ? ~0u : ((1u << SlotCount) - 1u) << (GetSlot(inHeapIndex) & 31u);
+    return countbits(Word & Mask);
+}
+
+bool ConcurrentBinaryTree::IsLeaf(uint32_t inHeapIndex) const {
+    uint32_t Slot = GetSlot(inHeapIndex);
+    return (mBitfield[mCurrent][Slot >> 5] & (1u << (Slot & 31u))) != 0u && GetNodeCount(inHeapIndex) == 1u;
+}
+
+uint32_t ConcurrentBinaryTree::DecodeLeaf(uint32_t inLeafIndex) const {
+    uint32_t HeapIndex = 1u;
+    while (GetNodeCount(HeapIndex) > 1u) {
+        uint32_t LeftCount = GetNodeCount(HeapIndex << 1u);
+        if (inLeafIndex < LeftCount) {
+            HeapIndex = HeapIndex << 1u;
+        }
+        else {
+            inLeafIndex -= LeftCount;
+            HeapIndex = (HeapIndex << 1u) | 1u;
+        }
+    }
+    return HeapIndex;
+}
+
+uint32_t ConcurrentBinaryTree::EncodeLeaf(uint32_t inHeapIndex) const {
+    uint32_t LeafIndex = 0;
+    for (; inHeapIndex > 1u; inHeapIndex >>= 1u) {
+        if (inHeapIndex & 1u) {
+            LeafIndex += GetNodeCount(inHeapIndex ^ 1u);
+        }
+    }
+    return LeafIndex;
+}
+
+uint32_t ConcurrentBinaryTree::GetNextLeaf(uint32_t inHeapIndex) const {
+    while (inHeapIndex & 1u) {
+        inHeapIndex >>= 1u;
+    }
+    if (inHeapIndex == 0u) {
+        return 0u;
+    }
+    inHeapIndex += 1u;
+    while (GetNodeCount(inHeapIndex) > 1u) {
+        inHeapIndex <<= 1u;
+    }
+    return inHeapIndex;
+}
+
+void ConcurrentBinaryTree::ClearNext(ThreadPool& inThreadPool) {
+    uint32_t* Next = mBitfield[1 - mCurrent].data();
+    inThreadPool.ParallelFor(mBitfieldWordCount, 1 << 16, [Next](size_t inBegin, size_t inEnd) {
+        std::fill(Next + inBegin, Next + inEnd, 0u);
+    });
+}
+
+void ConcurrentBinaryTree::EmitLeaf(uint32_t inHeapIndex) {
+    uint32_t Slot = GetSlot(inHeapIndex);
+    uint32_t* Word = &mBitfield[1 - mCurrent][Slot >> 5];
+#if defined(_MSC_VER)
+    _InterlockedOr((volatile long*)Word, (long)(1u << (Slot & 31u)));
+#else
+    __atomic_fetch_or(Word, 1u << (Slot & 31u), __ATOMIC_RELAXED);
+#endif
+}
+
+void ConcurrentBinaryTree::Reduce(ThreadPool& inThreadPool) {
+    mCurrent = 1 - mCurrent;
+    if (mWordDepth == 0) {
+        return;
+    }
+    // Deepest stored level straight from the bitfield words, then pairwise sums.
+    const uint32_t* Words = mBitfield[mCurrent].data();
+    uint32_t* Tree = mTree.data();
+    uint32_t First = 1u << (mWordDepth - 1);
+    inThreadPool.ParallelFor(First, 1 << 14, [=](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            Tree[First + i] = countbits(Words[2 * i]) + countbits(Words[2 * i + 1]);
+        }
+    });
+    for (int Depth = (int)mWordDepth - 2; Depth >= 0; --Depth) {
+        First = 1u << Depth;
+        inThreadPool.ParallelFor(First, 1 << 14, [=](size_t inBegin, size_t inEnd) {
+            for (size_t HeapIndex = First + inBegin; HeapIndex < First + inEnd; ++HeapIndex) {
+                Tree[HeapIndex] = Tree[2 * HeapIndex] + Tree[2 * HeapIndex + 1];
+            }
+        });
+    }
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include "SubdMath.h"
+#include "ThreadPool.h"
+
+namespace Headless {
+
+// Concurrent binary tree: the leaves of a binary tree no deeper than MaxDepth, stored as
+// a bitfield of 2^MaxDepth slots with one bit set at the first slot of every leaf, plus
+// a sum-reduction tree that counts the set bits under each node. The root count is the
+// leaf count, and the i-th leaf is found by walking down the sum tree in O(MaxDepth).
+//
+// Same layout as CbtTree / CbtBitfieldIn in Data/ConcurrentBinaryTree.hlsl: tree words in
+// heap order, Tree[0] = MaxDepth and Tree[h] = leaf count of node h for depths up to
+// MaxDepth - 6. Deeper nodes are counted straight from the 32-bit bitfield words.
+//
+// The bitfield is double buffered so a frame can decode leaves from the current tree
+// while the next one is emitted with atomic ors: ClearNext, EmitLeaf for every leaf of
+// the new tree, then Reduce swaps the bitfields and rebuilds the sum tree. That is about
+// 3 bits per slot, whatever the leaf count.
+class ConcurrentBinaryTree {
+public:
+    explicit ConcurrentBinaryTree(uint32_t inMaxDepth);
+
+    uint32_t GetMaxDepth() const { return mMaxDepth; }
+    uint32_t GetLeafCount() const { return GetNodeCount(1u); }
+    size_t GetByteSize() const;
+
+    // Replaces the tree with inLeaves (heap indices that partition the root).
+    void Reset(const std::vector<uint32_t>& inLeaves, ThreadPool& inThreadPool);
+    // Replaces the tree with 2^(MaxDepth - 5) bitfield words, e.g. read back from CbtBitfieldIn.
+    void SetBitfield(const uint32_t* inWords, ThreadPool& inThreadPool);
+
+    uint32_t GetNodeCount(uint32_t inHeapIndex) const;
+    bool IsLeaf(uint32_t inHeapIndex) const;
+    uint32_t DecodeLeaf(uint32_t inLeafIndex) const;
+    uint32_t EncodeLeaf(uint32_t inHeapIndex) const;
+    // Leaf following inHeapIndex, 0 after the last one. Amortised O(1) when walking all leaves.
+    uint32_t GetNextLeaf(uint32_t inHeapIndex) const;
+
+    void ClearNext(ThreadPool& inThreadPool);
+    // Thread safe; only touches the next bitfield.
+    void EmitLeaf(uint32_t inHeapIndex);
+    void Reduce(ThreadPool& inThreadPool);
+
+    const std::vector<uint32_t>& GetTreeWords() const { return mTree; }
+    // Current bitfield, 2^(MaxDepth - 5) words.
+    const std::vector<uint32_t>& GetBitfieldWords() const { return mBitfield[mCurrent]; }
+
+private:
+    uint32_t GetSlot(uint32_t inHeapIndex) const {
+        uint32_t Depth = (uint32_t)firstbithigh(inHeapIndex);
+        return (inHeapIndex << (mMaxDepth - Depth)) - (1u << mMaxDepth);
+    }
+
+    uint32_t mMaxDepth;
+    uint32_t mWordDepth;
+    size_t mBitfieldWordCount;
+    std::vector<uint32_t> mTree;
+    // Plain words: the next bitfield is only written through EmitLeaf's atomic or and
+    // only read after Reduce swaps it in.
+    std::vector<uint32_t> mBitfield[2];
+    int mCurrent = 0;
+};
+
+}
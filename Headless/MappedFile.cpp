@@ -0,0 +1,96 @@
+#include "MappedFile.h"
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Headless {
+
+bool MappedFile::Open(const std::string& inPath) {
+    Close();
+#if defined(_WIN32)
+    HANDLE File = CreateFileA(inPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (File == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER Size;
+    if (!GetFileSizeEx(File, &Size)) {
+        CloseHandle(File);
+        return false;
+    }
+    mFileHandle = File;
+    mSize = (size_t)Size.QuadPart;
+    mIsOpen = true;
+    // An empty file cannot be mapped; it is still a valid open file.
+    if (mSize == 0) {
+        return true;
+    }
+    mMappingHandle = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mMappingHandle) {
+        Close();
+        return false;
+    }
+    mpData = (const uint8_t*)MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+    int File = open(inPath.c_str(), O_RDONLY);
+    if (File < 0) {
+        return false;
+    }
+    struct stat Stat;
+    if (fstat(File, &Stat) != 0) {
+        close(File);
+        return false;
+    }
+    mSize = (size_t)Stat.st_size;
+    mIsOpen = true;
+    if (mSize == 0) {
+        close(File);
+        return true;
+    }
+    void* Data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, File, 0);
+    close(File);
+    if (Data == MAP_FAILED) {
+        mIsOpen = false;
+        mSize = 0;
+        return false;
+    }
+    madvise(Data, mSize, MADV_SEQUENTIAL);
+    mpData = (const uint8_t*)Data;
+#endif
+    if (!mpData) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close() {
+#if defined(_WIN32)
+    if (mpData) {
+        UnmapViewOfFile(mpData);
+    }
+    if (mMappingHandle) {
+        CloseHandle((HANDLE)mMappingHandle);
+    }
+    if (mFileHandle) {
+        CloseHandle((HANDLE)mFileHandle);
+    }
+    mMappingHandle = nullptr;
+    mFileHandle = nullptr;
+#else
+    if (mpData) {
+        munmap((void*)mpData, mSize);
+    }
+#endif
+    mpData = nullptr;
+    mSize = 0;
+    mIsOpen = false;
+}
+
+}
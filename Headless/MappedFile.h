@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Headless {
+
+// Read-only memory mapping of a whole file; pages are faulted in as they are read.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& inPath);
+    void Close();
+
+    bool IsOpen() const { return mIsOpen; }
+    const uint8_t* GetData() const { return mpData; }
+    size_t GetSize() const { return mSize; }
+
+private:
+    const uint8_t* mpData = nullptr;
+    size_t mSize = 0;
+    bool mIsOpen = false;
+#if defined(_WIN32)
+    void* mFileHandle = nullptr;
+    void* mMappingHandle = nullptr;
+#endif
+};
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "ThreadPool.h"
+
+namespace Headless {
+
+// Two-pass stream compaction: inCountBlock(begin, end) returns how many outputs a block
+// produces, block totals are prefix-summed in order, then inScatterBlock(begin, end, offset)
+// writes the block's outputs starting at its offset. Block boundaries depend only on
+// inBlockSize, so the output order is the input order whatever the thread count.
+// T needs a value-initialised zero and operator+. Returns the grand total.
+template <typename T, typename CountFunc, typename ScatterFunc>
+T ParallelCompact(size_t inCount, size_t inBlockSize, ThreadPool& inThreadPool, CountFunc&& inCountBlock, ScatterFunc&& inScatterBlock) {
+    size_t BlockCount = (inCount + inBlockSize - 1) / inBlockSize;
+    std::vector<T> BlockOffsets(BlockCount + 1, T());
+
+    inThreadPool.ParallelFor(BlockCount, 1, [&](size_t inBlockBegin, size_t inBlockEnd) {
+        for (size_t Block = inBlockBegin; Block < inBlockEnd; ++Block) {
+            size_t Begin = Block * inBlockSize;
+            BlockOffsets[Block + 1] = inCountBlock(Begin, std::min(inCount, Begin + inBlockSize));
+        }
+    });
+    for (size_t Block = 0; Block < BlockCount; ++Block) {
+        BlockOffsets[Block + 1] = BlockOffsets[Block] + BlockOffsets[Block + 1];
+    }
+    inThreadPool.ParallelFor(BlockCount, 1, [&](size_t inBlockBegin, size_t inBlockEnd) {
+        for (size_t Block = inBlockBegin; Block < inBlockEnd; ++Block) {
+            size_t Begin = Block * inBlockSize;
+            inScatterBlock(Begin, std::min(inCount, Begin + inBlockSize), BlockOffsets[Block]);
+        }
+    });
+    return BlockOffsets[BlockCount];
+}
+
+// Exclusive prefix sum in place; returns the total.
+template <typename T>
+T ParallelExclusiveScan(T* ioValues, size_t inCount, ThreadPool& inThreadPool, size_t inBlockSize = 1 << 16) {
+    return ParallelCompact<T>(inCount, inBlockSize, inThreadPool,
+        [ioValues](size_t inBegin, size_t inEnd) {
+            T Sum = T();
+            for (size_t i = inBegin; i < inEnd; ++i) {
+                Sum = Sum + ioValues[i];
+            }
+            return Sum;
+        },
+        [ioValues](size_t inBegin, size_t inEnd, T inOffset) {
+            for (size_t i = inBegin; i < inEnd; ++i) {
+                T Value = ioValues[i];
+                ioValues[i] = inOffset;
+                inOffset = inOffset + Value;
+            }
+        });
+}
+
+}
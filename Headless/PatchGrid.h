@@ -0,0 +1,154 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+namespace Headless {
+
+// Instanced patches drawn by RenderKernelVS for every leaf (SubdInstanced and its index
+// buffer), generated at compile time. A level L patch is the unit triangle bisected L times
+// the way SubdBinaryKey bisects: triangle k has the corners Subd gives key (1 << L) | k, so a
+// leaf drawn with it shows the triangles of its depth + L descendants. Triangles follow key
+// order, the bisection's space filling curve, and vertices are numbered by first use.
+
+const uint32_t PatchGridMinLevel = 1;
+const uint32_t PatchGridMaxLevel = 8;
+// The 45 vertex, 192 index patch the sample's TargetPixelSize is tuned for.
+const uint32_t DefaultPatchLevel = 6;
+
+// InstancedData of Data/Utils.hlsl.
+struct PatchVertex {
+    float BerpUV[2] = {};
+};
+
+constexpr uint32_t GetPatchIndexCount(uint32_t inLevel) {
+    return 3u << inLevel;
+}
+
+// An even level has n = 2^(L/2) segments per leg and (n+1)(n+2)/2 vertices; the odd level
+// above it adds the n(n+1)/2 midpoints of its diagonals.
+constexpr uint32_t GetPatchVertexCount(uint32_t inLevel) {
+    uint32_t n = 1u << (inLevel / 2);
+    return (n + 1) * (n + 2) / 2 + (inLevel % 2 ? n * (n + 1) / 2 : 0);
+}
+
+// Writes a level inLevel patch: GetPatchVertexCount vertices, GetPatchIndexCount indices.
+constexpr void BuildPatchGrid(uint32_t inLevel, PatchVertex* outVertices, uint16_t* outIndices) {
+    // Corners live on the lattice of spacing 2^-LatticeBits, exact in integers.
+    const uint32_t MaxLatticeSize = (1u << ((PatchGridMaxLevel + 1) / 2)) + 1;
+    const uint32_t LatticeBits = (inLevel + 1) / 2;
+    const uint32_t Scale = 1u << LatticeBits;
+    uint32_t VertexSlot[MaxLatticeSize * MaxLatticeSize] = {};
+    uint32_t VertexCount = 0;
+
+    for (uint32_t Triangle = 0; Triangle < (1u << inLevel); ++Triangle) {
+        uint32_t U[3] = { 0, Scale, 0 };
+        uint32_t V[3] = { 0, 0, Scale };
+        // BitToTransform as a corner map: child 0 is (middle, c0, c2), child 1 (middle, c1, c0),
+        // with middle the midpoint of the c1 c2 diagonal. The key's top bit is the first split.
+        for (uint32_t Depth = inLevel; Depth > 0; --Depth) {
+            uint32_t MiddleU = (U[1] + U[2]) / 2;
+            uint32_t MiddleV = (V[1] + V[2]) / 2;
+            if ((Triangle >> (Depth - 1)) & 1u) {
+                U[2] = U[0];
+                V[2] = V[0];
+            }
+            else {
+                U[1] = U[0];
+                V[1] = V[0];
+            }
+            U[0] = MiddleU;
+            V[0] = MiddleV;
+        }
+
+        for (uint32_t i = 0; i < 3; ++i) {
+            uint32_t& Slot = VertexSlot[V[i] * MaxLatticeSize + U[i]];
+            if (Slot == 0) {
+                outVertices[VertexCount].BerpUV[0] = (float)U[i] / (float)Scale;
+                outVertices[VertexCount].BerpUV[1] = (float)V[i] / (float)Scale;
+                Slot = ++VertexCount;
+            }
+            outIndices[Triangle * 3 + i] = (uint16_t)(Slot - 1);
+        }
+    }
+}
+
+template<uint32_t Level>
+struct PatchGrid {
+    static_assert(Level >= PatchGridMinLevel && Level <= PatchGridMaxLevel, "Patch level out of range");
+    static constexpr uint32_t VertexCount = GetPatchVertexCount(Level);
+    static constexpr uint32_t IndexCount = GetPatchIndexCount(Level);
+
+    PatchVertex Vertices[VertexCount] = {};
+    uint16_t Indices[IndexCount] = {};
+};
+
+template<uint32_t Level>
+constexpr PatchGrid<Level> MakePatchGrid() {
+    PatchGrid<Level> Grid;
+    BuildPatchGrid(Level, Grid.Vertices, Grid.Indices);
+    return Grid;
+}
+
+static_assert(PatchGrid<DefaultPatchLevel>::VertexCount == 45 && PatchGrid<DefaultPatchLevel>::IndexCount == 192, "Default patch changed size");
+
+// Where one level sits in PatchGridSet, in the terms of D3D12_DRAW_INDEXED_ARGUMENTS.
+struct PatchLevelOffset {
+    uint32_t IndexCountPerInstance = 0;
+    uint32_t StartIndexLocation = 0;
+    int32_t BaseVertexLocation = 0;
+    uint32_t VertexCount = 0;
+};
+
+constexpr uint32_t GetPatchGridSetVertexCount() {
+    uint32_t Count = 0;
+    for (uint32_t Level = PatchGridMinLevel; Level <= PatchGridMaxLevel; ++Level) {
+        Count += GetPatchVertexCount(Level);
+    }
+    return Count;
+}
+
+constexpr uint32_t GetPatchGridSetIndexCount() {
+    uint32_t Count = 0;
+    for (uint32_t Level = PatchGridMinLevel; Level <= PatchGridMaxLevel; ++Level) {
+        Count += GetPatchIndexCount(Level);
+    }
+    return Count;
+}
+
+// Every level back to back, so one SubdInstanced buffer and one index buffer serve all of
+// them and switching level only rewrites the indirect draw arguments.
+struct PatchGridSet {
+    static constexpr uint32_t VertexCount = GetPatchGridSetVertexCount();
+    static constexpr uint32_t IndexCount = GetPatchGridSetIndexCount();
+
+    PatchVertex Vertices[VertexCount] = {};
+    uint16_t Indices[IndexCount] = {};
+    PatchLevelOffset PatchLevelOffsets[PatchGridMaxLevel + 1] = {};
+};
+
+constexpr PatchGridSet MakePatchGridSet() {
+    PatchGridSet Set;
+    uint32_t VertexOffset = 0;
+    uint32_t IndexOffset = 0;
+    for (uint32_t Level = PatchGridMinLevel; Level <= PatchGridMaxLevel; ++Level) {
+        BuildPatchGrid(Level, Set.Vertices + VertexOffset, Set.Indices + IndexOffset);
+        PatchLevelOffset& Offset = Set.PatchLevelOffsets[Level];
+        Offset.IndexCountPerInstance = GetPatchIndexCount(Level);
+        Offset.StartIndexLocation = IndexOffset;
+        Offset.BaseVertexLocation = (int32_t)VertexOffset;
+        Offset.VertexCount = GetPatchVertexCount(Level);
+        VertexOffset += Offset.VertexCount;
+        IndexOffset += Offset.IndexCountPerInstance;
+    }
+    return Set;
+}
+
+inline constexpr PatchGridSet PatchGrids = MakePatchGridSet();
+
+// TargetPixelSize that keeps the triangle density of DefaultPatchLevel when leaves are drawn
+// with a level inPatchLevel patch: each extra patch level takes one level off the leaves.
+inline float GetPatchTargetPixelSize(float inTargetPixelSize, uint32_t inPatchLevel) {
+    return std::ldexp(inTargetPixelSize, (int)inPatchLevel - (int)DefaultPatchLevel);
+}
+
+}
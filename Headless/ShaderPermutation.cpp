@@ -0,0 +1,172 @@
+#include "ShaderPermutation.h"
+#include <cctype>
+#include <cstdio>
+
+namespace Headless {
+
+static const char* const ShaderToggleDefines[ShaderToggleCount] = {
+    "FREEZE_SUBDIVISION",
+    "FRUSTUM_CULLING",
+    "DISPLACE",
+    "KEY_TRANSFORM_TABLE",
+    "DETERMINISTIC_COMPACTION",
+    "CBT_STORAGE",
+    "LEAF_VERTEX_PREPASS",
+    "PHONG_TESSELLATION",
+    "MESH_SHADING",
+    "SHADING_LOD",
+    "SHADING_DIFFUSE",
+    "SHADING_NORMAL",
+    "OCCLUSION_CULLING",
+    "ROUGHNESS_LOD",
+    "INCREMENTAL_LOD",
+    "MULTI_VIEW",
+    "SLOPE_FROM_HEIGHTMAP",
+};
+
+const char* GetShaderToggleDefine(uint32_t inToggle) {
+    for (uint32_t Bit = 0; Bit < ShaderToggleCount; ++Bit) {
+        if (inToggle == 1u << Bit) {
+            return ShaderToggleDefines[Bit];
+        }
+    }
+    return nullptr;
+}
+
+ShaderPermutationSet::ShaderPermutationSet(const std::string& inProgramName, uint32_t inToggleMask, bool inReadsPrimitiveBits)
+    : mProgramName(inProgramName), mToggleMask(inToggleMask), mReadsPrimitiveBits(inReadsPrimitiveBits) {
+}
+
+uint32_t ShaderPermutationSet::GetKey(uint32_t inToggles, uint32_t inCbtPrimitiveBits) const {
+    return (inToggles & mToggleMask) | (mReadsPrimitiveBits ? inCbtPrimitiveBits << ShaderKeyPrimitiveBitsShift : 0u);
+}
+
+ShaderDefineList ShaderPermutationSet::GetDefines(uint32_t inKey) const {
+    ShaderDefineList Defines;
+    for (uint32_t Bit = 0; Bit < ShaderToggleCount; ++Bit) {
+        if (inKey & mToggleMask & (1u << Bit)) {
+            Defines.emplace_back(ShaderToggleDefines[Bit], "");
+        }
+    }
+    if (mReadsPrimitiveBits) {
+        Defines.emplace_back("CBT_PRIMITIVE_BITS", std::to_string(inKey >> ShaderKeyPrimitiveBitsShift));
+    }
+    return Defines;
+}
+
+std::vector<std::string> ShaderPermutationSet::GetToggleDefines() const {
+    std::vector<std::string> Defines;
+    for (uint32_t Bit = 0; Bit < ShaderToggleCount; ++Bit) {
+        if (mToggleMask & (1u << Bit)) {
+            Defines.push_back(ShaderToggleDefines[Bit]);
+        }
+    }
+    return Defines;
+}
+
+std::vector<uint32_t> ShaderPermutationSet::EnumerateKeys(uint32_t inCbtPrimitiveBits) const {
+    uint32_t FreeMask = mToggleMask & ~ShaderToggleShadingMask;
+    uint32_t ShadingMask = mToggleMask & ShaderToggleShadingMask;
+    std::vector<uint32_t> Shadings;
+    for (uint32_t Bit = 0; Bit < ShaderToggleCount; ++Bit) {
+        if (ShadingMask & (1u << Bit)) {
+            Shadings.push_back(1u << Bit);
+        }
+    }
+    if (Shadings.empty()) {
+        Shadings.push_back(0u);
+    }
+
+    // Every subset of FreeMask, counting up through its bits.
+    std::vector<uint32_t> Keys;
+    uint32_t Subset = 0;
+    do {
+        for (uint32_t Shading : Shadings) {
+            Keys.push_back(GetKey(Subset | Shading, inCbtPrimitiveBits));
+        }
+        Subset = (Subset - FreeMask) & FreeMask;
+    } while (Subset != 0);
+    return Keys;
+}
+
+std::vector<uint32_t> ShaderPermutationSet::GetNeighbourKeys(uint32_t inKey) const {
+    std::vector<uint32_t> Keys;
+    for (uint32_t Bit = 0; Bit < ShaderToggleCount; ++Bit) {
+        uint32_t Toggle = 1u << Bit;
+        if (!(mToggleMask & Toggle)) {
+            continue;
+        }
+        if (Toggle & ShaderToggleShadingMask) {
+            if (!(inKey & Toggle)) {
+                Keys.push_back((inKey & ~ShaderToggleShadingMask) | Toggle);
+            }
+        }
+        else {
+            Keys.push_back(inKey ^ Toggle);
+        }
+    }
+    return Keys;
+}
+
+bool ShaderPermutationCache::Add(const std::string& inProgramName, uint32_t inKey) {
+    return mKeys[inProgramName].insert(inKey).second;
+}
+
+std::vector<uint32_t> ShaderPermutationCache::GetKeys(const std::string& inProgramName) const {
+    auto It = mKeys.find(inProgramName);
+    return It == mKeys.end() ? std::vector<uint32_t>() : std::vector<uint32_t>(It->second.begin(), It->second.end());
+}
+
+size_t ShaderPermutationCache::GetKeyCount() const {
+    size_t Count = 0;
+    for (const auto& Program : mKeys) {
+        Count += Program.second.size();
+    }
+    return Count;
+}
+
+bool ShaderPermutationCache::Load(const std::string& inPath) {
+    FILE* File = fopen(inPath.c_str(), "r");
+    if (!File) {
+        return false;
+    }
+    std::map<std::string, std::set<uint32_t>> Keys;
+    char Line[256];
+    char Name[128];
+    unsigned int Key = 0;
+    bool Valid = true;
+    while (Valid && fgets(Line, sizeof(Line), File)) {
+        const char* Text = Line;
+        while (isspace((unsigned char)*Text)) {
+            ++Text;
+        }
+        if (*Text == '#' || *Text == '\0') {
+            continue;
+        }
+        Valid = sscanf(Text, "%127s %x", Name, &Key) == 2;
+        if (Valid) {
+            Keys[Name].insert(Key);
+        }
+    }
+    fclose(File);
+    if (Valid) {
+        mKeys.swap(Keys);
+    }
+    return Valid;
+}
+
+bool ShaderPermutationCache::Save(const std::string& inPath) const {
+    FILE* File = fopen(inPath.c_str(), "w");
+    if (!File) {
+        return false;
+    }
+    fprintf(File, "# program permutation key\n");
+    for (const auto& Program : mKeys) {
+        for (uint32_t Key : Program.second) {
+            fprintf(File, "%s %08x\n", Program.first.c_str(), Key);
+        }
+    }
+    return fclose(File) == 0;
+}
+
+}
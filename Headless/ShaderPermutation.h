@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Headless {
+
+// Shader toggles of the sample, one bit each. SHADING_LOD / SHADING_DIFFUSE / SHADING_NORMAL
+// are exclusive: exactly one is set whenever a program reads them.
+enum ShaderToggle : uint32_t {
+    ShaderToggleFreezeSubdivision = 1u << 0,
+    ShaderToggleFrustumCulling = 1u << 1,
+    ShaderToggleDisplace = 1u << 2,
+    ShaderToggleKeyTransformTable = 1u << 3,
+    ShaderToggleDeterministicCompaction = 1u << 4,
+    ShaderToggleCbtStorage = 1u << 5,
+    ShaderToggleLeafVertexPrepass = 1u << 6,
+    ShaderTogglePhongTessellation = 1u << 7,
+    ShaderToggleMeshShading = 1u << 8,
+    ShaderToggleShadingLod = 1u << 9,
+    ShaderToggleShadingDiffuse = 1u << 10,
+    ShaderToggleShadingNormal = 1u << 11,
+    ShaderToggleOcclusionCulling = 1u << 12,
+    ShaderToggleRoughnessLod = 1u << 13,
+    ShaderToggleIncrementalLod = 1u << 14,
+    ShaderToggleMultiView = 1u << 15,
+    ShaderToggleSlopeFromHeightMap = 1u << 16,
+};
+const uint32_t ShaderToggleCount = 17;
+const uint32_t ShaderToggleShadingMask = ShaderToggleShadingLod | ShaderToggleShadingDiffuse | ShaderToggleShadingNormal;
+// CBT_PRIMITIVE_BITS sits above the toggles in a permutation key.
+const uint32_t ShaderKeyPrimitiveBitsShift = 17;
+
+// Define name of a single ShaderToggle bit.
+const char* GetShaderToggleDefine(uint32_t inToggle);
+
+using ShaderDefineList = std::vector<std::pair<std::string, std::string>>;
+
+// The toggles one program reads. Its permutation key is the sample's toggle mask restricted
+// to them, plus CBT_PRIMITIVE_BITS when the program reads that, so toggles a program does
+// not read never select another version of it.
+class ShaderPermutationSet {
+public:
+    ShaderPermutationSet(const std::string& inProgramName, uint32_t inToggleMask, bool inReadsPrimitiveBits);
+
+    const std::string& GetProgramName() const { return mProgramName; }
+    uint32_t GetToggleMask() const { return mToggleMask; }
+
+    uint32_t GetKey(uint32_t inToggles, uint32_t inCbtPrimitiveBits) const;
+    // Defines inKey sets; every other toggle define of the set is to be removed.
+    ShaderDefineList GetDefines(uint32_t inKey) const;
+    std::vector<std::string> GetToggleDefines() const;
+    // Every valid key of the set at one primitive bit count.
+    std::vector<uint32_t> EnumerateKeys(uint32_t inCbtPrimitiveBits) const;
+    // inKey with each single toggle flipped (one shading mode swapped for another): what the
+    // next click in the GUI can ask for.
+    std::vector<uint32_t> GetNeighbourKeys(uint32_t inKey) const;
+
+private:
+    std::string mProgramName;
+    uint32_t mToggleMask;
+    bool mReadsPrimitiveBits;
+};
+
+// Permutation keys each program was used with, kept across runs so a start warms up the
+// versions of the last session first. Text, one "program key" per line.
+class ShaderPermutationCache {
+public:
+    // Returns false when the key was already known.
+    bool Add(const std::string& inProgramName, uint32_t inKey);
+    std::vector<uint32_t> GetKeys(const std::string& inProgramName) const;
+    size_t GetKeyCount() const;
+
+    bool Load(const std::string& inPath);
+    bool Save(const std::string& inPath) const;
+
+private:
+    std::map<std::string, std::set<uint32_t>> mKeys;
+};
+
+}
@@ -0,0 +1,120 @@
+#include "SubdBatch.h"
+#include "SubdKeyTransform.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Headless {
+
+void SubdBatchOutput::Resize(size_t inCount) {
+    for (int i = 0; i < 3; ++i) {
+        VertexX[i].resize(inCount);
+        VertexY[i].resize(inCount);
+        VertexZ[i].resize(inCount);
+        ParentVertexX[i].resize(inCount);
+        ParentVertexY[i].resize(inCount);
+        ParentVertexZ[i].resize(inCount);
+    }
+    TargetLod.resize(inCount);
+    ParentLod.resize(inCount);
+    Op.resize(inCount);
+}
+
+static bool CpuSupportsAvx2() {
+#if defined(SUBD_BATCH_AVX2) && defined(_MSC_VER)
+    int Info[4];
+    __cpuid(Info, 0);
+    if (Info[0] < 7) {
+        return false;
+    }
+    __cpuid(Info, 1);
+    bool OsXSave = (Info[2] & (1 << 27)) != 0;
+    bool Avx = (Info[2] & (1 << 28)) != 0;
+    if (!OsXSave || !Avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(Info, 7, 0);
+    return (Info[1] & (1 << 5)) != 0;
+#elif defined(SUBD_BATCH_AVX2)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+SubdBatchIsa GetSubdBatchIsa() {
+    static const SubdBatchIsa Isa = [] {
+        if (CpuSupportsAvx2()) {
+            return SubdBatchIsa::Avx2;
+        }
+#if defined(SUBD_BATCH_SSE)
+        return SubdBatchIsa::Sse;
+#else
+        return SubdBatchIsa::Scalar;
+#endif
+    }();
+    return Isa;
+}
+
+const char* GetSubdBatchIsaName(SubdBatchIsa inIsa) {
+    switch (inIsa) {
+    case SubdBatchIsa::Sse: return "SSE";
+    case SubdBatchIsa::Avx2: return "AVX2";
+    default: return "Scalar";
+    }
+}
+
+void EvaluateSubdBatchScalar(const SubdMesh& inMesh, const SubdKeyStream& inKeys, size_t inBegin, size_t inEnd, const float3& inCameraPosW,
+    const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, SubdBatchOutput& outResult) {
+    for (size_t i = inBegin; i < inEnd; ++i) {
+        float4 InVertices[3];
+        inMesh.GetPrimitiveVertices(inKeys.PrimitiveIndex[i], InVertices);
+
+        uint32_t SubdBinaryKey = inKeys.SubdBinaryKey[i];
+        float4 OutVertices[3], OutParentVertices[3];
+        Subd(SubdBinaryKey, InVertices, OutVertices, OutParentVertices, inDefines.KeyTransformTable ? &KeyTransformTable::GetDefault() : nullptr);
+        int TargetLod = FloatToInt(ComputeLod(OutVertices, inCameraPosW, inConfig));
+        int ParentLod = FloatToInt(ComputeLod(OutParentVertices, inCameraPosW, inConfig));
+        if (inDefines.FreezeSubdivision) {
+            TargetLod = ParentLod = firstbithigh(SubdBinaryKey);
+        }
+
+        for (int v = 0; v < 3; ++v) {
+            outResult.VertexX[v][i] = OutVertices[v].x;
+            outResult.VertexY[v][i] = OutVertices[v].y;
+            outResult.VertexZ[v][i] = OutVertices[v].z;
+            outResult.ParentVertexX[v][i] = OutParentVertices[v].x;
+            outResult.ParentVertexY[v][i] = OutParentVertices[v].y;
+            outResult.ParentVertexZ[v][i] = OutParentVertices[v].z;
+        }
+        outResult.TargetLod[i] = TargetLod;
+        outResult.ParentLod[i] = ParentLod;
+        outResult.Op[i] = UpdateSubdBuffer(SubdBinaryKey, TargetLod, ParentLod);
+    }
+}
+
+#if !defined(SUBD_BATCH_SSE)
+void EvaluateSubdBatchSse(const SubdMesh& inMesh, const SubdKeyStream& inKeys, size_t inBegin, size_t inEnd, const float3& inCameraPosW,
+    const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, SubdBatchOutput& outResult) {
+    EvaluateSubdBatchScalar(inMesh, inKeys, inBegin, inEnd, inCameraPosW, inConfig, inDefines, outResult);
+}
+#endif
+
+#if !defined(SUBD_BATCH_AVX2)
+void EvaluateSubdBatchAvx2(const SubdMesh& inMesh, const SubdKeyStream& inKeys, size_t inBegin, size_t inEnd, const float3& inCameraPosW,
+    const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, SubdBatchOutput& outResult) {
+    EvaluateSubdBatchSse(inMesh, inKeys, inBegin, inEnd, inCameraPosW, inConfig, inDefines, outResult);
+}
+#endif
+
+void EvaluateSubdBatch(const SubdMesh& inMesh, const SubdKeyStream& inKeys, const float3& inCameraPosW, const LodKernelConfig& inConfig,
+    const LodKernelDefines& inDefines, SubdBatchOutput& outResult, SubdBatchIsa inIsa, ThreadPool* inThreadPool) {
+    auto Kernel = inIsa == SubdBatchIsa::Avx2 ? EvaluateSubdBatchAvx2 : inIsa == SubdBatchIsa::Sse ? EvaluateSubdBatchSse : EvaluateSubdBatchScalar;
+    outResult.Resize(inKeys.Size());
+    ThreadPool& Pool = inThreadPool ? *inThreadPool : ThreadPool::GetDefault();
+    Pool.ParallelFor(inKeys.Size(), 4096, [&](size_t inBegin, size_t inEnd) {
+        Kernel(inMesh, inKeys, inBegin, inEnd, inCameraPosW, inConfig, inDefines, outResult);
+    });
+}
+
+}
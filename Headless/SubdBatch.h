@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include "SubdEngine.h"
+
+namespace Headless {
+
+// (PrimitiveIndex, SubdBinaryKey) pairs in structure-of-arrays layout.
+struct SubdKeyStream {
+    std::vector<uint32_t> PrimitiveIndex;
+    std::vector<uint32_t> SubdBinaryKey;
+
+    size_t Size() const { return SubdBinaryKey.size(); }
+    void Resize(size_t inCount) { PrimitiveIndex.resize(inCount); SubdBinaryKey.resize(inCount); }
+    void Push(const PrimitiveData& inData) { PrimitiveIndex.push_back(inData.PrimitiveIndex); SubdBinaryKey.push_back(inData.SubdBinaryKey); }
+};
+
+// Everything LodKernel derives from one key, one array per component. Vertex w is
+// always 1 and not stored.
+struct SubdBatchOutput {
+    std::vector<float> VertexX[3], VertexY[3], VertexZ[3];
+    std::vector<float> ParentVertexX[3], ParentVertexY[3], ParentVertexZ[3];
+    std::vector<int32_t> TargetLod;
+    std::vector<int32_t> ParentLod;
+    std::vector<SubdUpdateOp> Op;
+
+    void Resize(size_t inCount);
+};
+
+enum class SubdBatchIsa {
+    Scalar,
+    Sse,
+    Avx2
+};
+
+// Widest instruction set both compiled in and supported by this CPU.
+SubdBatchIsa GetSubdBatchIsa();
+const char* GetSubdBatchIsaName(SubdBatchIsa inIsa);
+
+// Subd + ComputeLod + UpdateSubdBuffer for every key of the stream. The scalar path
+// runs the shader port key by key; the SIMD paths evaluate 4 (SSE) or 8 (AVX2) keys
+// per instruction through the 8-bit KeyTransformTable and produce the same bits.
+void EvaluateSubdBatch(const SubdMesh& inMesh, const SubdKeyStream& inKeys, const float3& inCameraPosW, const LodKernelConfig& inConfig,
+    const LodKernelDefines& inDefines, SubdBatchOutput& outResult, SubdBatchIsa inIsa = GetSubdBatchIsa(), ThreadPool* inThreadPool = nullptr);
+
+// Range versions used by EvaluateSubdBatch, one per instruction set.
+void EvaluateSubdBatchScalar(const SubdMesh& inMesh, const SubdKeyStream& inKeys, size_t inBegin, size_t inEnd, const float3& inCameraPosW,
+    const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, SubdBatchOutput& outResult);
+void EvaluateSubdBatchSse(const SubdMesh& inMesh, const SubdKeyStream& inKeys, size_t inBegin, size_t inEnd, const float3& inCameraPosW,
+    const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, SubdBatchOutput& outResult);
+void EvaluateSubdBatchAvx2(const SubdMesh& inMesh, const SubdKeyStream& inKeys, size_t inBegin, size_t inEnd, const float3& inCameraPosW,
+    const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, SubdBatchOutput& outResult);
+
+}
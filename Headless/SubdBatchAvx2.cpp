@@ -0,0 +1,56 @@
+#include <immintrin.h>
+#include "SubdBatchKernel.inl"
+
+// Built with AVX2 code generation; only reached after GetSubdBatchIsa() checked the CPU.
+
+namespace Headless {
+
+namespace {
+
+struct VecAvx2 {
+    static constexpr int Width = 8;
+    using F = __m256;
+    using I = __m256i;
+
+    static F Set1(float x) { return _mm256_set1_ps(x); }
+    static I Set1I(int x) { return _mm256_set1_epi32(x); }
+    static I LoadI(const void* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static void Store(float* p, F a) { _mm256_storeu_ps(p, a); }
+    static void StoreI(void* p, I a) { _mm256_storeu_si256((__m256i*)p, a); }
+
+    static F Add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F Sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F Mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F Div(F a, F b) { return _mm256_div_ps(a, b); }
+    static F Sqrt(F a) { return _mm256_sqrt_ps(a); }
+    static F Min(F a, F b) { return _mm256_min_ps(a, b); }
+    static F Max(F a, F b) { return _mm256_max_ps(a, b); }
+
+    static I AddI(I a, I b) { return _mm256_add_epi32(a, b); }
+    static I SubI(I a, I b) { return _mm256_sub_epi32(a, b); }
+    static I AndI(I a, I b) { return _mm256_and_si256(a, b); }
+    static I OrI(I a, I b) { return _mm256_or_si256(a, b); }
+    static I XorI(I a, I b) { return _mm256_xor_si256(a, b); }
+    static I NotI(I a) { return _mm256_xor_si256(a, _mm256_set1_epi32(-1)); }
+    static I SllI(I a, int n) { return _mm256_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+    static I SrlI(I a, int n) { return _mm256_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+    static I CmpEqI(I a, I b) { return _mm256_cmpeq_epi32(a, b); }
+    static I CmpGtI(I a, I b) { return _mm256_cmpgt_epi32(a, b); }
+    static I SelectI(I m, I a, I b) { return _mm256_blendv_epi8(b, a, m); }
+    static bool Any(I m) { return _mm256_movemask_epi8(m) != 0; }
+
+    static I CastToI(F a) { return _mm256_castps_si256(a); }
+    static F ConvertI(I a) { return _mm256_cvtepi32_ps(a); }
+
+    static F Gather(const float* p, I Index) { return _mm256_i32gather_ps(p, Index, 4); }
+    static I GatherI(const uint32_t* p, I Index) { return _mm256_i32gather_epi32((const int*)p, Index, 4); }
+};
+
+}
+
+void EvaluateSubdBatchAvx2(const SubdMesh& inMesh, const SubdKeyStream& inKeys, size_t inBegin, size_t inEnd, const float3& inCameraPosW,
+    const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, SubdBatchOutput& outResult) {
+    EvaluateSubdBatchV<VecAvx2>(inMesh, inKeys, inBegin, inEnd, inCameraPosW, inConfig, inDefines, outResult);
+}
+
+}
@@ -0,0 +1,221 @@
+// Vector body of EvaluateSubdBatch, instantiated by SubdBatchSse.cpp and
+// SubdBatchAvx2.cpp with the matching wrapper type V. Every lane performs the same
+// float operations in the same order as the scalar port in SubdUtils.cpp.
+
+#include "SubdBatch.h"
+#include "SubdKeyTransform.h"
+#include <cstring>
+
+namespace Headless {
+namespace {
+
+template <typename V>
+struct VAffine {
+    typename V::F R0x, R0y, R1x, R1y, R2x, R2y;
+};
+
+template <typename V>
+VAffine<V> AffineMulV(const VAffine<V>& A, const VAffine<V>& B) {
+    VAffine<V> R;
+    R.R0x = V::Add(V::Mul(A.R0x, B.R0x), V::Mul(A.R0y, B.R1x));
+    R.R0y = V::Add(V::Mul(A.R0x, B.R0y), V::Mul(A.R0y, B.R1y));
+    R.R1x = V::Add(V::Mul(A.R1x, B.R0x), V::Mul(A.R1y, B.R1x));
+    R.R1y = V::Add(V::Mul(A.R1x, B.R0y), V::Mul(A.R1y, B.R1y));
+    R.R2x = V::Add(V::Add(V::Mul(A.R2x, B.R0x), V::Mul(A.R2y, B.R1x)), B.R2x);
+    R.R2y = V::Add(V::Add(V::Mul(A.R2x, B.R0y), V::Mul(A.R2y, B.R1y)), B.R2y);
+    return R;
+}
+
+template <typename V>
+VAffine<V> LoadAffineV(const float* inTable, typename V::I inIndex) {
+    // Entries are six floats: Row0, Row1, Row2.
+    typename V::I Base = V::AddI(V::SllI(inIndex, 2), V::SllI(inIndex, 1));
+    VAffine<V> R;
+    R.R0x = V::Gather(inTable, Base);
+    R.R0y = V::Gather(inTable + 1, Base);
+    R.R1x = V::Gather(inTable + 2, Base);
+    R.R1y = V::Gather(inTable + 3, Base);
+    R.R2x = V::Gather(inTable + 4, Base);
+    R.R2y = V::Gather(inTable + 5, Base);
+    return R;
+}
+
+// KeyTransformTable::KeyToAffine per lane. Lanes that run out of chunks multiply by
+// entry 1, the identity, which leaves their bits untouched.
+template <typename V>
+VAffine<V> KeyToAffineV(const float* inTable, typename V::I inKey) {
+    VAffine<V> Mat;
+    Mat.R0x = V::Set1(1.0f); Mat.R0y = V::Set1(0.0f);
+    Mat.R1x = V::Set1(0.0f); Mat.R1y = V::Set1(1.0f);
+    Mat.R2x = V::Set1(0.0f); Mat.R2y = V::Set1(0.0f);
+    const typename V::I Zero = V::Set1I(0);
+    const typename V::I One = V::Set1I(1);
+    for (;;) {
+        typename V::I Active = V::NotI(V::CmpEqI(V::SrlI(inKey, 9), Zero));
+        if (!V::Any(Active)) {
+            break;
+        }
+        typename V::I Chunk = V::OrI(V::AndI(inKey, V::Set1I(255)), V::Set1I(256));
+        Mat = AffineMulV<V>(Mat, LoadAffineV<V>(inTable, V::SelectI(Active, Chunk, One)));
+        inKey = V::SelectI(Active, V::SrlI(inKey, 8), inKey);
+    }
+    return AffineMulV<V>(Mat, LoadAffineV<V>(inTable, inKey));
+}
+
+template <typename V>
+typename V::F BerpV(typename V::F inV0, typename V::F inV1, typename V::F inV2, typename V::F inU, typename V::F inV) {
+    return V::Add(V::Add(inV0, V::Mul(inU, V::Sub(inV1, inV0))), V::Mul(inV, V::Sub(inV2, inV0)));
+}
+
+template <typename V>
+struct VTriangle {
+    typename V::F X[3], Y[3], Z[3];
+};
+
+// Berp at the three corners of the transformed unit triangle: (0,0), (1,0), (0,1).
+template <typename V>
+VTriangle<V> SubdV(const VAffine<V>& inMat, const VTriangle<V>& inRoot) {
+    typename V::F U[3] = { inMat.R2x, V::Add(inMat.R0x, inMat.R2x), V::Add(inMat.R1x, inMat.R2x) };
+    typename V::F W[3] = { inMat.R2y, V::Add(inMat.R0y, inMat.R2y), V::Add(inMat.R1y, inMat.R2y) };
+    VTriangle<V> Out;
+    for (int v = 0; v < 3; ++v) {
+        Out.X[v] = BerpV<V>(inRoot.X[0], inRoot.X[1], inRoot.X[2], U[v], W[v]);
+        Out.Y[v] = BerpV<V>(inRoot.Y[0], inRoot.Y[1], inRoot.Y[2], U[v], W[v]);
+        Out.Z[v] = BerpV<V>(inRoot.Z[0], inRoot.Z[1], inRoot.Z[2], U[v], W[v]);
+    }
+    return Out;
+}
+
+// ComputeLod followed by the float -> int conversion. floor(-log2(x)) comes straight
+// from the exponent; lanes whose mantissa is so close to 1 that log2 may round to
+// the integer, and zero / denormal / non-finite lanes, are redone with std::log2.
+template <typename V>
+typename V::I ComputeLodV(const VTriangle<V>& inTri, const float3& inCameraPosW, float inScale, float inTargetPixelSize, float inWidth) {
+    const typename V::F Two = V::Set1(2.0f);
+    typename V::F Dx = V::Sub(V::Div(V::Add(inTri.X[1], inTri.X[2]), Two), V::Set1(inCameraPosW.x));
+    typename V::F Dy = V::Sub(V::Div(V::Add(inTri.Y[1], inTri.Y[2]), Two), V::Set1(inCameraPosW.y));
+    typename V::F Dz = V::Sub(V::Div(V::Add(inTri.Z[1], inTri.Z[2]), Two), V::Set1(inCameraPosW.z));
+    typename V::F Distance = V::Sqrt(V::Add(V::Add(V::Mul(Dx, Dx), V::Mul(Dy, Dy)), V::Mul(Dz, Dz)));
+
+    typename V::F ImagePlaneSize = V::Div(V::Mul(V::Mul(V::Mul(V::Set1(2.0f), Distance), V::Set1(inScale)), V::Set1(inTargetPixelSize)), V::Set1(inWidth));
+    typename V::F Clamped = V::Min(V::Set1(1.0f), V::Max(V::Set1(0.0f), ImagePlaneSize));
+
+    typename V::I Bits = V::CastToI(Clamped);
+    typename V::I Exponent = V::AndI(V::SrlI(Bits, 23), V::Set1I(255));
+    typename V::I Mantissa = V::AndI(Bits, V::Set1I(0x7fffff));
+    typename V::I IsPow2 = V::CmpEqI(Mantissa, V::Set1I(0));
+    typename V::I Lod = V::SubI(V::Set1I(126), Exponent);
+    Lod = V::SelectI(IsPow2, V::AddI(Lod, V::Set1I(1)), Lod);
+
+    typename V::I Fallback = V::OrI(V::CmpEqI(Exponent, V::Set1I(0)), V::CmpEqI(Exponent, V::Set1I(255)));
+    Fallback = V::OrI(Fallback, V::AndI(V::NotI(IsPow2), V::CmpGtI(V::Set1I(1 << 11), Mantissa)));
+    if (V::Any(Fallback)) {
+        alignas(32) float X[V::Width];
+        alignas(32) int32_t L[V::Width], F[V::Width];
+        V::Store(X, Clamped);
+        V::StoreI(L, Lod);
+        V::StoreI(F, Fallback);
+        for (int i = 0; i < V::Width; ++i) {
+            if (F[i]) {
+                L[i] = FloatToInt(-std::log2(X[i]));
+            }
+        }
+        Lod = V::LoadI(L);
+    }
+    return Lod;
+}
+
+template <typename V>
+typename V::I FirstBitHighV(typename V::I inKey) {
+    typename V::I Smear = inKey;
+    Smear = V::OrI(Smear, V::SrlI(Smear, 1));
+    Smear = V::OrI(Smear, V::SrlI(Smear, 2));
+    Smear = V::OrI(Smear, V::SrlI(Smear, 4));
+    Smear = V::OrI(Smear, V::SrlI(Smear, 8));
+    Smear = V::OrI(Smear, V::SrlI(Smear, 16));
+    typename V::I TopBit = V::XorI(Smear, V::SrlI(Smear, 1));
+    // The isolated bit converts to a float exactly; 1 << 31 converts to -2^31, same exponent.
+    typename V::I Exponent = V::AndI(V::SrlI(V::CastToI(V::ConvertI(TopBit)), 23), V::Set1I(255));
+    typename V::I Result = V::SubI(Exponent, V::Set1I(127));
+    return V::SelectI(V::CmpEqI(inKey, V::Set1I(0)), V::Set1I(-1), Result);
+}
+
+// UpdateSubdBuffer with the ops encoded as SubdUpdateOp values.
+template <typename V>
+typename V::I UpdateSubdBufferV(typename V::I inKey, typename V::I inKeyLod, typename V::I inTargetLod, typename V::I inParentLod) {
+    typename V::I Split = V::AndI(V::CmpGtI(inTargetLod, inKeyLod), V::NotI(V::CmpEqI(inKeyLod, V::Set1I(31))));
+    typename V::I Keep = V::CmpGtI(V::AddI(inParentLod, V::Set1I(1)), inKeyLod);
+    typename V::I Root = V::CmpEqI(inKey, V::Set1I(1));
+    typename V::I ChildZero = V::CmpEqI(V::AndI(inKey, V::Set1I(1)), V::Set1I(0));
+
+    typename V::I Op = V::SelectI(ChildZero, V::Set1I((int)SubdUpdateOp::Merge), V::Set1I((int)SubdUpdateOp::Drop));
+    Op = V::SelectI(V::OrI(Keep, Root), V::Set1I((int)SubdUpdateOp::Keep), Op);
+    return V::SelectI(Split, V::Set1I((int)SubdUpdateOp::Split), Op);
+}
+
+template <typename V>
+void EvaluateSubdBatchV(const SubdMesh& inMesh, const SubdKeyStream& inKeys, size_t inBegin, size_t inEnd, const float3& inCameraPosW,
+    const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, SubdBatchOutput& outResult) {
+    const float* Table = &KeyTransformTable::GetDefault().GetEntries()[0].Row0.x;
+    const float* Vertices = &inMesh.VertexData[0].x;
+    const uint32_t* Indices = inMesh.IndexData.data();
+    const float Scale = std::tan(inConfig.FovX / 2);
+    const float Width = (float)inConfig.ScreenResolutionWidth;
+
+    size_t i = inBegin;
+    for (; i + V::Width <= inEnd; i += V::Width) {
+        typename V::I Key = V::LoadI(&inKeys.SubdBinaryKey[i]);
+        typename V::I Primitive = V::LoadI(&inKeys.PrimitiveIndex[i]);
+
+        VTriangle<V> Root;
+        typename V::I Primitive3 = V::AddI(V::SllI(Primitive, 1), Primitive);
+        for (int v = 0; v < 3; ++v) {
+            typename V::I Vertex4 = V::SllI(V::GatherI(Indices + v, Primitive3), 2);
+            Root.X[v] = V::Gather(Vertices, Vertex4);
+            Root.Y[v] = V::Gather(Vertices + 1, Vertex4);
+            Root.Z[v] = V::Gather(Vertices + 2, Vertex4);
+        }
+
+        // Parent from the table; the key's own transform is BitToTransform(lowest bit) * parent.
+        VAffine<V> Parent = KeyToAffineV<V>(Table, V::SrlI(Key, 1));
+        typename V::F Diff = V::Sub(V::ConvertI(V::AndI(Key, V::Set1I(1))), V::Set1(0.5f));
+        VAffine<V> Bit;
+        Bit.R0x = Diff; Bit.R0y = V::Set1(-0.5f);
+        Bit.R1x = V::Set1(-0.5f); Bit.R1y = V::Sub(V::Set1(0.0f), Diff);
+        Bit.R2x = V::Set1(0.5f); Bit.R2y = V::Set1(0.5f);
+        VAffine<V> Child = AffineMulV<V>(Bit, Parent);
+
+        VTriangle<V> Out = SubdV<V>(Child, Root);
+        VTriangle<V> OutParent = SubdV<V>(Parent, Root);
+        for (int v = 0; v < 3; ++v) {
+            V::Store(&outResult.VertexX[v][i], Out.X[v]);
+            V::Store(&outResult.VertexY[v][i], Out.Y[v]);
+            V::Store(&outResult.VertexZ[v][i], Out.Z[v]);
+            V::Store(&outResult.ParentVertexX[v][i], OutParent.X[v]);
+            V::Store(&outResult.ParentVertexY[v][i], OutParent.Y[v]);
+            V::Store(&outResult.ParentVertexZ[v][i], OutParent.Z[v]);
+        }
+
+        typename V::I KeyLod = FirstBitHighV<V>(Key);
+        typename V::I TargetLod, ParentLod;
+        if (inDefines.FreezeSubdivision) {
+            TargetLod = ParentLod = KeyLod;
+        }
+        else {
+            TargetLod = ComputeLodV<V>(Out, inCameraPosW, Scale, inConfig.TargetPixelSize, Width);
+            ParentLod = ComputeLodV<V>(OutParent, inCameraPosW, Scale, inConfig.TargetPixelSize, Width);
+        }
+        V::StoreI(&outResult.TargetLod[i], TargetLod);
+        V::StoreI(&outResult.ParentLod[i], ParentLod);
+
+        alignas(32) int32_t Op[V::Width];
+        V::StoreI(Op, UpdateSubdBufferV<V>(Key, KeyLod, TargetLod, ParentLod));
+        for (int l = 0; l < V::Width; ++l) {
+            outResult.Op[i + l] = (SubdUpdateOp)Op[l];
+        }
+    }
+    EvaluateSubdBatchScalar(inMesh, inKeys, i, inEnd, inCameraPosW, inConfig, inDefines, outResult);
+}
+
+}
+}
@@ -0,0 +1,63 @@
+#include <emmintrin.h>
+#include "SubdBatchKernel.inl"
+
+namespace Headless {
+
+namespace {
+
+// SSE2 wrapper for SubdBatchKernel.inl. SSE2 has no gathers, so those go through memory.
+struct VecSse {
+    static constexpr int Width = 4;
+    using F = __m128;
+    using I = __m128i;
+
+    static F Set1(float x) { return _mm_set1_ps(x); }
+    static I Set1I(int x) { return _mm_set1_epi32(x); }
+    static I LoadI(const void* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static void Store(float* p, F a) { _mm_storeu_ps(p, a); }
+    static void StoreI(void* p, I a) { _mm_storeu_si128((__m128i*)p, a); }
+
+    static F Add(F a, F b) { return _mm_add_ps(a, b); }
+    static F Sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F Mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static F Div(F a, F b) { return _mm_div_ps(a, b); }
+    static F Sqrt(F a) { return _mm_sqrt_ps(a); }
+    static F Min(F a, F b) { return _mm_min_ps(a, b); }
+    static F Max(F a, F b) { return _mm_max_ps(a, b); }
+
+    static I AddI(I a, I b) { return _mm_add_epi32(a, b); }
+    static I SubI(I a, I b) { return _mm_sub_epi32(a, b); }
+    static I AndI(I a, I b) { return _mm_and_si128(a, b); }
+    static I OrI(I a, I b) { return _mm_or_si128(a, b); }
+    static I XorI(I a, I b) { return _mm_xor_si128(a, b); }
+    static I NotI(I a) { return _mm_xor_si128(a, _mm_set1_epi32(-1)); }
+    static I SllI(I a, int n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+    static I SrlI(I a, int n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+    static I CmpEqI(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+    static I CmpGtI(I a, I b) { return _mm_cmpgt_epi32(a, b); }
+    static I SelectI(I m, I a, I b) { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+    static bool Any(I m) { return _mm_movemask_epi8(m) != 0; }
+
+    static I CastToI(F a) { return _mm_castps_si128(a); }
+    static F ConvertI(I a) { return _mm_cvtepi32_ps(a); }
+
+    static F Gather(const float* p, I Index) {
+        alignas(16) int32_t i[4];
+        StoreI(i, Index);
+        return _mm_setr_ps(p[i[0]], p[i[1]], p[i[2]], p[i[3]]);
+    }
+    static I GatherI(const uint32_t* p, I Index) {
+        alignas(16) int32_t i[4];
+        StoreI(i, Index);
+        return _mm_setr_epi32((int)p[i[0]], (int)p[i[1]], (int)p[i[2]], (int)p[i[3]]);
+    }
+};
+
+}
+
+void EvaluateSubdBatchSse(const SubdMesh& inMesh, const SubdKeyStream& inKeys, size_t inBegin, size_t inEnd, const float3& inCameraPosW,
+    const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, SubdBatchOutput& outResult) {
+    EvaluateSubdBatchV<VecSse>(inMesh, inKeys, inBegin, inEnd, inCameraPosW, inConfig, inDefines, outResult);
+}
+
+}
@@ -0,0 +1,391 @@
+#include "SubdBenchmark.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace Headless {
+
+uint32_t BenchmarkPath::GetFrameCount() const {
+    return (uint32_t)(Path.GetDuration() * BenchmarkFrameRate) + 1;
+}
+
+float BenchmarkPath::GetFrameTime(uint32_t inFrame) const {
+    return (float)inFrame / BenchmarkFrameRate;
+}
+
+std::vector<BenchmarkPath> GetBenchmarkPaths() {
+    std::vector<BenchmarkPath> Paths(4);
+    Paths[0].Name = "Flyover";
+    Paths[0].Path = CameraPath::CreateFlyover();
+    Paths[1].Name = "Grazing";
+    Paths[1].Path = CameraPath::CreateGrazing();
+    Paths[2].Name = "Teleport";
+    Paths[2].Path = CameraPath::CreateTeleport();
+    // Suzanne.obj spans about 2.7 x 2 x 1.7 around the origin.
+    Paths[3].Name = "SuzanneOrbit";
+    Paths[3].Path = CameraPath::CreateOrbit(float3(0.0f, 0.0f, 0.0f), 3.0f, 0.8f, 12.0f, 2);
+    Paths[3].Model = true;
+    return Paths;
+}
+
+static BenchmarkMetric GetMetric(std::vector<double> inValues) {
+    BenchmarkMetric Metric;
+    if (inValues.empty()) {
+        return Metric;
+    }
+    std::sort(inValues.begin(), inValues.end());
+    double Sum = 0.0;
+    for (double Value : inValues) {
+        Sum += Value;
+    }
+    Metric.Mean = Sum / inValues.size();
+    Metric.P95 = inValues[(size_t)std::ceil(0.95 * inValues.size()) - 1];
+    Metric.Max = inValues.back();
+    return Metric;
+}
+
+BenchmarkSummary GetBenchmarkSummary(const BenchmarkRun& inRun) {
+    auto Metric = [&](auto inGet) {
+        std::vector<double> Values;
+        Values.reserve(inRun.Frames.size());
+        for (const BenchmarkFrame& Frame : inRun.Frames) {
+            Values.push_back((double)inGet(Frame));
+        }
+        return GetMetric(std::move(Values));
+    };
+    BenchmarkSummary Summary;
+    Summary.LodKernelMs = Metric([](const BenchmarkFrame& inFrame) { return inFrame.LodKernelMs; });
+    Summary.IndirectBatcherKernelMs = Metric([](const BenchmarkFrame& inFrame) { return inFrame.IndirectBatcherKernelMs; });
+    Summary.RenderMs = Metric([](const BenchmarkFrame& inFrame) { return inFrame.RenderMs; });
+    Summary.LeafCount = Metric([](const BenchmarkFrame& inFrame) { return inFrame.LeafCount; });
+    Summary.VisibleCount = Metric([](const BenchmarkFrame& inFrame) { return inFrame.VisibleCount; });
+    Summary.CulledCount = Metric([](const BenchmarkFrame& inFrame) { return inFrame.CulledCount; });
+    for (const BenchmarkFrame& Frame : inRun.Frames) {
+        Summary.ConvergenceFrames += Frame.Converged ? 0 : 1;
+    }
+    return Summary;
+}
+
+const BenchmarkRun* BenchmarkReport::FindRun(const std::string& inName) const {
+    for (const BenchmarkRun& Run : Runs) {
+        if (Run.Name == inName) {
+            return &Run;
+        }
+    }
+    return nullptr;
+}
+
+static std::string EscapeJson(const std::string& inText) {
+    std::string Escaped;
+    for (char c : inText) {
+        if (c == '"' || c == '\\') {
+            Escaped += '\\';
+            Escaped += c;
+        } else if ((unsigned char)c < 0x20) {
+            char Code[8];
+            snprintf(Code, sizeof(Code), "\\u%04x", (unsigned)c);
+            Escaped += Code;
+        } else {
+            Escaped += c;
+        }
+    }
+    return Escaped;
+}
+
+static void WriteMetric(FILE* inFile, const char* inName, const BenchmarkMetric& inMetric, bool inLast) {
+    fprintf(inFile, "        \"%s\": { \"mean\": %.9g, \"p95\": %.9g, \"max\": %.9g }%s\n", inName, inMetric.Mean, inMetric.P95, inMetric.Max,
+        inLast ? "" : ",");
+}
+
+bool SaveBenchmarkReport(const std::string& inPath, const BenchmarkReport& inReport) {
+    FILE* File = fopen(inPath.c_str(), "w");
+    if (!File) {
+        return false;
+    }
+    fprintf(File, "{\n  \"version\": 1,\n  \"source\": \"%s\",\n  \"label\": \"%s\",\n  \"runs\": [\n", EscapeJson(inReport.Source).c_str(),
+        EscapeJson(inReport.Label).c_str());
+    for (size_t r = 0; r < inReport.Runs.size(); ++r) {
+        const BenchmarkRun& Run = inReport.Runs[r];
+        BenchmarkSummary Summary = GetBenchmarkSummary(Run);
+        fprintf(File, "    {\n      \"name\": \"%s\",\n      \"summary\": {\n", EscapeJson(Run.Name).c_str());
+        WriteMetric(File, "LodKernelMs", Summary.LodKernelMs, false);
+        WriteMetric(File, "IndirectBatcherKernelMs", Summary.IndirectBatcherKernelMs, false);
+        WriteMetric(File, "RenderMs", Summary.RenderMs, false);
+        WriteMetric(File, "LeafCount", Summary.LeafCount, false);
+        WriteMetric(File, "VisibleCount", Summary.VisibleCount, false);
+        WriteMetric(File, "CulledCount", Summary.CulledCount, false);
+        fprintf(File, "        \"ConvergenceFrames\": %u\n      },\n      \"frames\": [\n", Summary.ConvergenceFrames);
+        for (size_t f = 0; f < Run.Frames.size(); ++f) {
+            const BenchmarkFrame& Frame = Run.Frames[f];
+            fprintf(File, "        { \"LodKernelMs\": %.9g, \"IndirectBatcherKernelMs\": %.9g, \"RenderMs\": %.9g, \"LeafCount\": %u, \"VisibleCount\": %u, "
+                "\"CulledCount\": %u, \"ConvergenceIterations\": %u, \"Converged\": %s }%s\n", Frame.LodKernelMs, Frame.IndirectBatcherKernelMs,
+                Frame.RenderMs, Frame.LeafCount, Frame.VisibleCount, Frame.CulledCount, Frame.ConvergenceIterations, Frame.Converged ? "true" : "false",
+                f + 1 < Run.Frames.size() ? "," : "");
+        }
+        fprintf(File, "      ]\n    }%s\n", r + 1 < inReport.Runs.size() ? "," : "");
+    }
+    fprintf(File, "  ]\n}\n");
+    return fclose(File) == 0;
+}
+
+// Just enough JSON to read SaveBenchmarkReport back: objects, arrays, strings, numbers and
+// literals, with the usual escapes.
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+    Type Kind = Type::Null;
+    bool Bool = false;
+    double Number = 0.0;
+    std::string String;
+    std::vector<JsonValue> Array;
+    std::vector<std::pair<std::string, JsonValue>> Object;
+
+    const JsonValue* Find(const char* inKey) const {
+        for (const auto& Member : Object) {
+            if (Member.first == inKey) {
+                return &Member.second;
+            }
+        }
+        return nullptr;
+    }
+    double GetNumber(const char* inKey) const {
+        const JsonValue* Value = Find(inKey);
+        return Value && Value->Kind == Type::Number ? Value->Number : 0.0;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const char* inText) : mCursor(inText) {}
+
+    bool Parse(JsonValue& outValue) {
+        if (!ParseValue(outValue, 0)) {
+            return false;
+        }
+        SkipSpace();
+        return *mCursor == 0;
+    }
+
+private:
+    void SkipSpace() {
+        while (*mCursor == ' ' || *mCursor == '\t' || *mCursor == '\n' || *mCursor == '\r') {
+            ++mCursor;
+        }
+    }
+
+    bool Expect(char inChar) {
+        SkipSpace();
+        if (*mCursor != inChar) {
+            return false;
+        }
+        ++mCursor;
+        return true;
+    }
+
+    bool ParseString(std::string& outString) {
+        if (!Expect('"')) {
+            return false;
+        }
+        while (*mCursor != '"') {
+            if (*mCursor == 0) {
+                return false;
+            }
+            if (*mCursor != '\\') {
+                outString += *mCursor++;
+                continue;
+            }
+            ++mCursor;
+            switch (*mCursor++) {
+            case '"': outString += '"'; break;
+            case '\\': outString += '\\'; break;
+            case '/': outString += '/'; break;
+            case 'b': outString += '\b'; break;
+            case 'f': outString += '\f'; break;
+            case 'n': outString += '\n'; break;
+            case 'r': outString += '\r'; break;
+            case 't': outString += '\t'; break;
+            case 'u': {
+                // Only the control characters EscapeJson writes; others become '?'.
+                char Hex[5] = {};
+                for (int i = 0; i < 4; ++i) {
+                    if (!isxdigit((unsigned char)*mCursor)) {
+                        return false;
+                    }
+                    Hex[i] = *mCursor++;
+                }
+                unsigned long Code = strtoul(Hex, nullptr, 16);
+                outString += Code < 0x80 ? (char)Code : '?';
+                break;
+            }
+            default: return false;
+            }
+        }
+        ++mCursor;
+        return true;
+    }
+
+    bool ParseValue(JsonValue& outValue, int inDepth) {
+        if (inDepth > 32) {
+            return false;
+        }
+        SkipSpace();
+        if (*mCursor == '{') {
+            ++mCursor;
+            outValue.Kind = JsonValue::Type::Object;
+            SkipSpace();
+            if (*mCursor == '}') {
+                ++mCursor;
+                return true;
+            }
+            do {
+                std::pair<std::string, JsonValue> Member;
+                if (!ParseString(Member.first) || !Expect(':') || !ParseValue(Member.second, inDepth + 1)) {
+                    return false;
+                }
+                outValue.Object.push_back(std::move(Member));
+            } while (Expect(','));
+            return Expect('}');
+        }
+        if (*mCursor == '[') {
+            ++mCursor;
+            outValue.Kind = JsonValue::Type::Array;
+            SkipSpace();
+            if (*mCursor == ']') {
+                ++mCursor;
+                return true;
+            }
+            do {
+                outValue.Array.emplace_back();
+                if (!ParseValue(outValue.Array.back(), inDepth + 1)) {
+                    return false;
+                }
+            } while (Expect(','));
+            return Expect(']');
+        }
+        if (*mCursor == '"') {
+            outValue.Kind = JsonValue::Type::String;
+            return ParseString(outValue.String);
+        }
+        const char* Literals[] = { "true", "false", "null" };
+        for (int i = 0; i < 3; ++i) {
+            size_t Length = strlen(Literals[i]);
+            if (strncmp(mCursor, Literals[i], Length) == 0) {
+                mCursor += Length;
+                outValue.Kind = i == 2 ? JsonValue::Type::Null : JsonValue::Type::Bool;
+                outValue.Bool = i == 0;
+                return true;
+            }
+        }
+        char* End = nullptr;
+        outValue.Number = strtod(mCursor, &End);
+        if (End == mCursor) {
+            return false;
+        }
+        outValue.Kind = JsonValue::Type::Number;
+        mCursor = End;
+        return true;
+    }
+
+    const char* mCursor;
+};
+
+bool LoadBenchmarkReport(const std::string& inPath, BenchmarkReport& outReport) {
+    FILE* File = fopen(inPath.c_str(), "rb");
+    if (!File) {
+        return false;
+    }
+    std::string Text;
+    char Block[4096];
+    size_t Read;
+    while ((Read = fread(Block, 1, sizeof(Block), File)) > 0) {
+        Text.append(Block, Read);
+    }
+    fclose(File);
+
+    JsonValue Root;
+    if (!JsonParser(Text.c_str()).Parse(Root) || Root.Kind != JsonValue::Type::Object) {
+        return false;
+    }
+    const JsonValue* Source = Root.Find("source");
+    const JsonValue* Label = Root.Find("label");
+    const JsonValue* Runs = Root.Find("runs");
+    if (!Runs || Runs->Kind != JsonValue::Type::Array) {
+        return false;
+    }
+    BenchmarkReport Report;
+    Report.Source = Source ? Source->String : std::string();
+    Report.Label = Label ? Label->String : std::string();
+    for (const JsonValue& RunValue : Runs->Array) {
+        const JsonValue* Name = RunValue.Find("name");
+        const JsonValue* Frames = RunValue.Find("frames");
+        if (!Name || Name->Kind != JsonValue::Type::String || !Frames || Frames->Kind != JsonValue::Type::Array) {
+            return false;
+        }
+        BenchmarkRun Run;
+        Run.Name = Name->String;
+        Run.Frames.reserve(Frames->Array.size());
+        for (const JsonValue& FrameValue : Frames->Array) {
+            BenchmarkFrame Frame;
+            Frame.LodKernelMs = (float)FrameValue.GetNumber("LodKernelMs");
+            Frame.IndirectBatcherKernelMs = (float)FrameValue.GetNumber("IndirectBatcherKernelMs");
+            Frame.RenderMs = (float)FrameValue.GetNumber("RenderMs");
+            Frame.LeafCount = (uint32_t)FrameValue.GetNumber("LeafCount");
+            Frame.VisibleCount = (uint32_t)FrameValue.GetNumber("VisibleCount");
+            Frame.CulledCount = (uint32_t)FrameValue.GetNumber("CulledCount");
+            Frame.ConvergenceIterations = (uint32_t)FrameValue.GetNumber("ConvergenceIterations");
+            const JsonValue* Converged = FrameValue.Find("Converged");
+            Frame.Converged = Converged && Converged->Bool;
+            Run.Frames.push_back(Frame);
+        }
+        Report.Runs.push_back(std::move(Run));
+    }
+    outReport = std::move(Report);
+    return true;
+}
+
+std::vector<BenchmarkRegression> CompareBenchmarkReports(const BenchmarkReport& inBaseline, const BenchmarkReport& inCurrent,
+    const BenchmarkTolerance& inTolerance) {
+    std::vector<BenchmarkRegression> Regressions;
+    bool SameSource = inBaseline.Source == inCurrent.Source;
+    for (const BenchmarkRun& BaselineRun : inBaseline.Runs) {
+        const BenchmarkRun* CurrentRun = inCurrent.FindRun(BaselineRun.Name);
+        if (!CurrentRun) {
+            Regressions.push_back({ BaselineRun.Name, "missing", (double)BaselineRun.Frames.size(), 0.0 });
+            continue;
+        }
+        if (CurrentRun->Frames.size() != BaselineRun.Frames.size()) {
+            Regressions.push_back({ BaselineRun.Name, "frames", (double)BaselineRun.Frames.size(), (double)CurrentRun->Frames.size() });
+        }
+        BenchmarkSummary Baseline = GetBenchmarkSummary(BaselineRun);
+        BenchmarkSummary Current = GetBenchmarkSummary(*CurrentRun);
+        auto CheckTime = [&](const char* inMetric, double inBaseline, double inCurrent) {
+            if (inCurrent > inBaseline * (1.0 + inTolerance.TimeRatio) && inCurrent - inBaseline > inTolerance.MinTimeMs) {
+                Regressions.push_back({ BaselineRun.Name, inMetric, inBaseline, inCurrent });
+            }
+        };
+        auto CheckCount = [&](const char* inMetric, double inBaseline, double inCurrent) {
+            if (inCurrent > inBaseline * (1.0 + inTolerance.CountRatio)) {
+                Regressions.push_back({ BaselineRun.Name, inMetric, inBaseline, inCurrent });
+            }
+        };
+        if (SameSource) {
+            CheckTime("LodKernelMs.mean", Baseline.LodKernelMs.Mean, Current.LodKernelMs.Mean);
+            CheckTime("LodKernelMs.p95", Baseline.LodKernelMs.P95, Current.LodKernelMs.P95);
+            CheckTime("IndirectBatcherKernelMs.mean", Baseline.IndirectBatcherKernelMs.Mean, Current.IndirectBatcherKernelMs.Mean);
+            CheckTime("IndirectBatcherKernelMs.p95", Baseline.IndirectBatcherKernelMs.P95, Current.IndirectBatcherKernelMs.P95);
+            CheckTime("RenderMs.mean", Baseline.RenderMs.Mean, Current.RenderMs.Mean);
+            CheckTime("RenderMs.p95", Baseline.RenderMs.P95, Current.RenderMs.P95);
+        }
+        CheckCount("LeafCount.mean", Baseline.LeafCount.Mean, Current.LeafCount.Mean);
+        CheckCount("LeafCount.max", Baseline.LeafCount.Max, Current.LeafCount.Max);
+        CheckCount("VisibleCount.mean", Baseline.VisibleCount.Mean, Current.VisibleCount.Mean);
+        if (Current.ConvergenceFrames > Baseline.ConvergenceFrames + inTolerance.ConvergenceFrames) {
+            Regressions.push_back({ BaselineRun.Name, "ConvergenceFrames", (double)Baseline.ConvergenceFrames, (double)Current.ConvergenceFrames });
+        }
+    }
+    return Regressions;
+}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CameraPath.h"
+
+namespace Headless {
+
+// One camera path of the benchmark suite, played at BenchmarkFrameRate frames per second
+// from a cold start (the root keys).
+struct BenchmarkPath {
+    std::string Name;
+    CameraPath Path;
+    // Orbits Suzanne.obj (SubdivideModel) instead of flying over the terrain quad.
+    bool Model = false;
+
+    uint32_t GetFrameCount() const;
+    float GetFrameTime(uint32_t inFrame) const;
+};
+
+const float BenchmarkFrameRate = 60.0f;
+
+// Flyover, grazing, teleport and the Suzanne orbit.
+std::vector<BenchmarkPath> GetBenchmarkPaths();
+
+// What one frame of a run records. The pass times are GPU times in the sample and CPU times
+// of SubdEngine headless, summed over the passes of the frame; RenderMs is RenderKernel in
+// the sample and the LeafVertexKernel port of its vertex work headless.
+struct BenchmarkFrame {
+    float LodKernelMs = 0.0f;
+    float IndirectBatcherKernelMs = 0.0f;
+    float RenderMs = 0.0f;
+    uint32_t LeafCount = 0;
+    uint32_t VisibleCount = 0;
+    uint32_t CulledCount = 0;
+    uint32_t ConvergenceIterations = 0;
+    bool Converged = false;
+};
+
+struct BenchmarkRun {
+    std::string Name;
+    std::vector<BenchmarkFrame> Frames;
+};
+
+struct BenchmarkMetric {
+    double Mean = 0.0;
+    double P95 = 0.0;
+    double Max = 0.0;
+};
+
+struct BenchmarkSummary {
+    BenchmarkMetric LodKernelMs;
+    BenchmarkMetric IndirectBatcherKernelMs;
+    BenchmarkMetric RenderMs;
+    BenchmarkMetric LeafCount;
+    BenchmarkMetric VisibleCount;
+    BenchmarkMetric CulledCount;
+    // Frames that ended with the tree still changing: after the cold start and every cut.
+    uint32_t ConvergenceFrames = 0;
+};
+
+BenchmarkSummary GetBenchmarkSummary(const BenchmarkRun& inRun);
+
+// All runs of one suite, with what produced them: "AdaptiveSubdivision" for the sample and
+// "SubdEngine" for the headless port. Their times are not comparable with each other.
+struct BenchmarkReport {
+    std::string Source;
+    std::string Label;
+    std::vector<BenchmarkRun> Runs;
+
+    const BenchmarkRun* FindRun(const std::string& inName) const;
+};
+
+// JSON: the source, the label, and per run its summary and frames. Loading reads the frames
+// back and ignores the summaries, which follow from them.
+bool SaveBenchmarkReport(const std::string& inPath, const BenchmarkReport& inReport);
+bool LoadBenchmarkReport(const std::string& inPath, BenchmarkReport& outReport);
+
+struct BenchmarkTolerance {
+    // Pass times may grow by this fraction of the baseline, and by at least MinTimeMs, so
+    // the noise of sub-millisecond passes does not count.
+    double TimeRatio = 0.1;
+    double MinTimeMs = 0.05;
+    // Leaf counts may grow by this fraction; they move with the frame timing in the sample.
+    double CountRatio = 0.02;
+    uint32_t ConvergenceFrames = 2;
+};
+
+struct BenchmarkRegression {
+    std::string Run;
+    std::string Metric;
+    double Baseline = 0.0;
+    double Current = 0.0;
+};
+
+// Metrics of inCurrent worse than inBaseline beyond the tolerance, run by run; a run of the
+// baseline missing from inCurrent is one with Metric "missing". Times are only compared when
+// both come from the same source.
+std::vector<BenchmarkRegression> CompareBenchmarkReports(const BenchmarkReport& inBaseline, const BenchmarkReport& inCurrent,
+    const BenchmarkTolerance& inTolerance = BenchmarkTolerance());
+
+}
@@ -0,0 +1,63 @@
+#include "SubdBudget.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Headless {
+
+static const size_t BudgetHistorySize = 64;
+
+void SubdBudgetGovernor::Reset() {
+    mPixelSize = 0.0f;
+    mLoad = 0.0f;
+    mLastStatsFrame = ~0ull;
+    mHistory.clear();
+}
+
+float SubdBudgetGovernor::GetPixelSizeAt(uint64_t inFrame) const {
+    for (auto It = mHistory.rbegin(); It != mHistory.rend(); ++It) {
+        if (It->first <= inFrame) {
+            return It->second;
+        }
+    }
+    return mHistory.empty() ? mPixelSize : mHistory.front().second;
+}
+
+float SubdBudgetGovernor::Update(uint64_t inFrame, float inBasePixelSize, const SubdStats& inStats, float inFrameTimeMs) {
+    if (mPixelSize <= 0.0f) {
+        mPixelSize = inBasePixelSize;
+    }
+
+    // Each readback is acted on once; until the next arrives the pixel size holds.
+    if (inStats.Frame != mLastStatsFrame) {
+        mLastStatsFrame = inStats.Frame;
+        float Load = 0.0f;
+        if (mConfig.LeafBudget > 0) {
+            Load = std::max(Load, (float)inStats.LeafCount / (float)mConfig.LeafBudget);
+        }
+        if (mConfig.FrameTimeBudgetMs > 0.0f) {
+            Load = std::max(Load, inFrameTimeMs / mConfig.FrameTimeBudgetMs);
+        }
+        mLoad = Load;
+
+        float Target = mPixelSize;
+        if (Load > 1.0f || Load < 1.0f - mConfig.Hysteresis) {
+            float Goal = 1.0f - 0.5f * mConfig.Hysteresis;
+            Target = GetPixelSizeAt(inStats.Frame) * std::sqrt(std::max(Load, 1e-3f) / Goal);
+        }
+        if (Load > 1.0f) {
+            mPixelSize = std::min(std::max(Target, mPixelSize), mPixelSize * mConfig.MaxIncreasePerFrame);
+        }
+        else if (Load < 1.0f - mConfig.Hysteresis) {
+            mPixelSize = std::max(std::min(Target, mPixelSize), mPixelSize / mConfig.MaxDecreasePerFrame);
+        }
+    }
+
+    mPixelSize = std::min(std::max(mPixelSize, inBasePixelSize), std::max(mConfig.MaxPixelSize, inBasePixelSize));
+    mHistory.emplace_back(inFrame, mPixelSize);
+    if (mHistory.size() > BudgetHistorySize) {
+        mHistory.pop_front();
+    }
+    return mPixelSize;
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include "SubdStats.h"
+
+namespace Headless {
+
+struct SubdBudgetConfig {
+    // Leaves (SubdIn keys) to stay under; 0 disables the leaf budget.
+    uint32_t LeafBudget = 1 << 18;
+    // Frame time to stay under; 0 disables the time budget.
+    float FrameTimeBudgetMs = 0.0f;
+    // Dead band below the budget: loads between 1 - Hysteresis and 1 leave the pixel size
+    // alone, so a tree sitting at the budget does not split and merge back every frame.
+    float Hysteresis = 0.2f;
+    // Largest change of the pixel size per frame. Coarsening may be fast, since running past
+    // the budget drops keys; refining is slow, since its effect shows up frames later.
+    float MaxIncreasePerFrame = 1.5f;
+    float MaxDecreasePerFrame = 1.03f;
+    float MaxPixelSize = 64.0f;
+};
+
+// Closed-loop control of the effective LodKernelConfig::TargetPixelSize. The load is the
+// larger of leaves / LeafBudget and frame time / FrameTimeBudgetMs. Above 1 the pixel size
+// grows, below 1 - Hysteresis it shrinks back towards the slider value, which stays the
+// finest allowed. Leaves fall roughly with the square of the pixel size, so the step is the
+// square root of the load's distance from the middle of the dead band.
+//
+// Stats arrive a few frames late (ReadbackRing). Each step is taken relative to the pixel
+// size that was in effect on the frame the stats belong to, so the latency does not make
+// the controller overshoot.
+class SubdBudgetGovernor {
+public:
+    explicit SubdBudgetGovernor(const SubdBudgetConfig& inConfig = SubdBudgetConfig()) : mConfig(inConfig) {}
+
+    void SetConfig(const SubdBudgetConfig& inConfig) { mConfig = inConfig; }
+    const SubdBudgetConfig& GetConfig() const { return mConfig; }
+    void Reset();
+
+    // Pixel size for frame inFrame. inStats is the newest readback (the same one may be
+    // passed again until the next arrives) and inFrameTimeMs the last frame time.
+    float Update(uint64_t inFrame, float inBasePixelSize, const SubdStats& inStats, float inFrameTimeMs);
+
+    float GetPixelSize() const { return mPixelSize; }
+    // Load of the last stats used: 1 is on budget.
+    float GetLoad() const { return mLoad; }
+
+private:
+    float GetPixelSizeAt(uint64_t inFrame) const;
+
+    SubdBudgetConfig mConfig;
+    float mPixelSize = 0.0f;
+    float mLoad = 0.0f;
+    uint64_t mLastStatsFrame = ~0ull;
+    // (frame, pixel size) of the recent frames, to look up what a readback was rendered with.
+    std::deque<std::pair<uint64_t, float>> mHistory;
+};
+
+}
@@ -0,0 +1,161 @@
+#include "SubdCbtEngine.h"
+#include "ParallelScan.h"
+#include <chrono>
+
+namespace Headless {
+
+uint32_t SubdDataToHeapIndex(const PrimitiveData& inData, uint32_t inPrimitiveBits) {
+    uint32_t KeyDepth = (uint32_t)firstbithigh(inData.SubdBinaryKey);
+    return (((1u << inPrimitiveBits) | inData.PrimitiveIndex) << KeyDepth) | (inData.SubdBinaryKey ^ (1u << KeyDepth));
+}
+
+PrimitiveData HeapIndexToSubdData(uint32_t inHeapIndex, uint32_t inPrimitiveBits) {
+    uint32_t KeyDepth = (uint32_t)firstbithigh(inHeapIndex) - inPrimitiveBits;
+    PrimitiveData Data;
+    Data.PrimitiveIndex = (inHeapIndex >> KeyDepth) & ((1u << inPrimitiveBits) - 1u);
+    Data.SubdBinaryKey = (1u << KeyDepth) | (inHeapIndex & ((1u << KeyDepth) - 1u));
+    return Data;
+}
+
+uint32_t GetPrimitiveBits(uint32_t inPrimitiveCount) {
+    return inPrimitiveCount > 1u ? (uint32_t)firstbithigh(inPrimitiveCount - 1u) + 1u : 0u;
+}
+
+SubdCbtEngine::SubdCbtEngine(const SubdMesh& inMesh, uint32_t inMaxDepth, ThreadPool* inThreadPool)
+    : mMesh(inMesh), mpThreadPool(inThreadPool ? inThreadPool : &ThreadPool::GetDefault()), mTree(inMaxDepth),
+      mPrimitiveBits(Headless::GetPrimitiveBits(inMesh.GetPrimitiveCount())) {
+    LoadBuffer(SubdMesh::CreateInitSubdBuffer());
+}
+
+void SubdCbtEngine::LoadBuffer(const std::vector<PrimitiveData>& inInitSubdBuffer) {
+    std::vector<bool> HasRoot(1u << mPrimitiveBits, false);
+    std::vector<uint32_t> Leaves;
+    for (const PrimitiveData& Data : inInitSubdBuffer) {
+        Leaves.push_back(SubdDataToHeapIndex(Data, mPrimitiveBits));
+        HasRoot[Data.PrimitiveIndex] = true;
+    }
+    for (uint32_t PrimitiveIndex = 0; PrimitiveIndex < HasRoot.size(); ++PrimitiveIndex) {
+        if (!HasRoot[PrimitiveIndex]) {
+            Leaves.push_back(SubdDataToHeapIndex({ PrimitiveIndex, 1u }, mPrimitiveBits));
+        }
+    }
+    mTree.Reset(Leaves, *mpThreadPool);
+    mSubdCulledCount = 0;
+}
+
+void SubdCbtEngine::LoadBitfield(const uint32_t* inWords) {
+    mTree.SetBitfield(inWords, *mpThreadPool);
+    mSubdCulledCount = 0;
+}
+
+// Writes the leaves that replace inHeapIndex in the next tree. Returns true when the tree
+// changes there: a split, or child 1 going away in a merge.
+bool SubdCbtEngine::EmitUpdate(uint32_t inHeapIndex, const PrimitiveData& inData, SubdUpdateOp inOp, const SubdCamera& inCamera,
+    const LodKernelConfig& inConfig, const LodKernelDefines& inDefines) {
+    switch (inOp) {
+    case SubdUpdateOp::Split:
+        mTree.EmitLeaf(inHeapIndex);
+        mTree.EmitLeaf((inHeapIndex << 1u) | 1u);
+        return true;
+    case SubdUpdateOp::Keep:
+    case SubdUpdateOp::Merge:
+        // Child 0 already starts where its parent does; the merge happens by child 1 not emitting.
+        mTree.EmitLeaf(inHeapIndex);
+        return false;
+    case SubdUpdateOp::Drop: {
+        // Only child 1 drops. Its sibling sees the same parent lod, so it either merges or splits.
+        if (mTree.IsLeaf(inHeapIndex ^ 1u)) {
+            LodKernelDefines SiblingDefines = inDefines;
+            SiblingDefines.FrustumCulling = false;
+            LodKernelResult Sibling = EvaluateLodKernel(mMesh, { inData.PrimitiveIndex, inData.SubdBinaryKey ^ 1u }, inCamera, inConfig, SiblingDefines, mTextures);
+            bool SiblingSplits = Sibling.Op == SubdUpdateOp::Split && (uint32_t)firstbithigh(inData.SubdBinaryKey) < GetMaxKeyDepth();
+            if (!SiblingSplits) {
+                return true;
+            }
+        }
+        mTree.EmitLeaf(inHeapIndex);
+        return false;
+    }
+    }
+    return false;
+}
+
+void SubdCbtEngine::Update(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines) {
+    uint32_t LeafCount = mTree.GetLeafCount();
+    uint32_t PrimitiveCount = mMesh.GetPrimitiveCount();
+    mVisibleFlags.resize(LeafCount);
+    mSubdCulledBuffer.resize(LeafCount);
+    mTree.ClearNext(*mpThreadPool);
+    mChangeCount = 0;
+    LodKernelConfig Config = inConfig;
+    SetFrustumPlanes(Config, inCamera.ViewProjMat);
+
+    mSubdCulledCount = ParallelCompact<uint32_t>(LeafCount, 4096, *mpThreadPool,
+        [&](size_t inBegin, size_t inEnd) {
+            uint32_t VisibleCount = 0;
+            uint32_t ChangeCount = 0;
+            uint32_t HeapIndex = mTree.DecodeLeaf((uint32_t)inBegin);
+            for (size_t LeafIndex = inBegin; LeafIndex < inEnd; ++LeafIndex, HeapIndex = mTree.GetNextLeaf(HeapIndex)) {
+                PrimitiveData Data = HeapIndexToSubdData(HeapIndex, mPrimitiveBits);
+                bool Visible = false;
+                if (Data.PrimitiveIndex < PrimitiveCount) {
+                    LodKernelResult Result = EvaluateLodKernel(mMesh, Data, inCamera, Config, inDefines, mTextures);
+                    if (Result.Op == SubdUpdateOp::Split && (uint32_t)firstbithigh(Data.SubdBinaryKey) >= GetMaxKeyDepth()) {
+                        Result.Op = SubdUpdateOp::Keep;
+                    }
+                    ChangeCount += EmitUpdate(HeapIndex, Data, Result.Op, inCamera, Config, inDefines) ? 1 : 0;
+                    Visible = Result.Visible;
+                }
+                else {
+                    mTree.EmitLeaf(HeapIndex);
+                }
+                mVisibleFlags[LeafIndex] = Visible ? 1 : 0;
+                VisibleCount += Visible ? 1 : 0;
+            }
+            mChangeCount.fetch_add(ChangeCount, std::memory_order_relaxed);
+            return VisibleCount;
+        },
+        [&](size_t inBegin, size_t inEnd, uint32_t inOffset) {
+            uint32_t HeapIndex = mTree.DecodeLeaf((uint32_t)inBegin);
+            for (size_t LeafIndex = inBegin; LeafIndex < inEnd; ++LeafIndex, HeapIndex = mTree.GetNextLeaf(HeapIndex)) {
+                if (mVisibleFlags[LeafIndex]) {
+                    mSubdCulledBuffer[inOffset++] = HeapIndexToSubdData(HeapIndex, mPrimitiveBits);
+                }
+            }
+        });
+
+    mTree.Reduce(*mpThreadPool);
+}
+
+uint32_t SubdCbtEngine::Converge(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, uint32_t inMaxIterations,
+    double inTimeBudgetMs) {
+    auto Start = std::chrono::steady_clock::now();
+    uint32_t Iterations = 0;
+    while (Iterations < inMaxIterations) {
+        Update(inCamera, inConfig, inDefines);
+        ++Iterations;
+        if (mChangeCount == 0) {
+            break;
+        }
+        if (inTimeBudgetMs > 0.0 && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count() >= inTimeBudgetMs) {
+            break;
+        }
+    }
+    return Iterations;
+}
+
+std::vector<PrimitiveData> SubdCbtEngine::GetLeaves() const {
+    std::vector<PrimitiveData> Leaves;
+    uint32_t LeafCount = mTree.GetLeafCount();
+    Leaves.reserve(LeafCount);
+    uint32_t HeapIndex = mTree.DecodeLeaf(0);
+    for (uint32_t LeafIndex = 0; LeafIndex < LeafCount; ++LeafIndex, HeapIndex = mTree.GetNextLeaf(HeapIndex)) {
+        PrimitiveData Data = HeapIndexToSubdData(HeapIndex, mPrimitiveBits);
+        if (Data.PrimitiveIndex < mMesh.GetPrimitiveCount()) {
+            Leaves.push_back(Data);
+        }
+    }
+    return Leaves;
+}
+
+}
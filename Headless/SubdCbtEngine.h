@@ -0,0 +1,75 @@
+#pragma once
+#include "ConcurrentBinaryTree.h"
+#include "SubdEngine.h"
+
+namespace Headless {
+
+// The per-primitive key trees as one CBT: the primitive index (inPrimitiveBits of
+// them) sits between the root bit and the key, so primitive p's key 1 is heap index
+// (1 << inPrimitiveBits) | p.
+uint32_t SubdDataToHeapIndex(const PrimitiveData& inData, uint32_t inPrimitiveBits);
+PrimitiveData HeapIndexToSubdData(uint32_t inHeapIndex, uint32_t inPrimitiveBits);
+uint32_t GetPrimitiveBits(uint32_t inPrimitiveCount);
+
+// SubdEngine with the keys held in a ConcurrentBinaryTree (CBT_STORAGE in the shaders)
+// instead of the SubdIn / SubdOut ping-pong. Storage is fixed by the maximum depth, not
+// by a key budget, so any subdivision down to MaxDepth - GetPrimitiveBits() key levels
+// fits. The tree has to stay a partition, which changes two corner cases of
+// UpdateSubdBuffer: a child only merges into its parent when its sibling is a leaf that
+// does not split, and a child 1 that drops without that merge is kept instead.
+class SubdCbtEngine {
+public:
+    SubdCbtEngine(const SubdMesh& inMesh, uint32_t inMaxDepth = CbtMaxDepth, ThreadPool* inThreadPool = nullptr);
+
+    // inInitSubdBuffer must cover every primitive's root; primitives it leaves out start as a single root leaf.
+    // Keys must lie on the mesh and no deeper than GetMaxKeyDepth(); they are not checked here.
+    void LoadBuffer(const std::vector<PrimitiveData>& inInitSubdBuffer);
+    // Takes over a CBT_STORAGE bitfield read back from the GPU.
+    void LoadBitfield(const uint32_t* inWords);
+    // Same as SubdEngine::SetHeightBounds.
+    void SetHeightBounds(const HeightBoundsPyramid* inHeightBounds) { mTextures.HeightBounds = inHeightBounds; }
+    // Same as SubdEngine::SetHiZ.
+    void SetHiZ(const HiZPyramid* inHiZ) { mTextures.HiZ = inHiZ; }
+    // Same as SubdEngine::SetRoughness.
+    void SetRoughness(const RoughnessPyramid* inRoughness) { mTextures.Roughness = inRoughness; }
+
+    // One frame: LodKernel over every leaf, emitting the next tree, then the sum reduction.
+    void Update(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines);
+    // Same as SubdEngine::Converge: Update until a pass leaves the tree unchanged.
+    uint32_t Converge(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, uint32_t inMaxIterations,
+        double inTimeBudgetMs = 0.0);
+    // Leaves the last Update split, or merged away.
+    uint32_t GetChangeCount() const { return mChangeCount; }
+
+    const ConcurrentBinaryTree& GetTree() const { return mTree; }
+    uint32_t GetPrimitiveBits() const { return mPrimitiveBits; }
+    uint32_t GetMaxKeyDepth() const { return mTree.GetMaxDepth() - mPrimitiveBits; }
+    uint32_t GetLeafCount() const { return mTree.GetLeafCount(); }
+    PrimitiveData GetLeaf(uint32_t inLeafIndex) const { return HeapIndexToSubdData(mTree.DecodeLeaf(inLeafIndex), mPrimitiveBits); }
+    // Leaves of real primitives, in tree order.
+    std::vector<PrimitiveData> GetLeaves() const;
+
+    const PrimitiveData* GetSubdCulledOut() const { return mSubdCulledBuffer.data(); }
+    uint32_t GetSubdCulledOutCount() const { return mSubdCulledCount; }
+
+    // CBT words, plus the per-leaf culling output and scratch that grow with the leaf count.
+    size_t GetTreeByteSize() const { return mTree.GetByteSize(); }
+    size_t GetLeafByteSize() const { return mSubdCulledBuffer.capacity() * sizeof(PrimitiveData) + mVisibleFlags.capacity(); }
+
+private:
+    bool EmitUpdate(uint32_t inHeapIndex, const PrimitiveData& inData, SubdUpdateOp inOp, const SubdCamera& inCamera, const LodKernelConfig& inConfig,
+        const LodKernelDefines& inDefines);
+
+    SubdMesh mMesh;
+    ThreadPool* mpThreadPool;
+    LodKernelTextures mTextures;
+    ConcurrentBinaryTree mTree;
+    uint32_t mPrimitiveBits;
+
+    std::vector<PrimitiveData> mSubdCulledBuffer;
+    std::vector<uint8_t> mVisibleFlags;
+    uint32_t mSubdCulledCount = 0;
+    std::atomic<uint32_t> mChangeCount{ 0 };
+};
+
+}
@@ -0,0 +1,500 @@
+#include "SubdEngine.h"
+#include "SubdKeyTransform.h"
+#include "PatchGrid.h"
+#include "ParallelScan.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace Headless {
+
+SubdMesh SubdMesh::CreateQuad() {
+    SubdMesh Mesh;
+    Mesh.VertexData = { float4(-1.0f,-1.0f,0.0f,1.0f), float4(1.0f,-1.0f,0.0f,1.0f), float4(1.0f,1.0f,0.0f,1.0f), float4(-1.0f,1.0f,0.0f,1.0f) };
+    Mesh.IndexData = { 0,1,3,2,3,1 };
+    return Mesh;
+}
+
+std::vector<PrimitiveData> SubdMesh::CreateInitSubdBuffer() {
+    return { {0,2},{1,2},{0,3},{1,3} };
+}
+
+std::vector<PrimitiveData> SubdMesh::CreateRootKeys() const {
+    std::vector<PrimitiveData> Keys(2 * (size_t)GetPrimitiveCount());
+    for (uint32_t i = 0; i < GetPrimitiveCount(); ++i) {
+        Keys[2 * i] = { i, 2 };
+        Keys[2 * i + 1] = { i, 3 };
+    }
+    return Keys;
+}
+
+// The box LodKernel culls a leaf with: its triangle, raised by the heightmap bounds under it
+// when displaced.
+static void GetLeafBox(const float4 inVertices[3], const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, const LodKernelTextures& inTextures,
+    float4& outMinPosition, float4& outMaxPosition) {
+    outMinPosition = min(min(inVertices[0], inVertices[1]), inVertices[2]);
+    outMaxPosition = max(max(inVertices[0], inVertices[1]), inVertices[2]);
+    if (inDefines.Displace) {
+        float2 HeightBounds = inTextures.HeightBounds ? inTextures.HeightBounds->GetHeightBounds(float2(outMinPosition.x * 0.5f + 0.5f, outMinPosition.y * 0.5f + 0.5f),
+            float2(outMaxPosition.x * 0.5f + 0.5f, outMaxPosition.y * 0.5f + 0.5f)) : float2(0.0f, 1.0f);
+        float LowZ = HeightBounds.x * inConfig.DisplacementFactor;
+        float HighZ = HeightBounds.y * inConfig.DisplacementFactor;
+        outMinPosition.z += std::min(LowZ, HighZ);
+        outMaxPosition.z += std::max(LowZ, HighZ);
+    }
+}
+
+// MultiView: the views from 1 on, where a leaf is visible until culled.
+static uint32_t GetViewMask(const LodKernelConfig& inConfig, const LodKernelDefines& inDefines) {
+    return inDefines.MultiView ? ((1u << GetLodViewCount(inConfig)) - 1u) & ~1u : 0u;
+}
+
+// FrustumCullingTest, then HiZOcclusionTest with OcclusionCulling. The other MultiView views
+// only test their frustum: HiZ holds the depth of view 0.
+static void CullLeafBox(const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, const LodKernelTextures& inTextures, const float4& inMinPosition,
+    const float4& inMaxPosition, LodKernelResult& ioResult) {
+    ioResult.Visible = FrustumCullingTest(inConfig, inMinPosition, inMaxPosition);
+    if (ioResult.Visible && inDefines.OcclusionCulling && inTextures.HiZ && HiZOcclusionTest(inConfig, *inTextures.HiZ, inMinPosition, inMaxPosition)) {
+        ioResult.Visible = false;
+        ioResult.Occluded = true;
+    }
+    for (uint32_t View = 1; View < MaxLodViewCount; ++View) {
+        if ((ioResult.ViewVisibleMask >> View & 1u) && !ViewFrustumCullingTest(inConfig, View, inMinPosition, inMaxPosition)) {
+            ioResult.ViewVisibleMask &= ~(1u << View);
+        }
+    }
+}
+
+LodKernelResult EvaluateLodKernel(const SubdMesh& inMesh, const PrimitiveData& inData, const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines,
+    const LodKernelTextures& inTextures) {
+    LodKernelResult Result;
+    Result.ViewVisibleMask = GetViewMask(inConfig, inDefines);
+
+    float4 InVertices[3];
+    inMesh.GetPrimitiveVertices(inData.PrimitiveIndex, InVertices);
+
+    uint32_t SubdBinaryKey = inData.SubdBinaryKey;
+    float4 OutVertices[3], OutParentVertices[3];
+    Subd(SubdBinaryKey, InVertices, OutVertices, OutParentVertices, inDefines.KeyTransformTable ? &KeyTransformTable::GetDefault() : nullptr);
+    const RoughnessPyramid* Roughness = inDefines.RoughnessLod && inDefines.Displace ? inTextures.Roughness : nullptr;
+    float Distance = inDefines.MultiView ? GetMiddlePointDistance(OutVertices, inCamera.PosW, inConfig) : GetMiddlePointDistance(OutVertices, inCamera.PosW);
+    float ParentDistance = inDefines.MultiView ? GetMiddlePointDistance(OutParentVertices, inCamera.PosW, inConfig)
+        : GetMiddlePointDistance(OutParentVertices, inCamera.PosW);
+    float LodRoughness = Roughness ? GetLodRoughness(OutVertices, *Roughness) : 0.0f;
+    float ParentRoughness = Roughness ? GetLodRoughness(OutParentVertices, *Roughness) : 0.0f;
+    int TargetLod = FloatToInt(ComputeLod(Distance, LodRoughness, inConfig, Roughness != nullptr));
+    int ParentLod = FloatToInt(ComputeLod(ParentDistance, ParentRoughness, inConfig, Roughness != nullptr));
+    if (inDefines.FreezeSubdivision) {
+        TargetLod = ParentLod = firstbithigh(SubdBinaryKey);
+    }
+    Result.Op = UpdateSubdBuffer(SubdBinaryKey, TargetLod, ParentLod);
+    if (inDefines.IncrementalLod && Result.Op == SubdUpdateOp::Keep) {
+        Result.State.Slack = ComputeLodSlack(SubdBinaryKey, Distance, LodRoughness, ParentDistance, ParentRoughness, inConfig, Roughness != nullptr);
+    }
+
+    if (inDefines.FrustumCulling) {
+        float4 MinPosition, MaxPosition;
+        GetLeafBox(OutVertices, inConfig, inDefines, inTextures, MinPosition, MaxPosition);
+        CullLeafBox(inConfig, inDefines, inTextures, MinPosition, MaxPosition, Result);
+        for (int i = 0; i < 3; ++i) {
+            Result.State.BoxMin[i] = MinPosition[i];
+            Result.State.BoxMax[i] = MaxPosition[i];
+        }
+    }
+    return Result;
+}
+
+SubdEngine::SubdEngine(const SubdMesh& inMesh, size_t inSubdBufferSize, ThreadPool* inThreadPool)
+    : mMesh(inMesh), mSubdBufferSize(inSubdBufferSize), mpThreadPool(inThreadPool ? inThreadPool : &ThreadPool::GetDefault()) {
+    mSubdBuffer_0.resize(mSubdBufferSize);
+    mSubdBuffer_1.resize(mSubdBufferSize);
+    mSubdCulledBuffer.resize(mSubdBufferSize);
+    mCompactionFlags.resize(mSubdBufferSize);
+    LoadBuffer(SubdMesh::CreateInitSubdBuffer());
+}
+
+void SubdEngine::LoadBuffer(const std::vector<PrimitiveData>& inInitSubdBuffer) {
+    mPingpong = true;
+    size_t Count = std::min(inInitSubdBuffer.size(), mSubdBufferSize);
+    std::copy(inInitSubdBuffer.begin(), inInitSubdBuffer.begin() + Count, mSubdBuffer_0.begin());
+    mCulledCount = 0;
+    mSubdOutCount = 0;
+    mSubdInCount = (uint32_t)inInitSubdBuffer.size();
+    mChangeCount = 0;
+    mConvergenceIterations = 0;
+    mConverged = false;
+    mSplitCount = 0;
+    mMergeCount = 0;
+    mOccludedCount = 0;
+    mLastOccludedCount = 0;
+    mDirtyCount = 0;
+    mLastDirtyCount = 0;
+    mStateValid = false;
+    for (uint32_t View = 0; View < MaxLodViewCount; ++View) {
+        mIndirectDrawArgs[View] = { GetPatchIndexCount(DefaultPatchLevel),0,0,0,0 };
+    }
+    for (std::atomic<uint32_t>& Count : mViewCulledCount) {
+        Count = 0;
+    }
+    mIndirectDispatchArgs = { 1,1,1 };
+}
+
+uint32_t SubdEngine::WriteKeyToSubdBuffer(uint32_t inPrimitiveIndex, uint32_t inSubdBinaryKey) {
+    uint32_t OriginValue = mSubdOutCount.fetch_add(1u, std::memory_order_relaxed);
+    if (OriginValue < mSubdBufferSize) {
+        GetSubdOutBuffer()[OriginValue] = { inPrimitiveIndex, inSubdBinaryKey };
+    }
+    return OriginValue;
+}
+
+void SubdEngine::WriteKeyToSubdCulledOut(const PrimitiveData& inData) {
+    uint32_t OriginValue = mCulledCount.fetch_add(1u, std::memory_order_relaxed);
+    if (OriginValue < mSubdBufferSize) {
+        mSubdCulledBuffer[OriginValue] = inData;
+    }
+}
+
+// Appended in every mode, DeterministicCompaction included: only view 0 keeps SubdIn order.
+void SubdEngine::WriteKeyToViewCulledOut(uint32_t inViewMask, const PrimitiveData& inData) {
+    for (uint32_t View = 1; View < MaxLodViewCount; ++View) {
+        if (inViewMask >> View & 1u) {
+            uint32_t OriginValue = mViewCulledCount[View - 1].fetch_add(1u, std::memory_order_relaxed);
+            if (OriginValue < mSubdBufferSize) {
+                mViewCulledBuffer[(View - 1) * mSubdBufferSize + OriginValue] = inData;
+            }
+        }
+    }
+}
+
+static bool IsSameDefines(const LodKernelDefines& inA, const LodKernelDefines& inB) {
+    return inA.FreezeSubdivision == inB.FreezeSubdivision && inA.FrustumCulling == inB.FrustumCulling && inA.Displace == inB.Displace
+        && inA.KeyTransformTable == inB.KeyTransformTable && inA.DeterministicCompaction == inB.DeterministicCompaction && inA.OcclusionCulling == inB.OcclusionCulling
+        && inA.RoughnessLod == inB.RoughnessLod && inA.IncrementalLod == inB.IncrementalLod && inA.MultiView == inB.MultiView;
+}
+
+void SubdEngine::LodKernel(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines) {
+    // The sample fills LodKernelCB.FrustumPlanes once per frame; here once per pass.
+    LodKernelConfig Config = inConfig;
+    SetFrustumPlanes(Config, inCamera.ViewProjMat);
+    if (inDefines.MultiView && mViewCulledBuffer.empty()) {
+        mViewCulledBuffer.resize((MaxLodViewCount - 1) * mSubdBufferSize);
+    }
+    if (inDefines.DeterministicCompaction) {
+        LodKernelCompaction(inCamera, Config, inDefines);
+    }
+    else if (inDefines.IncrementalLod && !inDefines.FreezeSubdivision) {
+        LodKernelIncremental(inCamera, Config, inDefines);
+        return;
+    }
+    else {
+        LodKernelAtomic(inCamera, Config, inDefines);
+    }
+    mStateValid = false;
+}
+
+void SubdEngine::LodKernelAtomic(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines) {
+    const std::vector<PrimitiveData>& SubdIn = GetSubdInBuffer();
+
+    mpThreadPool->ParallelFor(GetSubdInCount(), 1024, [&](size_t inBegin, size_t inEnd) {
+        SubdChangeCount Changes;
+        uint32_t OccludedCount = 0;
+        for (size_t ThreadId = inBegin; ThreadId < inEnd; ++ThreadId) {
+            const PrimitiveData& Data = SubdIn[ThreadId];
+            LodKernelResult Result = EvaluateLodKernel(mMesh, Data, inCamera, inConfig, inDefines, mTextures);
+
+            uint32_t Keys[2];
+            uint32_t KeyCount = GetSubdUpdateKeys(Result.Op, Data.SubdBinaryKey, Keys);
+            for (uint32_t i = 0; i < KeyCount; ++i) {
+                WriteKeyToSubdBuffer(Data.PrimitiveIndex, Keys[i]);
+            }
+            Changes.Add(Result.Op);
+            OccludedCount += Result.Occluded ? 1 : 0;
+
+            if (Result.Visible) {
+                WriteKeyToSubdCulledOut(Data);
+            }
+            WriteKeyToViewCulledOut(Result.ViewVisibleMask, Data);
+        }
+        AddChangeCount(Changes);
+        mOccludedCount.fetch_add(OccludedCount, std::memory_order_relaxed);
+    });
+}
+
+// LodKernel with INCREMENTAL_LOD, then DirtyBatcherKernel and LodDirtyKernel. The first pass
+// takes the camera travel off every slack: a key with slack left is kept, and culled with
+// the box stored beside it; the others are listed in SubdDirty. The second evaluates the
+// listed keys in full and gives each key it writes a fresh state, with zero slack for the
+// keys of a split or merge so that they are evaluated in the next pass.
+void SubdEngine::LodKernelIncremental(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines) {
+    if (mSubdState_0.empty()) {
+        mSubdState_0.resize(mSubdBufferSize);
+        mSubdState_1.resize(mSubdBufferSize);
+        mSubdDirty.resize(mSubdBufferSize);
+    }
+    const std::vector<PrimitiveData>& SubdIn = GetSubdInBuffer();
+    const std::vector<LeafLodState>& SubdStateIn = GetSubdStateInBuffer();
+    std::vector<LeafLodState>& SubdStateOut = GetSubdStateOutBuffer();
+    float CameraTravel = mStateValid && IsSameDefines(inDefines, mStateDefines) ? inConfig.CameraTravel : std::numeric_limits<float>::infinity();
+
+    mpThreadPool->ParallelFor(GetSubdInCount(), 1024, [&](size_t inBegin, size_t inEnd) {
+        uint32_t OccludedCount = 0;
+        for (size_t ThreadId = inBegin; ThreadId < inEnd; ++ThreadId) {
+            LeafLodState State = SubdStateIn[ThreadId];
+            State.Slack -= CameraTravel;
+            if (!(State.Slack > 0.0f)) {
+                mSubdDirty[mDirtyCount.fetch_add(1u, std::memory_order_relaxed)] = (uint32_t)ThreadId;
+                continue;
+            }
+
+            const PrimitiveData& Data = SubdIn[ThreadId];
+            uint32_t OutIndex = WriteKeyToSubdBuffer(Data.PrimitiveIndex, Data.SubdBinaryKey);
+            if (OutIndex < mSubdBufferSize) {
+                SubdStateOut[OutIndex] = State;
+            }
+            LodKernelResult Result;
+            Result.ViewVisibleMask = GetViewMask(inConfig, inDefines);
+            if (inDefines.FrustumCulling) {
+                CullLeafBox(inConfig, inDefines, mTextures, float4(State.BoxMin[0], State.BoxMin[1], State.BoxMin[2], 1.0f),
+                    float4(State.BoxMax[0], State.BoxMax[1], State.BoxMax[2], 1.0f), Result);
+            }
+            OccludedCount += Result.Occluded ? 1 : 0;
+            if (Result.Visible) {
+                WriteKeyToSubdCulledOut(Data);
+            }
+            WriteKeyToViewCulledOut(Result.ViewVisibleMask, Data);
+        }
+        mOccludedCount.fetch_add(OccludedCount, std::memory_order_relaxed);
+    });
+
+    mpThreadPool->ParallelFor(mDirtyCount.load(), 1024, [&](size_t inBegin, size_t inEnd) {
+        SubdChangeCount Changes;
+        uint32_t OccludedCount = 0;
+        for (size_t ThreadId = inBegin; ThreadId < inEnd; ++ThreadId) {
+            const PrimitiveData& Data = SubdIn[mSubdDirty[ThreadId]];
+            LodKernelResult Result = EvaluateLodKernel(mMesh, Data, inCamera, inConfig, inDefines, mTextures);
+
+            uint32_t Keys[2];
+            uint32_t KeyCount = GetSubdUpdateKeys(Result.Op, Data.SubdBinaryKey, Keys);
+            for (uint32_t i = 0; i < KeyCount; ++i) {
+                uint32_t OutIndex = WriteKeyToSubdBuffer(Data.PrimitiveIndex, Keys[i]);
+                if (OutIndex < mSubdBufferSize) {
+                    SubdStateOut[OutIndex] = Result.State;
+                }
+            }
+            Changes.Add(Result.Op);
+            OccludedCount += Result.Occluded ? 1 : 0;
+            if (Result.Visible) {
+                WriteKeyToSubdCulledOut(Data);
+            }
+            WriteKeyToViewCulledOut(Result.ViewVisibleMask, Data);
+        }
+        AddChangeCount(Changes);
+        mOccludedCount.fetch_add(OccludedCount, std::memory_order_relaxed);
+    });
+
+    mStateValid = true;
+    mStateDefines = inDefines;
+}
+
+static const uint8_t CompactionOpMask = 3;
+static const uint8_t CompactionVisibleFlag = 4;
+
+// Same passes as LodKernel + CompactionScanBlockKernel + CompactionScanBlockSumsKernel +
+// CompactionScatterKernel, with CompactionBlockSize keys per block: no shared counter
+// is touched per key, and the result does not depend on the thread count.
+void SubdEngine::LodKernelCompaction(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines) {
+    const std::vector<PrimitiveData>& SubdIn = GetSubdInBuffer();
+    std::vector<PrimitiveData>& SubdOut = GetSubdOutBuffer();
+    std::vector<PrimitiveData>& SubdCulledOut = mSubdCulledBuffer;
+
+    SubdCompactionCount Total = ParallelCompact<SubdCompactionCount>(GetSubdInCount(), CompactionBlockSize, *mpThreadPool,
+        [&](size_t inBegin, size_t inEnd) {
+            SubdCompactionCount Count;
+            SubdChangeCount Changes;
+            uint32_t OccludedCount = 0;
+            for (size_t ThreadId = inBegin; ThreadId < inEnd; ++ThreadId) {
+                LodKernelResult Result = EvaluateLodKernel(mMesh, SubdIn[ThreadId], inCamera, inConfig, inDefines, mTextures);
+                mCompactionFlags[ThreadId] = (uint8_t)Result.Op | (Result.Visible ? CompactionVisibleFlag : 0);
+
+                uint32_t Keys[2];
+                Count.SubdOutCount += GetSubdUpdateKeys(Result.Op, 1u, Keys);
+                Count.CulledCount += Result.Visible ? 1 : 0;
+                WriteKeyToViewCulledOut(Result.ViewVisibleMask, SubdIn[ThreadId]);
+                Changes.Add(Result.Op);
+                OccludedCount += Result.Occluded ? 1 : 0;
+            }
+            AddChangeCount(Changes);
+            mOccludedCount.fetch_add(OccludedCount, std::memory_order_relaxed);
+            return Count;
+        },
+        [&](size_t inBegin, size_t inEnd, SubdCompactionCount inOffset) {
+            for (size_t ThreadId = inBegin; ThreadId < inEnd; ++ThreadId) {
+                const PrimitiveData& Data = SubdIn[ThreadId];
+                uint8_t CompactionFlag = mCompactionFlags[ThreadId];
+
+                uint32_t Keys[2];
+                uint32_t KeyCount = GetSubdUpdateKeys((SubdUpdateOp)(CompactionFlag & CompactionOpMask), Data.SubdBinaryKey, Keys);
+                for (uint32_t i = 0; i < KeyCount; ++i, ++inOffset.SubdOutCount) {
+                    if (inOffset.SubdOutCount < mSubdBufferSize) {
+                        SubdOut[inOffset.SubdOutCount] = { Data.PrimitiveIndex, Keys[i] };
+                    }
+                }
+                if (CompactionFlag & CompactionVisibleFlag) {
+                    if (inOffset.CulledCount < mSubdBufferSize) {
+                        SubdCulledOut[inOffset.CulledCount] = Data;
+                    }
+                    ++inOffset.CulledCount;
+                }
+            }
+        });
+
+    mSubdOutCount = Total.SubdOutCount;
+    mCulledCount = Total.CulledCount;
+}
+
+void SubdEngine::AddChangeCount(const SubdChangeCount& inChanges) {
+    mChangeCount.fetch_add(inChanges.ChangeCount, std::memory_order_relaxed);
+    mSplitCount.fetch_add(inChanges.SplitCount, std::memory_order_relaxed);
+    mMergeCount.fetch_add(inChanges.MergeCount, std::memory_order_relaxed);
+}
+
+void SubdEngine::ConvergenceResetKernel() {
+    mIndirectDispatchArgs = { mSubdInCount / LodKernelGroupSize + 1, 1, 1 };
+    mChangeCount = 0;
+    mConvergenceIterations = 0;
+    mConverged = false;
+    mSplitCount = 0;
+    mMergeCount = 0;
+}
+
+void SubdEngine::IndirectBatcherKernel() {
+    if (mConverged) {
+        return;
+    }
+    uint32_t SubdDataCount = mSubdOutCount.load();
+    mIndirectDispatchArgs = { SubdDataCount / LodKernelGroupSize + 1, 1, 1 };
+    if (mChangeCount.load() == 0) {
+        mIndirectDispatchArgs.ThreadGroupCountX = 0;
+        mConverged = true;
+    }
+    mIndirectDrawArgs[0].InstanceCount = mCulledCount.load();
+    for (uint32_t View = 1; View < MaxLodViewCount; ++View) {
+        mIndirectDrawArgs[View].InstanceCount = mViewCulledCount[View - 1].exchange(0);
+    }
+    mLastOccludedCount = mOccludedCount.load();
+    mLastDirtyCount = mDirtyCount.load();
+    mCulledCount = 0;
+    mOccludedCount = 0;
+    mDirtyCount = 0;
+    mSubdOutCount = 0;
+    mSubdInCount = SubdDataCount;
+    mChangeCount = 0;
+    ++mConvergenceIterations;
+}
+
+void SubdEngine::Update(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines) {
+    Converge(inCamera, inConfig, inDefines, 1);
+}
+
+// The GPU issues every pass and skips the work of those after convergence through the
+// empty dispatch; here the loop simply stops.
+uint32_t SubdEngine::Converge(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, uint32_t inMaxIterations,
+    double inTimeBudgetMs) {
+    auto Start = std::chrono::steady_clock::now();
+    ConvergenceResetKernel();
+    mPassTimings = SubdPassTimings();
+    while (!mConverged && mConvergenceIterations < inMaxIterations) {
+        auto PassStart = std::chrono::steady_clock::now();
+        LodKernel(inCamera, inConfig, inDefines);
+        auto BatcherStart = std::chrono::steady_clock::now();
+        IndirectBatcherKernel();
+        auto PassEnd = std::chrono::steady_clock::now();
+        mPassTimings.LodKernelMs += std::chrono::duration<double, std::milli>(BatcherStart - PassStart).count();
+        mPassTimings.IndirectBatcherKernelMs += std::chrono::duration<double, std::milli>(PassEnd - BatcherStart).count();
+        mPingpong = !mPingpong;
+        if (inTimeBudgetMs > 0.0 && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count() >= inTimeBudgetMs) {
+            break;
+        }
+    }
+    return mConvergenceIterations;
+}
+
+SubdBufferCounter SubdEngine::GetBufferCounter() const {
+    SubdBufferCounter Counter;
+    Counter.CulledCount = mCulledCount.load();
+    Counter.SubdOutCount = mSubdOutCount.load();
+    Counter.SubdInCount = mSubdInCount;
+    Counter.ChangeCount = mChangeCount.load();
+    Counter.ConvergenceIterations = mConvergenceIterations;
+    Counter.Converged = mConverged ? 1 : 0;
+    Counter.SplitCount = mSplitCount.load();
+    Counter.MergeCount = mMergeCount.load();
+    Counter.OccludedCount = mOccludedCount.load();
+    Counter.LastOccludedCount = mLastOccludedCount;
+    Counter.DirtyCount = mDirtyCount.load();
+    Counter.LastDirtyCount = mLastDirtyCount;
+    for (uint32_t View = 1; View < MaxLodViewCount; ++View) {
+        Counter.ViewCulledCount[View - 1] = mViewCulledCount[View - 1].load();
+    }
+    return Counter;
+}
+
+SubdReadback SubdEngine::GetReadback() const {
+    SubdReadback Readback;
+    Readback.Counter = GetBufferCounter();
+    std::copy(mIndirectDrawArgs, mIndirectDrawArgs + MaxLodViewCount, Readback.DrawArgs);
+    Readback.DispatchArgs[0] = mIndirectDispatchArgs;
+    return Readback;
+}
+
+// A GPU thread past the end of SubdIn would read zeros; the CPU copy simply stops there.
+uint32_t SubdEngine::GetSubdInCount() const {
+    return (uint32_t)std::min<size_t>(mSubdInCount, mSubdBufferSize);
+}
+
+const PrimitiveData* SubdEngine::GetSubdCulledOut(uint32_t inView) const {
+    if (inView == 0) {
+        return mSubdCulledBuffer.data();
+    }
+    return mViewCulledBuffer.empty() ? nullptr : mViewCulledBuffer.data() + (inView - 1) * mSubdBufferSize;
+}
+
+uint32_t SubdEngine::GetSubdCulledOutCount(uint32_t inView) const {
+    return (uint32_t)std::min<size_t>(mIndirectDrawArgs[inView].InstanceCount, mSubdBufferSize);
+}
+
+float4x4 CreateViewProjMat(const float3& inPosW, const float3& inTarget, const float3& inUp, float inFovY, float inAspectRatio, float inNearZ, float inFarZ) {
+    float3 f = normalize(inTarget - inPosW);
+    float3 s = normalize(cross(f, inUp));
+    float3 u = cross(s, f);
+
+    // Column-major like glm: View[c][r] is column c, row r.
+    float View[4][4] = {
+        { s.x, u.x, -f.x, 0.0f },
+        { s.y, u.y, -f.y, 0.0f },
+        { s.z, u.z, -f.z, 0.0f },
+        { -dot(s, inPosW), -dot(u, inPosW), dot(f, inPosW), 1.0f }
+    };
+    float TanHalfFovY = std::tan(inFovY / 2.0f);
+    float Proj[4][4] = {};
+    Proj[0][0] = 1.0f / (inAspectRatio * TanHalfFovY);
+    Proj[1][1] = 1.0f / TanHalfFovY;
+    Proj[2][2] = inFarZ / (inNearZ - inFarZ);
+    Proj[2][3] = -1.0f;
+    Proj[3][2] = -(inFarZ * inNearZ) / (inFarZ - inNearZ);
+
+    // Falcor binds matrices row-major, so the shader's row i is glm's column i.
+    float4x4 ViewProj;
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            float Sum = 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                Sum += Proj[k][r] * View[c][k];
+            }
+            ViewProj[c][r] = Sum;
+        }
+    }
+    return ViewProj;
+}
+
+}
@@ -0,0 +1,222 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "SubdHeightBounds.h"
+#include "SubdIncremental.h"
+#include "SubdOcclusion.h"
+#include "SubdRoughness.h"
+#include "SubdStats.h"
+#include "SubdUtils.h"
+#include "ThreadPool.h"
+
+namespace Headless {
+
+const size_t SubdBufferSize = 1 << 20;
+
+// CPU copy of VertexBuffer / IndexBuffer.
+struct SubdMesh {
+    std::vector<float4> VertexData;
+    std::vector<uint32_t> IndexData;
+
+    uint32_t GetPrimitiveCount() const { return (uint32_t)(IndexData.size() / 3); }
+    void GetPrimitiveVertices(uint32_t inPrimitiveIndex, float4 outVertices[3]) const {
+        outVertices[0] = VertexData[IndexData[inPrimitiveIndex * 3]];
+        outVertices[1] = VertexData[IndexData[inPrimitiveIndex * 3 + 1]];
+        outVertices[2] = VertexData[IndexData[inPrimitiveIndex * 3 + 2]];
+    }
+
+    // The unit quad and root keys the sample starts from (VertexData / IndexData / InitSubdBuffer).
+    static SubdMesh CreateQuad();
+    static std::vector<PrimitiveData> CreateInitSubdBuffer();
+    // InitSubdBuffer of any mesh: the root key pair { i, 2 }, { i, 3 } of every triangle.
+    std::vector<PrimitiveData> CreateRootKeys() const;
+};
+
+// Time spent in the kernels by the last Update / Converge, summed over its passes: what
+// the sample's benchmark mode measures with GpuTimers.
+struct SubdPassTimings {
+    double LodKernelMs = 0.0;
+    double IndirectBatcherKernelMs = 0.0;
+};
+
+// Result of one LodKernel thread.
+struct LodKernelResult {
+    SubdUpdateOp Op = SubdUpdateOp::Keep;
+    bool Visible = true;
+    // Inside the frustum but hidden by HiZ (OcclusionCulling); Visible is then false.
+    bool Occluded = false;
+    // IncrementalLod: the slack of a kept key (zero for any other op) and, with
+    // FrustumCulling, the box it was culled with.
+    LeafLodState State = {};
+    // MultiView: bit i set when view i >= 1 keeps the leaf (frustum test only).
+    uint32_t ViewVisibleMask = 0;
+};
+
+// The textures LodKernel reads besides the heightmap. All are optional.
+struct LodKernelTextures {
+    // HeightBoundsTexture: without it the culling box of a displaced leaf spans all of
+    // [0, DisplacementFactor].
+    const HeightBoundsPyramid* HeightBounds = nullptr;
+    // HiZTexture, at LodKernelConfig::HiZSize: without it nothing is occluded.
+    const HiZPyramid* HiZ = nullptr;
+    // RoughnessTexture: without it RoughnessLod keeps the distance lod.
+    const RoughnessPyramid* Roughness = nullptr;
+};
+
+// inConfig.FrustumPlanes must be set (SetFrustumPlanes), with OcclusionCulling and a HiZ
+// pyramid HiZViewProj / HiZSize as well (SetHiZView), and with RoughnessLod and a roughness
+// pyramid RoughnessLodScale / MaxLodOffset (SetRoughnessLod).
+LodKernelResult EvaluateLodKernel(const SubdMesh& inMesh, const PrimitiveData& inData, const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines,
+    const LodKernelTextures& inTextures = LodKernelTextures());
+
+// (SubdOut, SubdCulledOut) key counts summed by the DeterministicCompaction scan.
+struct SubdCompactionCount {
+    uint32_t SubdOutCount = 0;
+    uint32_t CulledCount = 0;
+
+    SubdCompactionCount operator+(const SubdCompactionCount& inOther) const {
+        return { SubdOutCount + inOther.SubdOutCount, CulledCount + inOther.CulledCount };
+    }
+};
+
+// Keys a LodKernel block split or merged; a merged pair counts once, by the child 1 that drops.
+struct SubdChangeCount {
+    uint32_t ChangeCount = 0;
+    uint32_t SplitCount = 0;
+    uint32_t MergeCount = 0;
+
+    void Add(SubdUpdateOp inOp) {
+        ChangeCount += inOp != SubdUpdateOp::Keep ? 1 : 0;
+        SplitCount += inOp == SubdUpdateOp::Split ? 1 : 0;
+        MergeCount += inOp == SubdUpdateOp::Drop ? 1 : 0;
+    }
+};
+
+// Headless reference of the LodKernel / IndirectBatcherKernel loop driven by
+// AdaptiveSubdivision::onFrameRender. Keeps the same ping-pong SubdIn / SubdOut /
+// SubdCulledOut buffers and BufferCounter semantics, including the atomic appends,
+// so the key set after each frame matches the shader's. Like a UAV, writes past
+// the end of a buffer are dropped while the counter keeps counting.
+// With LodKernelDefines::DeterministicCompaction the appends become a count / scan /
+// scatter over blocks of SubdIn: same key set, but both outputs keep SubdIn order.
+// With LodKernelDefines::IncrementalLod a LeafLodState follows every key through the
+// ping-pong, and only the keys whose slack ran out are evaluated, in a second pass over
+// the dirty list (LodDirtyKernel): same key set and culled set as the full evaluation.
+// With LodKernelDefines::MultiView the lod is taken over all views of the config in the
+// same walk of SubdIn, and every view from 1 on appends its leaves to a list of its own
+// (SubdViewCulledOut), counted in its own IndirectDrawArgs.
+class SubdEngine {
+public:
+    SubdEngine(const SubdMesh& inMesh, size_t inSubdBufferSize = SubdBufferSize, ThreadPool* inThreadPool = nullptr);
+
+    void LoadBuffer(const std::vector<PrimitiveData>& inInitSubdBuffer);
+    // Heightmap bounds for culling displaced leaves (HeightBoundsTexture); null culls against
+    // the full displacement range. Must outlive the engine.
+    void SetHeightBounds(const HeightBoundsPyramid* inHeightBounds) {
+        mTextures.HeightBounds = inHeightBounds;
+        mStateValid = false;
+    }
+    // Depth pyramid of the previous frame for OcclusionCulling (HiZTexture); the config
+    // passed to LodKernel carries its view. Must outlive the engine.
+    void SetHiZ(const HiZPyramid* inHiZ) { mTextures.HiZ = inHiZ; }
+    // Heightmap curvature for RoughnessLod (RoughnessTexture). Must outlive the engine.
+    void SetRoughness(const RoughnessPyramid* inRoughness) {
+        mTextures.Roughness = inRoughness;
+        mStateValid = false;
+    }
+
+    void ConvergenceResetKernel();
+    void LodKernel(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines);
+    void IndirectBatcherKernel();
+    // One frame: LodKernel, IndirectBatcherKernel and the ping-pong swap.
+    void Update(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines);
+    // One frame of the "Converge In Frame" mode: LodKernel passes until one changes no key,
+    // inMaxIterations passes have run or inTimeBudgetMs (0 = none) is spent. Returns the
+    // passes run; GetBufferCounter().Converged tells whether the tree is stable.
+    uint32_t Converge(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, uint32_t inMaxIterations,
+        double inTimeBudgetMs = 0.0);
+
+    const SubdMesh& GetMesh() const { return mMesh; }
+    size_t GetSubdBufferSize() const { return mSubdBufferSize; }
+    SubdBufferCounter GetBufferCounter() const;
+    // What the sample copies to its readback ring at the end of a frame (only the LodKernel
+    // dispatch record is tracked here).
+    SubdReadback GetReadback() const;
+    const IndirectDrawArgs& GetIndirectDrawArgs(uint32_t inView = 0) const { return mIndirectDrawArgs[inView]; }
+    const IndirectDispatchArgs& GetIndirectDispatchArgs() const { return mIndirectDispatchArgs; }
+    const SubdPassTimings& GetPassTimings() const { return mPassTimings; }
+
+    // Keys the next LodKernel reads, and the leaves the last LodKernel kept visible in view
+    // inView (MultiView views from 1 on).
+    const PrimitiveData* GetSubdIn() const { return GetSubdInBuffer().data(); }
+    uint32_t GetSubdInCount() const;
+    const PrimitiveData* GetSubdCulledOut(uint32_t inView = 0) const;
+    uint32_t GetSubdCulledOutCount(uint32_t inView = 0) const;
+    // IncrementalLod: the state of each SubdIn key.
+    const LeafLodState* GetSubdStateIn() const { return GetSubdStateInBuffer().data(); }
+
+private:
+    const std::vector<PrimitiveData>& GetSubdInBuffer() const { return mPingpong ? mSubdBuffer_0 : mSubdBuffer_1; }
+    std::vector<PrimitiveData>& GetSubdInBuffer() { return mPingpong ? mSubdBuffer_0 : mSubdBuffer_1; }
+    std::vector<PrimitiveData>& GetSubdOutBuffer() { return mPingpong ? mSubdBuffer_1 : mSubdBuffer_0; }
+    const std::vector<LeafLodState>& GetSubdStateInBuffer() const { return mPingpong ? mSubdState_0 : mSubdState_1; }
+    std::vector<LeafLodState>& GetSubdStateOutBuffer() { return mPingpong ? mSubdState_1 : mSubdState_0; }
+
+    void AddChangeCount(const SubdChangeCount& inChanges);
+    // Returns the SubdOut index written, which may be past the end of the buffer.
+    uint32_t WriteKeyToSubdBuffer(uint32_t inPrimitiveIndex, uint32_t inSubdBinaryKey);
+    void WriteKeyToSubdCulledOut(const PrimitiveData& inData);
+    void WriteKeyToViewCulledOut(uint32_t inViewMask, const PrimitiveData& inData);
+    void LodKernelAtomic(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines);
+    void LodKernelCompaction(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines);
+    void LodKernelIncremental(const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines);
+
+    SubdMesh mMesh;
+    size_t mSubdBufferSize;
+    ThreadPool* mpThreadPool;
+    LodKernelTextures mTextures;
+
+    std::vector<PrimitiveData> mSubdBuffer_0;
+    std::vector<PrimitiveData> mSubdBuffer_1;
+    std::vector<PrimitiveData> mSubdCulledBuffer;
+    // SubdViewCulledOut, one SubdBufferSize list per view from 1 on, allocated by the first
+    // MultiView pass.
+    std::vector<PrimitiveData> mViewCulledBuffer;
+    // Op in bits 0-1 and CompactionVisibleFlag per SubdIn key, like CompactionFlags.
+    std::vector<uint8_t> mCompactionFlags;
+    // SubdStateIn / SubdStateOut and SubdDirty, allocated by the first IncrementalLod pass.
+    // The states only hold for the keys when the last pass was incremental with the same
+    // defines and textures; otherwise the next one evaluates every key.
+    std::vector<LeafLodState> mSubdState_0;
+    std::vector<LeafLodState> mSubdState_1;
+    std::vector<uint32_t> mSubdDirty;
+    bool mStateValid = false;
+    LodKernelDefines mStateDefines;
+
+    std::atomic<uint32_t> mCulledCount{ 0 };
+    std::atomic<uint32_t> mSubdOutCount{ 0 };
+    uint32_t mSubdInCount = 0;
+    std::atomic<uint32_t> mChangeCount{ 0 };
+    uint32_t mConvergenceIterations = 0;
+    bool mConverged = false;
+    std::atomic<uint32_t> mSplitCount{ 0 };
+    std::atomic<uint32_t> mMergeCount{ 0 };
+    std::atomic<uint32_t> mOccludedCount{ 0 };
+    uint32_t mLastOccludedCount = 0;
+    std::atomic<uint32_t> mDirtyCount{ 0 };
+    uint32_t mLastDirtyCount = 0;
+    std::atomic<uint32_t> mViewCulledCount[MaxLodViewCount - 1];
+
+    IndirectDrawArgs mIndirectDrawArgs[MaxLodViewCount];
+    IndirectDispatchArgs mIndirectDispatchArgs;
+    SubdPassTimings mPassTimings;
+
+    bool mPingpong = true;
+};
+
+// Builds the row-vector view-projection matrix Falcor's camera uploads to gScene
+// (glm::lookAt / glm::perspective with a [0,1] depth range).
+float4x4 CreateViewProjMat(const float3& inPosW, const float3& inTarget, const float3& inUp, float inFovY, float inAspectRatio, float inNearZ, float inFarZ);
+
+}
@@ -0,0 +1,97 @@
+#include "SubdHeightBounds.h"
+
+namespace Headless {
+
+// Bounds texel (x, y) of a level covers texels [2x, 2x + 1] of the one below, through the
+// last texel of the row or column below when the size there is odd.
+static void GetChildRange(uint32_t inIndex, uint32_t inSize, uint32_t inChildSize, uint32_t& outBegin, uint32_t& outEnd) {
+    outBegin = std::min(2 * inIndex, inChildSize - 1);
+    outEnd = inIndex == inSize - 1 ? inChildSize - 1 : 2 * inIndex + 1;
+}
+
+void HeightBoundsPyramid::Build(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight, ThreadPool& inThreadPool) {
+    mSourceWidth = inWidth;
+    mSourceHeight = inHeight;
+    mLevels.clear();
+    if (inWidth == 0 || inHeight == 0) {
+        return;
+    }
+
+    do {
+        uint32_t Level = (uint32_t)mLevels.size();
+        uint32_t Width = GetWidth(Level);
+        uint32_t Height = GetHeight(Level);
+        uint32_t ChildWidth = Level == 0 ? inWidth : GetWidth(Level - 1);
+        uint32_t ChildHeight = Level == 0 ? inHeight : GetHeight(Level - 1);
+        const uint16_t* Child = Level == 0 ? nullptr : mLevels[Level - 1].data();
+        mLevels.emplace_back((size_t)Width * Height * 2);
+        uint16_t* Bounds = mLevels.back().data();
+
+        inThreadPool.ParallelFor(Height, 16, [&](size_t inBegin, size_t inEnd) {
+            for (uint32_t y = (uint32_t)inBegin; y < (uint32_t)inEnd; ++y) {
+                uint32_t ChildY0, ChildY1;
+                GetChildRange(y, Height, ChildHeight, ChildY0, ChildY1);
+                for (uint32_t x = 0; x < Width; ++x) {
+                    uint32_t ChildX0, ChildX1;
+                    GetChildRange(x, Width, ChildWidth, ChildX0, ChildX1);
+                    uint16_t Min = 0xffff;
+                    uint16_t Max = 0;
+                    for (uint32_t j = ChildY0; j <= ChildY1; ++j) {
+                        for (uint32_t i = ChildX0; i <= ChildX1; ++i) {
+                            size_t Index = (size_t)j * ChildWidth + i;
+                            Min = std::min(Min, Child ? Child[2 * Index] : inHeights[Index]);
+                            Max = std::max(Max, Child ? Child[2 * Index + 1] : inHeights[Index]);
+                        }
+                    }
+                    Bounds[2 * ((size_t)y * Width + x)] = Min;
+                    Bounds[2 * ((size_t)y * Width + x) + 1] = Max;
+                }
+            }
+        });
+    } while (GetWidth((uint32_t)mLevels.size() - 1) > 1 || GetHeight((uint32_t)mLevels.size() - 1) > 1);
+}
+
+std::vector<uint16_t> HeightBoundsPyramid::GetMipChain() const {
+    std::vector<uint16_t> Chain;
+    for (const std::vector<uint16_t>& Level : mLevels) {
+        Chain.insert(Chain.end(), Level.begin(), Level.end());
+    }
+    return Chain;
+}
+
+float2 HeightBoundsPyramid::GetHeightBounds(const float2& inMinUV, const float2& inMaxUV) const {
+    if (mLevels.empty()) {
+        return float2(0.0f, 1.0f);
+    }
+
+    // Heightmap texels bilinear filtering reads between the two corners.
+    float MaxX = (float)(mSourceWidth - 1);
+    float MaxY = (float)(mSourceHeight - 1);
+    uint32_t X0 = (uint32_t)std::min(std::max(std::floor(inMinUV.x * mSourceWidth - 0.5f), 0.0f), MaxX);
+    uint32_t Y0 = (uint32_t)std::min(std::max(std::floor(inMinUV.y * mSourceHeight - 0.5f), 0.0f), MaxY);
+    uint32_t X1 = (uint32_t)std::min(std::max(std::floor(inMaxUV.x * mSourceWidth - 0.5f) + 1.0f, 0.0f), MaxX);
+    uint32_t Y1 = (uint32_t)std::min(std::max(std::floor(inMaxUV.y * mSourceHeight - 0.5f) + 1.0f, 0.0f), MaxY);
+
+    // At heightmap mip firstbithigh(span) + 1 the footprint falls in at most 2x2 texels.
+    uint32_t Span = std::max(X1 - X0, Y1 - Y0);
+    uint32_t Level = (uint32_t)std::min(std::max(firstbithigh(Span), 0), (int)mLevels.size() - 1);
+    uint32_t Shift = Level + 1;
+    uint32_t Width = GetWidth(Level);
+    uint32_t Height = GetHeight(Level);
+    uint32_t X[2] = { std::min(X0 >> Shift, Width - 1), std::min(X1 >> Shift, Width - 1) };
+    uint32_t Y[2] = { std::min(Y0 >> Shift, Height - 1), std::min(Y1 >> Shift, Height - 1) };
+
+    const uint16_t* Bounds = mLevels[Level].data();
+    uint16_t Min = 0xffff;
+    uint16_t Max = 0;
+    for (uint32_t j = 0; j < 2; ++j) {
+        for (uint32_t i = 0; i < 2; ++i) {
+            size_t Index = (size_t)Y[j] * Width + X[i];
+            Min = std::min(Min, Bounds[2 * Index]);
+            Max = std::max(Max, Bounds[2 * Index + 1]);
+        }
+    }
+    return float2((float)Min / 65535.0f, (float)Max / 65535.0f);
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include "SubdMath.h"
+#include "ThreadPool.h"
+
+namespace Headless {
+
+// Min / max mip pyramid of an R16 heightmap, uploaded as the RG16Unorm HeightBoundsTexture.
+// Its mip 0 holds the bounds of 2x2 heightmap texels (heightmap mip 1), and each further mip
+// the bounds of the 2x2 texels below it; on odd sizes the last texel of a row or column also
+// covers the leftover one. GetHeightBounds gives LodKernel a z range under a leaf that holds
+// every bilinear HeightMapTexture sample of the patch, instead of all of [0, 1].
+class HeightBoundsPyramid {
+public:
+    void Build(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight, ThreadPool& inThreadPool = ThreadPool::GetDefault());
+
+    bool IsEmpty() const { return mLevels.empty(); }
+    // Size of the heightmap the pyramid was built from.
+    uint32_t GetSourceWidth() const { return mSourceWidth; }
+    uint32_t GetSourceHeight() const { return mSourceHeight; }
+    // Levels of the pyramid; level i is heightmap mip i + 1.
+    uint32_t GetLevelCount() const { return (uint32_t)mLevels.size(); }
+    uint32_t GetWidth(uint32_t inLevel) const { return std::max(mSourceWidth >> (inLevel + 1), 1u); }
+    uint32_t GetHeight(uint32_t inLevel) const { return std::max(mSourceHeight >> (inLevel + 1), 1u); }
+    // (min, max) pairs of one level, rows packed.
+    const uint16_t* GetLevel(uint32_t inLevel) const { return mLevels[inLevel].data(); }
+    // Every level back to back, the layout Texture::create2D takes for a full mip chain.
+    std::vector<uint16_t> GetMipChain() const;
+
+    // Bounds of the normalized heights bilinear sampling can return in the UV rectangle
+    // [inMinUV, inMaxUV] (clamped addressing, like the "Linear" sampler). Reads 2x2 texels
+    // of the finest level whose texels cover the footprint; mirrors GetHeightBounds in
+    // Data/Utils.hlsl.
+    float2 GetHeightBounds(const float2& inMinUV, const float2& inMaxUV) const;
+
+private:
+    uint32_t mSourceWidth = 0;
+    uint32_t mSourceHeight = 0;
+    std::vector<std::vector<uint16_t>> mLevels;
+};
+
+}
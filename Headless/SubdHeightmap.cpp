@@ -0,0 +1,160 @@
+#include "SubdHeightmap.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define SUBD_HEIGHTMAP_SSE2
+#endif
+
+namespace Headless {
+
+static const uint32_t SlopeTileRows = 32;
+static const uint32_t SlopeTileColumns = 2048;
+// Rows of slopes WriteHeightmapCache keeps in memory.
+static const uint32_t SlopeBandRows = 512;
+
+static uint64_t AlignCacheOffset(uint64_t inOffset) {
+    return (inOffset + 63) & ~63ull;
+}
+
+// Texels [inBegin, inEnd) of row inRow, with the clamped central differences of the
+// original LoadTexture loop: z = height / 65535, slope = size * 0.5 * (z+ - z-).
+static void ComputeSlopeSpan(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight, uint32_t inRow, uint32_t inBegin, uint32_t inEnd,
+    float* outSlopes) {
+    const uint16_t* Row = inHeights + (size_t)inRow * inWidth;
+    const uint16_t* Bottom = inHeights + (size_t)(inRow > 0 ? inRow - 1 : 0) * inWidth;
+    const uint16_t* Top = inHeights + (size_t)std::min(inRow + 1, inHeight - 1) * inWidth;
+    float ScaleX = (float)inWidth * 0.5f;
+    float ScaleY = (float)inHeight * 0.5f;
+    auto ComputeTexel = [&](uint32_t i) {
+        uint32_t i1 = i > 0 ? i - 1 : 0;
+        uint32_t i2 = std::min(i + 1, inWidth - 1);
+        outSlopes[2 * i] = ScaleX * ((float)Row[i2] / 65535.0f - (float)Row[i1] / 65535.0f);
+        outSlopes[2 * i + 1] = ScaleY * ((float)Top[i] / 65535.0f - (float)Bottom[i] / 65535.0f);
+    };
+
+    uint32_t i = inBegin;
+    if (i == 0 && i < inEnd) {
+        ComputeTexel(i++);
+    }
+#if defined(SUBD_HEIGHTMAP_SSE2)
+    // Interior texels, where the left and right neighbours need no clamping.
+    const __m128i Zero = _mm_setzero_si128();
+    const __m128 MaxHeight = _mm_set1_ps(65535.0f);
+    const __m128 ScaleX4 = _mm_set1_ps(ScaleX);
+    const __m128 ScaleY4 = _mm_set1_ps(ScaleY);
+    for (; i + 4 <= inEnd && i + 4 < inWidth; i += 4) {
+        __m128 Left = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(Row + i - 1)), Zero));
+        __m128 Right = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(Row + i + 1)), Zero));
+        __m128 Down = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(Bottom + i)), Zero));
+        __m128 Up = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(Top + i)), Zero));
+        __m128 SlopeX = _mm_mul_ps(ScaleX4, _mm_sub_ps(_mm_div_ps(Right, MaxHeight), _mm_div_ps(Left, MaxHeight)));
+        __m128 SlopeY = _mm_mul_ps(ScaleY4, _mm_sub_ps(_mm_div_ps(Up, MaxHeight), _mm_div_ps(Down, MaxHeight)));
+        _mm_storeu_ps(outSlopes + 2 * i, _mm_unpacklo_ps(SlopeX, SlopeY));
+        _mm_storeu_ps(outSlopes + 2 * i + 4, _mm_unpackhi_ps(SlopeX, SlopeY));
+    }
+#endif
+    for (; i < inEnd; ++i) {
+        ComputeTexel(i);
+    }
+}
+
+void ComputeSlopeRows(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight, uint32_t inRowBegin, uint32_t inRowEnd, float* outSlopes,
+    ThreadPool& inThreadPool) {
+    uint32_t TileRowCount = (inRowEnd - inRowBegin + SlopeTileRows - 1) / SlopeTileRows;
+    uint32_t TileColumnCount = (inWidth + SlopeTileColumns - 1) / SlopeTileColumns;
+    inThreadPool.ParallelFor((size_t)TileRowCount * TileColumnCount, 1, [&](size_t inTileBegin, size_t inTileEnd) {
+        for (size_t Tile = inTileBegin; Tile < inTileEnd; ++Tile) {
+            uint32_t RowBegin = inRowBegin + (uint32_t)(Tile / TileColumnCount) * SlopeTileRows;
+            uint32_t RowEnd = std::min(RowBegin + SlopeTileRows, inRowEnd);
+            uint32_t ColumnBegin = (uint32_t)(Tile % TileColumnCount) * SlopeTileColumns;
+            uint32_t ColumnEnd = std::min(ColumnBegin + SlopeTileColumns, inWidth);
+            for (uint32_t Row = RowBegin; Row < RowEnd; ++Row) {
+                ComputeSlopeSpan(inHeights, inWidth, inHeight, Row, ColumnBegin, ColumnEnd, outSlopes + (size_t)(Row - inRowBegin) * inWidth * 2);
+            }
+        }
+    });
+}
+
+bool GetFileStamp(const std::string& inPath, uint64_t& outSize, int64_t& outTime) {
+    std::error_code Error;
+    outSize = (uint64_t)std::filesystem::file_size(inPath, Error);
+    if (Error) {
+        return false;
+    }
+    outTime = (int64_t)std::filesystem::last_write_time(inPath, Error).time_since_epoch().count();
+    return !Error;
+}
+
+bool WriteHeightmapCache(const std::string& inCachePath, const std::string& inSourcePath, const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight,
+    ThreadPool& inThreadPool) {
+    HeightmapCacheHeader Header;
+    Header.Width = inWidth;
+    Header.Height = inHeight;
+    if (!inSourcePath.empty() && !GetFileStamp(inSourcePath, Header.SourceSize, Header.SourceTime)) {
+        return false;
+    }
+    size_t TexelCount = (size_t)inWidth * inHeight;
+    Header.HeightOffset = AlignCacheOffset(sizeof(Header));
+    Header.SlopeOffset = AlignCacheOffset(Header.HeightOffset + TexelCount * sizeof(uint16_t));
+
+    // Written to a temporary name first, so an interrupted run never leaves a valid looking cache.
+    std::string TempPath = inCachePath + ".tmp";
+    FILE* File = fopen(TempPath.c_str(), "wb");
+    if (!File) {
+        return false;
+    }
+    static const uint8_t Padding[64] = {};
+    bool Written = fwrite(&Header, sizeof(Header), 1, File) == 1
+        && fwrite(Padding, 1, Header.HeightOffset - sizeof(Header), File) == Header.HeightOffset - sizeof(Header)
+        && fwrite(inHeights, sizeof(uint16_t), TexelCount, File) == TexelCount
+        && fwrite(Padding, 1, Header.SlopeOffset - Header.HeightOffset - TexelCount * sizeof(uint16_t), File)
+            == Header.SlopeOffset - Header.HeightOffset - TexelCount * sizeof(uint16_t);
+
+    std::vector<float> Band((size_t)std::min(SlopeBandRows, inHeight) * inWidth * 2);
+    for (uint32_t Row = 0; Written && Row < inHeight; Row += SlopeBandRows) {
+        uint32_t RowEnd = std::min(Row + SlopeBandRows, inHeight);
+        ComputeSlopeRows(inHeights, inWidth, inHeight, Row, RowEnd, Band.data(), inThreadPool);
+        size_t Count = (size_t)(RowEnd - Row) * inWidth * 2;
+        Written = fwrite(Band.data(), sizeof(float), Count, File) == Count;
+    }
+    if (fclose(File) != 0 || !Written) {
+        std::remove(TempPath.c_str());
+        return false;
+    }
+    std::error_code Error;
+    std::filesystem::rename(TempPath, inCachePath, Error);
+    return !Error;
+}
+
+bool HeightmapCache::Open(const std::string& inCachePath, const std::string& inSourcePath) {
+    Close();
+    if (!mFile.Open(inCachePath) || mFile.GetSize() < sizeof(HeightmapCacheHeader)) {
+        Close();
+        return false;
+    }
+    memcpy(&mHeader, mFile.GetData(), sizeof(mHeader));
+    size_t TexelCount = (size_t)mHeader.Width * mHeader.Height;
+    bool Valid = mHeader.Magic == HeightmapCacheMagic && mHeader.Version == HeightmapCacheVersion
+        && mHeader.HeightOffset >= sizeof(HeightmapCacheHeader) && mHeader.SlopeOffset >= mHeader.HeightOffset + TexelCount * sizeof(uint16_t)
+        && mFile.GetSize() >= mHeader.SlopeOffset + TexelCount * 2 * sizeof(float);
+    if (Valid && !inSourcePath.empty()) {
+        uint64_t SourceSize = 0;
+        int64_t SourceTime = 0;
+        Valid = GetFileStamp(inSourcePath, SourceSize, SourceTime) && SourceSize == mHeader.SourceSize && SourceTime == mHeader.SourceTime;
+    }
+    if (!Valid) {
+        Close();
+    }
+    return Valid;
+}
+
+void HeightmapCache::Close() {
+    mFile.Close();
+    mHeader = HeightmapCacheHeader();
+}
+
+}
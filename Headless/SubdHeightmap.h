@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+namespace Headless {
+
+// Slope map rows [inRowBegin, inRowEnd) of an R16 heightmap, two floats per texel starting
+// with row inRowBegin. Tiles of the rows run across inThreadPool, four texels at a time with
+// SSE2 where available; the values are those of CreateSlopeMap's per-texel loop.
+void ComputeSlopeRows(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight, uint32_t inRowBegin, uint32_t inRowEnd, float* outSlopes,
+    ThreadPool& inThreadPool = ThreadPool::GetDefault());
+
+// Preprocessed heightmap: HeightmapCacheHeader, then the R16 heights at HeightOffset and the
+// RG32Float slopes at SlopeOffset, both 64-byte aligned, ready to upload straight from the
+// mapping. The source's size and modification time mark the cache stale when it changes.
+const uint32_t HeightmapCacheMagic = 0x50414d48; // "HMAP"
+const uint32_t HeightmapCacheVersion = 1;
+
+struct HeightmapCacheHeader {
+    uint32_t Magic = HeightmapCacheMagic;
+    uint32_t Version = HeightmapCacheVersion;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint64_t SourceSize = 0;
+    int64_t SourceTime = 0;
+    uint64_t HeightOffset = 0;
+    uint64_t SlopeOffset = 0;
+};
+
+bool GetFileStamp(const std::string& inPath, uint64_t& outSize, int64_t& outTime);
+
+// Writes the slopes one band of rows at a time, so only the heights and one band are in memory.
+bool WriteHeightmapCache(const std::string& inCachePath, const std::string& inSourcePath, const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight,
+    ThreadPool& inThreadPool = ThreadPool::GetDefault());
+
+// Read-only mapping of a heightmap cache; the pointers stay valid while it is open.
+class HeightmapCache {
+public:
+    // Fails when the file is missing, truncated, of another version, or was built from a
+    // different inSourcePath (not checked when empty).
+    bool Open(const std::string& inCachePath, const std::string& inSourcePath = "");
+    void Close();
+
+    bool IsOpen() const { return mFile.IsOpen(); }
+    uint32_t GetWidth() const { return mHeader.Width; }
+    uint32_t GetHeight() const { return mHeader.Height; }
+    const uint16_t* GetHeights() const { return (const uint16_t*)(mFile.GetData() + mHeader.HeightOffset); }
+    const float* GetSlopes() const { return (const float*)(mFile.GetData() + mHeader.SlopeOffset); }
+
+private:
+    MappedFile mFile;
+    HeightmapCacheHeader mHeader;
+};
+
+}
@@ -0,0 +1,50 @@
+#include "SubdIncremental.h"
+#include "SubdUtils.h"
+#include <cstring>
+#include <limits>
+
+namespace Headless {
+
+// Compared bit for bit: any change, however small, may move a threshold past a key.
+static bool IsSameLod(const LodKernelConfig& inA, const LodKernelConfig& inB) {
+    auto Same = [](float inX, float inY) { return memcmp(&inX, &inY, sizeof(float)) == 0; };
+    return Same(inA.FovX, inB.FovX) && Same(inA.TargetPixelSize, inB.TargetPixelSize) && inA.ScreenResolutionWidth == inB.ScreenResolutionWidth
+        && Same(inA.DisplacementFactor, inB.DisplacementFactor) && Same(inA.RoughnessLodScale, inB.RoughnessLodScale) && Same(inA.MaxLodOffset, inB.MaxLodOffset);
+}
+
+static bool IsSameViews(const LodKernelConfig& inA, const LodKernelConfig& inB) {
+    if (GetLodViewCount(inA) != GetLodViewCount(inB)) {
+        return false;
+    }
+    for (uint32_t View = 1; View < GetLodViewCount(inA); ++View) {
+        if (memcmp(&inA.ViewPosW[View - 1][3], &inB.ViewPosW[View - 1][3], sizeof(float)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static float3 GetViewPosW(const LodKernelConfig& inConfig, uint32_t inView) {
+    return float3(inConfig.ViewPosW[inView - 1][0], inConfig.ViewPosW[inView - 1][1], inConfig.ViewPosW[inView - 1][2]);
+}
+
+// A scaled view distance moves by at most the view's travel times its scale, and so does the
+// smallest of them that the lod reads.
+void LodTravelTracker::SetCameraTravel(LodKernelConfig& ioConfig, const float3& inPosW) {
+    ioConfig.CameraTravel = std::numeric_limits<float>::infinity();
+    if (mValid && IsSameLod(ioConfig, mConfig) && IsSameViews(ioConfig, mConfig)) {
+        ioConfig.CameraTravel = length(inPosW - mPosW);
+        for (uint32_t View = 1; View < GetLodViewCount(ioConfig); ++View) {
+            ioConfig.CameraTravel = std::max(ioConfig.CameraTravel, length(GetViewPosW(ioConfig, View) - mViewPosW[View - 1]) * ioConfig.ViewPosW[View - 1][3]);
+        }
+    }
+    ioConfig.TravelPadding[0] = ioConfig.TravelPadding[1] = ioConfig.TravelPadding[2] = 0;
+    mValid = true;
+    mPosW = inPosW;
+    for (uint32_t View = 1; View < GetLodViewCount(ioConfig); ++View) {
+        mViewPosW[View - 1] = GetViewPosW(ioConfig, View);
+    }
+    mConfig = ioConfig;
+}
+
+}
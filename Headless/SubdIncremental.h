@@ -0,0 +1,27 @@
+#pragma once
+#include "SubdMath.h"
+#include "SubdShared.h"
+
+namespace Headless {
+
+// Fills LodKernelConfig::CameraTravel for INCREMENTAL_LOD once per frame: the distance the
+// camera moved since the previous frame, which every kept key takes off its slack. Any
+// change to the parameters the lod reads (FovX, TargetPixelSize, ScreenResolutionWidth,
+// DisplacementFactor, RoughnessLodScale, MaxLodOffset), the first frame and the one after
+// Invalidate() give +inf instead, so every key is evaluated again. With MULTI_VIEW views it
+// is the largest travel of a view times its distance scale, and a change of ViewCount or of
+// a scale gives +inf as well.
+class LodTravelTracker {
+public:
+    void SetCameraTravel(LodKernelConfig& ioConfig, const float3& inPosW);
+    // Call when the keys, the heightmap or the LodKernel defines change.
+    void Invalidate() { mValid = false; }
+
+private:
+    bool mValid = false;
+    float3 mPosW;
+    float3 mViewPosW[MaxLodViewCount - 1];
+    LodKernelConfig mConfig;
+};
+
+}
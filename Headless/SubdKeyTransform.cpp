@@ -0,0 +1,65 @@
+#include "SubdKeyTransform.h"
+#include "SubdUtils.h"
+#include <cassert>
+
+namespace Headless {
+
+// Same products as the 4x4 mul with the zero terms dropped, in the same order.
+AffineTransform mul(const AffineTransform& A, const AffineTransform& B) {
+    AffineTransform R;
+    R.Row0 = A.Row0.x * B.Row0 + A.Row0.y * B.Row1;
+    R.Row1 = A.Row1.x * B.Row0 + A.Row1.y * B.Row1;
+    R.Row2 = A.Row2.x * B.Row0 + A.Row2.y * B.Row1 + B.Row2;
+    return R;
+}
+
+AffineTransform ToAffine(const float4x4& inMat) {
+    AffineTransform Affine;
+    Affine.Row0 = inMat[0].xy();
+    Affine.Row1 = inMat[1].xy();
+    Affine.Row2 = inMat[2].xy();
+    return Affine;
+}
+
+float4x4 ToTransform(const AffineTransform& inAffine) {
+    float4x4 Mat;
+    Mat[0] = float4(inAffine.Row0.x, inAffine.Row0.y, 0.0f, 0.0f);
+    Mat[1] = float4(inAffine.Row1.x, inAffine.Row1.y, 0.0f, 0.0f);
+    Mat[2] = float4(inAffine.Row2.x, inAffine.Row2.y, 1.0f, 0.0f);
+    Mat[3] = float4(0.0f, 0.0f, 0.0f, 1.0f);
+    return Mat;
+}
+
+AffineTransform KeyToAffine(uint32_t inSubdBinaryKey) {
+    AffineTransform Mat;
+    while (inSubdBinaryKey > 1u) {
+        Mat = mul(Mat, ToAffine(BitToTransform(inSubdBinaryKey & 1u)));
+        inSubdBinaryKey = inSubdBinaryKey >> 1u;
+    }
+    return Mat;
+}
+
+KeyTransformTable::KeyTransformTable(uint32_t inChunkBits) : mChunkBits(inChunkBits) {
+    assert(inChunkBits >= 1 && inChunkBits <= 16);
+    mEntries.resize(2u << mChunkBits);
+    for (uint32_t Index = 1; Index < (uint32_t)mEntries.size(); ++Index) {
+        mEntries[Index] = Headless::KeyToAffine(Index);
+    }
+}
+
+AffineTransform KeyTransformTable::KeyToAffine(uint32_t inSubdBinaryKey) const {
+    const uint32_t FullChunk = 1u << mChunkBits;
+    AffineTransform Mat;
+    while (inSubdBinaryKey >= (FullChunk << 1u)) {
+        Mat = mul(Mat, mEntries[FullChunk | (inSubdBinaryKey & (FullChunk - 1u))]);
+        inSubdBinaryKey >>= mChunkBits;
+    }
+    return mul(Mat, mEntries[inSubdBinaryKey]);
+}
+
+const KeyTransformTable& KeyTransformTable::GetDefault() {
+    static KeyTransformTable DefaultTable(8);
+    return DefaultTable;
+}
+
+}
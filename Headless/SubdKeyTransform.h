@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include "SubdMath.h"
+
+namespace Headless {
+
+// The 2x3 affine part of the 4x4 matrices built by KeyToTransform: a row vector
+// (u, v, 1) maps to u * Row0 + v * Row1 + Row2.
+struct AffineTransform {
+    float2 Row0 = float2(1.0f, 0.0f);
+    float2 Row1 = float2(0.0f, 1.0f);
+    float2 Row2 = float2(0.0f, 0.0f);
+};
+
+AffineTransform mul(const AffineTransform& A, const AffineTransform& B);
+AffineTransform ToAffine(const float4x4& inMat);
+float4x4 ToTransform(const AffineTransform& inAffine);
+
+// KeyToTransform walking one bit at a time, on 2x3 matrices instead of 4x4.
+AffineTransform KeyToAffine(uint32_t inSubdBinaryKey);
+
+// Precomposed transforms for every key chunk of up to ChunkBits bits. Entries are
+// indexed by the chunk with its leading one still set, the same encoding as
+// SubdBinaryKey, so index 1 is the identity and a key of depth <= ChunkBits is
+// its own index. Deeper keys compose one entry per ChunkBits bits, lowest first.
+class KeyTransformTable {
+public:
+    explicit KeyTransformTable(uint32_t inChunkBits = 8);
+
+    uint32_t GetChunkBits() const { return mChunkBits; }
+    const std::vector<AffineTransform>& GetEntries() const { return mEntries; }
+
+    AffineTransform KeyToAffine(uint32_t inSubdBinaryKey) const;
+    float4x4 KeyToTransform(uint32_t inSubdBinaryKey) const { return ToTransform(KeyToAffine(inSubdBinaryKey)); }
+
+    // Table used when LodKernelDefines::KeyTransformTable is set, matching the
+    // KEY_TRANSFORM_CHUNK_BITS default in Utils.hlsl.
+    static const KeyTransformTable& GetDefault();
+
+private:
+    uint32_t mChunkBits;
+    std::vector<AffineTransform> mEntries;
+};
+
+}
@@ -0,0 +1,189 @@
+#include "SubdLeafSort.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "ParallelScan.h"
+
+namespace Headless {
+
+// Spreads the low 16 bits of inValue to the even bits, and the low 10 bits to every third.
+static uint32_t Part1By1(uint32_t inValue) {
+    inValue &= 0x0000ffffu;
+    inValue = (inValue | (inValue << 8)) & 0x00ff00ffu;
+    inValue = (inValue | (inValue << 4)) & 0x0f0f0f0fu;
+    inValue = (inValue | (inValue << 2)) & 0x33333333u;
+    inValue = (inValue | (inValue << 1)) & 0x55555555u;
+    return inValue;
+}
+
+static uint32_t Part1By2(uint32_t inValue) {
+    inValue &= 0x000003ffu;
+    inValue = (inValue | (inValue << 16)) & 0xff0000ffu;
+    inValue = (inValue | (inValue << 8)) & 0x0300f00fu;
+    inValue = (inValue | (inValue << 4)) & 0x030c30c3u;
+    inValue = (inValue | (inValue << 2)) & 0x09249249u;
+    return inValue;
+}
+
+LeafSortBounds GetLeafSortBounds(const SubdMesh& inMesh) {
+    float4 Min = inMesh.VertexData.empty() ? float4() : inMesh.VertexData[0];
+    float4 Max = Min;
+    for (const float4& Vertex : inMesh.VertexData) {
+        Min = min(Min, Vertex);
+        Max = max(Max, Vertex);
+    }
+    LeafSortBounds Bounds;
+    Bounds.Min = Min.xyz();
+    Bounds.Dimensions = Max.z > Min.z ? 3 : 2;
+    float CellCount = (float)(1u << (LeafSortKeyBits / Bounds.Dimensions));
+    float3 Extent = Max.xyz() - Min.xyz();
+    Bounds.Scale = float3(Extent.x > 0.0f ? CellCount / Extent.x : 0.0f, Extent.y > 0.0f ? CellCount / Extent.y : 0.0f,
+        Bounds.Dimensions == 3 ? CellCount / Extent.z : 0.0f);
+    return Bounds;
+}
+
+uint32_t GetMortonKey(const LeafSortBounds& inBounds, const float3& inPosition) {
+    float MaxCell = (float)((1u << (LeafSortKeyBits / inBounds.Dimensions)) - 1u);
+    float3 Cell = float3((inPosition.x - inBounds.Min.x) * inBounds.Scale.x, (inPosition.y - inBounds.Min.y) * inBounds.Scale.y,
+        (inPosition.z - inBounds.Min.z) * inBounds.Scale.z);
+    uint32_t x = (uint32_t)clamp(Cell.x, 0.0f, MaxCell);
+    uint32_t y = (uint32_t)clamp(Cell.y, 0.0f, MaxCell);
+    if (inBounds.Dimensions == 2) {
+        return Part1By1(x) | (Part1By1(y) << 1);
+    }
+    uint32_t z = (uint32_t)clamp(Cell.z, 0.0f, MaxCell);
+    return Part1By2(x) | (Part1By2(y) << 1) | (Part1By2(z) << 2);
+}
+
+uint32_t GetLeafSortKey(const SubdMesh& inMesh, const LeafSortBounds& inBounds, const PrimitiveData& inData, const KeyTransformTable* inKeyTransformTable) {
+    float4 InVertices[3];
+    inMesh.GetPrimitiveVertices(inData.PrimitiveIndex, InVertices);
+    float4 OutVertices[3];
+    Subd(inData.SubdBinaryKey, InVertices, OutVertices, inKeyTransformTable);
+    return GetMortonKey(inBounds, (OutVertices[0].xyz() + OutVertices[1].xyz() + OutVertices[2].xyz()) / 3.0f);
+}
+
+void RadixSortLeaves(uint32_t* ioKeys, PrimitiveData* ioLeaves, uint32_t inCount, uint32_t inKeyBits, ThreadPool& inThreadPool, std::vector<double>* outPassMs) {
+    const uint32_t DigitCount = 1u << LeafSortRadixBits;
+    const uint32_t DigitMask = DigitCount - 1u;
+    uint32_t BlockCount = (inCount + LeafSortBlockSize - 1) / LeafSortBlockSize;
+    std::vector<uint32_t> Histograms((size_t)DigitCount * BlockCount);
+    std::vector<uint32_t> ScratchKeys(inCount);
+    std::vector<PrimitiveData> ScratchLeaves(inCount);
+    uint32_t* InKeys = ioKeys;
+    PrimitiveData* InLeaves = ioLeaves;
+    uint32_t* OutKeys = ScratchKeys.data();
+    PrimitiveData* OutLeaves = ScratchLeaves.data();
+    if (outPassMs) {
+        outPassMs->clear();
+    }
+
+    for (uint32_t Shift = 0; Shift < inKeyBits; Shift += LeafSortRadixBits) {
+        auto Start = std::chrono::high_resolution_clock::now();
+        // LeafSortHistogramKernel: column Block of the digit-major table.
+        inThreadPool.ParallelFor(BlockCount, 16, [&](size_t inBlockBegin, size_t inBlockEnd) {
+            for (size_t Block = inBlockBegin; Block < inBlockEnd; ++Block) {
+                uint32_t Counts[1u << LeafSortRadixBits] = {};
+                size_t End = std::min<size_t>(inCount, (Block + 1) * LeafSortBlockSize);
+                for (size_t i = Block * LeafSortBlockSize; i < End; ++i) {
+                    ++Counts[(InKeys[i] >> Shift) & DigitMask];
+                }
+                for (uint32_t Digit = 0; Digit < DigitCount; ++Digit) {
+                    Histograms[(size_t)Digit * BlockCount + Block] = Counts[Digit];
+                }
+            }
+        });
+        // LeafSortScanKernel: where the keys of each digit of each block start.
+        ParallelExclusiveScan(Histograms.data(), Histograms.size(), inThreadPool);
+        // LeafSortScatterKernel: in block order, so equal digits keep their order.
+        inThreadPool.ParallelFor(BlockCount, 16, [&](size_t inBlockBegin, size_t inBlockEnd) {
+            for (size_t Block = inBlockBegin; Block < inBlockEnd; ++Block) {
+                uint32_t Offsets[1u << LeafSortRadixBits];
+                for (uint32_t Digit = 0; Digit < DigitCount; ++Digit) {
+                    Offsets[Digit] = Histograms[(size_t)Digit * BlockCount + Block];
+                }
+                size_t End = std::min<size_t>(inCount, (Block + 1) * LeafSortBlockSize);
+                for (size_t i = Block * LeafSortBlockSize; i < End; ++i) {
+                    uint32_t Offset = Offsets[(InKeys[i] >> Shift) & DigitMask]++;
+                    OutKeys[Offset] = InKeys[i];
+                    OutLeaves[Offset] = InLeaves[i];
+                }
+            }
+        });
+        std::swap(InKeys, OutKeys);
+        std::swap(InLeaves, OutLeaves);
+        if (outPassMs) {
+            outPassMs->push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count());
+        }
+    }
+    // The GPU passes start from a copy in the scratch buffer so an odd pass count ends in
+    // SubdCulledOut; here the last pass is copied back instead.
+    if (InKeys != ioKeys) {
+        memcpy(ioKeys, InKeys, inCount * sizeof(uint32_t));
+        memcpy(ioLeaves, InLeaves, inCount * sizeof(PrimitiveData));
+    }
+}
+
+void SortLeaves(const SubdMesh& inMesh, const LeafSortBounds& inBounds, PrimitiveData* ioCulled, uint32_t inCulledCount,
+    ThreadPool& inThreadPool, const KeyTransformTable* inKeyTransformTable) {
+    std::vector<uint32_t> Keys(inCulledCount);
+    inThreadPool.ParallelFor(inCulledCount, 4096, [&](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            Keys[i] = GetLeafSortKey(inMesh, inBounds, ioCulled[i], inKeyTransformTable);
+        }
+    });
+    RadixSortLeaves(Keys.data(), ioCulled, inCulledCount, LeafSortKeyBits, inThreadPool);
+}
+
+LeafBatchLocality GetLeafBatchLocality(const SubdMesh& inMesh, const PrimitiveData* inCulled, uint32_t inCulledCount, uint32_t inBatchSize,
+    uint32_t inTextureSize, uint32_t inTileTexels, ThreadPool& inThreadPool) {
+    LeafBatchLocality Locality;
+    Locality.BatchCount = (inCulledCount + inBatchSize - 1) / inBatchSize;
+    std::vector<uint32_t> BatchTiles(Locality.BatchCount);
+    std::vector<uint32_t> BatchPrimitives(Locality.BatchCount);
+    uint32_t TileCount = std::max((inTextureSize + inTileTexels - 1) / inTileTexels, 1u);
+
+    inThreadPool.ParallelFor(Locality.BatchCount, 64, [&](size_t inBatchBegin, size_t inBatchEnd) {
+        std::vector<uint32_t> Tiles;
+        std::vector<uint32_t> Primitives;
+        for (size_t Batch = inBatchBegin; Batch < inBatchEnd; ++Batch) {
+            Tiles.clear();
+            Primitives.clear();
+            size_t End = std::min<size_t>(inCulledCount, (Batch + 1) * inBatchSize);
+            for (size_t i = Batch * inBatchSize; i < End; ++i) {
+                float4 InVertices[3];
+                inMesh.GetPrimitiveVertices(inCulled[i].PrimitiveIndex, InVertices);
+                float4 OutVertices[3];
+                Subd(inCulled[i].SubdBinaryKey, InVertices, OutVertices);
+                float4 Min = min(min(OutVertices[0], OutVertices[1]), OutVertices[2]);
+                float4 Max = max(max(OutVertices[0], OutVertices[1]), OutVertices[2]);
+                auto GetTile = [&](float inPosition) {
+                    float Texel = (inPosition * 0.5f + 0.5f) * inTextureSize;
+                    return (uint32_t)clamp(Texel / inTileTexels, 0.0f, (float)(TileCount - 1));
+                };
+                for (uint32_t y = GetTile(Min.y); y <= GetTile(Max.y); ++y) {
+                    for (uint32_t x = GetTile(Min.x); x <= GetTile(Max.x); ++x) {
+                        Tiles.push_back(y * TileCount + x);
+                    }
+                }
+                Primitives.push_back(inCulled[i].PrimitiveIndex);
+            }
+            std::sort(Tiles.begin(), Tiles.end());
+            std::sort(Primitives.begin(), Primitives.end());
+            BatchTiles[Batch] = (uint32_t)(std::unique(Tiles.begin(), Tiles.end()) - Tiles.begin());
+            BatchPrimitives[Batch] = (uint32_t)(std::unique(Primitives.begin(), Primitives.end()) - Primitives.begin());
+        }
+    });
+
+    for (uint32_t Batch = 0; Batch < Locality.BatchCount; ++Batch) {
+        Locality.TilesPerBatch += BatchTiles[Batch];
+        Locality.PrimitivesPerBatch += BatchPrimitives[Batch];
+    }
+    if (Locality.BatchCount) {
+        Locality.TilesPerBatch /= Locality.BatchCount;
+        Locality.PrimitivesPerBatch /= Locality.BatchCount;
+    }
+    return Locality;
+}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include "SubdEngine.h"
+
+namespace Headless {
+
+// Box the leaf centroids are quantised in for their Morton key, LeafSortCB in the sample.
+// A flat mesh (the quad, displaced or not) is ordered in 2D with LeafSortKeyBits / 2 bits
+// per axis: displacement only moves z, and the heightmap and slope map are addressed by xy.
+// Any other mesh interleaves LeafSortKeyBits / 3 bits of each axis.
+struct LeafSortBounds {
+    float3 Min;
+    // Cells per unit along each axis, zero along a flat one.
+    float3 Scale;
+    uint32_t Dimensions = 2;
+};
+
+LeafSortBounds GetLeafSortBounds(const SubdMesh& inMesh);
+uint32_t GetMortonKey(const LeafSortBounds& inBounds, const float3& inPosition);
+// LeafSortKeyKernel: the key of the centroid of the leaf's Subd triangle.
+uint32_t GetLeafSortKey(const SubdMesh& inMesh, const LeafSortBounds& inBounds, const PrimitiveData& inData,
+    const KeyTransformTable* inKeyTransformTable = nullptr);
+
+// LSD radix sort of (key, leaf) pairs over the low inKeyBits, LeafSortRadixBits per pass,
+// the way the GPU passes run it: a digit histogram per LeafSortBlockSize block, an exclusive
+// scan of all histograms digit by digit, then each block scatters its keys in order. Equal
+// keys keep their order. Sorts in place and returns the time per pass in outPassMs if given.
+void RadixSortLeaves(uint32_t* ioKeys, PrimitiveData* ioLeaves, uint32_t inCount, uint32_t inKeyBits,
+    ThreadPool& inThreadPool = ThreadPool::GetDefault(), std::vector<double>* outPassMs = nullptr);
+
+// LeafSortKeyKernel and the radix passes over a SubdCulledOut list.
+void SortLeaves(const SubdMesh& inMesh, const LeafSortBounds& inBounds, PrimitiveData* ioCulled, uint32_t inCulledCount,
+    ThreadPool& inThreadPool = ThreadPool::GetDefault(), const KeyTransformTable* inKeyTransformTable = nullptr);
+
+// How much of the heightmap and of VertexBuffer a run of consecutive instances touches.
+struct LeafBatchLocality {
+    uint32_t BatchCount = 0;
+    // Per batch: distinct texture tiles under the leaves, and distinct PrimitiveIndex.
+    double TilesPerBatch = 0.0;
+    double PrimitivesPerBatch = 0.0;
+};
+
+// Cuts inCulled into batches of inBatchSize instances, the leaves a wave or a few waves of
+// RenderKernelVS draw together. A leaf touches the inTileTexels square tiles of an
+// inTextureSize texture that its corners' box covers at xy * 0.5 + 0.5, the uv RenderKernelVS
+// samples HeightMapTexture and SlopeMapTexture with.
+LeafBatchLocality GetLeafBatchLocality(const SubdMesh& inMesh, const PrimitiveData* inCulled, uint32_t inCulledCount, uint32_t inBatchSize,
+    uint32_t inTextureSize, uint32_t inTileTexels, ThreadPool& inThreadPool = ThreadPool::GetDefault());
+
+}
@@ -0,0 +1,112 @@
+#include "SubdLeafVertex.h"
+#include "SubdKeyTransform.h"
+#include "SubdSlopeFormat.h"
+
+namespace Headless {
+
+static float3 GetProjectionPlaneVertex(const float3& inTriangleVertice0, const float3& inTriangleVertice1, const float3& inNormal) {
+    return inTriangleVertice0 - dot(inTriangleVertice0 - inTriangleVertice1, inNormal) * inNormal;
+}
+
+static float3 PhongTessellation(const float3 inVertice[3], const float3 inNormal[3], const float2& inUV) {
+    float u = inUV.x;
+    float v = inUV.y;
+    float w = 1 - inUV.x - inUV.y;
+    return (u * u) * inVertice[1] + (v * v) * inVertice[2] + (w * w) * inVertice[0]
+        + u * v * (GetProjectionPlaneVertex(inVertice[2], inVertice[1], inNormal[1]) + GetProjectionPlaneVertex(inVertice[1], inVertice[2], inNormal[2]))
+        + v * w * (GetProjectionPlaneVertex(inVertice[2], inVertice[0], inNormal[0]) + GetProjectionPlaneVertex(inVertice[0], inVertice[2], inNormal[2]))
+        + w * u * (GetProjectionPlaneVertex(inVertice[1], inVertice[0], inNormal[0]) + GetProjectionPlaneVertex(inVertice[0], inVertice[1], inNormal[1]));
+}
+
+static float2 GetSlopeNormalXY(const RenderKernelContext& inContext, const float3& inPosition) {
+    float2 UV(inPosition.x * 0.5f + 0.5f, inPosition.y * 0.5f + 0.5f);
+    float2 Slope = inContext.SlopeHeightMap ? GetHeightMapSlope(*inContext.SlopeHeightMap, UV) : inContext.SlopeMap->SampleLevel(UV).xy();
+    return float2(-Slope.x * inContext.DisplacementFactor, -Slope.y * inContext.DisplacementFactor);
+}
+
+float3 GetSlopeNormal(const RenderKernelContext& inContext, const float3& inPosition) {
+    float2 NormalXY = GetSlopeNormalXY(inContext, inPosition);
+    return normalize(float3(NormalXY.x, NormalXY.y, 1.0f));
+}
+
+float4 RenderBerp(const RenderKernelContext& inContext, const float4 inVertice[3], const float2& inUV) {
+    float4 LinearPos = Berp(inVertice, inUV);
+    if (!inContext.PhongTessellation) {
+        return LinearPos;
+    }
+    float3 Normal = GetSlopeNormal(inContext, LinearPos.xyz());
+    float3 Vertices[3] = { inVertice[0].xyz(), inVertice[1].xyz(), inVertice[2].xyz() };
+    float3 Normals[3] = { Normal, Normal, Normal };
+    return float4(PhongTessellation(Vertices, Normals, inUV), 1.0f);
+}
+
+void RenderSubd(const RenderKernelContext& inContext, uint32_t inSubdBinaryKey, const float4 inVertices[3], float4 outVertices[3]) {
+    float4x4 ExtractionMat;
+    ExtractionMat[0] = float4(0.0f, 0.0f, 1.0f, 0.0f);
+    ExtractionMat[1] = float4(1.0f, 0.0f, 1.0f, 0.0f);
+    ExtractionMat[2] = float4(0.0f, 1.0f, 1.0f, 0.0f);
+    ExtractionMat[3] = float4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    float4x4 Transform = KeyToTransform(inSubdBinaryKey, inContext.TransformTable);
+    Transform = mul(ExtractionMat, Transform);
+
+    outVertices[0] = RenderBerp(inContext, inVertices, Transform[0].xy());
+    outVertices[1] = RenderBerp(inContext, inVertices, Transform[1].xy());
+    outVertices[2] = RenderBerp(inContext, inVertices, Transform[2].xy());
+}
+
+float4 EvaluateRenderVertex(const RenderKernelContext& inContext, const PrimitiveData& inData, const float2& inBerpUV) {
+    float4 InVertices[3];
+    inContext.Mesh->GetPrimitiveVertices(inData.PrimitiveIndex, InVertices);
+    float4 OutVertices[3];
+    RenderSubd(inContext, inData.SubdBinaryKey, InVertices, OutVertices);
+    return RenderBerp(inContext, OutVertices, inBerpUV);
+}
+
+LeafVertexData EvaluateLeafVertexKernel(const RenderKernelContext& inContext, const PrimitiveData& inData) {
+    float4 InVertices[3];
+    inContext.Mesh->GetPrimitiveVertices(inData.PrimitiveIndex, InVertices);
+    float4 OutVertices[3];
+    RenderSubd(inContext, inData.SubdBinaryKey, InVertices, OutVertices);
+
+    LeafVertexData Leaf = {};
+    for (int i = 0; i < 3; ++i) {
+        Leaf.Position[i][0] = OutVertices[i].x;
+        Leaf.Position[i][1] = OutVertices[i].y;
+        Leaf.Position[i][2] = OutVertices[i].z;
+        if (inContext.PhongTessellation) {
+            float2 NormalXY = GetSlopeNormalXY(inContext, OutVertices[i].xyz());
+            Leaf.NormalXY[i][0] = NormalXY.x;
+            Leaf.NormalXY[i][1] = NormalXY.y;
+        }
+    }
+    return Leaf;
+}
+
+void LeafVertexKernel(const RenderKernelContext& inContext, const PrimitiveData* inCulled, uint32_t inCulledCount, LeafVertexData* outLeafVertices,
+    ThreadPool& inThreadPool) {
+    inThreadPool.ParallelFor(inCulledCount, 1024, [&](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            outLeafVertices[i] = EvaluateLeafVertexKernel(inContext, inCulled[i]);
+        }
+    });
+}
+
+float4 EvaluateLeafVertex(const LeafVertexData& inLeaf, const float2& inBerpUV, bool inPhongTessellation) {
+    float4 Corners[3];
+    for (int i = 0; i < 3; ++i) {
+        Corners[i] = float4(inLeaf.Position[i][0], inLeaf.Position[i][1], inLeaf.Position[i][2], 1.0f);
+    }
+    if (!inPhongTessellation) {
+        return Berp(Corners, inBerpUV);
+    }
+    float3 Vertices[3];
+    float3 Normals[3];
+    for (int i = 0; i < 3; ++i) {
+        Vertices[i] = Corners[i].xyz();
+        Normals[i] = normalize(float3(inLeaf.NormalXY[i][0], inLeaf.NormalXY[i][1], 1.0f));
+    }
+    return float4(PhongTessellation(Vertices, Normals, inBerpUV), 1.0f);
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "SubdEngine.h"
+#include "SubdTexture.h"
+
+namespace Headless {
+
+// Inputs of the RenderKernelVS vertex position: the mesh, RenderKernelCB and the program
+// defines that change it. The slopes are only read with PhongTessellation: from SlopeMap, or
+// with SLOPE_FROM_HEIGHTMAP from the central differences of SlopeHeightMap when it is set.
+struct RenderKernelContext {
+    const SubdMesh* Mesh = nullptr;
+    const SubdTexture* SlopeMap = nullptr;
+    const SubdTexture* SlopeHeightMap = nullptr;
+    float DisplacementFactor = 0.3f;
+    bool PhongTessellation = true;
+    const KeyTransformTable* TransformTable = nullptr;
+};
+
+// Slope-map normal at inPosition.xy, as Berp and RenderKernelPS compute it.
+float3 GetSlopeNormal(const RenderKernelContext& inContext, const float3& inPosition);
+// Berp / Subd as compiled into RenderKernelVS, PHONG_TESSELLATION included.
+float4 RenderBerp(const RenderKernelContext& inContext, const float4 inVertice[3], const float2& inUV);
+void RenderSubd(const RenderKernelContext& inContext, uint32_t inSubdBinaryKey, const float4 inVertices[3], float4 outVertices[3]);
+
+// RenderKernelVS without LEAF_VERTEX_PREPASS: Subd of the leaf, then Berp at inBerpUV,
+// for each vertex of the instance.
+float4 EvaluateRenderVertex(const RenderKernelContext& inContext, const PrimitiveData& inData, const float2& inBerpUV);
+
+// LeafVertexKernel for one SubdCulledOut leaf, and over a whole buffer.
+LeafVertexData EvaluateLeafVertexKernel(const RenderKernelContext& inContext, const PrimitiveData& inData);
+void LeafVertexKernel(const RenderKernelContext& inContext, const PrimitiveData* inCulled, uint32_t inCulledCount, LeafVertexData* outLeafVertices,
+    ThreadPool& inThreadPool = ThreadPool::GetDefault());
+
+// RenderKernelVS with LEAF_VERTEX_PREPASS: the corners are interpolated directly. The linear
+// path matches EvaluateRenderVertex bit for bit; Phong tessellation projects onto the
+// tangent plane of each corner's own normal instead of the normal at the linear position.
+float4 EvaluateLeafVertex(const LeafVertexData& inLeaf, const float2& inBerpUV, bool inPhongTessellation);
+
+}
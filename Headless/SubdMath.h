@@ -0,0 +1,145 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Minimal HLSL-flavoured vector math for the headless port of Data/Utils.hlsl.
+// Matrices are stored by rows and multiplied as row vectors (mul(v, M)), exactly
+// like the shader sees them, and every operation keeps the shader's evaluation
+// order so the CPU results round the same way.
+
+namespace Headless {
+
+struct float2 {
+    float x = 0.0f, y = 0.0f;
+    float2() = default;
+    float2(float inX, float inY) : x(inX), y(inY) {}
+};
+
+struct float3 {
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+    float3() = default;
+    float3(float inX, float inY, float inZ) : x(inX), y(inY), z(inZ) {}
+};
+
+struct float4 {
+    float x = 0.0f, y = 0.0f, z = 0.0f, w = 0.0f;
+    float4() = default;
+    float4(float inX, float inY, float inZ, float inW) : x(inX), y(inY), z(inZ), w(inW) {}
+    float4(const float3& inXYZ, float inW) : x(inXYZ.x), y(inXYZ.y), z(inXYZ.z), w(inW) {}
+
+    float3 xyz() const { return float3(x, y, z); }
+    float2 xy() const { return float2(x, y); }
+    float& operator[](int i) { return (&x)[i]; }
+    float operator[](int i) const { return (&x)[i]; }
+};
+
+inline float2 operator+(const float2& a, const float2& b) { return float2(a.x + b.x, a.y + b.y); }
+inline float2 operator-(const float2& a, const float2& b) { return float2(a.x - b.x, a.y - b.y); }
+inline float2 operator*(float s, const float2& a) { return float2(s * a.x, s * a.y); }
+inline float2 operator*(const float2& a, float s) { return float2(a.x * s, a.y * s); }
+
+inline float3 operator+(const float3& a, const float3& b) { return float3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline float3 operator-(const float3& a, const float3& b) { return float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline float3 operator-(const float3& a) { return float3(-a.x, -a.y, -a.z); }
+inline float3 operator*(float s, const float3& a) { return float3(s * a.x, s * a.y, s * a.z); }
+inline float3 operator*(const float3& a, float s) { return float3(a.x * s, a.y * s, a.z * s); }
+inline float3 operator/(const float3& a, float s) { return float3(a.x / s, a.y / s, a.z / s); }
+
+inline float4 operator+(const float4& a, const float4& b) { return float4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+inline float4 operator-(const float4& a, const float4& b) { return float4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); }
+inline float4 operator*(float s, const float4& a) { return float4(s * a.x, s * a.y, s * a.z, s * a.w); }
+inline float4 operator*(const float4& a, float s) { return float4(a.x * s, a.y * s, a.z * s, a.w * s); }
+inline float4 operator/(const float4& a, float s) { return float4(a.x / s, a.y / s, a.z / s, a.w / s); }
+
+inline float dot(const float3& a, const float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline float dot(const float4& a, const float4& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+inline float length(const float3& a) { return std::sqrt(dot(a, a)); }
+inline float length(const float4& a) { return std::sqrt(dot(a, a)); }
+inline float distance(const float4& a, const float4& b) { return length(a - b); }
+inline float3 normalize(const float3& a) { return a / length(a); }
+inline float3 cross(const float3& a, const float3& b) { return float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+
+inline float4 min(const float4& a, const float4& b) { return float4(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z), std::min(a.w, b.w)); }
+inline float4 max(const float4& a, const float4& b) { return float4(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z), std::max(a.w, b.w)); }
+inline float clamp(float x, float lo, float hi) { return std::min(std::max(x, lo), hi); }
+inline float step(float a, float x) { return x >= a ? 1.0f : 0.0f; }
+inline float lerp(float a, float b, float s) { return a + s * (b - a); }
+
+struct float4x4 {
+    float4 m[4];
+
+    float4& operator[](int i) { return m[i]; }
+    const float4& operator[](int i) const { return m[i]; }
+
+    static float4x4 Identity() {
+        float4x4 Mat;
+        Mat[0] = float4(1.0f, 0.0f, 0.0f, 0.0f);
+        Mat[1] = float4(0.0f, 1.0f, 0.0f, 0.0f);
+        Mat[2] = float4(0.0f, 0.0f, 1.0f, 0.0f);
+        Mat[3] = float4(0.0f, 0.0f, 0.0f, 1.0f);
+        return Mat;
+    }
+};
+
+inline float4 mul(const float4& v, const float4x4& M) {
+    float4 r;
+    for (int j = 0; j < 4; ++j) {
+        r[j] = v.x * M[0][j] + v.y * M[1][j] + v.z * M[2][j] + v.w * M[3][j];
+    }
+    return r;
+}
+
+inline float4x4 mul(const float4x4& A, const float4x4& B) {
+    float4x4 r;
+    for (int i = 0; i < 4; ++i) {
+        r[i] = mul(A[i], B);
+    }
+    return r;
+}
+
+// HLSL firstbithigh on a uint: index of the highest set bit, -1 for zero.
+inline int firstbithigh(uint32_t x) {
+    if (x == 0u) {
+        return -1;
+    }
+#if defined(_MSC_VER)
+    unsigned long Index;
+    _BitScanReverse(&Index, x);
+    return (int)Index;
+#else
+    return 31 - __builtin_clz(x);
+#endif
+}
+
+// HLSL countbits. SWAR unless POPCNT is part of the target, since the builtin falls
+// back to a library call on baseline x86-64.
+inline uint32_t countbits(uint32_t x) {
+#if defined(__POPCNT__)
+    return (uint32_t)__builtin_popcount(x);
+#else
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+    return (x * 0x01010101u) >> 24;
+#endif
+}
+
+// float -> int conversion with D3D rules: truncate, saturate on overflow, NaN becomes 0.
+inline int FloatToInt(float x) {
+    if (std::isnan(x)) {
+        return 0;
+    }
+    if (x >= 2147483648.0f) {
+        return INT32_MAX;
+    }
+    if (x <= -2147483648.0f) {
+        return INT32_MIN;
+    }
+    return (int)x;
+}
+
+}
@@ -0,0 +1,469 @@
+#include "SubdMeshExport.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "MappedFile.h"
+#include "SubdLeafSort.h"
+
+namespace Headless {
+
+static_assert(sizeof(float3) == 12, "Positions are written as packed float3");
+
+// Root triangle coordinates in units of 2^-WeldLatticeBits: deep enough for a depth 31 key
+// and the finest patch lattice, 2^-((PatchGridMaxLevel + 1) / 2), below it.
+static const uint32_t WeldLatticeBits = 36;
+static const uint64_t WeldLatticeOne = 1ull << WeldLatticeBits;
+
+// Where a leaf border vertex lies: a mesh vertex, a point of a mesh edge (lower vertex index
+// first) or a point inside a root triangle.
+struct WeldKey {
+    uint64_t Id = 0;
+    uint64_t U = 0;
+    uint64_t V = 0;
+
+    bool operator==(const WeldKey& inOther) const { return Id == inOther.Id && U == inOther.U && V == inOther.V; }
+};
+
+struct WeldEntry {
+    WeldKey Key;
+    uint32_t Index = 0;
+    uint32_t LastChunk = 0;
+};
+
+// Open addressing with linear probing over a power of two table, at most half full; erasing
+// shifts the run after the slot back, so there are no tombstones. Id ~0 marks a free slot,
+// a kind no key has.
+class WeldTable {
+public:
+    WeldTable() : mEntries(1024) { Clear(mEntries); }
+
+    size_t GetSize() const { return mSize; }
+
+    // The entry of inKey, added with inIndex and inChunk when missing.
+    WeldEntry& FindOrAdd(const WeldKey& inKey, uint32_t inIndex, uint32_t inChunk, bool& outAdded) {
+        if ((mSize + 1) * 2 > mEntries.size()) {
+            Grow();
+        }
+        size_t Slot = FindSlot(inKey);
+        outAdded = mEntries[Slot].Key.Id == FreeId;
+        if (outAdded) {
+            mEntries[Slot] = { inKey, inIndex, inChunk };
+            ++mSize;
+        }
+        return mEntries[Slot];
+    }
+
+    WeldEntry* Find(const WeldKey& inKey) {
+        size_t Slot = FindSlot(inKey);
+        return mEntries[Slot].Key.Id == FreeId ? nullptr : &mEntries[Slot];
+    }
+
+    void Erase(WeldEntry* inEntry) {
+        size_t Mask = mEntries.size() - 1;
+        size_t Hole = inEntry - mEntries.data();
+        for (size_t Slot = (Hole + 1) & Mask; mEntries[Slot].Key.Id != FreeId; Slot = (Slot + 1) & Mask) {
+            // An entry moves into the hole unless its home lies cyclically in (Hole, Slot].
+            size_t Home = GetHome(mEntries[Slot].Key);
+            if (((Slot - Home) & Mask) >= ((Slot - Hole) & Mask)) {
+                mEntries[Hole] = mEntries[Slot];
+                Hole = Slot;
+            }
+        }
+        mEntries[Hole].Key.Id = FreeId;
+        --mSize;
+    }
+
+private:
+    static const uint64_t FreeId = ~0ull;
+
+    size_t GetHome(const WeldKey& inKey) const {
+        uint64_t Hash = inKey.Id * 0x9e3779b97f4a7c15ull ^ inKey.U * 0xc2b2ae3d27d4eb4full ^ inKey.V * 0x165667b19e3779f9ull;
+        return (size_t)(Hash ^ (Hash >> 31)) & (mEntries.size() - 1);
+    }
+
+    size_t FindSlot(const WeldKey& inKey) const {
+        size_t Mask = mEntries.size() - 1;
+        size_t Slot = GetHome(inKey);
+        while (mEntries[Slot].Key.Id != FreeId && !(mEntries[Slot].Key == inKey)) {
+            Slot = (Slot + 1) & Mask;
+        }
+        return Slot;
+    }
+
+    static void Clear(std::vector<WeldEntry>& ioEntries) {
+        for (WeldEntry& Entry : ioEntries) {
+            Entry.Key.Id = FreeId;
+        }
+    }
+
+    void Grow() {
+        std::vector<WeldEntry> Old(mEntries.size() * 2);
+        Clear(Old);
+        Old.swap(mEntries);
+        for (const WeldEntry& Entry : Old) {
+            if (Entry.Key.Id != FreeId) {
+                mEntries[FindSlot(Entry.Key)] = Entry;
+            }
+        }
+    }
+
+    std::vector<WeldEntry> mEntries;
+    size_t mSize = 0;
+};
+
+static WeldKey GetWeldKey(const SubdMesh& inMesh, uint32_t inPrimitiveIndex, uint64_t inU, uint64_t inV) {
+    const uint32_t* Corners = &inMesh.IndexData[(size_t)inPrimitiveIndex * 3];
+    WeldKey Key;
+    if (inU == 0 && inV == 0) {
+        Key.Id = Corners[0];
+        return Key;
+    }
+    if (inU == WeldLatticeOne || inV == WeldLatticeOne) {
+        Key.Id = Corners[inU == WeldLatticeOne ? 1 : 2];
+        return Key;
+    }
+    // The edge from First to Second, at Offset from First.
+    uint32_t First, Second;
+    uint64_t Offset;
+    if (inV == 0) {
+        First = Corners[0], Second = Corners[1], Offset = inU;
+    }
+    else if (inU == 0) {
+        First = Corners[0], Second = Corners[2], Offset = inV;
+    }
+    else if (inU + inV == WeldLatticeOne) {
+        First = Corners[1], Second = Corners[2], Offset = inV;
+    }
+    else {
+        Key.Id = 2ull << 62 | inPrimitiveIndex;
+        Key.U = inU;
+        Key.V = inV;
+        return Key;
+    }
+    if (First > Second) {
+        std::swap(First, Second);
+        Offset = WeldLatticeOne - Offset;
+    }
+    Key.Id = 1ull << 62 | (uint64_t)First << 31 | Second;
+    Key.U = Offset;
+    return Key;
+}
+
+// The corners Subd gives the key, on the root triangle's (u, v) lattice: BitToTransform as a
+// corner map, the way BuildPatchGrid walks it.
+static void GetLeafLatticeCorners(uint32_t inSubdBinaryKey, uint64_t outU[3], uint64_t outV[3]) {
+    outU[0] = 0, outU[1] = WeldLatticeOne, outU[2] = 0;
+    outV[0] = 0, outV[1] = 0, outV[2] = WeldLatticeOne;
+    for (int Depth = firstbithigh(inSubdBinaryKey); Depth > 0; --Depth) {
+        uint64_t MiddleU = (outU[1] + outU[2]) / 2;
+        uint64_t MiddleV = (outV[1] + outV[2]) / 2;
+        if ((inSubdBinaryKey >> (Depth - 1)) & 1u) {
+            outU[2] = outU[0];
+            outV[2] = outV[0];
+        }
+        else {
+            outU[1] = outU[0];
+            outV[1] = outV[0];
+        }
+        outU[0] = MiddleU;
+        outV[0] = MiddleV;
+    }
+}
+
+// Writes whole blocks and counts the bytes.
+struct ExportFile {
+    FILE* File = nullptr;
+    uint64_t ByteCount = 0;
+    bool Failed = false;
+
+    void Write(const void* inData, size_t inSize) {
+        if (!Failed && inSize && fwrite(inData, 1, inSize, File) != inSize) {
+            Failed = true;
+        }
+        ByteCount += inSize;
+    }
+};
+
+static double GetMs(std::chrono::steady_clock::time_point inStart) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inStart).count();
+}
+
+// "v" lines of the chunk's positions, then "f" lines of its triangles, 1-based, formatted in
+// parallel pieces and written in order.
+static void WriteObjChunk(ExportFile& ioFile, const std::vector<float3>& inVertices, uint32_t inVertexCount, const std::vector<uint32_t>& inIndices,
+    uint32_t inTriangleCount, ThreadPool& inThreadPool) {
+    const size_t PieceLines = 4096;
+    size_t VertexPieces = (inVertexCount + PieceLines - 1) / PieceLines;
+    size_t TrianglePieces = (inTriangleCount + PieceLines - 1) / PieceLines;
+    std::vector<std::string> Pieces(VertexPieces + TrianglePieces);
+    inThreadPool.ParallelFor(Pieces.size(), 1, [&](size_t inBegin, size_t inEnd) {
+        char Line[96];
+        for (size_t Piece = inBegin; Piece < inEnd; ++Piece) {
+            std::string& Text = Pieces[Piece];
+            if (Piece < VertexPieces) {
+                size_t End = std::min<size_t>(inVertexCount, (Piece + 1) * PieceLines);
+                for (size_t i = Piece * PieceLines; i < End; ++i) {
+                    const float3& Vertex = inVertices[i];
+                    Text.append(Line, snprintf(Line, sizeof(Line), "v %.9g %.9g %.9g\n", Vertex.x, Vertex.y, Vertex.z));
+                }
+            }
+            else {
+                size_t End = std::min<size_t>(inTriangleCount, (Piece - VertexPieces + 1) * PieceLines);
+                for (size_t i = (Piece - VertexPieces) * PieceLines; i < End; ++i) {
+                    const uint32_t* Triangle = &inIndices[i * 3];
+                    Text.append(Line, snprintf(Line, sizeof(Line), "f %u %u %u\n", Triangle[0] + 1, Triangle[1] + 1, Triangle[2] + 1));
+                }
+            }
+        }
+    });
+    for (const std::string& Text : Pieces) {
+        ioFile.Write(Text.data(), Text.size());
+    }
+}
+
+bool ExportSubdMesh(const std::string& inPath, const PrimitiveData* inLeaves, uint32_t inLeafCount, const MeshExportConfig& inConfig,
+    MeshExportStats* outStats, ThreadPool& inThreadPool) {
+    auto Start = std::chrono::steady_clock::now();
+    const SubdMesh& Mesh = *inConfig.Render.Mesh;
+    MeshExportStats Stats;
+    Stats.LeafCount = inLeafCount;
+
+    std::vector<PrimitiveData> Sorted;
+    if (inConfig.SortLeaves) {
+        auto SortStart = std::chrono::steady_clock::now();
+        Sorted.assign(inLeaves, inLeaves + inLeafCount);
+        Headless::SortLeaves(Mesh, GetLeafSortBounds(Mesh), Sorted.data(), inLeafCount, inThreadPool, inConfig.Render.TransformTable);
+        inLeaves = Sorted.data();
+        Stats.SortMs = GetMs(SortStart);
+    }
+
+    // The patch and its vertices on the leaf border, in lattice units of 2^-LatticeBits.
+    const PatchLevelOffset& Patch = PatchGrids.PatchLevelOffsets[inConfig.PatchLevel];
+    const PatchVertex* PatchVertices = &PatchGrids.Vertices[Patch.BaseVertexLocation];
+    const uint16_t* PatchIndices = &PatchGrids.Indices[Patch.StartIndexLocation];
+    const uint32_t VertexCount = Patch.VertexCount;
+    const uint32_t TriangleCount = Patch.IndexCountPerInstance / 3;
+    const uint32_t LatticeBits = (inConfig.PatchLevel + 1) / 2;
+    const float LatticeScale = (float)(1u << LatticeBits);
+    std::vector<uint32_t> BorderVertices;
+    std::vector<uint32_t> LatticeU(VertexCount), LatticeV(VertexCount);
+    for (uint32_t i = 0; i < VertexCount; ++i) {
+        LatticeU[i] = (uint32_t)(PatchVertices[i].BerpUV[0] * LatticeScale);
+        LatticeV[i] = (uint32_t)(PatchVertices[i].BerpUV[1] * LatticeScale);
+        if (LatticeU[i] == 0 || LatticeV[i] == 0 || LatticeU[i] + LatticeV[i] == (1u << LatticeBits)) {
+            BorderVertices.push_back(i);
+        }
+    }
+    const uint32_t BorderCount = (uint32_t)BorderVertices.size();
+
+    ExportFile File;
+    File.File = fopen(inPath.c_str(), "wb");
+    if (!File.File) {
+        return false;
+    }
+    MeshExportHeader Header;
+    if (inConfig.Format == MeshExportFormat::Binary) {
+        File.Write(&Header, sizeof(Header));
+    }
+    else {
+        char Comment[128];
+        File.Write(Comment, snprintf(Comment, sizeof(Comment), "# ExportSubdMesh: %u leaves, patch level %u\n", inLeafCount, inConfig.PatchLevel));
+    }
+
+    const uint32_t ChunkLeafCount = std::max(inConfig.ChunkLeafCount, 1u);
+    std::vector<WeldKey> ChunkKeys((size_t)ChunkLeafCount * BorderCount);
+    std::vector<uint32_t> ChunkVertexIndices((size_t)ChunkLeafCount * VertexCount);
+    std::vector<uint8_t> ChunkVertexNew((size_t)ChunkLeafCount * VertexCount);
+    std::vector<float3> ChunkVertices((size_t)ChunkLeafCount * VertexCount);
+    std::vector<uint32_t> ChunkIndices((size_t)ChunkLeafCount * TriangleCount * 3);
+
+    // Each entry sits in the list of the chunk that inserted or last kept it. When that
+    // chunk leaves the window the list is swept: entries used since move to the current
+    // chunk's list, the others are forgotten.
+    WeldTable Weld;
+    const uint32_t WindowChunks = inConfig.WeldWindowChunks;
+    std::vector<std::vector<WeldKey>> WindowLists(WindowChunks ? WindowChunks + 1 : 0);
+    std::vector<WeldKey> Expired;
+
+    uint64_t NextVertex = 0;
+    bool Overflow = false;
+    for (uint32_t Chunk = 0; (uint64_t)Chunk * ChunkLeafCount < inLeafCount && !File.Failed; ++Chunk) {
+        const PrimitiveData* Leaves = inLeaves + (size_t)Chunk * ChunkLeafCount;
+        uint32_t LeafCount = std::min(ChunkLeafCount, inLeafCount - Chunk * ChunkLeafCount);
+
+        auto EvaluateStart = std::chrono::steady_clock::now();
+        inThreadPool.ParallelFor(LeafCount, 256, [&](size_t inBegin, size_t inEnd) {
+            for (size_t Leaf = inBegin; Leaf < inEnd; ++Leaf) {
+                uint64_t CornerU[3], CornerV[3];
+                GetLeafLatticeCorners(Leaves[Leaf].SubdBinaryKey, CornerU, CornerV);
+                WeldKey* Keys = &ChunkKeys[Leaf * BorderCount];
+                for (uint32_t b = 0; b < BorderCount; ++b) {
+                    uint32_t i = BorderVertices[b];
+                    // Berp on the lattice: exact, as the corners are multiples of 2^LatticeBits.
+                    int64_t U = (int64_t)CornerU[0] + (((int64_t)CornerU[1] - (int64_t)CornerU[0]) * LatticeU[i]
+                        + ((int64_t)CornerU[2] - (int64_t)CornerU[0]) * LatticeV[i]) / (1 << LatticeBits);
+                    int64_t V = (int64_t)CornerV[0] + (((int64_t)CornerV[1] - (int64_t)CornerV[0]) * LatticeU[i]
+                        + ((int64_t)CornerV[2] - (int64_t)CornerV[0]) * LatticeV[i]) / (1 << LatticeBits);
+                    Keys[b] = GetWeldKey(Mesh, Leaves[Leaf].PrimitiveIndex, (uint64_t)U, (uint64_t)V);
+                }
+            }
+        });
+        Stats.EvaluateMs += GetMs(EvaluateStart);
+
+        auto WeldStart = std::chrono::steady_clock::now();
+        std::vector<WeldKey>* WindowList = nullptr;
+        if (WindowChunks) {
+            WindowList = &WindowLists[Chunk % WindowLists.size()];
+            Expired.swap(*WindowList);
+            WindowList->clear();
+            for (const WeldKey& Key : Expired) {
+                WeldEntry* Found = Weld.Find(Key);
+                if (Found->LastChunk + WindowChunks < Chunk) {
+                    Weld.Erase(Found);
+                }
+                else {
+                    WindowList->push_back(Key);
+                }
+            }
+            Expired.clear();
+        }
+        uint64_t ChunkFirstVertex = NextVertex;
+        for (uint32_t Leaf = 0; Leaf < LeafCount; ++Leaf) {
+            const WeldKey* Keys = &ChunkKeys[(size_t)Leaf * BorderCount];
+            uint32_t* Indices = &ChunkVertexIndices[(size_t)Leaf * VertexCount];
+            uint8_t* New = &ChunkVertexNew[(size_t)Leaf * VertexCount];
+            std::fill(New, New + VertexCount, 1);
+            uint32_t b = 0;
+            for (uint32_t i = 0; i < VertexCount; ++i) {
+                if (b < BorderCount && BorderVertices[b] == i) {
+                    bool Added;
+                    WeldEntry& Entry = Weld.FindOrAdd(Keys[b], (uint32_t)NextVertex, Chunk, Added);
+                    ++b;
+                    if (!Added) {
+                        Indices[i] = Entry.Index;
+                        Entry.LastChunk = Chunk;
+                        New[i] = 0;
+                        ++Stats.WeldedCount;
+                        continue;
+                    }
+                    if (WindowList) {
+                        WindowList->push_back(Keys[b - 1]);
+                    }
+                }
+                Indices[i] = (uint32_t)NextVertex++;
+            }
+        }
+        Stats.PeakWeldEntries = std::max(Stats.PeakWeldEntries, Weld.GetSize());
+        Stats.WeldMs += GetMs(WeldStart);
+        if (NextVertex > 0xffffffffull) {
+            Overflow = true;
+            break;
+        }
+
+        // Positions of the vertices this chunk created, and its triangles.
+        EvaluateStart = std::chrono::steady_clock::now();
+        inThreadPool.ParallelFor(LeafCount, 64, [&](size_t inBegin, size_t inEnd) {
+            for (size_t Leaf = inBegin; Leaf < inEnd; ++Leaf) {
+                const uint32_t* Indices = &ChunkVertexIndices[Leaf * VertexCount];
+                const uint8_t* New = &ChunkVertexNew[Leaf * VertexCount];
+                float4 InVertices[3];
+                Mesh.GetPrimitiveVertices(Leaves[Leaf].PrimitiveIndex, InVertices);
+                float4 OutVertices[3];
+                RenderSubd(inConfig.Render, Leaves[Leaf].SubdBinaryKey, InVertices, OutVertices);
+                for (uint32_t i = 0; i < VertexCount; ++i) {
+                    if (!New[i]) {
+                        continue;
+                    }
+                    float4 Position = RenderBerp(inConfig.Render, OutVertices, float2(PatchVertices[i].BerpUV[0], PatchVertices[i].BerpUV[1]));
+                    if (inConfig.HeightMap) {
+                        Position.z += inConfig.HeightMap->SampleLevel(float2(Position.x * 0.5f + 0.5f, Position.y * 0.5f + 0.5f)).x * inConfig.Render.DisplacementFactor;
+                    }
+                    ChunkVertices[Indices[i] - ChunkFirstVertex] = Position.xyz();
+                }
+                uint32_t* Triangles = &ChunkIndices[Leaf * TriangleCount * 3];
+                for (uint32_t j = 0; j < TriangleCount * 3; ++j) {
+                    Triangles[j] = Indices[PatchIndices[j]];
+                }
+            }
+        });
+        Stats.EvaluateMs += GetMs(EvaluateStart);
+
+        auto WriteStart = std::chrono::steady_clock::now();
+        MeshExportChunkHeader ChunkHeader;
+        ChunkHeader.VertexCount = (uint32_t)(NextVertex - ChunkFirstVertex);
+        ChunkHeader.TriangleCount = LeafCount * TriangleCount;
+        if (inConfig.Format == MeshExportFormat::Binary) {
+            File.Write(&ChunkHeader, sizeof(ChunkHeader));
+            File.Write(ChunkVertices.data(), (size_t)ChunkHeader.VertexCount * sizeof(float3));
+            File.Write(ChunkIndices.data(), (size_t)ChunkHeader.TriangleCount * 3 * sizeof(uint32_t));
+        }
+        else {
+            WriteObjChunk(File, ChunkVertices, ChunkHeader.VertexCount, ChunkIndices, ChunkHeader.TriangleCount, inThreadPool);
+        }
+        ++Header.ChunkCount;
+        Stats.TriangleCount += ChunkHeader.TriangleCount;
+        Stats.WriteMs += GetMs(WriteStart);
+    }
+    Stats.VertexCount = NextVertex;
+
+    // The totals go in front once they are known.
+    if (inConfig.Format == MeshExportFormat::Binary && !File.Failed && !Overflow) {
+        Header.VertexCount = Stats.VertexCount;
+        Header.TriangleCount = Stats.TriangleCount;
+        File.Failed = fseek(File.File, 0, SEEK_SET) != 0 || fwrite(&Header, sizeof(Header), 1, File.File) != 1;
+    }
+    bool Written = fclose(File.File) == 0 && !File.Failed && !Overflow;
+    Stats.ByteCount = File.ByteCount;
+    Stats.TotalMs = GetMs(Start);
+    if (outStats) {
+        *outStats = Stats;
+    }
+    return Written;
+}
+
+bool ReadSubdMeshExport(const std::string& inPath, std::vector<float3>& outVertices, std::vector<uint32_t>& outIndices) {
+    outVertices.clear();
+    outIndices.clear();
+    MappedFile File;
+    if (!File.Open(inPath) || File.GetSize() < sizeof(MeshExportHeader)) {
+        return false;
+    }
+    MeshExportHeader Header;
+    memcpy(&Header, File.GetData(), sizeof(Header));
+    if (Header.Magic != MeshExportMagic || Header.Version != MeshExportVersion) {
+        return false;
+    }
+    const uint8_t* Cursor = File.GetData() + sizeof(Header);
+    const uint8_t* End = File.GetData() + File.GetSize();
+    for (uint32_t Chunk = 0; Chunk < Header.ChunkCount; ++Chunk) {
+        MeshExportChunkHeader ChunkHeader;
+        if ((size_t)(End - Cursor) < sizeof(ChunkHeader)) {
+            return false;
+        }
+        memcpy(&ChunkHeader, Cursor, sizeof(ChunkHeader));
+        Cursor += sizeof(ChunkHeader);
+        size_t VertexBytes = (size_t)ChunkHeader.VertexCount * sizeof(float3);
+        size_t IndexBytes = (size_t)ChunkHeader.TriangleCount * 3 * sizeof(uint32_t);
+        if ((size_t)(End - Cursor) < VertexBytes + IndexBytes) {
+            return false;
+        }
+        size_t FirstVertex = outVertices.size();
+        outVertices.resize(FirstVertex + ChunkHeader.VertexCount);
+        memcpy(outVertices.data() + FirstVertex, Cursor, VertexBytes);
+        Cursor += VertexBytes;
+        size_t FirstIndex = outIndices.size();
+        outIndices.resize(FirstIndex + (size_t)ChunkHeader.TriangleCount * 3);
+        memcpy(outIndices.data() + FirstIndex, Cursor, IndexBytes);
+        Cursor += IndexBytes;
+        for (size_t i = FirstIndex; i < outIndices.size(); ++i) {
+            if (outIndices[i] >= outVertices.size()) {
+                return false;
+            }
+        }
+    }
+    return Cursor == End && outVertices.size() == Header.VertexCount && outIndices.size() == Header.TriangleCount * 3;
+}
+
+}
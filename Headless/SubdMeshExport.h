@@ -0,0 +1,87 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "PatchGrid.h"
+#include "SubdLeafVertex.h"
+
+namespace Headless {
+
+// Triangle mesh of a key set as RenderKernelVS draws it, streamed to disk for offline baking
+// (collision, lightmaps, LOD proxies).
+//
+// Binary is MeshExportHeader, then ChunkCount chunks: a MeshExportChunkHeader, its float3
+// positions and its uint32 index triples. Indices count from the first vertex of the file
+// and only point into their chunk or earlier ones, so the file reads back as a stream too.
+// Obj writes the same vertices and faces as "v" and "f" lines.
+enum class MeshExportFormat : uint32_t {
+    Binary,
+    Obj,
+};
+
+const uint32_t MeshExportMagic = 0x4d425553; // "SUBM"
+const uint32_t MeshExportVersion = 1;
+
+struct MeshExportHeader {
+    uint32_t Magic = MeshExportMagic;
+    uint32_t Version = MeshExportVersion;
+    uint64_t VertexCount = 0;
+    uint64_t TriangleCount = 0;
+    uint32_t ChunkCount = 0;
+    uint32_t Reserved = 0;
+};
+
+struct MeshExportChunkHeader {
+    uint32_t VertexCount = 0;
+    uint32_t TriangleCount = 0;
+};
+
+// Each leaf becomes its level PatchLevel patch, placed by Subd and Berp (Phong tessellation
+// included) and raised by HeightMap * DisplacementFactor as DISPLACE does.
+//
+// Patch vertices on a leaf's border are welded by where they lie on their root triangle, in
+// exact integers from the key bits: on a root edge or corner they are named by the mesh's
+// vertex indices (below 2^31), so neighbouring root triangles weld too. The first leaf to
+// reach a vertex places it. Vertices where a finer leaf meets a coarser one stay apart, the
+// T-junctions RenderKernelVS draws. Welding only remembers the vertices used in the last
+// WeldWindowChunks chunks; neighbours further apart in the key order are written twice.
+struct MeshExportConfig {
+    RenderKernelContext Render;
+    const SubdTexture* HeightMap = nullptr;
+    uint32_t PatchLevel = DefaultPatchLevel;
+    MeshExportFormat Format = MeshExportFormat::Binary;
+    // Orders a copy of the leaves as SortLeaves does, so neighbours fall in nearby chunks.
+    bool SortLeaves = true;
+    // Leaves expanded, welded and written at a time.
+    uint32_t ChunkLeafCount = 1u << 14;
+    // 0 remembers every border vertex: exact welding, memory growing with the mesh.
+    uint32_t WeldWindowChunks = 8;
+};
+
+struct MeshExportStats {
+    uint64_t LeafCount = 0;
+    uint64_t VertexCount = 0;
+    uint64_t TriangleCount = 0;
+    // Leaf border vertices that reused one written before.
+    uint64_t WeldedCount = 0;
+    uint64_t ByteCount = 0;
+    size_t PeakWeldEntries = 0;
+    double SortMs = 0.0;
+    // Weld ids and positions, the serial weld, then formatting and writing.
+    double EvaluateMs = 0.0;
+    double WeldMs = 0.0;
+    double WriteMs = 0.0;
+    double TotalMs = 0.0;
+
+    double GetTrianglesPerSecond() const { return TotalMs > 0.0 ? TriangleCount / (TotalMs * 1e-3) : 0.0; }
+};
+
+// inLeaves is a SubdIn or SubdCulledOut list over inConfig.Render.Mesh. Memory stays within
+// the chunk buffers, the weld window and, with SortLeaves, a copy of the leaves. Fails when
+// the file cannot be written or the mesh would pass 2^32 vertices.
+bool ExportSubdMesh(const std::string& inPath, const PrimitiveData* inLeaves, uint32_t inLeafCount, const MeshExportConfig& inConfig,
+    MeshExportStats* outStats = nullptr, ThreadPool& inThreadPool = ThreadPool::GetDefault());
+
+// Whole Binary file back in memory, checking every index against the vertices before it.
+bool ReadSubdMeshExport(const std::string& inPath, std::vector<float3>& outVertices, std::vector<uint32_t>& outIndices);
+
+}
@@ -0,0 +1,415 @@
+#include "SubdObjLoader.h"
+#include "MappedFile.h"
+#include "ParallelScan.h"
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+namespace Headless {
+
+static const size_t ObjBlockBytes = 1 << 20;
+static const size_t WeldBlockSize = 1 << 16;
+static const uint32_t WeldPartitionBits = 6;
+static const uint32_t InvalidVertex = ~0u;
+
+// Lines [Begin, End) of the file and where their positions and triangles go.
+struct ObjBlock {
+    const char* Begin = nullptr;
+    const char* End = nullptr;
+    uint32_t PositionCount = 0;
+    uint32_t FaceCount = 0;
+    uint32_t TriangleCount = 0;
+    uint32_t PositionBase = 0;
+    uint32_t TriangleBase = 0;
+};
+
+static bool IsBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static const char* SkipBlanks(const char* inCursor, const char* inEnd) {
+    while (inCursor < inEnd && IsBlank(*inCursor)) {
+        ++inCursor;
+    }
+    return inCursor;
+}
+
+static const char* FindLineEnd(const char* inCursor, const char* inEnd) {
+    const char* LineEnd = (const char*)memchr(inCursor, '\n', inEnd - inCursor);
+    return LineEnd ? LineEnd : inEnd;
+}
+
+// Decimal with optional sign, fraction and exponent. The first 19 significant digits are
+// kept and scaled by an exact power of ten, which rounds like strtof for the 6 to 9 digit
+// values exporters write.
+static bool ParseFloat(const char*& ioCursor, const char* inEnd, float& outValue) {
+    static const double PowersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+        1e20, 1e21, 1e22 };
+    const char* p = SkipBlanks(ioCursor, inEnd);
+    bool Negative = p < inEnd && *p == '-';
+    if (p < inEnd && (*p == '-' || *p == '+')) {
+        ++p;
+    }
+    uint64_t Mantissa = 0;
+    int Digits = 0;
+    int Exponent = 0;
+    bool HasDigits = false;
+    for (; p < inEnd && IsDigit(*p); ++p) {
+        HasDigits = true;
+        if (Digits < 19) {
+            Mantissa = Mantissa * 10 + (uint64_t)(*p - '0');
+            Digits += Mantissa != 0;
+        } else {
+            ++Exponent;
+        }
+    }
+    if (p < inEnd && *p == '.') {
+        for (++p; p < inEnd && IsDigit(*p); ++p) {
+            HasDigits = true;
+            if (Digits < 19) {
+                Mantissa = Mantissa * 10 + (uint64_t)(*p - '0');
+                Digits += Mantissa != 0;
+                --Exponent;
+            }
+        }
+    }
+    if (!HasDigits) {
+        return false;
+    }
+    if (p < inEnd && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool NegativeExponent = p < inEnd && *p == '-';
+        if (p < inEnd && (*p == '-' || *p == '+')) {
+            ++p;
+        }
+        if (p == inEnd || !IsDigit(*p)) {
+            return false;
+        }
+        int Value = 0;
+        for (; p < inEnd && IsDigit(*p); ++p) {
+            Value = std::min(Value * 10 + (*p - '0'), 1000);
+        }
+        Exponent += NegativeExponent ? -Value : Value;
+    }
+
+    double Value = (double)Mantissa;
+    if (Exponent < 0) {
+        Value = Exponent >= -22 ? Value / PowersOf10[-Exponent] : Value * std::pow(10.0, Exponent);
+    } else if (Exponent > 0) {
+        Value = Exponent <= 22 ? Value * PowersOf10[Exponent] : Value * std::pow(10.0, Exponent);
+    }
+    outValue = (float)(Negative ? -Value : Value);
+    ioCursor = p;
+    return true;
+}
+
+static bool ParseInt(const char*& ioCursor, const char* inEnd, int64_t& outValue) {
+    const char* p = ioCursor;
+    bool Negative = p < inEnd && *p == '-';
+    if (p < inEnd && (*p == '-' || *p == '+')) {
+        ++p;
+    }
+    if (p == inEnd || !IsDigit(*p)) {
+        return false;
+    }
+    int64_t Value = 0;
+    for (; p < inEnd && IsDigit(*p); ++p) {
+        Value = std::min<int64_t>(Value * 10 + (*p - '0'), (int64_t)1 << 40);
+    }
+    outValue = Negative ? -Value : Value;
+    ioCursor = p;
+    return true;
+}
+
+// Pass 1: positions, faces and fan triangles of a block.
+static void CountObjBlock(ObjBlock& ioBlock) {
+    for (const char* Line = ioBlock.Begin; Line < ioBlock.End;) {
+        const char* LineEnd = FindLineEnd(Line, ioBlock.End);
+        const char* p = SkipBlanks(Line, LineEnd);
+        if (LineEnd - p >= 2 && IsBlank(p[1])) {
+            if (p[0] == 'v') {
+                ++ioBlock.PositionCount;
+            } else if (p[0] == 'f') {
+                uint32_t Corners = 0;
+                for (p += 2; p < LineEnd;) {
+                    p = SkipBlanks(p, LineEnd);
+                    if (p < LineEnd && *p != '\r') {
+                        ++Corners;
+                    }
+                    while (p < LineEnd && !IsBlank(*p)) {
+                        ++p;
+                    }
+                }
+                ++ioBlock.FaceCount;
+                ioBlock.TriangleCount += Corners > 2 ? Corners - 2 : 0;
+            }
+        }
+        Line = LineEnd + 1;
+    }
+}
+
+// Pass 2: parses a block into its slots of outPositions / outIndices.
+static bool ParseObjBlock(const ObjBlock& inBlock, uint32_t inTotalPositionCount, float4* outPositions, uint32_t* outIndices) {
+    uint32_t PositionIndex = inBlock.PositionBase;
+    uint32_t* Indices = outIndices + (size_t)inBlock.TriangleBase * 3;
+    for (const char* Line = inBlock.Begin; Line < inBlock.End;) {
+        const char* LineEnd = FindLineEnd(Line, inBlock.End);
+        const char* p = SkipBlanks(Line, LineEnd);
+        if (LineEnd - p >= 2 && IsBlank(p[1])) {
+            if (p[0] == 'v') {
+                float4& Position = outPositions[PositionIndex++];
+                p += 2;
+                if (!ParseFloat(p, LineEnd, Position.x) || !ParseFloat(p, LineEnd, Position.y) || !ParseFloat(p, LineEnd, Position.z)) {
+                    return false;
+                }
+                Position.w = 1.0f;
+            } else if (p[0] == 'f') {
+                uint32_t Corners[3] = {};
+                uint32_t CornerCount = 0;
+                for (p += 2;;) {
+                    p = SkipBlanks(p, LineEnd);
+                    if (p == LineEnd || *p == '\r') {
+                        break;
+                    }
+                    int64_t Index = 0;
+                    if (!ParseInt(p, LineEnd, Index)) {
+                        return false;
+                    }
+                    // Negative indices count back from the last position before this line.
+                    Index = Index > 0 ? Index - 1 : (int64_t)PositionIndex + Index;
+                    if (Index < 0 || Index >= (int64_t)inTotalPositionCount) {
+                        return false;
+                    }
+                    // Texture coordinate and normal indices.
+                    while (p < LineEnd && !IsBlank(*p) && *p != '\r') {
+                        ++p;
+                    }
+                    if (CornerCount < 2) {
+                        Corners[CornerCount++] = (uint32_t)Index;
+                    } else {
+                        Corners[2] = (uint32_t)Index;
+                        Indices[0] = Corners[0];
+                        Indices[1] = Corners[1];
+                        Indices[2] = Corners[2];
+                        Indices += 3;
+                        Corners[1] = Corners[2];
+                    }
+                }
+            }
+        }
+        Line = LineEnd + 1;
+    }
+    return true;
+}
+
+bool ParseObjMesh(const char* inText, size_t inSize, SubdMesh& outMesh, const ObjLoadConfig& inConfig, ObjLoadStats* outStats, ThreadPool& inThreadPool) {
+    // Blocks of about ObjBlockBytes, each ending after a newline.
+    std::vector<ObjBlock> Blocks;
+    const char* End = inText + inSize;
+    for (const char* Begin = inText; Begin < End;) {
+        const char* BlockEnd = Begin + std::min<size_t>(ObjBlockBytes, End - Begin);
+        BlockEnd = BlockEnd < End ? FindLineEnd(BlockEnd, End) + 1 : End;
+        ObjBlock Block;
+        Block.Begin = Begin;
+        Block.End = std::min(BlockEnd, End);
+        Blocks.push_back(Block);
+        Begin = Block.End;
+    }
+
+    inThreadPool.ParallelFor(Blocks.size(), 1, [&](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            CountObjBlock(Blocks[i]);
+        }
+    });
+    uint64_t PositionCount = 0, TriangleCount = 0, FaceCount = 0;
+    for (ObjBlock& Block : Blocks) {
+        Block.PositionBase = (uint32_t)PositionCount;
+        Block.TriangleBase = (uint32_t)TriangleCount;
+        PositionCount += Block.PositionCount;
+        TriangleCount += Block.TriangleCount;
+        FaceCount += Block.FaceCount;
+    }
+    if (PositionCount >= InvalidVertex || TriangleCount * 3 >= InvalidVertex) {
+        return false;
+    }
+
+    SubdMesh Mesh;
+    Mesh.VertexData.resize(PositionCount);
+    Mesh.IndexData.resize(TriangleCount * 3);
+    std::atomic<bool> Valid{ true };
+    inThreadPool.ParallelFor(Blocks.size(), 1, [&](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            if (!ParseObjBlock(Blocks[i], (uint32_t)PositionCount, Mesh.VertexData.data(), Mesh.IndexData.data())) {
+                Valid = false;
+            }
+        }
+    });
+    if (!Valid) {
+        return false;
+    }
+
+    uint32_t DegenerateCount = WeldSubdMesh(Mesh, inConfig, inThreadPool);
+    if (outStats) {
+        outStats->FileBytes = inSize;
+        outStats->PositionCount = (uint32_t)PositionCount;
+        outStats->FaceCount = (uint32_t)FaceCount;
+        outStats->VertexCount = (uint32_t)Mesh.VertexData.size();
+        outStats->TriangleCount = Mesh.GetPrimitiveCount();
+        outStats->DegenerateTriangleCount = DegenerateCount;
+    }
+    outMesh = std::move(Mesh);
+    return true;
+}
+
+bool LoadObjMesh(const std::string& inPath, SubdMesh& outMesh, const ObjLoadConfig& inConfig, ObjLoadStats* outStats, ThreadPool& inThreadPool) {
+    MappedFile File;
+    if (!File.Open(inPath)) {
+        return false;
+    }
+    return ParseObjMesh((const char*)File.GetData(), File.GetSize(), outMesh, inConfig, outStats, inThreadPool);
+}
+
+// Bit pattern of a position, or of its grid cell; -0 and +0 weld.
+struct WeldKey {
+    uint32_t Bits[3];
+
+    bool operator==(const WeldKey& inOther) const { return Bits[0] == inOther.Bits[0] && Bits[1] == inOther.Bits[1] && Bits[2] == inOther.Bits[2]; }
+};
+
+static WeldKey MakeWeldKey(const float4& inPosition, float inEpsilon) {
+    WeldKey Key;
+    for (int c = 0; c < 3; ++c) {
+        if (inEpsilon > 0.0f) {
+            Key.Bits[c] = (uint32_t)(int32_t)std::floor(inPosition[c] / inEpsilon + 0.5f);
+        } else {
+            float Value = inPosition[c] == 0.0f ? 0.0f : inPosition[c];
+            memcpy(&Key.Bits[c], &Value, sizeof(Value));
+        }
+    }
+    return Key;
+}
+
+static uint64_t HashWeldKey(const WeldKey& inKey) {
+    uint64_t Hash = ((uint64_t)inKey.Bits[0] << 32 | inKey.Bits[1]) * 0x9E3779B97F4A7C15ull;
+    Hash ^= (uint64_t)inKey.Bits[2] * 0xC2B2AE3D27D4EB4Full;
+    return Hash ^ (Hash >> 29);
+}
+
+uint32_t WeldSubdMesh(SubdMesh& ioMesh, const ObjLoadConfig& inConfig, ThreadPool& inThreadPool) {
+    size_t VertexCount = ioMesh.VertexData.size();
+    if (VertexCount == 0) {
+        return 0;
+    }
+    const uint32_t PartitionCount = 1u << WeldPartitionBits;
+    std::vector<WeldKey> Keys(VertexCount);
+    std::vector<uint64_t> Hashes(VertexCount);
+    size_t BlockCount = (VertexCount + WeldBlockSize - 1) / WeldBlockSize;
+    std::vector<uint32_t> PartitionOffsets(BlockCount * PartitionCount + 1, 0);
+
+    // Partition the vertices by hash, keeping file order inside each partition.
+    inThreadPool.ParallelFor(BlockCount, 1, [&](size_t inBlockBegin, size_t inBlockEnd) {
+        for (size_t Block = inBlockBegin; Block < inBlockEnd; ++Block) {
+            size_t End = std::min(VertexCount, (Block + 1) * WeldBlockSize);
+            for (size_t i = Block * WeldBlockSize; i < End; ++i) {
+                Keys[i] = MakeWeldKey(ioMesh.VertexData[i], inConfig.WeldEpsilon);
+                Hashes[i] = HashWeldKey(Keys[i]);
+                ++PartitionOffsets[(Hashes[i] >> (64 - WeldPartitionBits)) * BlockCount + Block];
+            }
+        }
+    });
+    ParallelExclusiveScan(PartitionOffsets.data(), PartitionOffsets.size(), inThreadPool);
+    std::vector<uint32_t> Order(VertexCount);
+    inThreadPool.ParallelFor(BlockCount, 1, [&](size_t inBlockBegin, size_t inBlockEnd) {
+        for (size_t Block = inBlockBegin; Block < inBlockEnd; ++Block) {
+            size_t End = std::min(VertexCount, (Block + 1) * WeldBlockSize);
+            for (size_t i = Block * WeldBlockSize; i < End; ++i) {
+                Order[PartitionOffsets[(Hashes[i] >> (64 - WeldPartitionBits)) * BlockCount + Block]++] = (uint32_t)i;
+            }
+        }
+    });
+
+    // Each partition maps its vertices to the first one with the same key.
+    std::vector<uint32_t> Remap(VertexCount);
+    inThreadPool.ParallelFor(PartitionCount, 1, [&](size_t inPartitionBegin, size_t inPartitionEnd) {
+        std::vector<uint32_t> Table;
+        for (size_t Partition = inPartitionBegin; Partition < inPartitionEnd; ++Partition) {
+            // After the scatter each offset points at the end of its block's range.
+            size_t Begin = Partition == 0 ? 0 : PartitionOffsets[Partition * BlockCount - 1];
+            size_t End = PartitionOffsets[(Partition + 1) * BlockCount - 1];
+            size_t TableSize = 16;
+            while (TableSize < 2 * (End - Begin)) {
+                TableSize *= 2;
+            }
+            Table.assign(TableSize, InvalidVertex);
+            for (size_t i = Begin; i < End; ++i) {
+                uint32_t Vertex = Order[i];
+                size_t Slot = (size_t)Hashes[Vertex] & (TableSize - 1);
+                while (Table[Slot] != InvalidVertex && !(Keys[Table[Slot]] == Keys[Vertex])) {
+                    Slot = (Slot + 1) & (TableSize - 1);
+                }
+                if (Table[Slot] == InvalidVertex) {
+                    Table[Slot] = Vertex;
+                }
+                Remap[Vertex] = Table[Slot];
+            }
+        }
+    });
+
+    // Kept vertices in file order, then the triangles through the new indices.
+    std::vector<uint32_t> NewIndex(VertexCount);
+    inThreadPool.ParallelFor(VertexCount, WeldBlockSize, [&](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            NewIndex[i] = Remap[i] == i ? 1u : 0u;
+        }
+    });
+    uint32_t WeldedCount = ParallelExclusiveScan(NewIndex.data(), VertexCount, inThreadPool);
+    std::vector<float4> Vertices(WeldedCount);
+    inThreadPool.ParallelFor(VertexCount, WeldBlockSize, [&](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            if (Remap[i] == i) {
+                Vertices[NewIndex[i]] = ioMesh.VertexData[i];
+            }
+        }
+    });
+    inThreadPool.ParallelFor(VertexCount, WeldBlockSize, [&](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            Remap[i] = NewIndex[Remap[i]];
+        }
+    });
+
+    size_t TriangleCount = ioMesh.GetPrimitiveCount();
+    const std::vector<uint32_t>& Indices = ioMesh.IndexData;
+    auto IsKept = [&](size_t inTriangle) {
+        uint32_t a = Remap[Indices[inTriangle * 3]], b = Remap[Indices[inTriangle * 3 + 1]], c = Remap[Indices[inTriangle * 3 + 2]];
+        return !inConfig.RemoveDegenerateTriangles || (a != b && b != c && c != a);
+    };
+    std::vector<uint32_t> NewIndices(TriangleCount * 3);
+    uint32_t KeptCount = ParallelCompact<uint32_t>(TriangleCount, WeldBlockSize, inThreadPool,
+        [&](size_t inBegin, size_t inEnd) {
+            uint32_t Count = 0;
+            for (size_t t = inBegin; t < inEnd; ++t) {
+                Count += IsKept(t) ? 1u : 0u;
+            }
+            return Count;
+        },
+        [&](size_t inBegin, size_t inEnd, uint32_t inOffset) {
+            for (size_t t = inBegin; t < inEnd; ++t) {
+                if (IsKept(t)) {
+                    for (int c = 0; c < 3; ++c) {
+                        NewIndices[(size_t)inOffset * 3 + c] = Remap[Indices[t * 3 + c]];
+                    }
+                    ++inOffset;
+                }
+            }
+        });
+    NewIndices.resize((size_t)KeptCount * 3);
+    ioMesh.VertexData.swap(Vertices);
+    ioMesh.IndexData.swap(NewIndices);
+    return (uint32_t)TriangleCount - KeptCount;
+}
+
+}
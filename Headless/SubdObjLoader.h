@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include "SubdEngine.h"
+
+namespace Headless {
+
+struct ObjLoadConfig {
+    // Positions closer than this are welded: 0 merges bit-identical positions only, otherwise
+    // positions snap to a grid of this spacing and those in the same cell merge.
+    float WeldEpsilon = 0.0f;
+    // Triangles that welding collapses onto an edge or a point are removed.
+    bool RemoveDegenerateTriangles = true;
+};
+
+struct ObjLoadStats {
+    size_t FileBytes = 0;
+    uint32_t PositionCount = 0;
+    uint32_t FaceCount = 0;
+    // After welding.
+    uint32_t VertexCount = 0;
+    uint32_t TriangleCount = 0;
+    uint32_t DegenerateTriangleCount = 0;
+};
+
+// Loads the positions and faces of a Wavefront OBJ into a SubdMesh: polygons become triangle
+// fans, texture coordinates, normals, groups and materials are ignored, negative (relative)
+// indices are resolved. The text is split at line boundaries into blocks parsed on
+// inThreadPool: one pass counts each block's positions and triangles, a prefix sum places
+// them, a second pass parses straight into the mesh. Welding hashes positions into
+// independent partitions, also in parallel. Vertex and triangle order follow the file.
+// Fails on malformed numbers or out-of-range indices.
+bool LoadObjMesh(const std::string& inPath, SubdMesh& outMesh, const ObjLoadConfig& inConfig = ObjLoadConfig(), ObjLoadStats* outStats = nullptr,
+    ThreadPool& inThreadPool = ThreadPool::GetDefault());
+bool ParseObjMesh(const char* inText, size_t inSize, SubdMesh& outMesh, const ObjLoadConfig& inConfig = ObjLoadConfig(), ObjLoadStats* outStats = nullptr,
+    ThreadPool& inThreadPool = ThreadPool::GetDefault());
+
+// Merges equal positions (see ObjLoadConfig::WeldEpsilon) and remaps the triangles; returns
+// the number of degenerate triangles removed.
+uint32_t WeldSubdMesh(SubdMesh& ioMesh, const ObjLoadConfig& inConfig = ObjLoadConfig(), ThreadPool& inThreadPool = ThreadPool::GetDefault());
+
+}
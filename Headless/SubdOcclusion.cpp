@@ -0,0 +1,192 @@
+#include "SubdOcclusion.h"
+#include <cmath>
+
+namespace Headless {
+
+void SoftwareDepthBuffer::Resize(uint32_t inWidth, uint32_t inHeight) {
+    mWidth = inWidth;
+    mHeight = inHeight;
+    mDepth.assign((size_t)inWidth * inHeight, 1.0f);
+}
+
+void SoftwareDepthBuffer::Clear(float inDepth) {
+    std::fill(mDepth.begin(), mDepth.end(), inDepth);
+}
+
+// Calls inFn(x, y, depth) for every pixel centre inside the triangle, depth interpolated
+// linearly in screen space like SV_Position.z.
+template<typename Fn>
+void SoftwareDepthBuffer::ForEachPixel(const float4 inClip[3], Fn&& inFn) const {
+    float2 Screen[3];
+    float Depth[3];
+    for (int i = 0; i < 3; ++i) {
+        if (inClip[i].w <= 0.0f) {
+            return;
+        }
+        float InvW = 1.0f / inClip[i].w;
+        Screen[i] = float2((inClip[i].x * InvW * 0.5f + 0.5f) * mWidth, (0.5f - inClip[i].y * InvW * 0.5f) * mHeight);
+        Depth[i] = inClip[i].z * InvW;
+    }
+    float Area = (Screen[1].x - Screen[0].x) * (Screen[2].y - Screen[0].y) - (Screen[1].y - Screen[0].y) * (Screen[2].x - Screen[0].x);
+    if (std::fabs(Area) < 1e-12f) {
+        return;
+    }
+
+    float MinX = std::min(std::min(Screen[0].x, Screen[1].x), Screen[2].x);
+    float MaxX = std::max(std::max(Screen[0].x, Screen[1].x), Screen[2].x);
+    float MinY = std::min(std::min(Screen[0].y, Screen[1].y), Screen[2].y);
+    float MaxY = std::max(std::max(Screen[0].y, Screen[1].y), Screen[2].y);
+    int X0 = std::max((int)std::ceil(MinX - 0.5f), 0);
+    int X1 = std::min((int)std::floor(MaxX - 0.5f), (int)mWidth - 1);
+    int Y0 = std::max((int)std::ceil(MinY - 0.5f), 0);
+    int Y1 = std::min((int)std::floor(MaxY - 0.5f), (int)mHeight - 1);
+
+    float InvArea = 1.0f / Area;
+    for (int y = Y0; y <= Y1; ++y) {
+        for (int x = X0; x <= X1; ++x) {
+            float2 P(x + 0.5f, y + 0.5f);
+            float B0 = ((Screen[1].x - P.x) * (Screen[2].y - P.y) - (Screen[1].y - P.y) * (Screen[2].x - P.x)) * InvArea;
+            float B1 = ((Screen[2].x - P.x) * (Screen[0].y - P.y) - (Screen[2].y - P.y) * (Screen[0].x - P.x)) * InvArea;
+            float B2 = 1.0f - B0 - B1;
+            if (B0 < 0.0f || B1 < 0.0f || B2 < 0.0f) {
+                continue;
+            }
+            float PixelDepth = B0 * Depth[0] + B1 * Depth[1] + B2 * Depth[2];
+            if (PixelDepth >= 0.0f && PixelDepth <= 1.0f) {
+                inFn((uint32_t)x, (uint32_t)y, PixelDepth);
+            }
+        }
+    }
+}
+
+void SoftwareDepthBuffer::RasterizeTriangle(const float4 inClip[3]) {
+    ForEachPixel(inClip, [&](uint32_t inX, uint32_t inY, float inDepth) {
+        float& Stored = mDepth[(size_t)inY * mWidth + inX];
+        Stored = std::min(Stored, inDepth);
+    });
+}
+
+uint32_t SoftwareDepthBuffer::CountVisiblePixels(const float4 inClip[3], float inBias) const {
+    uint32_t Count = 0;
+    ForEachPixel(inClip, [&](uint32_t inX, uint32_t inY, float inDepth) {
+        Count += inDepth < GetDepth(inX, inY) + inBias ? 1 : 0;
+    });
+    return Count;
+}
+
+// Same child ranges as the HeightBoundsPyramid levels.
+static void GetChildRange(uint32_t inIndex, uint32_t inSize, uint32_t inChildSize, uint32_t& outBegin, uint32_t& outEnd) {
+    outBegin = std::min(2 * inIndex, inChildSize - 1);
+    outEnd = inIndex == inSize - 1 ? inChildSize - 1 : 2 * inIndex + 1;
+}
+
+void HiZPyramid::Build(const float* inDepth, uint32_t inWidth, uint32_t inHeight, ThreadPool& inThreadPool) {
+    mSourceWidth = inWidth;
+    mSourceHeight = inHeight;
+    mLevels.clear();
+    if (inWidth == 0 || inHeight == 0) {
+        return;
+    }
+
+    do {
+        uint32_t Level = (uint32_t)mLevels.size();
+        uint32_t Width = GetWidth(Level);
+        uint32_t Height = GetHeight(Level);
+        uint32_t ChildWidth = Level == 0 ? inWidth : GetWidth(Level - 1);
+        uint32_t ChildHeight = Level == 0 ? inHeight : GetHeight(Level - 1);
+        const float* Child = Level == 0 ? inDepth : mLevels[Level - 1].data();
+        mLevels.emplace_back((size_t)Width * Height);
+        float* Depth = mLevels.back().data();
+
+        inThreadPool.ParallelFor(Height, 16, [&](size_t inBegin, size_t inEnd) {
+            for (uint32_t y = (uint32_t)inBegin; y < (uint32_t)inEnd; ++y) {
+                uint32_t ChildY0, ChildY1;
+                GetChildRange(y, Height, ChildHeight, ChildY0, ChildY1);
+                for (uint32_t x = 0; x < Width; ++x) {
+                    uint32_t ChildX0, ChildX1;
+                    GetChildRange(x, Width, ChildWidth, ChildX0, ChildX1);
+                    float Max = 0.0f;
+                    for (uint32_t j = ChildY0; j <= ChildY1; ++j) {
+                        for (uint32_t i = ChildX0; i <= ChildX1; ++i) {
+                            Max = std::max(Max, Child[(size_t)j * ChildWidth + i]);
+                        }
+                    }
+                    Depth[(size_t)y * Width + x] = Max;
+                }
+            }
+        });
+    } while (GetWidth((uint32_t)mLevels.size() - 1) > 1 || GetHeight((uint32_t)mLevels.size() - 1) > 1);
+}
+
+float HiZPyramid::GetMaxDepth(uint32_t inX0, uint32_t inY0, uint32_t inX1, uint32_t inY1) const {
+    if (mLevels.empty()) {
+        return 1.0f;
+    }
+
+    uint32_t Span = std::max(inX1 - inX0, inY1 - inY0);
+    uint32_t Level = (uint32_t)std::min(std::max(firstbithigh(Span), 0), (int)mLevels.size() - 1);
+    uint32_t Shift = Level + 1;
+    uint32_t Width = GetWidth(Level);
+    uint32_t Height = GetHeight(Level);
+    uint32_t X[2] = { std::min(inX0 >> Shift, Width - 1), std::min(inX1 >> Shift, Width - 1) };
+    uint32_t Y[2] = { std::min(inY0 >> Shift, Height - 1), std::min(inY1 >> Shift, Height - 1) };
+
+    const float* Depth = mLevels[Level].data();
+    float Max = 0.0f;
+    for (uint32_t j = 0; j < 2; ++j) {
+        for (uint32_t i = 0; i < 2; ++i) {
+            Max = std::max(Max, Depth[(size_t)Y[j] * Width + X[i]]);
+        }
+    }
+    return Max;
+}
+
+void SetHiZView(LodKernelConfig& ioConfig, const float4x4& inViewProjMat, uint32_t inWidth, uint32_t inHeight) {
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            ioConfig.HiZViewProj[i][j] = inViewProjMat[i][j];
+        }
+    }
+    ioConfig.HiZSize[0] = inWidth;
+    ioConfig.HiZSize[1] = inHeight;
+    ioConfig.HiZPadding[0] = ioConfig.HiZPadding[1] = 0;
+}
+
+bool HiZOcclusionTest(const LodKernelConfig& inConfig, const HiZPyramid& inHiZ, const float4& inMinPosition, const float4& inMaxPosition) {
+    if (inConfig.HiZSize[0] == 0 || inHiZ.IsEmpty()) {
+        return false;
+    }
+
+    float4x4 ViewProjMat;
+    for (int i = 0; i < 4; ++i) {
+        ViewProjMat[i] = float4(inConfig.HiZViewProj[i][0], inConfig.HiZViewProj[i][1], inConfig.HiZViewProj[i][2], inConfig.HiZViewProj[i][3]);
+    }
+    float2 MinUV(1.0f, 1.0f);
+    float2 MaxUV(0.0f, 0.0f);
+    float MinDepth = 1.0f;
+    for (uint32_t i = 0; i < 8; ++i) {
+        float4 Corner((i & 1) ? inMaxPosition.x : inMinPosition.x, (i & 2) ? inMaxPosition.y : inMinPosition.y, (i & 4) ? inMaxPosition.z : inMinPosition.z, 1.0f);
+        float4 Clip = mul(Corner, ViewProjMat);
+        if (Clip.w <= 0.0f) {
+            return false;
+        }
+        float2 UV(Clip.x / Clip.w * 0.5f + 0.5f, 0.5f - Clip.y / Clip.w * 0.5f);
+        MinUV = float2(std::min(MinUV.x, UV.x), std::min(MinUV.y, UV.y));
+        MaxUV = float2(std::max(MaxUV.x, UV.x), std::max(MaxUV.y, UV.y));
+        MinDepth = std::min(MinDepth, Clip.z / Clip.w);
+    }
+    if (MaxUV.x < 0.0f || MaxUV.y < 0.0f || MinUV.x > 1.0f || MinUV.y > 1.0f) {
+        return false;
+    }
+
+    // Depth texels whose centres the rectangle can reach.
+    float MaxX = (float)(inConfig.HiZSize[0] - 1);
+    float MaxY = (float)(inConfig.HiZSize[1] - 1);
+    uint32_t X0 = (uint32_t)std::min(std::max(std::floor(MinUV.x * inConfig.HiZSize[0]), 0.0f), MaxX);
+    uint32_t Y0 = (uint32_t)std::min(std::max(std::floor(MinUV.y * inConfig.HiZSize[1]), 0.0f), MaxY);
+    uint32_t X1 = (uint32_t)std::min(std::max(std::floor(MaxUV.x * inConfig.HiZSize[0]), 0.0f), MaxX);
+    uint32_t Y1 = (uint32_t)std::min(std::max(std::floor(MaxUV.y * inConfig.HiZSize[1]), 0.0f), MaxY);
+    return MinDepth > inHiZ.GetMaxDepth(X0, Y0, X1, Y1);
+}
+
+}
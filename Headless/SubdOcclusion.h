@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include "SubdMath.h"
+#include "SubdShared.h"
+#include "ThreadPool.h"
+
+namespace Headless {
+
+// Coarse software depth buffer standing in for the sample's depth target: [0,1] depth of
+// gScene.camera.viewProjMat, cleared to 1 and written with the LessEnableDepth test. Pixel
+// (x, y) covers uv [x, x + 1] / Width from the top-left, like the viewport, and a triangle
+// covers the pixels whose centre it contains.
+class SoftwareDepthBuffer {
+public:
+    void Resize(uint32_t inWidth, uint32_t inHeight);
+    void Clear(float inDepth = 1.0f);
+
+    uint32_t GetWidth() const { return mWidth; }
+    uint32_t GetHeight() const { return mHeight; }
+    const float* GetDepth() const { return mDepth.data(); }
+    float GetDepth(uint32_t inX, uint32_t inY) const { return mDepth[(size_t)inY * mWidth + inX]; }
+
+    // Clip space corners. Triangles with a corner behind the camera (w <= 0) are skipped,
+    // which only leaves the buffer further than the real one, and fragments outside the
+    // [0, 1] depth range are clipped per pixel.
+    void RasterizeTriangle(const float4 inClip[3]);
+    // Pixels of the triangle that would pass the depth test against the buffer, with
+    // inBias added to the stored depth.
+    uint32_t CountVisiblePixels(const float4 inClip[3], float inBias = 0.0f) const;
+
+private:
+    template<typename Fn>
+    void ForEachPixel(const float4 inClip[3], Fn&& inFn) const;
+
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    std::vector<float> mDepth;
+};
+
+// Max depth pyramid of a depth buffer, the HiZTexture LodKernel tests leaves against. Laid
+// out like HeightBoundsPyramid: level i is depth mip i + 1, and on odd sizes the last texel
+// of a row or column also covers the leftover one.
+class HiZPyramid {
+public:
+    void Build(const float* inDepth, uint32_t inWidth, uint32_t inHeight, ThreadPool& inThreadPool = ThreadPool::GetDefault());
+
+    bool IsEmpty() const { return mLevels.empty(); }
+    uint32_t GetSourceWidth() const { return mSourceWidth; }
+    uint32_t GetSourceHeight() const { return mSourceHeight; }
+    uint32_t GetLevelCount() const { return (uint32_t)mLevels.size(); }
+    uint32_t GetWidth(uint32_t inLevel) const { return std::max(mSourceWidth >> (inLevel + 1), 1u); }
+    uint32_t GetHeight(uint32_t inLevel) const { return std::max(mSourceHeight >> (inLevel + 1), 1u); }
+    const float* GetLevel(uint32_t inLevel) const { return mLevels[inLevel].data(); }
+
+    // Largest depth stored over the source texels [inX0, inX1] x [inY0, inY1]: 2x2 texels of
+    // the finest level whose texels cover the span.
+    float GetMaxDepth(uint32_t inX0, uint32_t inY0, uint32_t inX1, uint32_t inY1) const;
+
+private:
+    uint32_t mSourceWidth = 0;
+    uint32_t mSourceHeight = 0;
+    std::vector<std::vector<float>> mLevels;
+};
+
+// Fills LodKernelConfig::HiZViewProj / HiZSize: the view-projection matrix the depth buffer
+// was rendered with and its size. A zero width disables HiZOcclusionTest.
+void SetHiZView(LodKernelConfig& ioConfig, const float4x4& inViewProjMat, uint32_t inWidth, uint32_t inHeight);
+
+// True when the box lies behind the depth in inHiZ everywhere it projects to. Boxes that
+// cross the camera plane are never occluded. Mirrors HiZOcclusionTest in Data/Utils.hlsl.
+bool HiZOcclusionTest(const LodKernelConfig& inConfig, const HiZPyramid& inHiZ, const float4& inMinPosition, const float4& inMaxPosition);
+
+}
@@ -0,0 +1,140 @@
+#include "SubdRoughness.h"
+#include <cmath>
+#include <cstdlib>
+
+namespace Headless {
+
+// Same child ranges as the HeightBoundsPyramid levels.
+static void GetChildRange(uint32_t inIndex, uint32_t inSize, uint32_t inChildSize, uint32_t& outBegin, uint32_t& outEnd) {
+    outBegin = std::min(2 * inIndex, inChildSize - 1);
+    outEnd = inIndex == inSize - 1 ? inChildSize - 1 : 2 * inIndex + 1;
+}
+
+// Bilinear sampling anywhere over texels [ioBegin, ioEnd] also reads the texel either side.
+static void DilateTexelRange(uint32_t inSize, uint32_t& ioBegin, uint32_t& ioEnd) {
+    ioBegin = ioBegin > 0 ? ioBegin - 1 : 0;
+    ioEnd = std::min(ioEnd + 1, inSize - 1);
+}
+
+// |h(p - d) + h(p + d) - 2 h(p)| at the largest of the four directions; the diagonal steps
+// are sqrt(2) texels long, hence the halving.
+static uint16_t GetTexelCurvature(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight, uint32_t inX, uint32_t inY) {
+    auto Height = [&](int inDx, int inDy) {
+        uint32_t X = (uint32_t)std::min(std::max((int)inX + inDx, 0), (int)inWidth - 1);
+        uint32_t Y = (uint32_t)std::min(std::max((int)inY + inDy, 0), (int)inHeight - 1);
+        return (int)inHeights[(size_t)Y * inWidth + X];
+    };
+    int Center = 2 * Height(0, 0);
+    int AlongX = std::abs(Height(-1, 0) + Height(1, 0) - Center);
+    int AlongY = std::abs(Height(0, -1) + Height(0, 1) - Center);
+    int Diagonal = std::abs(Height(-1, -1) + Height(1, 1) - Center) / 2;
+    int AntiDiagonal = std::abs(Height(1, -1) + Height(-1, 1) - Center) / 2;
+    return (uint16_t)std::min(std::max(std::max(AlongX, AlongY), std::max(Diagonal, AntiDiagonal)), 0xffff);
+}
+
+void RoughnessPyramid::Build(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight, ThreadPool& inThreadPool) {
+    mSourceWidth = inWidth;
+    mSourceHeight = inHeight;
+    mLevels.clear();
+    if (inWidth == 0 || inHeight == 0) {
+        return;
+    }
+
+    std::vector<uint16_t> Curvatures((size_t)inWidth * inHeight);
+    inThreadPool.ParallelFor(inHeight, 16, [&](size_t inBegin, size_t inEnd) {
+        for (uint32_t y = (uint32_t)inBegin; y < (uint32_t)inEnd; ++y) {
+            for (uint32_t x = 0; x < inWidth; ++x) {
+                Curvatures[(size_t)y * inWidth + x] = GetTexelCurvature(inHeights, inWidth, inHeight, x, y);
+            }
+        }
+    });
+
+    do {
+        uint32_t Level = (uint32_t)mLevels.size();
+        uint32_t Width = GetWidth(Level);
+        uint32_t Height = GetHeight(Level);
+        uint32_t ChildWidth = Level == 0 ? inWidth : GetWidth(Level - 1);
+        uint32_t ChildHeight = Level == 0 ? inHeight : GetHeight(Level - 1);
+        const uint16_t* Child = Level == 0 ? Curvatures.data() : mLevels[Level - 1].data();
+        mLevels.emplace_back((size_t)Width * Height);
+        uint16_t* Roughness = mLevels.back().data();
+
+        inThreadPool.ParallelFor(Height, 16, [&](size_t inBegin, size_t inEnd) {
+            for (uint32_t y = (uint32_t)inBegin; y < (uint32_t)inEnd; ++y) {
+                uint32_t ChildY0, ChildY1;
+                GetChildRange(y, Height, ChildHeight, ChildY0, ChildY1);
+                if (Level == 0) {
+                    DilateTexelRange(inHeight, ChildY0, ChildY1);
+                }
+                for (uint32_t x = 0; x < Width; ++x) {
+                    uint32_t ChildX0, ChildX1;
+                    GetChildRange(x, Width, ChildWidth, ChildX0, ChildX1);
+                    if (Level == 0) {
+                        DilateTexelRange(inWidth, ChildX0, ChildX1);
+                    }
+                    uint16_t Max = 0;
+                    for (uint32_t j = ChildY0; j <= ChildY1; ++j) {
+                        for (uint32_t i = ChildX0; i <= ChildX1; ++i) {
+                            Max = std::max(Max, Child[(size_t)j * ChildWidth + i]);
+                        }
+                    }
+                    Roughness[(size_t)y * Width + x] = Max;
+                }
+            }
+        });
+    } while (GetWidth((uint32_t)mLevels.size() - 1) > 1 || GetHeight((uint32_t)mLevels.size() - 1) > 1);
+}
+
+std::vector<uint16_t> RoughnessPyramid::GetMipChain() const {
+    std::vector<uint16_t> Chain;
+    for (const std::vector<uint16_t>& Level : mLevels) {
+        Chain.insert(Chain.end(), Level.begin(), Level.end());
+    }
+    return Chain;
+}
+
+float RoughnessPyramid::GetRoughness(const float2& inMinUV, const float2& inMaxUV) const {
+    if (mLevels.empty()) {
+        return 0.0f;
+    }
+
+    float MaxX = (float)(mSourceWidth - 1);
+    float MaxY = (float)(mSourceHeight - 1);
+    uint32_t X0 = (uint32_t)std::min(std::max(std::floor(inMinUV.x * mSourceWidth), 0.0f), MaxX);
+    uint32_t Y0 = (uint32_t)std::min(std::max(std::floor(inMinUV.y * mSourceHeight), 0.0f), MaxY);
+    uint32_t X1 = std::max((uint32_t)std::min(std::max(std::ceil(inMaxUV.x * mSourceWidth) - 1.0f, 0.0f), MaxX), X0);
+    uint32_t Y1 = std::max((uint32_t)std::min(std::max(std::ceil(inMaxUV.y * mSourceHeight) - 1.0f, 0.0f), MaxY), Y0);
+
+    // Read at the level whose texels are a quarter to a half of the longer side, at most 3 x 3
+    // of them. A leaf of the quad covers an aligned power-of-two square or 2:1 block of texels
+    // and reads the 2 x 2 or 2 x 1 that tile it exactly. The 2 x 2 of GetHeightBounds, at
+    // twice the size, would hand a cliff's curvature to the smooth leaves beside it.
+    uint32_t Span = std::max(X1 - X0, Y1 - Y0);
+    uint32_t Level = (uint32_t)std::min(std::max(firstbithigh(Span) - 1, 0), (int)mLevels.size() - 1);
+    uint32_t Shift = Level + 1;
+    uint32_t Width = GetWidth(Level);
+    uint32_t Height = GetHeight(Level);
+    const uint16_t* Roughness = mLevels[Level].data();
+    uint16_t Max = 0;
+    for (uint32_t y = std::min(Y0 >> Shift, Height - 1); y <= std::min(Y1 >> Shift, Height - 1); ++y) {
+        for (uint32_t x = std::min(X0 >> Shift, Width - 1); x <= std::min(X1 >> Shift, Width - 1); ++x) {
+            Max = std::max(Max, Roughness[(size_t)y * Width + x]);
+        }
+    }
+    return (float)Max / 65535.0f;
+}
+
+// A leaf of key depth k on the quad has legs of 2^(1 - k/2); its patch triangles, inPatchLevel
+// bisections further down, have legs a with a^2 = 4 * 2^-(k + inPatchLevel). Linear
+// interpolation over them misses a surface of curvature c by up to c a^2 / 4, and a heightmap
+// texel is 2 / Width wide, so a normalized roughness r is r * DisplacementFactor * Width^2 / 4
+// in world units: the error is r * Scale * 2^-k with Scale below, held under inScreenError
+// pixels of 2 d tan(FovX / 2) / ScreenResolutionWidth world units each.
+void SetRoughnessLod(LodKernelConfig& ioConfig, float inScreenError, float inMaxLodOffset, uint32_t inHeightMapWidth, uint32_t inPatchLevel) {
+    float Width = (float)inHeightMapWidth;
+    ioConfig.RoughnessLodScale = ioConfig.DisplacementFactor * Width * Width / (4.0f * std::max(inScreenError, 1e-3f) * std::ldexp(1.0f, (int)inPatchLevel));
+    ioConfig.MaxLodOffset = std::max(inMaxLodOffset, 0.0f);
+    ioConfig.RoughnessPadding[0] = ioConfig.RoughnessPadding[1] = 0;
+}
+
+}
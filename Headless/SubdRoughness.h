@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include "SubdMath.h"
+#include "SubdShared.h"
+#include "ThreadPool.h"
+
+namespace Headless {
+
+// Max curvature pyramid of an R16 heightmap, uploaded as the R16Unorm RoughnessTexture that
+// ROUGHNESS_LOD reads. The curvature of a heightmap texel is the largest absolute second
+// difference of the heights through it, along x, y and both diagonals (per texel squared,
+// borders clamped). Laid out like HeightBoundsPyramid: level i is heightmap mip i + 1 and
+// holds the largest curvature of the texels under it and of the ring of texels around them,
+// which bilinear sampling inside it also reads.
+class RoughnessPyramid {
+public:
+    void Build(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight, ThreadPool& inThreadPool = ThreadPool::GetDefault());
+
+    bool IsEmpty() const { return mLevels.empty(); }
+    uint32_t GetSourceWidth() const { return mSourceWidth; }
+    uint32_t GetSourceHeight() const { return mSourceHeight; }
+    uint32_t GetLevelCount() const { return (uint32_t)mLevels.size(); }
+    uint32_t GetWidth(uint32_t inLevel) const { return std::max(mSourceWidth >> (inLevel + 1), 1u); }
+    uint32_t GetHeight(uint32_t inLevel) const { return std::max(mSourceHeight >> (inLevel + 1), 1u); }
+    const uint16_t* GetLevel(uint32_t inLevel) const { return mLevels[inLevel].data(); }
+    std::vector<uint16_t> GetMipChain() const;
+
+    // Largest normalized curvature of the heightmap texels bilinear sampling reads in the UV
+    // rectangle [inMinUV, inMaxUV], from at most 3 x 3 texels of one level. Mirrors
+    // GetRoughness in Data/Utils.hlsl.
+    float GetRoughness(const float2& inMinUV, const float2& inMaxUV) const;
+
+private:
+    uint32_t mSourceWidth = 0;
+    uint32_t mSourceHeight = 0;
+    std::vector<std::vector<uint16_t>> mLevels;
+};
+
+// Fills LodKernelConfig::RoughnessLodScale / MaxLodOffset for ROUGHNESS_LOD: leaves split
+// until the patch triangles of inPatchLevel stay within inScreenError pixels of the
+// heightmap they displace, but end at most inMaxLodOffset levels away from the distance lod
+// either way. ioConfig.DisplacementFactor must already be set.
+void SetRoughnessLod(LodKernelConfig& ioConfig, float inScreenError, float inMaxLodOffset, uint32_t inHeightMapWidth, uint32_t inPatchLevel);
+
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+
+// Structures shared between the Falcor sample, the shaders and the headless engine.
+// Layouts mirror Data/Utils.hlsl and must stay in sync with it.
+
+// MULTI_VIEW: views LodKernel takes the lod over and culls for, gScene.camera included.
+const uint32_t MaxLodViewCount = 4;
+
+struct PrimitiveData {
+    uint32_t PrimitiveIndex;
+    uint32_t SubdBinaryKey;
+};
+
+struct LodKernelConfig {
+    float FovX;
+    float TargetPixelSize;
+    uint32_t ScreenResolutionWidth;
+    float DisplacementFactor;
+    // (Normal, Intercept) of the six planes of gScene.camera.viewProjMat, see
+    // Headless::SetFrustumPlanes. Set once per frame instead of in every LodKernel thread.
+    float FrustumPlanes[6][4];
+    // OCCLUSION_CULLING: rows of the view-projection matrix HiZTexture was rendered with (the
+    // previous frame's) and the size of that depth buffer; a zero width turns the test off.
+    // See Headless::SetHiZView.
+    float HiZViewProj[4][4];
+    uint32_t HiZSize[2];
+    uint32_t HiZPadding[2];
+    // ROUGHNESS_LOD: world error scale of the heightmap curvature under a leaf, and how many
+    // levels the lod may move away from the distance lod. See Headless::SetRoughnessLod.
+    float RoughnessLodScale;
+    float MaxLodOffset;
+    uint32_t RoughnessPadding[2];
+    // INCREMENTAL_LOD: how far the camera moved since the last frame, +inf when the lod
+    // parameters changed. See Headless::LodTravelTracker.
+    float CameraTravel;
+    uint32_t TravelPadding[3];
+    // MULTI_VIEW: views 1 .. ViewCount - 1, gScene.camera being view 0. Per view, its
+    // position with the ratio of its pixel footprint to view 0's in w (its distances times w
+    // are view 0 distances of the same lod), and its frustum planes. See
+    // Headless::SetLodViews.
+    uint32_t ViewCount;
+    uint32_t ViewPadding[3];
+    float ViewPosW[MaxLodViewCount - 1][4];
+    float ViewFrustumPlanes[MaxLodViewCount - 1][6][4];
+};
+
+// INCREMENTAL_LOD state kept per key alongside SubdIn / SubdOut: the distance the camera can
+// still move before the key's update op could change (at or below zero the key is evaluated
+// again), and the box LodKernel culls it with.
+struct LeafLodState {
+    float Slack;
+    float BoxMin[3];
+    float BoxMax[3];
+};
+
+struct RenderKernelConfig {
+    float DisplacementFactor;
+    float SlopeScale;
+};
+
+// Byte offsets 0/4/8 of BufferCounter, then the in-frame convergence state at 12/16/20:
+// keys the current pass split or merged, passes run this frame, and whether a pass
+// changed nothing (the remaining passes of the frame are then dispatched empty).
+// 24/28 count the splits and merged pairs of all passes of the frame, for SubdStats.
+// 32 counts the leaves of the current pass that passed the frustum test but were occluded,
+// and 36 holds that count for the pass that filled SubdCulledOut last. 40 / 44 do the same
+// for the keys INCREMENTAL_LOD sent to LodDirtyKernel. From 48, the leaves of the current
+// pass each MULTI_VIEW view from 1 on keeps, moved to its IndirectDrawBuffer record.
+struct SubdBufferCounter {
+    uint32_t CulledCount = 0;
+    uint32_t SubdOutCount = 0;
+    uint32_t SubdInCount = 0;
+    uint32_t ChangeCount = 0;
+    uint32_t ConvergenceIterations = 0;
+    uint32_t Converged = 0;
+    uint32_t SplitCount = 0;
+    uint32_t MergeCount = 0;
+    uint32_t OccludedCount = 0;
+    uint32_t LastOccludedCount = 0;
+    uint32_t DirtyCount = 0;
+    uint32_t LastDirtyCount = 0;
+    uint32_t ViewCulledCount[MaxLodViewCount - 1] = {};
+};
+
+// Same layout as D3D12_DRAW_INDEXED_ARGUMENTS / D3D12_DISPATCH_ARGUMENTS.
+struct IndirectDrawArgs {
+    uint32_t IndexCountPerInstance = 0;
+    uint32_t InstanceCount = 0;
+    uint32_t StartIndexLocation = 0;
+    int32_t BaseVertexLocation = 0;
+    uint32_t StartInstanceLocation = 0;
+};
+
+// One SubdCulledOut leaf of LEAF_VERTEX_PREPASS: its corners as Subd writes them and the
+// slope-map normal at each corner, normalize(float3(NormalXY, 1)).
+struct LeafVertexData {
+    float Position[3][3];
+    float NormalXY[3][2];
+};
+
+struct IndirectDispatchArgs {
+    uint32_t ThreadGroupCountX = 1;
+    uint32_t ThreadGroupCountY = 1;
+    uint32_t ThreadGroupCountZ = 1;
+};
+
+const uint32_t LodKernelGroupSize = 32;
+const uint32_t LeafVertexGroupSize = 64;
+// Thread group size of the DETERMINISTIC_COMPACTION scan kernels (COMPACTION_BLOCK_SIZE).
+const uint32_t CompactionBlockSize = 1024;
+// Leaf sort ("Sort Leaves"): keys per LeafSortScatterKernel group (LEAF_SORT_BLOCK_SIZE),
+// Morton key bits of a leaf centroid, and bits sorted per radix pass.
+const uint32_t LeafSortBlockSize = 1024;
+const uint32_t LeafSortKeyBits = 24;
+const uint32_t LeafSortRadixBits = 8;
+// Slots of the CBT_STORAGE bitfield are 2^CbtMaxDepth: 12 MB of tree and bitfields, and
+// keys down to depth CbtMaxDepth - 1 on the two-triangle quad.
+const uint32_t CbtMaxDepth = 25;
@@ -0,0 +1,332 @@
+#include "SubdSlopeFormat.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace Headless {
+
+static const char* const SlopeFormatNames[SlopeFormatCount] = {
+    "RG32Float",
+    "RG16Float",
+    "RG16Snorm",
+    "BC5Snorm",
+    "HeightMap",
+};
+
+const char* GetSlopeFormatName(SlopeFormat inFormat) {
+    return (uint32_t)inFormat < SlopeFormatCount ? SlopeFormatNames[(uint32_t)inFormat] : "";
+}
+
+double GetSlopeFormatTexelBytes(SlopeFormat inFormat) {
+    switch (inFormat) {
+    case SlopeFormat::RG32Float: return 8.0;
+    case SlopeFormat::RG16Float: return 4.0;
+    case SlopeFormat::RG16Snorm: return 4.0;
+    case SlopeFormat::BC5Snorm: return 1.0;
+    default: return 0.0;
+    }
+}
+
+uint16_t FloatToHalf(float inValue) {
+    uint32_t Bits;
+    memcpy(&Bits, &inValue, sizeof(Bits));
+    uint16_t Sign = (uint16_t)((Bits >> 16) & 0x8000u);
+    uint32_t Abs = Bits & 0x7fffffffu;
+    if (Abs >= 0x7f800000u) {
+        return Sign | 0x7c00u | (Abs > 0x7f800000u ? 0x200u : 0u);
+    }
+    // 65520 and up round to infinity.
+    if (Abs >= 0x477ff000u) {
+        return Sign | 0x7c00u;
+    }
+    // Below 2^-14 the half is denormal: a count of 2^-24.
+    if (Abs < 0x38800000u) {
+        float Value;
+        memcpy(&Value, &Abs, sizeof(Value));
+        return Sign | (uint16_t)std::nearbyint(Value * 16777216.0f);
+    }
+    // Rebias the exponent and round the mantissa to nearest even.
+    uint32_t Rounded = Abs + 0xfffu + ((Abs >> 13) & 1u);
+    return Sign | (uint16_t)((Rounded - 0x38000000u) >> 13);
+}
+
+float HalfToFloat(uint16_t inValue) {
+    uint32_t Sign = (uint32_t)(inValue & 0x8000u) << 16;
+    uint32_t Exponent = (inValue >> 10) & 0x1fu;
+    uint32_t Mantissa = inValue & 0x3ffu;
+    if (Exponent == 0) {
+        float Value = std::ldexp((float)Mantissa, -24);
+        return Sign ? -Value : Value;
+    }
+    uint32_t Bits = Sign | (Exponent == 31 ? 0x7f800000u : (Exponent + 112u) << 23) | (Mantissa << 13);
+    float Value;
+    memcpy(&Value, &Bits, sizeof(Value));
+    return Value;
+}
+
+// The eight values of a BC4 Snorm block. With e0 > e1, e0, e1 and six steps between; else
+// e0, e1, four steps, -1 and 1.
+static void GetBc4SnormPalette(int inEndpoint0, int inEndpoint1, float outPalette[8]) {
+    float Value0 = std::max(inEndpoint0 / 127.0f, -1.0f);
+    float Value1 = std::max(inEndpoint1 / 127.0f, -1.0f);
+    outPalette[0] = Value0;
+    outPalette[1] = Value1;
+    if (inEndpoint0 > inEndpoint1) {
+        for (int i = 1; i <= 6; ++i) {
+            outPalette[1 + i] = ((7 - i) * Value0 + i * Value1) / 7.0f;
+        }
+    }
+    else {
+        for (int i = 1; i <= 4; ++i) {
+            outPalette[1 + i] = ((5 - i) * Value0 + i * Value1) / 5.0f;
+        }
+        outPalette[6] = -1.0f;
+        outPalette[7] = 1.0f;
+    }
+}
+
+// Nearest palette entry of each value in the eight-value mode, where the palette is evenly
+// spaced from e0 (index 0) through the six steps (indices 2 to 7) to e1 (index 1).
+static float GetBc4Indices(const float inValues[16], const float inPalette[8], uint64_t& outIndices) {
+    const uint32_t StepIndices[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+    float Range = inPalette[1] - inPalette[0];
+    float Error = 0.0f;
+    outIndices = 0;
+    for (int i = 0; i < 16; ++i) {
+        float Step = Range != 0.0f ? clamp((inValues[i] - inPalette[0]) / Range, 0.0f, 1.0f) * 7.0f : 0.0f;
+        uint32_t Index = StepIndices[(uint32_t)(Step + 0.5f)];
+        outIndices |= (uint64_t)Index << (3 * i);
+        float Difference = inValues[i] - inPalette[Index];
+        Error += Difference * Difference;
+    }
+    return Error;
+}
+
+void EncodeBc4SnormBlock(const float inValues[16], uint8_t outBlock[8]) {
+    float Min = inValues[0];
+    float Max = inValues[0];
+    for (int i = 1; i < 16; ++i) {
+        Min = std::min(Min, inValues[i]);
+        Max = std::max(Max, inValues[i]);
+    }
+    // The eight-value mode over the range, each endpoint nudged one step either way.
+    int High = (int)std::lround(clamp(Max, -1.0f, 1.0f) * 127.0f);
+    int Low = (int)std::lround(clamp(Min, -1.0f, 1.0f) * 127.0f);
+    float BestError = std::numeric_limits<float>::infinity();
+    uint64_t BestIndices = 0;
+    int BestHigh = 0;
+    int BestLow = 0;
+    for (int dHigh = -1; dHigh <= 1; ++dHigh) {
+        for (int dLow = -1; dLow <= 1; ++dLow) {
+            int Endpoint0 = std::min(std::max(High + dHigh, -127), 127);
+            int Endpoint1 = std::min(std::max(Low + dLow, -127), 127);
+            if (Endpoint0 <= Endpoint1) {
+                // A flat block: any pair one step apart around the value.
+                Endpoint0 = std::max(Endpoint1 + 1, -126);
+                Endpoint1 = Endpoint0 - 1;
+            }
+            float Palette[8];
+            GetBc4SnormPalette(Endpoint0, Endpoint1, Palette);
+            uint64_t Indices;
+            float Error = GetBc4Indices(inValues, Palette, Indices);
+            if (Error < BestError) {
+                BestError = Error;
+                BestIndices = Indices;
+                BestHigh = Endpoint0;
+                BestLow = Endpoint1;
+            }
+        }
+    }
+    outBlock[0] = (uint8_t)(int8_t)BestHigh;
+    outBlock[1] = (uint8_t)(int8_t)BestLow;
+    for (int i = 0; i < 6; ++i) {
+        outBlock[2 + i] = (uint8_t)(BestIndices >> (8 * i));
+    }
+}
+
+void DecodeBc4SnormBlock(const uint8_t inBlock[8], float outValues[16]) {
+    float Palette[8];
+    GetBc4SnormPalette((int8_t)inBlock[0], (int8_t)inBlock[1], Palette);
+    uint64_t Indices = 0;
+    for (int i = 0; i < 6; ++i) {
+        Indices |= (uint64_t)inBlock[2 + i] << (8 * i);
+    }
+    for (int i = 0; i < 16; ++i) {
+        outValues[i] = Palette[(Indices >> (3 * i)) & 7u];
+    }
+}
+
+// Largest slope of the map, what RG16Snorm and BC5Snorm divide by; 1 for the other formats.
+static float GetSlopeScale(const float* inSlopes, uint32_t inWidth, uint32_t inHeight, SlopeFormat inFormat) {
+    if (inFormat != SlopeFormat::RG16Snorm && inFormat != SlopeFormat::BC5Snorm) {
+        return 1.0f;
+    }
+    float MaxSlope = 0.0f;
+    for (size_t i = 0; i < (size_t)inWidth * inHeight * 2; ++i) {
+        MaxSlope = std::max(MaxSlope, std::fabs(inSlopes[i]));
+    }
+    return MaxSlope > 0.0f ? MaxSlope : 1.0f;
+}
+
+static EncodedSlopeMap EncodeSlopeMap(const float* inSlopes, uint32_t inWidth, uint32_t inHeight, SlopeFormat inFormat, float inScale, ThreadPool& inThreadPool) {
+    EncodedSlopeMap SlopeMap;
+    SlopeMap.Format = inFormat;
+    SlopeMap.Width = inWidth;
+    SlopeMap.Height = inHeight;
+    SlopeMap.Scale = inScale;
+    size_t ValueCount = (size_t)inWidth * inHeight * 2;
+    float InverseScale = 1.0f / SlopeMap.Scale;
+
+    switch (inFormat) {
+    case SlopeFormat::RG32Float:
+        SlopeMap.Data.resize(ValueCount * sizeof(float));
+        memcpy(SlopeMap.Data.data(), inSlopes, SlopeMap.Data.size());
+        break;
+    case SlopeFormat::RG16Float:
+    case SlopeFormat::RG16Snorm: {
+        SlopeMap.Data.resize(ValueCount * sizeof(uint16_t));
+        uint16_t* Values = (uint16_t*)SlopeMap.Data.data();
+        inThreadPool.ParallelFor(inHeight, 16, [&](size_t inRowBegin, size_t inRowEnd) {
+            for (size_t i = inRowBegin * inWidth * 2; i < inRowEnd * inWidth * 2; ++i) {
+                Values[i] = inFormat == SlopeFormat::RG16Float ? FloatToHalf(inSlopes[i])
+                    : (uint16_t)(int16_t)std::lround(clamp(inSlopes[i] * InverseScale, -1.0f, 1.0f) * 32767.0f);
+            }
+        });
+        break;
+    }
+    case SlopeFormat::BC5Snorm: {
+        // Texels past the edge of a partial block repeat the last row and column.
+        uint32_t BlocksX = (inWidth + 3) / 4;
+        uint32_t BlocksY = (inHeight + 3) / 4;
+        SlopeMap.Data.resize((size_t)BlocksX * BlocksY * 16);
+        inThreadPool.ParallelFor(BlocksY, 4, [&](size_t inBlockRowBegin, size_t inBlockRowEnd) {
+            for (size_t BlockY = inBlockRowBegin; BlockY < inBlockRowEnd; ++BlockY) {
+                for (uint32_t BlockX = 0; BlockX < BlocksX; ++BlockX) {
+                    float Values[2][16];
+                    for (uint32_t i = 0; i < 16; ++i) {
+                        uint32_t x = std::min(BlockX * 4 + (i & 3u), inWidth - 1);
+                        uint32_t y = std::min((uint32_t)BlockY * 4 + (i >> 2), inHeight - 1);
+                        const float* Texel = inSlopes + ((size_t)y * inWidth + x) * 2;
+                        Values[0][i] = Texel[0] * InverseScale;
+                        Values[1][i] = Texel[1] * InverseScale;
+                    }
+                    uint8_t* Block = &SlopeMap.Data[(BlockY * BlocksX + BlockX) * 16];
+                    EncodeBc4SnormBlock(Values[0], Block);
+                    EncodeBc4SnormBlock(Values[1], Block + 8);
+                }
+            }
+        });
+        break;
+    }
+    default:
+        break;
+    }
+    return SlopeMap;
+}
+
+EncodedSlopeMap EncodeSlopeMap(const float* inSlopes, uint32_t inWidth, uint32_t inHeight, SlopeFormat inFormat, ThreadPool& inThreadPool) {
+    return EncodeSlopeMap(inSlopes, inWidth, inHeight, inFormat, GetSlopeScale(inSlopes, inWidth, inHeight, inFormat), inThreadPool);
+}
+
+std::vector<EncodedSlopeMap> EncodeSlopeMipChain(const float* inSlopes, uint32_t inWidth, uint32_t inHeight, SlopeFormat inFormat, ThreadPool& inThreadPool) {
+    std::vector<EncodedSlopeMap> Chain;
+    if (inFormat == SlopeFormat::HeightMap || inWidth == 0 || inHeight == 0) {
+        return Chain;
+    }
+    float Scale = GetSlopeScale(inSlopes, inWidth, inHeight, inFormat);
+    Chain.push_back(EncodeSlopeMap(inSlopes, inWidth, inHeight, inFormat, Scale, inThreadPool));
+
+    std::vector<float> Level(inSlopes, inSlopes + (size_t)inWidth * inHeight * 2);
+    std::vector<float> Mip;
+    uint32_t Width = inWidth;
+    uint32_t Height = inHeight;
+    while (Width > 1 || Height > 1) {
+        uint32_t MipWidth = std::max(Width / 2, 1u);
+        uint32_t MipHeight = std::max(Height / 2, 1u);
+        Mip.resize((size_t)MipWidth * MipHeight * 2);
+        inThreadPool.ParallelFor(MipHeight, 16, [&](size_t inRowBegin, size_t inRowEnd) {
+            for (uint32_t y = (uint32_t)inRowBegin; y < (uint32_t)inRowEnd; ++y) {
+                uint32_t Y[2] = { std::min(2 * y, Height - 1), std::min(2 * y + 1, Height - 1) };
+                for (uint32_t x = 0; x < MipWidth; ++x) {
+                    uint32_t X[2] = { std::min(2 * x, Width - 1), std::min(2 * x + 1, Width - 1) };
+                    for (uint32_t c = 0; c < 2; ++c) {
+                        float Sum = 0.0f;
+                        for (uint32_t j = 0; j < 2; ++j) {
+                            for (uint32_t i = 0; i < 2; ++i) {
+                                Sum += Level[((size_t)Y[j] * Width + X[i]) * 2 + c];
+                            }
+                        }
+                        Mip[((size_t)y * MipWidth + x) * 2 + c] = Sum * 0.25f;
+                    }
+                }
+            }
+        });
+        Level.swap(Mip);
+        Width = MipWidth;
+        Height = MipHeight;
+        Chain.push_back(EncodeSlopeMap(Level.data(), Width, Height, inFormat, Scale, inThreadPool));
+    }
+    return Chain;
+}
+
+SubdTexture DecodeSlopeMap(const EncodedSlopeMap& inSlopeMap) {
+    SubdTexture SlopeMap;
+    if (inSlopeMap.Format == SlopeFormat::HeightMap) {
+        return SlopeMap;
+    }
+    SlopeMap.Width = inSlopeMap.Width;
+    SlopeMap.Height = inSlopeMap.Height;
+    SlopeMap.ChannelCount = 2;
+    size_t ValueCount = (size_t)inSlopeMap.Width * inSlopeMap.Height * 2;
+    SlopeMap.Texels.resize(ValueCount);
+    switch (inSlopeMap.Format) {
+    case SlopeFormat::RG32Float:
+        memcpy(SlopeMap.Texels.data(), inSlopeMap.Data.data(), ValueCount * sizeof(float));
+        break;
+    case SlopeFormat::RG16Float:
+    case SlopeFormat::RG16Snorm: {
+        const uint16_t* Values = (const uint16_t*)inSlopeMap.Data.data();
+        for (size_t i = 0; i < ValueCount; ++i) {
+            SlopeMap.Texels[i] = inSlopeMap.Format == SlopeFormat::RG16Float ? HalfToFloat(Values[i])
+                : std::max((int16_t)Values[i] / 32767.0f, -1.0f) * inSlopeMap.Scale;
+        }
+        break;
+    }
+    case SlopeFormat::BC5Snorm: {
+        uint32_t BlocksX = (inSlopeMap.Width + 3) / 4;
+        uint32_t BlocksY = (inSlopeMap.Height + 3) / 4;
+        for (uint32_t BlockY = 0; BlockY < BlocksY; ++BlockY) {
+            for (uint32_t BlockX = 0; BlockX < BlocksX; ++BlockX) {
+                const uint8_t* Block = &inSlopeMap.Data[((size_t)BlockY * BlocksX + BlockX) * 16];
+                float Values[2][16];
+                DecodeBc4SnormBlock(Block, Values[0]);
+                DecodeBc4SnormBlock(Block + 8, Values[1]);
+                for (uint32_t i = 0; i < 16; ++i) {
+                    uint32_t x = BlockX * 4 + (i & 3u);
+                    uint32_t y = BlockY * 4 + (i >> 2);
+                    if (x < inSlopeMap.Width && y < inSlopeMap.Height) {
+                        float* Texel = &SlopeMap.Texels[((size_t)y * inSlopeMap.Width + x) * 2];
+                        Texel[0] = Values[0][i] * inSlopeMap.Scale;
+                        Texel[1] = Values[1][i] * inSlopeMap.Scale;
+                    }
+                }
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return SlopeMap;
+}
+
+float2 GetHeightMapSlope(const SubdTexture& inHeightMap, const float2& inUV) {
+    float TexelX = 1.0f / inHeightMap.Width;
+    float TexelY = 1.0f / inHeightMap.Height;
+    float SlopeX = inHeightMap.SampleLevel(float2(inUV.x + TexelX, inUV.y)).x - inHeightMap.SampleLevel(float2(inUV.x - TexelX, inUV.y)).x;
+    float SlopeY = inHeightMap.SampleLevel(float2(inUV.x, inUV.y + TexelY)).x - inHeightMap.SampleLevel(float2(inUV.x, inUV.y - TexelY)).x;
+    return float2(SlopeX * inHeightMap.Width * 0.5f, SlopeY * inHeightMap.Height * 0.5f);
+}
+
+}
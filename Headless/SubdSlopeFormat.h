@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "SubdTexture.h"
+#include "ThreadPool.h"
+
+namespace Headless {
+
+// Storage of SlopeMapTexture. RG32Float is the reference, 8 bytes per texel. RG16Float halves
+// it. RG16Snorm and BC5Snorm store the slopes divided by the largest one, the scale
+// RenderKernelCB carries as SlopeScale. BC5Snorm is 16 bytes per 4 x 4 block, one BC4 block
+// per channel. HeightMap drops the texture: SLOPE_FROM_HEIGHTMAP takes the central
+// differences of HeightMapTexture where the slopes are sampled.
+enum class SlopeFormat : uint32_t {
+    RG32Float,
+    RG16Float,
+    RG16Snorm,
+    BC5Snorm,
+    HeightMap,
+};
+const uint32_t SlopeFormatCount = 5;
+
+const char* GetSlopeFormatName(SlopeFormat inFormat);
+// Bytes of SlopeMapTexture per texel, for a width and height that are multiples of 4.
+double GetSlopeFormatTexelBytes(SlopeFormat inFormat);
+
+// SlopeMapTexture ready to upload: Data holds the texels, or the BC5 blocks row by row.
+// Empty for SlopeFormat::HeightMap.
+struct EncodedSlopeMap {
+    SlopeFormat Format = SlopeFormat::RG32Float;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    // What the sampled slopes are multiplied by.
+    float Scale = 1.0f;
+    std::vector<uint8_t> Data;
+};
+
+// inSlopes are the RG32Float texels of CreateSlopeMap or the heightmap cache. BC5Snorm needs
+// a width and height that are multiples of 4.
+EncodedSlopeMap EncodeSlopeMap(const float* inSlopes, uint32_t inWidth, uint32_t inHeight, SlopeFormat inFormat,
+    ThreadPool& inThreadPool = ThreadPool::GetDefault());
+// EncodeSlopeMap of every mip down to 1 x 1, for a texture created with its full chain. Each
+// mip is the 2 x 2 average of the one above (the last row and column repeated on an odd
+// size), and all take the Scale of the first. BC5Snorm pads the mips smaller than a block.
+// Empty for SlopeFormat::HeightMap.
+std::vector<EncodedSlopeMap> EncodeSlopeMipChain(const float* inSlopes, uint32_t inWidth, uint32_t inHeight, SlopeFormat inFormat,
+    ThreadPool& inThreadPool = ThreadPool::GetDefault());
+// The slopes as the shaders read them, Scale applied: filtering happens after the decode, so
+// sampling the result matches sampling the compressed texture.
+SubdTexture DecodeSlopeMap(const EncodedSlopeMap& inSlopeMap);
+
+// SLOPE_FROM_HEIGHTMAP: half the size of the heightmap times the difference of the filtered
+// heights one texel to either side. Equals CreateSlopeMap sampled at inUV away from the border.
+float2 GetHeightMapSlope(const SubdTexture& inHeightMap, const float2& inUV);
+
+uint16_t FloatToHalf(float inValue);
+float HalfToFloat(uint16_t inValue);
+// One BC4 Snorm block of 16 values in [-1, 1], row by row; 8 bytes.
+void EncodeBc4SnormBlock(const float inValues[16], uint8_t outBlock[8]);
+void DecodeBc4SnormBlock(const uint8_t inBlock[8], float outValues[16]);
+
+}
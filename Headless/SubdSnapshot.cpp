@@ -0,0 +1,187 @@
+#include "SubdSnapshot.h"
+#include "SubdMath.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace Headless {
+
+static const uint32_t SlotDepth = 31;
+
+static uint64_t GetSlot(uint32_t inSubdBinaryKey, uint32_t inDepth) {
+    return (uint64_t)(inSubdBinaryKey ^ (1u << inDepth)) << (SlotDepth - inDepth);
+}
+
+static uint64_t GetSlotSpan(uint32_t inDepth) {
+    return 1ull << (SlotDepth - inDepth);
+}
+
+static void WriteVarint(std::vector<uint8_t>& ioBytes, uint64_t inValue) {
+    while (inValue >= 0x80) {
+        ioBytes.push_back((uint8_t)(inValue | 0x80));
+        inValue >>= 7;
+    }
+    ioBytes.push_back((uint8_t)inValue);
+}
+
+static uint64_t ZigZag(int64_t inValue) {
+    return ((uint64_t)inValue << 1) ^ (uint64_t)(inValue >> 63);
+}
+
+static int64_t UnZigZag(uint64_t inValue) {
+    return (int64_t)(inValue >> 1) ^ -(int64_t)(inValue & 1);
+}
+
+std::vector<uint8_t> EncodeSubdSnapshot(const PrimitiveData* inKeys, size_t inCount) {
+    // (PrimitiveIndex, slot, depth) packed so one integer sort orders the keys.
+    std::vector<uint64_t> Keys;
+    Keys.reserve(inCount);
+    for (size_t i = 0; i < inCount; ++i) {
+        if (inKeys[i].SubdBinaryKey == 0 || inKeys[i].PrimitiveIndex >= SubdSnapshotMaxPrimitiveCount) {
+            continue;
+        }
+        uint32_t Depth = (uint32_t)firstbithigh(inKeys[i].SubdBinaryKey);
+        Keys.push_back(((uint64_t)inKeys[i].PrimitiveIndex << 36) | (GetSlot(inKeys[i].SubdBinaryKey, Depth) << 5) | Depth);
+    }
+    std::sort(Keys.begin(), Keys.end());
+
+    SubdSnapshotHeader Header;
+    Header.KeyCount = (uint32_t)Keys.size();
+    std::vector<uint8_t> Bytes(sizeof(Header));
+    Bytes.reserve(sizeof(Header) + Keys.size() + Keys.size() / 8);
+
+    uint32_t PreviousPrimitiveIndex = 0;
+    for (size_t Begin = 0; Begin < Keys.size();) {
+        uint32_t PrimitiveIndex = (uint32_t)(Keys[Begin] >> 36);
+        size_t End = Begin;
+        while (End < Keys.size() && (uint32_t)(Keys[End] >> 36) == PrimitiveIndex) {
+            ++End;
+        }
+        WriteVarint(Bytes, PrimitiveIndex - PreviousPrimitiveIndex);
+        WriteVarint(Bytes, End - Begin);
+        PreviousPrimitiveIndex = PrimitiveIndex;
+
+        uint64_t ExpectedSlot = 0;
+        for (size_t i = Begin; i < End; ++i) {
+            uint64_t Slot = (Keys[i] >> 5) & (GetSlotSpan(0) - 1);
+            uint32_t Depth = (uint32_t)(Keys[i] & 31u);
+            WriteVarint(Bytes, (ZigZag((int64_t)(Slot - ExpectedSlot)) << 5) | Depth);
+            ExpectedSlot = Slot + GetSlotSpan(Depth);
+        }
+        ++Header.GroupCount;
+        Begin = End;
+    }
+    memcpy(Bytes.data(), &Header, sizeof(Header));
+    return Bytes;
+}
+
+bool SaveSubdSnapshot(const std::string& inPath, const PrimitiveData* inKeys, size_t inCount) {
+    std::vector<uint8_t> Bytes = EncodeSubdSnapshot(inKeys, inCount);
+    FILE* File = fopen(inPath.c_str(), "wb");
+    if (!File) {
+        return false;
+    }
+    bool Written = fwrite(Bytes.data(), 1, Bytes.size(), File) == Bytes.size();
+    return fclose(File) == 0 && Written;
+}
+
+bool SubdSnapshotReader::Open(const std::string& inPath) {
+    if (!mFile.Open(inPath)) {
+        mValid = false;
+        return false;
+    }
+    return Open(mFile.GetData(), mFile.GetSize());
+}
+
+bool SubdSnapshotReader::Open(const uint8_t* inData, size_t inSize) {
+    mValid = false;
+    if (!inData || inSize < sizeof(SubdSnapshotHeader)) {
+        return false;
+    }
+    memcpy(&mHeader, inData, sizeof(mHeader));
+    if (mHeader.Magic != SubdSnapshotMagic || mHeader.Version != SubdSnapshotVersion) {
+        return false;
+    }
+    // Every key takes at least one byte, so a larger KeyCount cannot be backed by the payload.
+    if (mHeader.KeyCount > inSize - sizeof(mHeader)) {
+        return false;
+    }
+    mpCursor = inData + sizeof(mHeader);
+    mpEnd = inData + inSize;
+    mGroupsLeft = mHeader.GroupCount;
+    mKeysLeftInGroup = 0;
+    mPrimitiveIndex = 0;
+    mValid = true;
+    return true;
+}
+
+bool SubdSnapshotReader::ReadVarint(uint64_t& outValue) {
+    outValue = 0;
+    for (uint32_t Shift = 0; Shift < 64 && mpCursor < mpEnd; Shift += 7) {
+        uint8_t Byte = *mpCursor++;
+        outValue |= (uint64_t)(Byte & 0x7f) << Shift;
+        if (!(Byte & 0x80)) {
+            return true;
+        }
+    }
+    mValid = false;
+    return false;
+}
+
+size_t SubdSnapshotReader::Read(PrimitiveData* outKeys, size_t inMaxCount) {
+    size_t Count = 0;
+    while (mValid && Count < inMaxCount) {
+        if (mKeysLeftInGroup == 0) {
+            if (mGroupsLeft == 0) {
+                break;
+            }
+            uint64_t PrimitiveDelta, KeyCount;
+            if (!ReadVarint(PrimitiveDelta) || !ReadVarint(KeyCount)) {
+                break;
+            }
+            mPrimitiveIndex += (uint32_t)PrimitiveDelta;
+            mKeysLeftInGroup = (uint32_t)KeyCount;
+            mExpectedSlot = 0;
+            --mGroupsLeft;
+            continue;
+        }
+
+        uint64_t Value;
+        if (!ReadVarint(Value)) {
+            break;
+        }
+        uint32_t Depth = (uint32_t)(Value & 31u);
+        uint64_t Slot = mExpectedSlot + (uint64_t)UnZigZag(Value >> 5);
+        if (Slot >= GetSlotSpan(0) || (Slot & (GetSlotSpan(Depth) - 1)) != 0) {
+            mValid = false;
+            break;
+        }
+        outKeys[Count++] = { mPrimitiveIndex, (1u << Depth) | (uint32_t)(Slot >> (SlotDepth - Depth)) };
+        mExpectedSlot = Slot + GetSlotSpan(Depth);
+        --mKeysLeftInGroup;
+    }
+    return mValid ? Count : 0;
+}
+
+bool LoadSubdSnapshot(const std::string& inPath, std::vector<PrimitiveData>& outKeys) {
+    SubdSnapshotReader Reader;
+    if (!Reader.Open(inPath)) {
+        return false;
+    }
+    std::vector<PrimitiveData> Keys(Reader.GetKeyCount());
+    size_t Count = 0;
+    while (Count < Keys.size()) {
+        size_t Read = Reader.Read(Keys.data() + Count, Keys.size() - Count);
+        if (Read == 0) {
+            break;
+        }
+        Count += Read;
+    }
+    if (!Reader.IsValid() || Count != Keys.size() || !Reader.IsDone()) {
+        return false;
+    }
+    outKeys.swap(Keys);
+    return true;
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "SubdShared.h"
+
+namespace Headless {
+
+// On-disk copy of a SubdIn key set, so a restart can begin at the converged tessellation
+// instead of InitSubdBuffer.
+//
+// SubdSnapshotHeader, then one group per primitive in ascending PrimitiveIndex order:
+// varint PrimitiveIndex delta from the previous group, varint key count, and one varint
+// per key. Keys are sorted along the tree (the position of their first depth-31
+// descendant, the "slot") and stored as (zigzag(slot - expected slot) << 5) | depth,
+// where the expected slot is the end of the previous key. Leaves that partition the
+// primitive therefore cost one byte each, against 8 for a raw PrimitiveData.
+const uint32_t SubdSnapshotMagic = 0x44425553; // "SUBD"
+const uint32_t SubdSnapshotVersion = 1;
+// Keys of primitives past this are not stored.
+const uint32_t SubdSnapshotMaxPrimitiveCount = 1u << 28;
+
+struct SubdSnapshotHeader {
+    uint32_t Magic = SubdSnapshotMagic;
+    uint32_t Version = SubdSnapshotVersion;
+    uint32_t GroupCount = 0;
+    uint32_t KeyCount = 0;
+};
+
+// Sorts a copy of the keys; key 0 (no depth) is skipped.
+std::vector<uint8_t> EncodeSubdSnapshot(const PrimitiveData* inKeys, size_t inCount);
+bool SaveSubdSnapshot(const std::string& inPath, const PrimitiveData* inKeys, size_t inCount);
+
+// Streams keys out of a mapped snapshot (or any encoded buffer) in tree order.
+class SubdSnapshotReader {
+public:
+    bool Open(const std::string& inPath);
+    // inData must outlive the reader. Fails on a KeyCount the payload is too small to hold.
+    bool Open(const uint8_t* inData, size_t inSize);
+
+    uint32_t GetKeyCount() const { return mHeader.KeyCount; }
+    // Decodes up to inMaxCount keys, returns how many; 0 once done or when the data is corrupt.
+    size_t Read(PrimitiveData* outKeys, size_t inMaxCount);
+    bool IsValid() const { return mValid; }
+    bool IsDone() const { return mGroupsLeft == 0 && mKeysLeftInGroup == 0; }
+
+private:
+    bool ReadVarint(uint64_t& outValue);
+
+    MappedFile mFile;
+    const uint8_t* mpCursor = nullptr;
+    const uint8_t* mpEnd = nullptr;
+    SubdSnapshotHeader mHeader;
+    bool mValid = false;
+
+    uint32_t mGroupsLeft = 0;
+    uint32_t mKeysLeftInGroup = 0;
+    uint32_t mPrimitiveIndex = 0;
+    uint64_t mExpectedSlot = 0;
+};
+
+// Whole snapshot into outKeys; false (and outKeys untouched) when missing or corrupt.
+bool LoadSubdSnapshot(const std::string& inPath, std::vector<PrimitiveData>& outKeys);
+
+}
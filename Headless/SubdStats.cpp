@@ -0,0 +1,27 @@
+#include "SubdStats.h"
+
+namespace Headless {
+
+// IndirectBatcherKernel has already moved SubdOutCount into SubdInCount and the culled
+// counts into the InstanceCount of each view's draw (and the occluded and dirty counts into
+// LastOccludedCount / LastDirtyCount) by the time the frame's copy is made.
+SubdStats GetSubdStats(const SubdReadback& inReadback, size_t inBufferCapacity, uint64_t inFrame) {
+    SubdStats Stats;
+    Stats.Frame = inFrame;
+    Stats.LeafCount = inReadback.Counter.SubdInCount;
+    Stats.VisibleCount = inReadback.DrawArgs[0].InstanceCount;
+    for (uint32_t View = 1; View < MaxLodViewCount; ++View) {
+        Stats.ViewVisibleCount[View - 1] = inReadback.DrawArgs[View].InstanceCount;
+    }
+    Stats.CulledCount = Stats.LeafCount > Stats.VisibleCount ? Stats.LeafCount - Stats.VisibleCount : 0;
+    Stats.OccludedCount = inReadback.Counter.LastOccludedCount;
+    Stats.DirtyCount = inReadback.Counter.LastDirtyCount;
+    Stats.SplitCount = inReadback.Counter.SplitCount;
+    Stats.MergeCount = inReadback.Counter.MergeCount;
+    Stats.ConvergenceIterations = inReadback.Counter.ConvergenceIterations;
+    Stats.Converged = inReadback.Counter.Converged != 0;
+    Stats.BufferCapacity = inBufferCapacity;
+    return Stats;
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "SubdShared.h"
+
+namespace Headless {
+
+// The GPU state the sample copies into one staging buffer per frame: BufferCounter, the
+// IndirectDrawBuffer record of every view and the first five IndirectDispatchBuffer
+// records, back to back.
+struct SubdReadback {
+    SubdBufferCounter Counter;
+    IndirectDrawArgs DrawArgs[MaxLodViewCount];
+    IndirectDispatchArgs DispatchArgs[5];
+};
+
+// Subdivision state at the end of a frame, decoded from a SubdReadback.
+struct SubdStats {
+    // Frame the readback was copied in.
+    uint64_t Frame = 0;
+    // Keys the next LodKernel reads: SubdIn, or the leaves of the CBT.
+    uint32_t LeafCount = 0;
+    // Leaves the last pass kept visible (SubdCulledOut, the instances drawn) and the ones it
+    // culled. Culled is taken against LeafCount, so it is exact once the frame converged.
+    uint32_t VisibleCount = 0;
+    uint32_t CulledCount = 0;
+    // Of the culled leaves, those inside the frustum that HiZ hid (OCCLUSION_CULLING).
+    uint32_t OccludedCount = 0;
+    // Keys of the last pass that INCREMENTAL_LOD evaluated; the others kept their op on
+    // the slack left to them.
+    uint32_t DirtyCount = 0;
+    // Leaves the last pass kept visible in each MULTI_VIEW view from 1 on.
+    uint32_t ViewVisibleCount[MaxLodViewCount - 1] = {};
+    // Over all passes of the frame; a merged pair counts once.
+    uint32_t SplitCount = 0;
+    uint32_t MergeCount = 0;
+    uint32_t ConvergenceIterations = 0;
+    bool Converged = false;
+    // SubdBufferSize: keys past it were dropped (ping-pong storage).
+    size_t BufferCapacity = 0;
+
+    float GetOccupancy() const { return BufferCapacity ? (float)LeafCount / (float)BufferCapacity : 0.0f; }
+    bool IsOverflowing() const { return LeafCount > BufferCapacity || VisibleCount > BufferCapacity; }
+};
+
+SubdStats GetSubdStats(const SubdReadback& inReadback, size_t inBufferCapacity, uint64_t inFrame);
+
+// Slots of a ring of staging copies read a fixed number of frames late: frame F copies
+// into GetWriteSlot(F) and reads the slot written GetLatency() frames earlier, which is the
+// slot frame F + 1 overwrites. With more slots than frames in flight the GPU has finished
+// that copy, so reading it never waits.
+class ReadbackRing {
+public:
+    explicit ReadbackRing(uint32_t inSlotCount) : mSlotCount(inSlotCount < 2 ? 2 : inSlotCount) {}
+
+    uint32_t GetSlotCount() const { return mSlotCount; }
+    uint32_t GetLatency() const { return mSlotCount - 1; }
+    uint32_t GetWriteSlot(uint64_t inFrame) const { return (uint32_t)(inFrame % mSlotCount); }
+    // False for the first GetLatency() frames, before anything was written.
+    bool GetReadSlot(uint64_t inFrame, uint32_t& outSlot) const {
+        if (inFrame < GetLatency()) {
+            return false;
+        }
+        outSlot = (uint32_t)((inFrame + 1) % mSlotCount);
+        return true;
+    }
+
+private:
+    uint32_t mSlotCount;
+};
+
+}
@@ -0,0 +1,360 @@
+#include "SubdSurfaceQuery.h"
+#include <algorithm>
+#include <chrono>
+#include "SubdLeafSort.h"
+
+namespace Headless {
+
+static float3 Min3(const float3& a, const float3& b) { return float3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)); }
+static float3 Max3(const float3& a, const float3& b) { return float3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)); }
+
+void SubdSurfaceQuery::Box::Extend(const Box& inBox) {
+    Min = Min3(Min, inBox.Min);
+    Max = Max3(Max, inBox.Max);
+}
+
+void SubdSurfaceQuery::Box::Extend(const float3& inPoint) {
+    Min = Min3(Min, inPoint);
+    Max = Max3(Max, inPoint);
+}
+
+bool SubdSurfaceQuery::Box::Intersect(const float3& inOrigin, const float3& inInverseDirection, float inMaxDistance, float& outDistance) const {
+    if (Min.x > Max.x) {
+        return false;
+    }
+    float Near = 0.0f;
+    float Far = inMaxDistance;
+    const float* BoxMin = &Min.x;
+    const float* BoxMax = &Max.x;
+    const float* Origin = &inOrigin.x;
+    const float* Inverse = &inInverseDirection.x;
+    for (int Axis = 0; Axis < 3; ++Axis) {
+        float t0 = (BoxMin[Axis] - Origin[Axis]) * Inverse[Axis];
+        float t1 = (BoxMax[Axis] - Origin[Axis]) * Inverse[Axis];
+        // A ray parallel to the slab, starting on its plane: 0 * inf.
+        if (t0 != t0 || t1 != t1) {
+            continue;
+        }
+        Near = std::max(Near, std::min(t0, t1));
+        Far = std::min(Far, std::max(t0, t1));
+    }
+    outDistance = Near;
+    return Near <= Far;
+}
+
+SubdSurfaceQuery::SubdSurfaceQuery(const SurfaceQueryContext& inContext)
+    : mContext(inContext), mPatch(PatchGrids.PatchLevelOffsets[inContext.PatchLevel]) {
+}
+
+void SubdSurfaceQuery::EvaluateSlot(uint32_t inSlot) {
+    const PrimitiveData& Leaf = mSlotLeaves[inSlot];
+    float4 InVertices[3];
+    mContext.Render.Mesh->GetPrimitiveVertices(Leaf.PrimitiveIndex, InVertices);
+    float4 OutVertices[3];
+    RenderSubd(mContext.Render, Leaf.SubdBinaryKey, InVertices, OutVertices);
+
+    Box SlotBox;
+    float3* Vertices = &mSlotVertices[(size_t)inSlot * mPatch.VertexCount];
+    for (uint32_t i = 0; i < mPatch.VertexCount; ++i) {
+        const PatchVertex& Vertex = PatchGrids.Vertices[mPatch.BaseVertexLocation + i];
+        float4 Position = RenderBerp(mContext.Render, OutVertices, float2(Vertex.BerpUV[0], Vertex.BerpUV[1]));
+        if (mContext.HeightMap) {
+            Position.z += mContext.HeightMap->SampleLevel(float2(Position.x * 0.5f + 0.5f, Position.y * 0.5f + 0.5f)).x * mContext.Render.DisplacementFactor;
+        }
+        Vertices[i] = Position.xyz();
+        SlotBox.Extend(Vertices[i]);
+    }
+    mSlotBoxes[inSlot] = SlotBox;
+}
+
+uint32_t SubdSurfaceQuery::FindCoveringBucket(const PrimitiveData& inData) const {
+    for (uint32_t Ancestor = inData.SubdBinaryKey >> 1; Ancestor != 0; Ancestor >>= 1) {
+        auto Found = mSlotIndex.find(GetMapKey({ inData.PrimitiveIndex, Ancestor }));
+        if (Found != mSlotIndex.end()) {
+            return mSlotBuckets[Found->second];
+        }
+    }
+    // The old leaves under a merged key partition it, so one of them lies on its leftmost path.
+    for (uint32_t Descendant = inData.SubdBinaryKey << 1; Descendant != 0 && !(Descendant >> 31); Descendant <<= 1) {
+        auto Found = mSlotIndex.find(GetMapKey({ inData.PrimitiveIndex, Descendant }));
+        if (Found != mSlotIndex.end()) {
+            return mSlotBuckets[Found->second];
+        }
+    }
+    return ~0u;
+}
+
+SurfaceQueryUpdate SubdSurfaceQuery::Update(const PrimitiveData* inLeaves, uint32_t inLeafCount, ThreadPool& inThreadPool) {
+    auto Start = std::chrono::high_resolution_clock::now();
+    SurfaceQueryUpdate Result;
+
+    std::vector<uint8_t> Kept(mSlotLeaves.size(), 0);
+    std::vector<uint32_t> Added;
+    for (uint32_t i = 0; i < inLeafCount; ++i) {
+        auto Found = mSlotIndex.find(GetMapKey(inLeaves[i]));
+        if (Found != mSlotIndex.end()) {
+            Kept[Found->second] = 1;
+        }
+        else {
+            Added.push_back(i);
+        }
+    }
+    Result.AddedCount = (uint32_t)Added.size();
+
+    // Against the old leaves, before any of them goes.
+    bool Rebuild = mRebuildPending;
+    std::vector<uint32_t> AddedBuckets(Added.size(), ~0u);
+    for (size_t i = 0; i < Added.size() && !Rebuild; ++i) {
+        AddedBuckets[i] = FindCoveringBucket(inLeaves[Added[i]]);
+        Rebuild = AddedBuckets[i] == ~0u;
+    }
+
+    std::vector<uint32_t> DirtyBuckets;
+    for (uint32_t Slot = 0; Slot < Kept.size(); ++Slot) {
+        if (Kept[Slot] || mSlotBuckets[Slot] == ~0u) {
+            continue;
+        }
+        std::vector<uint32_t>& Bucket = mBuckets[mSlotBuckets[Slot]];
+        *std::find(Bucket.begin(), Bucket.end(), Slot) = Bucket.back();
+        Bucket.pop_back();
+        DirtyBuckets.push_back(mSlotBuckets[Slot]);
+        mSlotIndex.erase(GetMapKey(mSlotLeaves[Slot]));
+        mSlotBuckets[Slot] = ~0u;
+        mFreeSlots.push_back(Slot);
+        ++Result.RemovedCount;
+    }
+
+    std::vector<uint32_t> AddedSlots(Added.size());
+    for (size_t i = 0; i < Added.size(); ++i) {
+        uint32_t Slot;
+        if (!mFreeSlots.empty()) {
+            Slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }
+        else {
+            Slot = (uint32_t)mSlotLeaves.size();
+            mSlotLeaves.emplace_back();
+            mSlotBoxes.emplace_back();
+            mSlotBuckets.push_back(~0u);
+        }
+        mSlotLeaves[Slot] = inLeaves[Added[i]];
+        mSlotIndex.emplace(GetMapKey(inLeaves[Added[i]]), Slot);
+        AddedSlots[i] = Slot;
+    }
+    mSlotVertices.resize(mSlotLeaves.size() * mPatch.VertexCount);
+    inThreadPool.ParallelFor(AddedSlots.size(), 256, [&](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            EvaluateSlot(AddedSlots[i]);
+        }
+    });
+
+    for (size_t i = 0; i < Added.size() && !Rebuild; ++i) {
+        mSlotBuckets[AddedSlots[i]] = AddedBuckets[i];
+        mBuckets[AddedBuckets[i]].push_back(AddedSlots[i]);
+        DirtyBuckets.push_back(AddedBuckets[i]);
+        Rebuild = mBuckets[AddedBuckets[i]].size() > SurfaceQueryMaxBucketSize;
+    }
+
+    if (Rebuild) {
+        this->Rebuild(inThreadPool);
+    }
+    else {
+        std::sort(DirtyBuckets.begin(), DirtyBuckets.end());
+        DirtyBuckets.erase(std::unique(DirtyBuckets.begin(), DirtyBuckets.end()), DirtyBuckets.end());
+        RefitBuckets(DirtyBuckets);
+        if (!DirtyBuckets.empty()) {
+            RefitTree();
+        }
+    }
+    Result.Rebuilt = Rebuild;
+    Result.Ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+    return Result;
+}
+
+void SubdSurfaceQuery::Rebuild(ThreadPool& inThreadPool) {
+    Box Bounds;
+    std::vector<uint32_t> Slots;
+    Slots.reserve(mSlotIndex.size());
+    for (const auto& Entry : mSlotIndex) {
+        Slots.push_back(Entry.second);
+        Bounds.Extend(mSlotBoxes[Entry.second]);
+    }
+
+    // Morton order of the box centres, 8 bits per axis of the bounds.
+    LeafSortBounds SortBounds;
+    SortBounds.Min = Bounds.Min;
+    SortBounds.Dimensions = 3;
+    float3 Extent = Bounds.Max - Bounds.Min;
+    float CellCount = (float)(1u << (LeafSortKeyBits / 3));
+    SortBounds.Scale = float3(Extent.x > 0.0f ? CellCount / Extent.x : 0.0f, Extent.y > 0.0f ? CellCount / Extent.y : 0.0f,
+        Extent.z > 0.0f ? CellCount / Extent.z : 0.0f);
+    std::vector<uint64_t> Order(Slots.size());
+    inThreadPool.ParallelFor(Slots.size(), 4096, [&](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            const Box& SlotBox = mSlotBoxes[Slots[i]];
+            Order[i] = (uint64_t)GetMortonKey(SortBounds, (SlotBox.Min + SlotBox.Max) * 0.5f) << 32 | Slots[i];
+        }
+    });
+    std::sort(Order.begin(), Order.end());
+
+    mBuckets.assign((Order.size() + SurfaceQueryBucketSize - 1) / SurfaceQueryBucketSize, std::vector<uint32_t>());
+    for (size_t i = 0; i < Order.size(); ++i) {
+        uint32_t Slot = (uint32_t)Order[i];
+        mSlotBuckets[Slot] = (uint32_t)(i / SurfaceQueryBucketSize);
+        mBuckets[i / SurfaceQueryBucketSize].push_back(Slot);
+    }
+    mLeafNodeBase = 1;
+    while (mLeafNodeBase < mBuckets.size()) {
+        mLeafNodeBase <<= 1;
+    }
+    mNodes.assign(2 * (size_t)mLeafNodeBase, Box());
+    std::vector<uint32_t> AllBuckets(mBuckets.size());
+    for (uint32_t Bucket = 0; Bucket < AllBuckets.size(); ++Bucket) {
+        AllBuckets[Bucket] = Bucket;
+    }
+    RefitBuckets(AllBuckets);
+    RefitTree();
+    mRebuildPending = false;
+}
+
+void SubdSurfaceQuery::RefitBuckets(const std::vector<uint32_t>& inBuckets) {
+    for (uint32_t Bucket : inBuckets) {
+        Box BucketBox;
+        for (uint32_t Slot : mBuckets[Bucket]) {
+            BucketBox.Extend(mSlotBoxes[Slot]);
+        }
+        mNodes[mLeafNodeBase + Bucket] = BucketBox;
+    }
+}
+
+void SubdSurfaceQuery::RefitTree() {
+    for (uint32_t Node = mLeafNodeBase - 1; Node >= 1; --Node) {
+        mNodes[Node] = mNodes[2 * Node];
+        mNodes[Node].Extend(mNodes[2 * Node + 1]);
+    }
+}
+
+void SubdSurfaceQuery::IntersectSlot(uint32_t inSlot, const SurfaceRay& inRay, bool inTestBox, SurfaceHit& ioHit) const {
+    if (inTestBox) {
+        float3 Inverse(1.0f / inRay.Direction.x, 1.0f / inRay.Direction.y, 1.0f / inRay.Direction.z);
+        float Distance;
+        if (!mSlotBoxes[inSlot].Intersect(inRay.Origin, Inverse, std::min(ioHit.Distance, inRay.MaxDistance), Distance)) {
+            return;
+        }
+    }
+    const float3* Vertices = &mSlotVertices[(size_t)inSlot * mPatch.VertexCount];
+    const uint16_t* Indices = &PatchGrids.Indices[mPatch.StartIndexLocation];
+    for (uint32_t i = 0; i < mPatch.IndexCountPerInstance; i += 3) {
+        // Moller-Trumbore, both faces.
+        const float3& V0 = Vertices[Indices[i]];
+        float3 Edge1 = Vertices[Indices[i + 1]] - V0;
+        float3 Edge2 = Vertices[Indices[i + 2]] - V0;
+        float3 P = cross(inRay.Direction, Edge2);
+        float Determinant = dot(Edge1, P);
+        if (std::fabs(Determinant) < 1e-20f) {
+            continue;
+        }
+        float InverseDeterminant = 1.0f / Determinant;
+        float3 S = inRay.Origin - V0;
+        float u = dot(S, P) * InverseDeterminant;
+        if (u < 0.0f || u > 1.0f) {
+            continue;
+        }
+        float3 Q = cross(S, Edge1);
+        float v = dot(inRay.Direction, Q) * InverseDeterminant;
+        if (v < 0.0f || u + v > 1.0f) {
+            continue;
+        }
+        float t = dot(Edge2, Q) * InverseDeterminant;
+        if (t >= 0.0f && t <= inRay.MaxDistance && t < ioHit.Distance) {
+            ioHit.Distance = t;
+            ioHit.Normal = cross(Edge1, Edge2);
+            ioHit.Leaf = mSlotLeaves[inSlot];
+        }
+    }
+}
+
+void SubdSurfaceQuery::FinishHit(const SurfaceRay& inRay, SurfaceHit& ioHit) const {
+    if (!ioHit.IsHit()) {
+        return;
+    }
+    ioHit.Position = inRay.Origin + inRay.Direction * ioHit.Distance;
+    if (mContext.Render.SlopeMap) {
+        ioHit.Normal = GetSlopeNormal(mContext.Render, ioHit.Position);
+    }
+    else {
+        ioHit.Normal = normalize(dot(ioHit.Normal, inRay.Direction) > 0.0f ? -ioHit.Normal : ioHit.Normal);
+    }
+}
+
+SurfaceHit SubdSurfaceQuery::CastRay(const SurfaceRay& inRay) const {
+    SurfaceHit Hit;
+    if (mBuckets.empty()) {
+        return Hit;
+    }
+    float3 Inverse(1.0f / inRay.Direction.x, 1.0f / inRay.Direction.y, 1.0f / inRay.Direction.z);
+    uint32_t Stack[64];
+    uint32_t StackSize = 0;
+    Stack[StackSize++] = 1;
+    while (StackSize) {
+        uint32_t Node = Stack[--StackSize];
+        float Distance;
+        if (!mNodes[Node].Intersect(inRay.Origin, Inverse, std::min(Hit.Distance, inRay.MaxDistance), Distance)) {
+            continue;
+        }
+        if (Node >= mLeafNodeBase) {
+            if (Node - mLeafNodeBase < mBuckets.size()) {
+                for (uint32_t Slot : mBuckets[Node - mLeafNodeBase]) {
+                    IntersectSlot(Slot, inRay, true, Hit);
+                }
+            }
+            continue;
+        }
+        // Nearer child on top.
+        float Distances[2];
+        bool Hits[2];
+        for (uint32_t Child = 0; Child < 2; ++Child) {
+            Hits[Child] = mNodes[2 * Node + Child].Intersect(inRay.Origin, Inverse, std::min(Hit.Distance, inRay.MaxDistance), Distances[Child]);
+        }
+        uint32_t Near = Hits[1] && (!Hits[0] || Distances[1] < Distances[0]) ? 1 : 0;
+        if (Hits[1 - Near]) {
+            Stack[StackSize++] = 2 * Node + 1 - Near;
+        }
+        if (Hits[Near]) {
+            Stack[StackSize++] = 2 * Node + Near;
+        }
+    }
+    FinishHit(inRay, Hit);
+    return Hit;
+}
+
+SurfaceHit SubdSurfaceQuery::CastRayBruteForce(const SurfaceRay& inRay) const {
+    SurfaceHit Hit;
+    for (const auto& Entry : mSlotIndex) {
+        IntersectSlot(Entry.second, inRay, false, Hit);
+    }
+    FinishHit(inRay, Hit);
+    return Hit;
+}
+
+void SubdSurfaceQuery::CastRays(const SurfaceRay* inRays, uint32_t inCount, SurfaceHit* outHits, ThreadPool& inThreadPool) const {
+    inThreadPool.ParallelFor(inCount, 64, [&](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            outHits[i] = CastRay(inRays[i]);
+        }
+    });
+}
+
+void SubdSurfaceQuery::QueryHeights(const float2* inPoints, uint32_t inCount, SurfaceHit* outHits, ThreadPool& inThreadPool) const {
+    float Top = mBuckets.empty() ? 0.0f : mNodes[1].Max.z + 1.0f;
+    inThreadPool.ParallelFor(inCount, 64, [&](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            SurfaceRay Ray;
+            Ray.Origin = float3(inPoints[i].x, inPoints[i].y, Top);
+            Ray.Direction = float3(0.0f, 0.0f, -1.0f);
+            outHits[i] = CastRay(Ray);
+        }
+    });
+}
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <limits>
+#include <unordered_map>
+#include <vector>
+#include "PatchGrid.h"
+#include "SubdLeafVertex.h"
+
+namespace Headless {
+
+// What RenderKernelVS draws of a leaf: its level PatchLevel patch, each vertex placed by
+// Subd and Berp (Phong tessellation included) and, with a HeightMap, raised by
+// HeightMapTexture * DisplacementFactor as DISPLACE does.
+struct SurfaceQueryContext {
+    RenderKernelContext Render;
+    const SubdTexture* HeightMap = nullptr;
+    uint32_t PatchLevel = DefaultPatchLevel;
+};
+
+struct SurfaceRay {
+    float3 Origin;
+    // Need not be normalized; distances are in units of its length.
+    float3 Direction;
+    float MaxDistance = std::numeric_limits<float>::infinity();
+};
+
+// Distance is infinite on a miss. Normal is the shading normal of RenderKernelPS: from the
+// slope map with one, else the facet normal turned towards the ray.
+struct SurfaceHit {
+    float Distance = std::numeric_limits<float>::infinity();
+    float3 Position;
+    float3 Normal;
+    PrimitiveData Leaf = {};
+
+    bool IsHit() const { return Distance < std::numeric_limits<float>::infinity(); }
+};
+
+// Leaves per bucket of a fresh tree, and the size past which Update rebuilds it.
+const uint32_t SurfaceQueryBucketSize = 8;
+const uint32_t SurfaceQueryMaxBucketSize = 64;
+
+// What the last Update did to the leaves and the tree.
+struct SurfaceQueryUpdate {
+    uint32_t AddedCount = 0;
+    uint32_t RemovedCount = 0;
+    // Rebuilt from scratch, or the new leaves joined the buckets of the keys they split from
+    // or merged into and only the boxes were refit.
+    bool Rebuilt = false;
+    double Ms = 0.0;
+};
+
+// Batched height and ray queries against the surface the sample renders. Keeps the patch
+// vertices of every leaf and a BVH over them: the leaves are cut in buckets of
+// SurfaceQueryBucketSize along their Morton order, and an implicit binary tree sits on the
+// buckets. When keys split or merge, the new keys go to the bucket of the old key covering
+// them, so the tree stays spatially sound and only the boxes are refit; it is rebuilt when
+// a bucket grows past SurfaceQueryMaxBucketSize. Stores PatchVertexCount * 12 bytes per leaf.
+class SubdSurfaceQuery {
+public:
+    explicit SubdSurfaceQuery(const SurfaceQueryContext& inContext);
+
+    // Moves to the leaf set inLeaves, SubdIn of the engine: every leaf, culled or not.
+    SurfaceQueryUpdate Update(const PrimitiveData* inLeaves, uint32_t inLeafCount, ThreadPool& inThreadPool = ThreadPool::GetDefault());
+    // The next Update rebuilds the tree whatever changed.
+    void Invalidate() { mRebuildPending = true; }
+
+    // Closest hit of each ray, one ParallelFor over the batch.
+    void CastRays(const SurfaceRay* inRays, uint32_t inCount, SurfaceHit* outHits, ThreadPool& inThreadPool = ThreadPool::GetDefault()) const;
+    // Topmost surface above each xy: a ray straight down from above the tree. Position.z is
+    // the height.
+    void QueryHeights(const float2* inPoints, uint32_t inCount, SurfaceHit* outHits, ThreadPool& inThreadPool = ThreadPool::GetDefault()) const;
+    SurfaceHit CastRay(const SurfaceRay& inRay) const;
+
+    // The same ray against every triangle of every leaf, to check the tree with.
+    SurfaceHit CastRayBruteForce(const SurfaceRay& inRay) const;
+
+    uint32_t GetLeafCount() const { return (uint32_t)mSlotIndex.size(); }
+    uint32_t GetBucketCount() const { return (uint32_t)mBuckets.size(); }
+
+private:
+    struct Box {
+        float3 Min = float3(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity());
+        float3 Max = float3(-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity());
+
+        void Extend(const Box& inBox);
+        void Extend(const float3& inPoint);
+        // Entry distance of the ray if it meets the box within [0, inMaxDistance].
+        bool Intersect(const float3& inOrigin, const float3& inInverseDirection, float inMaxDistance, float& outDistance) const;
+    };
+
+    static uint64_t GetMapKey(const PrimitiveData& inData) { return (uint64_t)inData.PrimitiveIndex << 32 | inData.SubdBinaryKey; }
+    void EvaluateSlot(uint32_t inSlot);
+    // The bucket of the old leaf whose region holds inData's: an ancestor when it split, a
+    // descendant on the leftmost path when it merged. ~0u when no old leaf covers it.
+    uint32_t FindCoveringBucket(const PrimitiveData& inData) const;
+    void Rebuild(ThreadPool& inThreadPool);
+    void RefitBuckets(const std::vector<uint32_t>& inBuckets);
+    void RefitTree();
+    // Closer hits of the leaf's triangles go to ioHit, with their facet normal.
+    void IntersectSlot(uint32_t inSlot, const SurfaceRay& inRay, bool inTestBox, SurfaceHit& ioHit) const;
+    void FinishHit(const SurfaceRay& inRay, SurfaceHit& ioHit) const;
+
+    SurfaceQueryContext mContext;
+    PatchLevelOffset mPatch;
+
+    // Per slot: the leaf, its patch vertices, its box and its bucket. Free slots hold ~0u
+    // in their bucket and are reused by the next added keys.
+    std::vector<PrimitiveData> mSlotLeaves;
+    std::vector<float3> mSlotVertices;
+    std::vector<Box> mSlotBoxes;
+    std::vector<uint32_t> mSlotBuckets;
+    std::vector<uint32_t> mFreeSlots;
+    std::unordered_map<uint64_t, uint32_t> mSlotIndex;
+
+    // Buckets in Morton order, each a list of slots, and the implicit tree over them: node i
+    // has children 2i and 2i + 1, bucket b is node mLeafNodeBase + b.
+    std::vector<std::vector<uint32_t>> mBuckets;
+    std::vector<Box> mNodes;
+    uint32_t mLeafNodeBase = 1;
+    bool mRebuildPending = true;
+};
+
+}
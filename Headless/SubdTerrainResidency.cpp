@@ -0,0 +1,201 @@
+#include "SubdTerrainResidency.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Headless {
+
+TerrainResidency::TerrainResidency(const TerrainTileFile& inFile, const TerrainResidencyConfig& inConfig)
+    : mFile(inFile), mConfig(inConfig), mTileBytes(inFile.GetHeader().GetTileBytes()), mIoPool(inConfig.IoThreadCount + 1) {
+    uint32_t TileCount = mFile.GetHeader().TileCount;
+    mSlotCount = (uint32_t)std::min<size_t>(std::max<size_t>(mConfig.MemoryBudget / mTileBytes, 2), TileCount);
+    mSlots.resize((size_t)mSlotCount * mTileBytes);
+    for (uint32_t Slot = mSlotCount; Slot-- > 0;) {
+        mFreeSlots.push_back(Slot);
+    }
+    mState.assign(TileCount, TileState::Absent);
+    mSlot.assign(TileCount, 0);
+    mLastRequestFrame.assign(TileCount, 0);
+    mPrev.assign(TileCount, InvalidTile);
+    mNext.assign(TileCount, InvalidTile);
+
+    // The coarsest mip is a single tile covering the whole terrain.
+    mPinnedTile = TileCount - 1;
+    mSlot[mPinnedTile] = mFreeSlots.back();
+    mFreeSlots.pop_back();
+    mStats.BytesRead += mFile.ReadTile(mPinnedTile, &mSlots[(size_t)mSlot[mPinnedTile] * mTileBytes]);
+    mState[mPinnedTile] = TileState::Resident;
+    ++mStats.TilesLoaded;
+    ++mStats.ResidentTiles;
+}
+
+TerrainResidency::~TerrainResidency() {
+    Flush();
+}
+
+void TerrainResidency::LinkFront(uint32_t inTileIndex) {
+    mPrev[inTileIndex] = InvalidTile;
+    mNext[inTileIndex] = mHead;
+    if (mHead != InvalidTile) {
+        mPrev[mHead] = inTileIndex;
+    }
+    mHead = inTileIndex;
+    if (mTail == InvalidTile) {
+        mTail = inTileIndex;
+    }
+}
+
+void TerrainResidency::Unlink(uint32_t inTileIndex) {
+    uint32_t Prev = mPrev[inTileIndex];
+    uint32_t Next = mNext[inTileIndex];
+    (Prev != InvalidTile ? mNext[Prev] : mHead) = Next;
+    (Next != InvalidTile ? mPrev[Next] : mTail) = Prev;
+    mPrev[inTileIndex] = InvalidTile;
+    mNext[inTileIndex] = InvalidTile;
+}
+
+void TerrainResidency::CollectLoads(bool inWait) {
+    std::vector<uint32_t> Loaded;
+    {
+        std::unique_lock<std::mutex> Lock(mLoadMutex);
+        if (inWait) {
+            mLoadDone.wait(Lock, [this] { return mLoaded.size() == mStats.PendingTiles; });
+        }
+        Loaded.swap(mLoaded);
+        mStats.BytesRead += mLoadedBytes;
+        mLoadedBytes = 0;
+    }
+    for (uint32_t Tile : Loaded) {
+        mState[Tile] = TileState::Resident;
+        LinkFront(Tile);
+    }
+    mStats.PendingTiles -= (uint32_t)Loaded.size();
+    mStats.ResidentTiles += (uint32_t)Loaded.size();
+    mStats.TilesLoaded += Loaded.size();
+}
+
+void TerrainResidency::Flush() {
+    CollectLoads(true);
+}
+
+uint32_t TerrainResidency::GetLeafTiles(const SubdMesh& inMesh, const PrimitiveData& inLeaf, std::vector<uint32_t>& outTiles) const {
+    float4 PrimitiveVertices[3];
+    float4 LeafVertices[3];
+    inMesh.GetPrimitiveVertices(inLeaf.PrimitiveIndex, PrimitiveVertices);
+    Subd(inLeaf.SubdBinaryKey, PrimitiveVertices, LeafVertices);
+    float MinU = 1.0f, MinV = 1.0f, MaxU = 0.0f, MaxV = 0.0f;
+    for (const float4& Vertex : LeafVertices) {
+        float U = clamp(Vertex.x * 0.5f + 0.5f, 0.0f, 1.0f);
+        float V = clamp(Vertex.y * 0.5f + 0.5f, 0.0f, 1.0f);
+        MinU = std::min(MinU, U);
+        MinV = std::min(MinV, V);
+        MaxU = std::max(MaxU, U);
+        MaxV = std::max(MaxV, V);
+    }
+
+    const TerrainTileHeader& Header = mFile.GetHeader();
+    float Texels = std::max((MaxU - MinU) * Header.Width, (MaxV - MinV) * Header.Height);
+    int Mip = Texels > mConfig.TexelsPerLeafEdge ? (int)std::floor(std::log2(Texels / mConfig.TexelsPerLeafEdge)) : 0;
+    uint32_t MipIndex = (uint32_t)std::min(Mip, (int)Header.MipCount - 1);
+
+    const TerrainTileMip& MipDesc = mFile.GetMip(MipIndex);
+    auto ToTile = [&](float inCoord, uint32_t inSize, uint32_t inTiles) {
+        return std::min((uint32_t)(inCoord * inSize) / Header.TileSize, inTiles - 1);
+    };
+    uint32_t X0 = ToTile(MinU, MipDesc.Width, MipDesc.TilesX), X1 = ToTile(MaxU, MipDesc.Width, MipDesc.TilesX);
+    uint32_t Y0 = ToTile(MinV, MipDesc.Height, MipDesc.TilesY), Y1 = ToTile(MaxV, MipDesc.Height, MipDesc.TilesY);
+    for (uint32_t y = Y0; y <= Y1; ++y) {
+        for (uint32_t x = X0; x <= X1; ++x) {
+            outTiles.push_back(mFile.GetTileIndex(MipIndex, x, y));
+        }
+    }
+    return MipIndex;
+}
+
+void TerrainResidency::Update(const SubdMesh& inMesh, const PrimitiveData* inLeaves, uint32_t inLeafCount) {
+    CollectLoads(false);
+    ++mFrame;
+    ++mStats.Frames;
+
+    mRequested.clear();
+    for (uint32_t i = 0; i < inLeafCount; ++i) {
+        mLeafTiles.clear();
+        GetLeafTiles(inMesh, inLeaves[i], mLeafTiles);
+        for (uint32_t Tile : mLeafTiles) {
+            if (mLastRequestFrame[Tile] != mFrame) {
+                mLastRequestFrame[Tile] = mFrame;
+                mRequested.push_back(Tile);
+            }
+        }
+    }
+
+    mMissing.clear();
+    for (uint32_t Tile : mRequested) {
+        ++mStats.Requests;
+        if (mState[Tile] == TileState::Resident) {
+            ++mStats.Hits;
+            if (Tile != mPinnedTile) {
+                Unlink(Tile);
+                LinkFront(Tile);
+            }
+        } else if (mState[Tile] == TileState::Absent) {
+            mMissing.push_back(Tile);
+        }
+    }
+
+    // Coarse tiles first: they cover more leaves and are the fallback of the finer ones.
+    // Tile indices grow with the mip.
+    std::sort(mMissing.begin(), mMissing.end(), std::greater<uint32_t>());
+    uint32_t Queued = 0;
+    for (uint32_t Tile : mMissing) {
+        if (Queued == mConfig.MaxLoadsPerFrame) {
+            mStats.Deferred += mMissing.size() - Queued;
+            break;
+        }
+        if (mFreeSlots.empty()) {
+            if (mTail == InvalidTile || mLastRequestFrame[mTail] == mFrame) {
+                mStats.Deferred += mMissing.size() - Queued;
+                break;
+            }
+            uint32_t Victim = mTail;
+            Unlink(Victim);
+            mState[Victim] = TileState::Absent;
+            mFreeSlots.push_back(mSlot[Victim]);
+            --mStats.ResidentTiles;
+            ++mStats.TilesEvicted;
+        }
+        mSlot[Tile] = mFreeSlots.back();
+        mFreeSlots.pop_back();
+        mState[Tile] = TileState::Pending;
+        ++mStats.PendingTiles;
+        ++Queued;
+
+        uint8_t* Payload = &mSlots[(size_t)mSlot[Tile] * mTileBytes];
+        mIoPool.Submit([this, Tile, Payload] {
+            size_t Bytes = mFile.ReadTile(Tile, Payload);
+            std::lock_guard<std::mutex> Lock(mLoadMutex);
+            mLoaded.push_back(Tile);
+            mLoadedBytes += Bytes;
+            mLoadDone.notify_all();
+        });
+    }
+}
+
+const uint8_t* TerrainResidency::GetTileData(uint32_t inTileIndex) const {
+    return mState[inTileIndex] == TileState::Resident ? &mSlots[(size_t)mSlot[inTileIndex] * mTileBytes] : nullptr;
+}
+
+uint32_t TerrainResidency::FindResidentTile(const float2& inUV, uint32_t inMip) const {
+    const TerrainTileHeader& Header = mFile.GetHeader();
+    for (uint32_t Mip = inMip; Mip + 1 < Header.MipCount; ++Mip) {
+        const TerrainTileMip& MipDesc = mFile.GetMip(Mip);
+        uint32_t X = std::min((uint32_t)(clamp(inUV.x, 0.0f, 1.0f) * MipDesc.Width) / Header.TileSize, MipDesc.TilesX - 1);
+        uint32_t Y = std::min((uint32_t)(clamp(inUV.y, 0.0f, 1.0f) * MipDesc.Height) / Header.TileSize, MipDesc.TilesY - 1);
+        uint32_t Tile = mFile.GetTileIndex(Mip, X, Y);
+        if (mState[Tile] == TileState::Resident) {
+            return Tile;
+        }
+    }
+    return mPinnedTile;
+}
+
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "PatchGrid.h"
+#include "SubdEngine.h"
+#include "SubdTerrainTiles.h"
+
+namespace Headless {
+
+struct TerrainResidencyConfig {
+    // Tile payloads kept in memory, coarsest mip included.
+    size_t MemoryBudget = (size_t)256 << 20;
+    // Background loader threads; 0 loads synchronously inside Update.
+    uint32_t IoThreadCount = 2;
+    // Heightmap texels wanted along a leaf: one per patch vertex at the default patch level.
+    float TexelsPerLeafEdge = (float)(1u << (DefaultPatchLevel / 2));
+    // Loads queued per Update; the rest wait for the next frame.
+    uint32_t MaxLoadsPerFrame = 64;
+};
+
+// Running totals since the residency was created.
+struct TerrainResidencyStats {
+    uint64_t Frames = 0;
+    // Distinct tiles asked for by each frame's leaves, summed over frames.
+    uint64_t Requests = 0;
+    // Requests for tiles already resident.
+    uint64_t Hits = 0;
+    uint64_t BytesRead = 0;
+    uint64_t TilesLoaded = 0;
+    uint64_t TilesEvicted = 0;
+    // Missing tiles not queued because the budget was full of tiles in use, or
+    // MaxLoadsPerFrame was reached.
+    uint64_t Deferred = 0;
+    uint32_t ResidentTiles = 0;
+    uint32_t PendingTiles = 0;
+
+    double GetHitRate() const { return Requests > 0 ? (double)Hits / (double)Requests : 1.0; }
+};
+
+// Residency of a TerrainTileFile under a memory budget, driven by the SubdCulledOut leaves:
+// each leaf asks for the tiles under its UV bounds (xy * 0.5 + 0.5, like the heightmap
+// lookup of the shaders) at the mip whose texel spacing matches its patch vertices, so
+// only visible, finely subdivided areas page in mip 0. Tiles live in fixed slots of
+// GetTileBytes() (the CPU side of an atlas); when they run out the least recently
+// requested tile is evicted, never one the current frame asked for. The single tile of
+// the coarsest mip is loaded up front and never evicted, so FindResidentTile always has
+// a fallback.
+//
+// Only TerrainStreamBench drives it for now. The sample still samples the whole heightmap
+// and has no leaf readback or tile atlas to feed it.
+class TerrainResidency {
+public:
+    TerrainResidency(const TerrainTileFile& inFile, const TerrainResidencyConfig& inConfig = TerrainResidencyConfig());
+    ~TerrainResidency();
+
+    TerrainResidency(const TerrainResidency&) = delete;
+    TerrainResidency& operator=(const TerrainResidency&) = delete;
+
+    // One frame: makes finished loads resident, requests the tiles under inLeaves and queues
+    // the missing ones on the loader threads.
+    void Update(const SubdMesh& inMesh, const PrimitiveData* inLeaves, uint32_t inLeafCount);
+    // Waits for the queued loads and makes them resident.
+    void Flush();
+
+    // Tiles under one leaf at the mip its size asks for; returns that mip.
+    uint32_t GetLeafTiles(const SubdMesh& inMesh, const PrimitiveData& inLeaf, std::vector<uint32_t>& outTiles) const;
+
+    // Payload of a resident tile, nullptr otherwise; valid until the next Update.
+    const uint8_t* GetTileData(uint32_t inTileIndex) const;
+    // Finest resident tile covering inUV at inMip or coarser.
+    uint32_t FindResidentTile(const float2& inUV, uint32_t inMip) const;
+
+    const TerrainResidencyStats& GetStats() const { return mStats; }
+    uint32_t GetSlotCount() const { return mSlotCount; }
+    size_t GetResidentBytes() const { return (size_t)mStats.ResidentTiles * mTileBytes; }
+
+private:
+    enum class TileState : uint8_t { Absent, Pending, Resident };
+    static constexpr uint32_t InvalidTile = ~0u;
+
+    void CollectLoads(bool inWait);
+    void LinkFront(uint32_t inTileIndex);
+    void Unlink(uint32_t inTileIndex);
+
+    const TerrainTileFile& mFile;
+    TerrainResidencyConfig mConfig;
+    size_t mTileBytes;
+    uint32_t mSlotCount;
+    uint32_t mPinnedTile;
+    uint32_t mFrame = 0;
+
+    std::vector<uint8_t> mSlots;
+    std::vector<uint32_t> mFreeSlots;
+    std::vector<TileState> mState;
+    std::vector<uint32_t> mSlot;
+    std::vector<uint32_t> mLastRequestFrame;
+    // Resident tiles, most recently requested first.
+    std::vector<uint32_t> mPrev;
+    std::vector<uint32_t> mNext;
+    uint32_t mHead = InvalidTile;
+    uint32_t mTail = InvalidTile;
+
+    std::vector<uint32_t> mRequested;
+    std::vector<uint32_t> mMissing;
+    std::vector<uint32_t> mLeafTiles;
+
+    std::mutex mLoadMutex;
+    std::condition_variable mLoadDone;
+    std::vector<uint32_t> mLoaded;
+    uint64_t mLoadedBytes = 0;
+    TerrainResidencyStats mStats;
+
+    // Last, so the loader threads are joined before anything they touch goes away.
+    ThreadPool mIoPool;
+};
+
+}
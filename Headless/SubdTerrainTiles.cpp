@@ -0,0 +1,178 @@
+#include "SubdTerrainTiles.h"
+#include "SubdHeightmap.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+namespace Headless {
+
+static uint64_t AlignTileOffset(uint64_t inOffset) {
+    return (inOffset + 63) & ~63ull;
+}
+
+// 2x2 box filter with rounding; the last row / column of an odd sized mip is repeated.
+static std::vector<uint16_t> DownsampleHeights(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight, uint32_t inMipWidth, uint32_t inMipHeight,
+    ThreadPool& inThreadPool) {
+    std::vector<uint16_t> Mip((size_t)inMipWidth * inMipHeight);
+    inThreadPool.ParallelFor(inMipHeight, 16, [&](size_t inBegin, size_t inEnd) {
+        for (size_t j = inBegin; j < inEnd; ++j) {
+            const uint16_t* Row0 = inHeights + std::min<size_t>(2 * j, inHeight - 1) * inWidth;
+            const uint16_t* Row1 = inHeights + std::min<size_t>(2 * j + 1, inHeight - 1) * inWidth;
+            for (uint32_t i = 0; i < inMipWidth; ++i) {
+                uint32_t i0 = std::min(2 * i, inWidth - 1);
+                uint32_t i1 = std::min(2 * i + 1, inWidth - 1);
+                Mip[j * inMipWidth + i] = (uint16_t)(((uint32_t)Row0[i0] + Row0[i1] + Row1[i0] + Row1[i1] + 2) / 4);
+            }
+        }
+    });
+    return Mip;
+}
+
+bool WriteTerrainTiles(const std::string& inPath, const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight, uint32_t inTileSize,
+    ThreadPool& inThreadPool) {
+    if (inTileSize == 0 || (inTileSize & (inTileSize - 1)) != 0 || inWidth == 0 || inHeight == 0) {
+        return false;
+    }
+    TerrainTileHeader Header;
+    Header.Width = inWidth;
+    Header.Height = inHeight;
+    Header.TileSize = inTileSize;
+
+    // Mip 0 is read in place; the smaller mips are built up front (a third of the heights).
+    TerrainTileMip Mips[TerrainTileMaxMipCount];
+    std::vector<std::vector<uint16_t>> MipHeights(1);
+    const uint16_t* MipData[TerrainTileMaxMipCount] = { inHeights };
+    for (uint32_t Width = inWidth, Height = inHeight;; Width = (Width + 1) / 2, Height = (Height + 1) / 2) {
+        TerrainTileMip& Mip = Mips[Header.MipCount];
+        Mip.Width = Width;
+        Mip.Height = Height;
+        Mip.TilesX = (Width + inTileSize - 1) / inTileSize;
+        Mip.TilesY = (Height + inTileSize - 1) / inTileSize;
+        Mip.FirstTile = Header.TileCount;
+        Header.TileCount += Mip.TilesX * Mip.TilesY;
+        if (Header.MipCount > 0) {
+            const TerrainTileMip& Parent = Mips[Header.MipCount - 1];
+            MipHeights.push_back(DownsampleHeights(MipData[Header.MipCount - 1], Parent.Width, Parent.Height, Width, Height, inThreadPool));
+            MipData[Header.MipCount] = MipHeights.back().data();
+        }
+        ++Header.MipCount;
+        if ((Width <= inTileSize && Height <= inTileSize) || Header.MipCount == TerrainTileMaxMipCount) {
+            break;
+        }
+    }
+
+    size_t TileBytes = Header.GetTileBytes();
+    uint64_t PayloadStride = AlignTileOffset(TileBytes);
+    std::vector<TerrainTileEntry> Entries(Header.TileCount);
+    uint64_t Offset = AlignTileOffset(sizeof(Header) + Header.MipCount * sizeof(TerrainTileMip) + Header.TileCount * sizeof(TerrainTileEntry));
+    for (TerrainTileEntry& Entry : Entries) {
+        Entry.Offset = Offset;
+        Offset += PayloadStride;
+    }
+
+    // Written to a temporary name first, so an interrupted run never leaves a valid looking file.
+    std::string TempPath = inPath + ".tmp";
+    FILE* File = fopen(TempPath.c_str(), "wb");
+    if (!File) {
+        return false;
+    }
+    static const uint8_t Padding[64] = {};
+    size_t DirectoryBytes = sizeof(Header) + Header.MipCount * sizeof(TerrainTileMip) + Header.TileCount * sizeof(TerrainTileEntry);
+    bool Written = fwrite(&Header, sizeof(Header), 1, File) == 1 && fwrite(Mips, sizeof(TerrainTileMip), Header.MipCount, File) == Header.MipCount
+        && fwrite(Entries.data(), sizeof(TerrainTileEntry), Entries.size(), File) == Entries.size()
+        && fwrite(Padding, 1, Entries[0].Offset - DirectoryBytes, File) == Entries[0].Offset - DirectoryBytes;
+
+    // One row of tiles at a time: the slopes of its rows plus the apron, then the payloads.
+    uint32_t TileWidth = inTileSize + 2 * TerrainTileBorder;
+    std::vector<float> BandSlopes;
+    std::vector<uint8_t> RowPayloads;
+    for (uint32_t m = 0; Written && m < Header.MipCount; ++m) {
+        const TerrainTileMip& Mip = Mips[m];
+        for (uint32_t TileY = 0; Written && TileY < Mip.TilesY; ++TileY) {
+            int64_t FirstRow = (int64_t)TileY * inTileSize - TerrainTileBorder;
+            uint32_t BandBegin = (uint32_t)std::max<int64_t>(FirstRow, 0);
+            uint32_t BandEnd = (uint32_t)std::min<int64_t>(FirstRow + TileWidth, Mip.Height);
+            BandSlopes.resize((size_t)(BandEnd - BandBegin) * Mip.Width * 2);
+            ComputeSlopeRows(MipData[m], Mip.Width, Mip.Height, BandBegin, BandEnd, BandSlopes.data(), inThreadPool);
+
+            RowPayloads.assign(Mip.TilesX * PayloadStride, 0);
+            inThreadPool.ParallelFor(Mip.TilesX, 1, [&](size_t inBegin, size_t inEnd) {
+                for (size_t TileX = inBegin; TileX < inEnd; ++TileX) {
+                    uint16_t* Heights = (uint16_t*)(RowPayloads.data() + TileX * PayloadStride);
+                    float* Slopes = (float*)(Heights + Header.GetTileTexelCount());
+                    int64_t FirstColumn = (int64_t)TileX * inTileSize - TerrainTileBorder;
+                    for (uint32_t y = 0; y < TileWidth; ++y) {
+                        uint32_t Row = (uint32_t)std::min<int64_t>(std::max<int64_t>(FirstRow + y, 0), Mip.Height - 1);
+                        const uint16_t* SourceHeights = MipData[m] + (size_t)Row * Mip.Width;
+                        const float* SourceSlopes = BandSlopes.data() + (size_t)(Row - BandBegin) * Mip.Width * 2;
+                        for (uint32_t x = 0; x < TileWidth; ++x) {
+                            uint32_t Column = (uint32_t)std::min<int64_t>(std::max<int64_t>(FirstColumn + x, 0), Mip.Width - 1);
+                            Heights[y * TileWidth + x] = SourceHeights[Column];
+                            Slopes[2 * (y * TileWidth + x)] = SourceSlopes[2 * Column];
+                            Slopes[2 * (y * TileWidth + x) + 1] = SourceSlopes[2 * Column + 1];
+                        }
+                    }
+                }
+            });
+            Written = fwrite(RowPayloads.data(), 1, RowPayloads.size(), File) == RowPayloads.size();
+        }
+    }
+    if (fclose(File) != 0 || !Written) {
+        std::remove(TempPath.c_str());
+        return false;
+    }
+    std::error_code Error;
+    std::filesystem::rename(TempPath, inPath, Error);
+    return !Error;
+}
+
+bool TerrainTileFile::Open(const std::string& inPath) {
+    Close();
+    if (!mFile.Open(inPath) || mFile.GetSize() < sizeof(TerrainTileHeader)) {
+        Close();
+        return false;
+    }
+    memcpy(&mHeader, mFile.GetData(), sizeof(mHeader));
+    size_t DirectoryBytes = sizeof(mHeader) + (size_t)mHeader.MipCount * sizeof(TerrainTileMip) + (size_t)mHeader.TileCount * sizeof(TerrainTileEntry);
+    bool Valid = mHeader.Magic == TerrainTileMagic && mHeader.Version == TerrainTileVersion && mHeader.MipCount > 0
+        && mHeader.MipCount <= TerrainTileMaxMipCount && mHeader.TileSize > 0 && mFile.GetSize() >= DirectoryBytes;
+    if (Valid) {
+        memcpy(mMips, mFile.GetData() + sizeof(mHeader), mHeader.MipCount * sizeof(TerrainTileMip));
+        mpEntries = (const TerrainTileEntry*)(mFile.GetData() + sizeof(mHeader) + mHeader.MipCount * sizeof(TerrainTileMip));
+        const TerrainTileMip& LastMip = mMips[mHeader.MipCount - 1];
+        Valid = LastMip.FirstTile + LastMip.TilesX * LastMip.TilesY == mHeader.TileCount;
+        for (uint32_t i = 0; Valid && i < mHeader.TileCount; ++i) {
+            Valid = mpEntries[i].Offset + mHeader.GetTileBytes() <= mFile.GetSize();
+        }
+    }
+    if (!Valid) {
+        Close();
+    }
+    return Valid;
+}
+
+void TerrainTileFile::Close() {
+    mFile.Close();
+    mHeader = TerrainTileHeader();
+    mpEntries = nullptr;
+}
+
+void TerrainTileFile::GetTileCoord(uint32_t inTileIndex, uint32_t& outMip, uint32_t& outTileX, uint32_t& outTileY) const {
+    outMip = 0;
+    while (outMip + 1 < mHeader.MipCount && mMips[outMip + 1].FirstTile <= inTileIndex) {
+        ++outMip;
+    }
+    uint32_t Local = inTileIndex - mMips[outMip].FirstTile;
+    outTileX = Local % mMips[outMip].TilesX;
+    outTileY = Local / mMips[outMip].TilesX;
+}
+
+size_t TerrainTileFile::ReadTile(uint32_t inTileIndex, void* outPayload) const {
+    size_t Bytes = mHeader.GetTileBytes();
+    memcpy(outPayload, mFile.GetData() + mpEntries[inTileIndex].Offset, Bytes);
+    return Bytes;
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+namespace Headless {
+
+// Tiled, mip-chained heightmap for terrains larger than memory. Mip 0 is the source; each
+// further mip halves it (2x2 box filter, rounding up odd sizes) until one tile covers it.
+// Every mip is cut into TileSize x TileSize tiles that carry a TerrainTileBorder texel
+// apron copied from their neighbours (clamped at the edge), so a tile filters bilinearly
+// on its own. A tile payload is the R16 heights followed by the RG32Float slopes of
+// ComputeSlopeRows for that mip, for TerrainTileHeader::GetTileTexelCount() texels.
+//
+// TerrainTileHeader, MipCount TerrainTileMip, TileCount TerrainTileEntry, then the payloads,
+// each 64-byte aligned. Tiles are numbered mip by mip, row-major within a mip.
+const uint32_t TerrainTileMagic = 0x454c4954; // "TILE"
+const uint32_t TerrainTileVersion = 1;
+const uint32_t TerrainTileBorder = 1;
+const uint32_t TerrainTileMaxMipCount = 16;
+
+struct TerrainTileHeader {
+    uint32_t Magic = TerrainTileMagic;
+    uint32_t Version = TerrainTileVersion;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t TileSize = 0;
+    uint32_t MipCount = 0;
+    uint32_t TileCount = 0;
+    uint32_t Reserved = 0;
+
+    uint32_t GetTileTexelCount() const { return (TileSize + 2 * TerrainTileBorder) * (TileSize + 2 * TerrainTileBorder); }
+    size_t GetTileBytes() const { return (size_t)GetTileTexelCount() * (sizeof(uint16_t) + 2 * sizeof(float)); }
+};
+
+struct TerrainTileMip {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t TilesX = 0;
+    uint32_t TilesY = 0;
+    uint32_t FirstTile = 0;
+};
+
+struct TerrainTileEntry {
+    uint64_t Offset = 0;
+};
+
+// Builds the mip chain of inHeights and writes every tile; inTileSize must be a power of two.
+bool WriteTerrainTiles(const std::string& inPath, const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight, uint32_t inTileSize,
+    ThreadPool& inThreadPool = ThreadPool::GetDefault());
+
+// Read-only view of a tile file. ReadTile is safe to call from several threads.
+class TerrainTileFile {
+public:
+    bool Open(const std::string& inPath);
+    void Close();
+
+    bool IsOpen() const { return mFile.IsOpen(); }
+    const TerrainTileHeader& GetHeader() const { return mHeader; }
+    const TerrainTileMip& GetMip(uint32_t inMip) const { return mMips[inMip]; }
+    uint32_t GetTileIndex(uint32_t inMip, uint32_t inTileX, uint32_t inTileY) const { return mMips[inMip].FirstTile + inTileY * mMips[inMip].TilesX + inTileX; }
+    // Mip and tile coordinates of a tile index.
+    void GetTileCoord(uint32_t inTileIndex, uint32_t& outMip, uint32_t& outTileX, uint32_t& outTileY) const;
+
+    // Copies the payload of a tile (GetHeader().GetTileBytes()) and returns the bytes read.
+    size_t ReadTile(uint32_t inTileIndex, void* outPayload) const;
+
+private:
+    MappedFile mFile;
+    TerrainTileHeader mHeader;
+    TerrainTileMip mMips[TerrainTileMaxMipCount];
+    const TerrainTileEntry* mpEntries = nullptr;
+};
+
+}
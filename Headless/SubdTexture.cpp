@@ -0,0 +1,55 @@
+#include "SubdTexture.h"
+#include "SubdHeightmap.h"
+#include <cmath>
+
+namespace Headless {
+
+float4 SubdTexture::Load(int inX, int inY) const {
+    inX = std::min(std::max(inX, 0), (int)Width - 1);
+    inY = std::min(std::max(inY, 0), (int)Height - 1);
+    const float* Texel = &Texels[((size_t)inY * Width + inX) * ChannelCount];
+    float4 Result(0.0f, 0.0f, 0.0f, 1.0f);
+    for (uint32_t c = 0; c < ChannelCount && c < 4; ++c) {
+        Result[c] = Texel[c];
+    }
+    return Result;
+}
+
+float4 SubdTexture::SampleLevel(const float2& inUV) const {
+    float X = inUV.x * (float)Width - 0.5f;
+    float Y = inUV.y * (float)Height - 0.5f;
+    float X0 = std::floor(X);
+    float Y0 = std::floor(Y);
+    float FracX = X - X0;
+    float FracY = Y - Y0;
+    int i = (int)X0;
+    int j = (int)Y0;
+
+    float4 Bottom = Load(i, j) + FracX * (Load(i + 1, j) - Load(i, j));
+    float4 Top = Load(i, j + 1) + FracX * (Load(i + 1, j + 1) - Load(i, j + 1));
+    return Bottom + FracY * (Top - Bottom);
+}
+
+SubdTexture CreateSlopeMap(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight) {
+    SubdTexture SlopeMap;
+    SlopeMap.Width = inWidth;
+    SlopeMap.Height = inHeight;
+    SlopeMap.ChannelCount = 2;
+    SlopeMap.Texels.resize((size_t)inWidth * inHeight * 2);
+    ComputeSlopeRows(inHeights, inWidth, inHeight, 0, inHeight, SlopeMap.Texels.data());
+    return SlopeMap;
+}
+
+SubdTexture CreateHeightMap(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight) {
+    SubdTexture HeightMap;
+    HeightMap.Width = inWidth;
+    HeightMap.Height = inHeight;
+    HeightMap.ChannelCount = 1;
+    HeightMap.Texels.resize((size_t)inWidth * inHeight);
+    for (size_t i = 0; i < HeightMap.Texels.size(); ++i) {
+        HeightMap.Texels[i] = inHeights[i] / 65535.0f;
+    }
+    return HeightMap;
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "SubdMath.h"
+
+namespace Headless {
+
+// CPU copy of a float texture, mip 0 only, sampled like the sample's "Linear" sampler:
+// bilinear filtering with clamped U / V. Channels the texture lacks read as (0, 0, 0, 1).
+struct SubdTexture {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t ChannelCount = 0;
+    std::vector<float> Texels;
+
+    float4 Load(int inX, int inY) const;
+    float4 SampleLevel(const float2& inUV) const;
+};
+
+// SlopeMapTexture of AdaptiveSubdivision::LoadTexture: central differences of the R16
+// heights (clamped at the border), scaled to slopes per unit of texture space. See
+// ComputeSlopeRows.
+SubdTexture CreateSlopeMap(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight);
+// HeightMapTexture: the R16 heights as unorm floats.
+SubdTexture CreateHeightMap(const uint16_t* inHeights, uint32_t inWidth, uint32_t inHeight);
+
+}
@@ -0,0 +1,285 @@
+#include "SubdUtils.h"
+#include "SubdKeyTransform.h"
+#include "SubdRoughness.h"
+
+namespace Headless {
+
+void GetChildrenKey(uint32_t inSubdBinaryKey, uint32_t outChildrenKey[2]) {
+    outChildrenKey[0] = (inSubdBinaryKey << 1u) | 0u;
+    outChildrenKey[1] = (inSubdBinaryKey << 1u) | 1u;
+}
+
+uint32_t GetParentKey(uint32_t inSubdBinaryKey) {
+    return (inSubdBinaryKey >> 1u);
+}
+
+bool IsLeafKey(uint32_t inSubdBinaryKey) {
+    return firstbithigh(inSubdBinaryKey) == 31;
+}
+
+bool IsRootKey(uint32_t inSubdBinaryKey) {
+    return (inSubdBinaryKey == 1u);
+}
+
+bool IsChildZeroKey(uint32_t inSubdBinaryKey) {
+    return (inSubdBinaryKey & 1u) == 0u;
+}
+
+float4x4 BitToTransform(uint32_t inSubdBinaryBit) {
+    float DiffValue = float(inSubdBinaryBit) - 0.5f;
+    float4x4 Mat;
+    Mat[0] = float4(DiffValue, -0.5f, 0.0f, 0.0f);
+    Mat[1] = float4(-0.5f, -DiffValue, 0.0f, 0.0f);
+    Mat[2] = float4(0.5f, 0.5f, 1.0f, 0.0f);
+    Mat[3] = float4(0.0f, 0.0f, 0.0f, 1.0f);
+    return Mat;
+}
+
+float4x4 KeyToTransform(uint32_t inSubdBinaryKey) {
+    float4x4 Mat = float4x4::Identity();
+    while (inSubdBinaryKey > 1u) {
+        Mat = mul(Mat, BitToTransform(inSubdBinaryKey & 1u));
+        inSubdBinaryKey = inSubdBinaryKey >> 1u;
+    }
+    return Mat;
+}
+
+float4x4 KeyToTransform(uint32_t inSubdBinaryKey, float4x4& outParentMatrix) {
+    outParentMatrix = KeyToTransform(GetParentKey(inSubdBinaryKey));
+    return KeyToTransform(inSubdBinaryKey);
+}
+
+float4x4 KeyToTransform(uint32_t inSubdBinaryKey, const KeyTransformTable* inKeyTransformTable) {
+    return inKeyTransformTable ? inKeyTransformTable->KeyToTransform(inSubdBinaryKey) : KeyToTransform(inSubdBinaryKey);
+}
+
+float4 Berp(const float4 inVertice[3], const float2& inUV) {
+    return float4(inVertice[0].xyz() + inUV.x * (inVertice[1] - inVertice[0]).xyz() + inUV.y * (inVertice[2] - inVertice[0]).xyz(), 1.0f);
+}
+
+void Subd(uint32_t inSubdBinaryKey, const float4 inVertices[3], float4 outVertices[3], const KeyTransformTable* inKeyTransformTable) {
+    float4x4 ExtractionMat;
+    ExtractionMat[0] = float4(0.0f, 0.0f, 1.0f, 0.0f);
+    ExtractionMat[1] = float4(1.0f, 0.0f, 1.0f, 0.0f);
+    ExtractionMat[2] = float4(0.0f, 1.0f, 1.0f, 0.0f);
+    ExtractionMat[3] = float4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    float4x4 Transform = KeyToTransform(inSubdBinaryKey, inKeyTransformTable);
+    Transform = mul(ExtractionMat, Transform);
+
+    outVertices[0] = Berp(inVertices, Transform[0].xy());
+    outVertices[1] = Berp(inVertices, Transform[1].xy());
+    outVertices[2] = Berp(inVertices, Transform[2].xy());
+}
+
+void Subd(uint32_t inSubdBinaryKey, const float4 inVertices[3], float4 outVertices[3], float4 outParentVertices[3], const KeyTransformTable* inKeyTransformTable) {
+    float4x4 ParentMatrix = KeyToTransform(GetParentKey(inSubdBinaryKey), inKeyTransformTable);
+    float4x4 Transform = KeyToTransform(inSubdBinaryKey, inKeyTransformTable);
+    float2 UV0 = mul(float4(0.0f, 0.0f, 1.0f, 0.0f), Transform).xy();
+    float2 UV1 = mul(float4(1.0f, 0.0f, 1.0f, 0.0f), Transform).xy();
+    float2 UV2 = mul(float4(0.0f, 1.0f, 1.0f, 0.0f), Transform).xy();
+
+    outVertices[0] = Berp(inVertices, UV0);
+    outVertices[1] = Berp(inVertices, UV1);
+    outVertices[2] = Berp(inVertices, UV2);
+
+    UV0 = mul(float4(0.0f, 0.0f, 1.0f, 0.0f), ParentMatrix).xy();
+    UV1 = mul(float4(1.0f, 0.0f, 1.0f, 0.0f), ParentMatrix).xy();
+    UV2 = mul(float4(0.0f, 1.0f, 1.0f, 0.0f), ParentMatrix).xy();
+
+    outParentVertices[0] = Berp(inVertices, UV0);
+    outParentVertices[1] = Berp(inVertices, UV1);
+    outParentVertices[2] = Berp(inVertices, UV2);
+}
+
+float DistanceToLod(float inDistance, const LodKernelConfig& inConfig) {
+    float ImagePlaneSize = 2 * inDistance * std::tan(inConfig.FovX / 2) * inConfig.TargetPixelSize / (float)inConfig.ScreenResolutionWidth;
+    return -std::log2(clamp(ImagePlaneSize, 0.0f, 1.0f));
+}
+
+// A flat region gives log2(0) and ends MaxLodOffset levels under the distance lod.
+float RoughnessToLod(float inLod, float inDistance, float inRoughness, const LodKernelConfig& inConfig) {
+    float PixelWorldSize = 2 * inDistance * std::tan(inConfig.FovX / 2) / (float)inConfig.ScreenResolutionWidth;
+    float ErrorLod = std::log2(std::max(inRoughness * inConfig.RoughnessLodScale, 1e-30f)) - std::log2(PixelWorldSize);
+    return clamp(ErrorLod, inLod - inConfig.MaxLodOffset, inLod + inConfig.MaxLodOffset);
+}
+
+float ComputeLod(const float4 inVertices[3], const float3& inCameraPosW, const LodKernelConfig& inConfig, const RoughnessPyramid* inRoughness) {
+    float Roughness = inRoughness ? GetLodRoughness(inVertices, *inRoughness) : 0.0f;
+    return ComputeLod(GetMiddlePointDistance(inVertices, inCameraPosW), Roughness, inConfig, inRoughness != nullptr);
+}
+
+float GetMiddlePointDistance(const float4 inVertices[3], const float3& inCameraPosW) {
+    return distance((inVertices[1] + inVertices[2]) / 2.0f, float4(inCameraPosW, 1.0f));
+}
+
+float GetMiddlePointDistance(const float4 inVertices[3], const float3& inCameraPosW, const LodKernelConfig& inConfig) {
+    float4 MiddlePoint = (inVertices[1] + inVertices[2]) / 2.0f;
+    float Distance = distance(MiddlePoint, float4(inCameraPosW, 1.0f));
+    for (uint32_t View = 1; View < GetLodViewCount(inConfig); ++View) {
+        const float* PosW = inConfig.ViewPosW[View - 1];
+        Distance = std::min(Distance, distance(MiddlePoint, float4(PosW[0], PosW[1], PosW[2], 1.0f)) * PosW[3]);
+    }
+    return Distance;
+}
+
+float GetLodRoughness(const float4 inVertices[3], const RoughnessPyramid& inRoughness) {
+    float4 MinPosition = min(min(inVertices[0], inVertices[1]), inVertices[2]);
+    float4 MaxPosition = max(max(inVertices[0], inVertices[1]), inVertices[2]);
+    return inRoughness.GetRoughness(float2(MinPosition.x * 0.5f + 0.5f, MinPosition.y * 0.5f + 0.5f), float2(MaxPosition.x * 0.5f + 0.5f, MaxPosition.y * 0.5f + 0.5f));
+}
+
+float ComputeLod(float inDistance, float inRoughness, const LodKernelConfig& inConfig, bool inRoughnessLod) {
+    float Lod = DistanceToLod(inDistance, inConfig);
+    return inRoughnessLod ? RoughnessToLod(Lod, inDistance, inRoughness, inConfig) : Lod;
+}
+
+// DistanceToLod reaches inLod under 2^-inLod / (PixelScale * TargetPixelSize). With
+// ROUGHNESS_LOD, the error lod reaches it under ErrorDistance and the clamp around the
+// distance lod holds it there under NearDistance, and below it past FarDistance (never once
+// inLod <= MaxLodOffset).
+float LodToDistance(float inLod, float inRoughness, const LodKernelConfig& inConfig, bool inRoughnessLod) {
+    float PixelScale = 2 * std::tan(inConfig.FovX / 2) / (float)inConfig.ScreenResolutionWidth;
+    float Distance = std::exp2(-inLod) / (PixelScale * inConfig.TargetPixelSize);
+    if (inRoughnessLod) {
+        float ErrorDistance = std::exp2(std::log2(std::max(inRoughness * inConfig.RoughnessLodScale, 1e-30f)) - inLod) / PixelScale;
+        float NearDistance = std::exp2(-(inLod + inConfig.MaxLodOffset)) / (PixelScale * inConfig.TargetPixelSize);
+        float FarDistance = std::exp2(-(inLod - inConfig.MaxLodOffset)) / (PixelScale * inConfig.TargetPixelSize);
+        Distance = std::max(ErrorDistance, NearDistance);
+        if (inLod - inConfig.MaxLodOffset > 0.0f) {
+            Distance = std::min(Distance, FarDistance);
+        }
+    }
+    return std::min(Distance, 1e30f);
+}
+
+// The camera distance to a point changes by at most the distance the camera moves. The
+// 1e-3 relative margin (about 0.0015 lod) absorbs the rounding of ComputeLod against
+// LodToDistance.
+static float GetLodThresholdSlack(float inDistance, float inThreshold) {
+    return std::fabs(inDistance - inThreshold) - 1e-3f * inThreshold;
+}
+
+float ComputeLodSlack(uint32_t inSubdBinaryKey, float inDistance, float inRoughness, float inParentDistance, float inParentRoughness, const LodKernelConfig& inConfig,
+    bool inRoughnessLod) {
+    int KeyLod = firstbithigh(inSubdBinaryKey);
+    float Slack = 1e30f;
+    if (!IsLeafKey(inSubdBinaryKey)) {
+        Slack = GetLodThresholdSlack(inDistance, LodToDistance((float)(KeyLod + 1), inRoughness, inConfig, inRoughnessLod));
+    }
+    if (!IsRootKey(inSubdBinaryKey)) {
+        Slack = std::min(Slack, GetLodThresholdSlack(inParentDistance, LodToDistance((float)KeyLod, inParentRoughness, inConfig, inRoughnessLod)));
+    }
+    return std::max(Slack, 0.0f);
+}
+
+// inParentLod + 1 wraps like HLSL int addition when the lod saturated to INT_MAX.
+SubdUpdateOp UpdateSubdBuffer(uint32_t inSubdBinaryKey, int inTargetLod, int inParentLod) {
+    int KeyLod = firstbithigh(inSubdBinaryKey);
+    if (KeyLod < inTargetLod && !IsLeafKey(inSubdBinaryKey)) {
+        return SubdUpdateOp::Split;
+    }
+    else if (KeyLod < (int)((uint32_t)inParentLod + 1u)) {
+        return SubdUpdateOp::Keep;
+    }
+    else {
+        if (IsRootKey(inSubdBinaryKey)) {
+            return SubdUpdateOp::Keep;
+        }
+        else if (IsChildZeroKey(inSubdBinaryKey)) {
+            return SubdUpdateOp::Merge;
+        }
+    }
+    return SubdUpdateOp::Drop;
+}
+
+uint32_t GetSubdUpdateKeys(SubdUpdateOp inOp, uint32_t inSubdBinaryKey, uint32_t outKeys[2]) {
+    GetChildrenKey(inSubdBinaryKey, outKeys);
+    if (inOp == SubdUpdateOp::Split) {
+        return 2;
+    }
+    outKeys[0] = inOp == SubdUpdateOp::Merge ? GetParentKey(inSubdBinaryKey) : inSubdBinaryKey;
+    return inOp == SubdUpdateOp::Drop ? 0 : 1;
+}
+
+void GetFrustumPlane(const float4x4& inModelViewProjection, FrustumPlane outFrustumPlane[6]) {
+    float NormalizedNormal = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 2; j++) {
+            FrustumPlane& Plane = outFrustumPlane[i * 2 + j];
+            Plane.Normal.x = (i == 2 && j == 0 ? 0 : inModelViewProjection[0][3]) + (j == 0 ? inModelViewProjection[0][i] : -inModelViewProjection[0][i]);
+            Plane.Normal.y = (i == 2 && j == 0 ? 0 : inModelViewProjection[1][3]) + (j == 0 ? inModelViewProjection[1][i] : -inModelViewProjection[1][i]);
+            Plane.Normal.z = (i == 2 && j == 0 ? 0 : inModelViewProjection[2][3]) + (j == 0 ? inModelViewProjection[2][i] : -inModelViewProjection[2][i]);
+            Plane.Intercept = (i == 2 && j == 0 ? 0 : inModelViewProjection[3][3]) + (j == 0 ? inModelViewProjection[3][i] : -inModelViewProjection[3][i]);
+            NormalizedNormal = length(Plane.Normal);
+            Plane.Normal = Plane.Normal / NormalizedNormal;
+            Plane.Intercept /= NormalizedNormal;
+        }
+    }
+}
+
+static void SetPlanes(float outPlanes[6][4], const float4x4& inModelViewProjection) {
+    FrustumPlane Planes[6];
+    GetFrustumPlane(inModelViewProjection, Planes);
+    for (int i = 0; i < 6; i++) {
+        outPlanes[i][0] = Planes[i].Normal.x;
+        outPlanes[i][1] = Planes[i].Normal.y;
+        outPlanes[i][2] = Planes[i].Normal.z;
+        outPlanes[i][3] = Planes[i].Intercept;
+    }
+}
+
+// lerp(Min, Max, step(0, n)) picks the positive vertex of the box.
+static bool FrustumCullingTest(const float inPlanes[6][4], const float4& inMinPosition, const float4& inMaxPosition) {
+    float Result = 0.0f;
+    for (int i = 0; i < 6 && Result >= 0.0f; i++) {
+        float4 Plane(inPlanes[i][0], inPlanes[i][1], inPlanes[i][2], inPlanes[i][3]);
+        float3 PositivePos(lerp(inMinPosition.x, inMaxPosition.x, step(0.0f, Plane.x)),
+                           lerp(inMinPosition.y, inMaxPosition.y, step(0.0f, Plane.y)),
+                           lerp(inMinPosition.z, inMaxPosition.z, step(0.0f, Plane.z)));
+        Result = dot(Plane, float4(PositivePos, 1.0f));
+    }
+    return (Result >= 0);
+}
+
+void SetFrustumPlanes(LodKernelConfig& ioConfig, const float4x4& inModelViewProjection) {
+    SetPlanes(ioConfig.FrustumPlanes, inModelViewProjection);
+}
+
+bool FrustumCullingTest(const LodKernelConfig& inConfig, const float4& inMinPosition, const float4& inMaxPosition) {
+    return FrustumCullingTest(inConfig.FrustumPlanes, inMinPosition, inMaxPosition);
+}
+
+uint32_t GetLodViewCount(const LodKernelConfig& inConfig) {
+    return std::min(std::max(inConfig.ViewCount, 1u), MaxLodViewCount);
+}
+
+// DistanceToLod reads the distance through 2 tan(FovX / 2) / ScreenResolutionWidth, the
+// world size of a pixel at distance 1, so a view sees at distance d what view 0 sees at
+// d times the ratio of the two.
+void SetLodViews(LodKernelConfig& ioConfig, const SubdView* inViews, uint32_t inViewCount) {
+    ioConfig.ViewCount = std::min(std::max(inViewCount, 1u), MaxLodViewCount);
+    ioConfig.ViewPadding[0] = ioConfig.ViewPadding[1] = ioConfig.ViewPadding[2] = 0;
+    if (inViewCount == 0) {
+        return;
+    }
+    ioConfig.FovX = inViews[0].FovX;
+    ioConfig.ScreenResolutionWidth = inViews[0].ScreenResolutionWidth;
+    SetFrustumPlanes(ioConfig, inViews[0].Camera.ViewProjMat);
+    float PixelScale = std::tan(ioConfig.FovX / 2) / (float)ioConfig.ScreenResolutionWidth;
+    for (uint32_t View = 1; View < ioConfig.ViewCount; ++View) {
+        const SubdView& Source = inViews[View];
+        float* PosW = ioConfig.ViewPosW[View - 1];
+        PosW[0] = Source.Camera.PosW.x;
+        PosW[1] = Source.Camera.PosW.y;
+        PosW[2] = Source.Camera.PosW.z;
+        PosW[3] = std::tan(Source.FovX / 2) / (float)Source.ScreenResolutionWidth / PixelScale;
+        SetPlanes(ioConfig.ViewFrustumPlanes[View - 1], Source.Camera.ViewProjMat);
+    }
+}
+
+bool ViewFrustumCullingTest(const LodKernelConfig& inConfig, uint32_t inView, const float4& inMinPosition, const float4& inMaxPosition) {
+    return FrustumCullingTest(inConfig.ViewFrustumPlanes[inView - 1], inMinPosition, inMaxPosition);
+}
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include "SubdMath.h"
+#include "SubdShared.h"
+
+// Headless port of Data/Utils.hlsl. Function names and argument order follow the
+// shader so the two can be diffed side by side.
+
+namespace Headless {
+
+class KeyTransformTable;
+class RoughnessPyramid;
+
+struct FrustumPlane {
+    float3 Normal;
+    float Intercept;
+};
+
+// Mirrors the program defines that change the behaviour of LodKernel.
+struct LodKernelDefines {
+    bool FreezeSubdivision = false;
+    bool FrustumCulling = true;
+    bool Displace = true;
+    bool KeyTransformTable = false;
+    bool DeterministicCompaction = false;
+    // Only read with FrustumCulling, like OCCLUSION_CULLING.
+    bool OcclusionCulling = false;
+    // ROUGHNESS_LOD: displaced quad leaves over smooth heightmap regions stay coarser.
+    bool RoughnessLod = false;
+    // INCREMENTAL_LOD: keys whose LeafLodState slack outlasts LodKernelConfig::CameraTravel
+    // keep their op without evaluating the lod. Only with the atomic appends, so neither
+    // with FreezeSubdivision nor with DeterministicCompaction.
+    bool IncrementalLod = false;
+    // MULTI_VIEW: the lod is the largest over the LodKernelConfig views, and views 1 and up
+    // each cull into their own list.
+    bool MultiView = false;
+};
+
+// Per-frame camera inputs read from gScene.camera.
+struct SubdCamera {
+    float3 PosW;
+    float4x4 ViewProjMat;
+};
+
+// One view of MULTI_VIEW: a split-screen player, a stereo eye or a shadow cascade seen from
+// its light (perspective only).
+struct SubdView {
+    SubdCamera Camera;
+    float FovX = 0.0f;
+    uint32_t ScreenResolutionWidth = 0;
+};
+
+// What UpdateSubdBuffer writes to SubdOut for one key.
+enum class SubdUpdateOp : uint8_t {
+    Split,  // both children
+    Keep,   // the key itself
+    Merge,  // the parent key (child zero only)
+    Drop    // nothing (child one of a merging pair)
+};
+
+void GetChildrenKey(uint32_t inSubdBinaryKey, uint32_t outChildrenKey[2]);
+uint32_t GetParentKey(uint32_t inSubdBinaryKey);
+bool IsLeafKey(uint32_t inSubdBinaryKey);
+bool IsRootKey(uint32_t inSubdBinaryKey);
+bool IsChildZeroKey(uint32_t inSubdBinaryKey);
+
+float4x4 BitToTransform(uint32_t inSubdBinaryBit);
+float4x4 KeyToTransform(uint32_t inSubdBinaryKey);
+float4x4 KeyToTransform(uint32_t inSubdBinaryKey, float4x4& outParentMatrix);
+// Bit walk when inKeyTransformTable is null, chunked table lookups otherwise.
+float4x4 KeyToTransform(uint32_t inSubdBinaryKey, const KeyTransformTable* inKeyTransformTable);
+
+float4 Berp(const float4 inVertice[3], const float2& inUV);
+void Subd(uint32_t inSubdBinaryKey, const float4 inVertices[3], float4 outVertices[3], const KeyTransformTable* inKeyTransformTable = nullptr);
+void Subd(uint32_t inSubdBinaryKey, const float4 inVertices[3], float4 outVertices[3], float4 outParentVertices[3], const KeyTransformTable* inKeyTransformTable = nullptr);
+
+float DistanceToLod(float inDistance, const LodKernelConfig& inConfig);
+// Lod at which the patch triangles stay within the screen error of SetRoughnessLod over a
+// heightmap region of normalized roughness inRoughness, kept within MaxLodOffset levels of
+// the distance lod inLod.
+float RoughnessToLod(float inLod, float inDistance, float inRoughness, const LodKernelConfig& inConfig);
+// With inRoughness (ROUGHNESS_LOD) the distance lod goes through RoughnessToLod.
+float ComputeLod(const float4 inVertices[3], const float3& inCameraPosW, const LodKernelConfig& inConfig, const RoughnessPyramid* inRoughness = nullptr);
+// The two halves of ComputeLod: the camera distance it measures and the roughness it reads,
+// then the lod of both (inRoughnessLod for ROUGHNESS_LOD).
+float GetMiddlePointDistance(const float4 inVertices[3], const float3& inCameraPosW);
+// MULTI_VIEW: the smallest distance over view 0 (inCameraPosW) and the inConfig views, each
+// scaled to view 0. The views share TargetPixelSize, so its lod is the largest of theirs.
+float GetMiddlePointDistance(const float4 inVertices[3], const float3& inCameraPosW, const LodKernelConfig& inConfig);
+float GetLodRoughness(const float4 inVertices[3], const RoughnessPyramid& inRoughness);
+float ComputeLod(float inDistance, float inRoughness, const LodKernelConfig& inConfig, bool inRoughnessLod);
+// Largest camera distance at which ComputeLod still reaches inLod (>= 1); the lod never
+// grows with the distance.
+float LodToDistance(float inLod, float inRoughness, const LodKernelConfig& inConfig, bool inRoughnessLod);
+// INCREMENTAL_LOD: how far the camera can move before the op of a kept key could change,
+// that is before its lod reaches KeyLod + 1 (a split) or its parent's falls below KeyLod (a
+// merge). Distances and roughness as ComputeLod reads them for the key and its parent.
+float ComputeLodSlack(uint32_t inSubdBinaryKey, float inDistance, float inRoughness, float inParentDistance, float inParentRoughness, const LodKernelConfig& inConfig,
+    bool inRoughnessLod);
+
+// Decision half of UpdateSubdBuffer; the caller performs the writes.
+SubdUpdateOp UpdateSubdBuffer(uint32_t inSubdBinaryKey, int inTargetLod, int inParentLod);
+// Keys inOp writes to SubdOut, returns how many of outKeys are used.
+uint32_t GetSubdUpdateKeys(SubdUpdateOp inOp, uint32_t inSubdBinaryKey, uint32_t outKeys[2]);
+
+void GetFrustumPlane(const float4x4& inModelViewProjection, FrustumPlane outFrustumPlane[6]);
+// Fills LodKernelConfig::FrustumPlanes from GetFrustumPlane.
+void SetFrustumPlanes(LodKernelConfig& ioConfig, const float4x4& inModelViewProjection);
+// Box against the planes of LodKernelConfig::FrustumPlanes.
+bool FrustumCullingTest(const LodKernelConfig& inConfig, const float4& inMinPosition, const float4& inMaxPosition);
+
+// MULTI_VIEW views of inConfig, ViewCount clamped to [1, MaxLodViewCount].
+uint32_t GetLodViewCount(const LodKernelConfig& inConfig);
+// Fills FovX, ScreenResolutionWidth and FrustumPlanes from inViews[0], whose camera is the
+// one LodKernel is given, and ViewCount, ViewPosW and ViewFrustumPlanes from the others (at
+// most MaxLodViewCount views in all).
+void SetLodViews(LodKernelConfig& ioConfig, const SubdView* inViews, uint32_t inViewCount);
+// Box against the frustum planes of view inView >= 1.
+bool ViewFrustumCullingTest(const LodKernelConfig& inConfig, uint32_t inView, const float4& inMinPosition, const float4& inMaxPosition);
+
+}
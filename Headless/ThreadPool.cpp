@@ -0,0 +1,111 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace Headless {
+
+static thread_local bool IsPoolWorker = false;
+
+ThreadPool::ThreadPool(uint32_t inThreadCount) {
+    if (inThreadCount == 0) {
+        inThreadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (uint32_t i = 1; i < inThreadCount; ++i) {
+        mWorkers.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mStop = true;
+    }
+    mTaskReady.notify_all();
+    for (std::thread& Worker : mWorkers) {
+        Worker.join();
+    }
+}
+
+void ThreadPool::WorkerLoop() {
+    IsPoolWorker = true;
+    for (;;) {
+        std::function<void()> Task;
+        {
+            std::unique_lock<std::mutex> Lock(mMutex);
+            mTaskReady.wait(Lock, [this] { return mStop || !mTasks.empty(); });
+            if (mStop && mTasks.empty()) {
+                return;
+            }
+            Task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+        Task();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> inTask) {
+    if (mWorkers.empty()) {
+        inTask();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mTasks.push_back(std::move(inTask));
+    }
+    mTaskReady.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t inCount, size_t inGrainSize, const std::function<void(size_t inBegin, size_t inEnd)>& inFunc) {
+    if (inCount == 0) {
+        return;
+    }
+    inGrainSize = std::max<size_t>(1, inGrainSize);
+    size_t GrainCount = (inCount + inGrainSize - 1) / inGrainSize;
+    if (GrainCount == 1 || mWorkers.empty() || IsPoolWorker) {
+        inFunc(0, inCount);
+        return;
+    }
+
+    struct Job {
+        std::atomic<size_t> NextGrain{ 0 };
+        std::atomic<size_t> ActiveHelpers{ 0 };
+        std::mutex DoneMutex;
+        std::condition_variable Done;
+    };
+    auto SharedJob = std::make_shared<Job>();
+
+    auto RunGrains = [SharedJob, inCount, inGrainSize, GrainCount, &inFunc]() {
+        for (;;) {
+            size_t Grain = SharedJob->NextGrain.fetch_add(1);
+            if (Grain >= GrainCount) {
+                return;
+            }
+            size_t Begin = Grain * inGrainSize;
+            inFunc(Begin, std::min(inCount, Begin + inGrainSize));
+        }
+    };
+
+    size_t HelperCount = std::min(mWorkers.size(), GrainCount - 1);
+    SharedJob->ActiveHelpers = HelperCount;
+    for (size_t i = 0; i < HelperCount; ++i) {
+        Submit([SharedJob, RunGrains]() {
+            RunGrains();
+            if (SharedJob->ActiveHelpers.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> Lock(SharedJob->DoneMutex);
+                SharedJob->Done.notify_all();
+            }
+        });
+    }
+    RunGrains();
+
+    std::unique_lock<std::mutex> Lock(SharedJob->DoneMutex);
+    SharedJob->Done.wait(Lock, [&SharedJob] { return SharedJob->ActiveHelpers.load() == 0; });
+}
+
+ThreadPool& ThreadPool::GetDefault() {
+    static ThreadPool DefaultPool;
+    return DefaultPool;
+}
+
+}
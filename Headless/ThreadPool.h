@@ -0,0 +1,42 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Headless {
+
+// Fixed set of worker threads shared by every headless kernel. ParallelFor splits a
+// range into grains that the workers and the calling thread pull from a shared
+// counter; calls made from inside a worker run inline so kernels may nest.
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t inThreadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Worker threads plus the calling thread.
+    uint32_t GetThreadCount() const { return (uint32_t)mWorkers.size() + 1; }
+
+    void Submit(std::function<void()> inTask);
+    void ParallelFor(size_t inCount, size_t inGrainSize, const std::function<void(size_t inBegin, size_t inEnd)>& inFunc);
+
+    static ThreadPool& GetDefault();
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> mWorkers;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mTaskReady;
+    bool mStop = false;
+};
+
+}
@@ -0,0 +1,170 @@
+// Headless benchmark suite: the camera paths of the sample's "Run Benchmark"
+// (Headless/SubdBenchmark.h) played on SubdEngine, so builds can be compared without a GPU.
+// Each path starts from the root keys and runs one LodKernel pass per frame, like the
+// sample's default; the terrain is a synthetic displaced heightmap, the orbit subdivides
+// Suzanne.obj. Per frame it records the LodKernel and IndirectBatcherKernel times, the
+// LeafVertexKernel time standing in for RenderKernel, and the leaf counts; the report is
+// saved as JSON and compared with a baseline when one is given.
+//
+// BenchmarkSuite [output json] [baseline json] [label] [model obj]
+// BenchmarkSuite compare <baseline json> <current json>
+//
+// Either form exits with 1 when a metric regressed beyond BenchmarkTolerance. compare also
+// takes the sample's reports; times are only compared between reports of the same source.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Headless/PatchGrid.h"
+#include "Headless/SubdBenchmark.h"
+#include "Headless/SubdEngine.h"
+#include "Headless/SubdLeafVertex.h"
+#include "Headless/SubdObjLoader.h"
+
+using namespace Headless;
+
+// The sample's default "Target Pixel Size".
+static const float TargetPixelSize = 5.0f;
+
+static float GetTerrainHeight(float inX, float inY) {
+    float Ridge = std::max(0.0f, std::sin(6.2831853f * 1.5f * inX) * std::cos(6.2831853f * inY));
+    float Band = std::exp(-(inY - 0.5f) * (inY - 0.5f) / 0.01f);
+    return 0.1f + 0.35f * Ridge * Ridge + 0.03f * Band * std::sin(6.2831853f * 23.0f * (inX + inY));
+}
+
+static int PrintRegressions(const BenchmarkReport& inBaseline, const BenchmarkReport& inCurrent) {
+    if (inBaseline.Source != inCurrent.Source) {
+        printf("baseline from %s, current from %s: times not compared\n", inBaseline.Source.c_str(), inCurrent.Source.c_str());
+    }
+    std::vector<BenchmarkRegression> Regressions = CompareBenchmarkReports(inBaseline, inCurrent);
+    for (const BenchmarkRegression& Regression : Regressions) {
+        printf("  %-14s %-30s %12.4f -> %12.4f\n", Regression.Run.c_str(), Regression.Metric.c_str(), Regression.Baseline, Regression.Current);
+    }
+    printf("%zu regressions against %s\n", Regressions.size(), inBaseline.Label.empty() ? "the baseline" : inBaseline.Label.c_str());
+    return Regressions.empty() ? 0 : 1;
+}
+
+static int Compare(const char* inBaselinePath, const char* inCurrentPath) {
+    BenchmarkReport Baseline, Current;
+    if (!LoadBenchmarkReport(inBaselinePath, Baseline)) {
+        printf("could not read %s\n", inBaselinePath);
+        return 1;
+    }
+    if (!LoadBenchmarkReport(inCurrentPath, Current)) {
+        printf("could not read %s\n", inCurrentPath);
+        return 1;
+    }
+    return PrintRegressions(Baseline, Current);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "compare") == 0) {
+        if (argc < 4) {
+            printf("usage: BenchmarkSuite compare <baseline json> <current json>\n");
+            return 1;
+        }
+        return Compare(argv[2], argv[3]);
+    }
+    const char* OutputPath = argc > 1 ? argv[1] : "Benchmark.json";
+    const char* BaselinePath = argc > 2 && argv[2][0] ? argv[2] : nullptr;
+    const char* ModelPath = argc > 4 ? argv[4] : "Data/Suzanne.obj";
+
+    const uint32_t Size = 1024;
+    std::vector<uint16_t> Heights((size_t)Size * Size);
+    for (uint32_t j = 0; j < Size; ++j) {
+        for (uint32_t i = 0; i < Size; ++i) {
+            float z = GetTerrainHeight((float)i / Size, (float)j / Size);
+            Heights[(size_t)j * Size + i] = (uint16_t)(std::min(std::max(z, 0.0f), 1.0f) * 65535.0f);
+        }
+    }
+    ThreadPool Pool(0);
+    HeightBoundsPyramid Bounds;
+    Bounds.Build(Heights.data(), Size, Size, Pool);
+    SubdTexture SlopeMap = CreateSlopeMap(Heights.data(), Size, Size);
+    SubdMesh Quad = SubdMesh::CreateQuad();
+    SubdMesh Model;
+    bool HasModel = LoadObjMesh(ModelPath, Model, ObjLoadConfig(), nullptr, Pool);
+    if (!HasModel) {
+        printf("could not read %s, skipping the model paths\n", ModelPath);
+    }
+
+    CameraProjection Projection;
+    LodKernelConfig Config = {};
+    Config.FovX = Projection.GetFovX();
+    Config.TargetPixelSize = GetPatchTargetPixelSize(TargetPixelSize, DefaultPatchLevel);
+    Config.ScreenResolutionWidth = Projection.ScreenResolutionWidth;
+    Config.DisplacementFactor = 0.3f;
+
+    BenchmarkReport Report;
+    Report.Source = "SubdEngine";
+    Report.Label = argc > 3 ? argv[3] : "";
+    printf("%-14s %7s %10s %10s %10s %10s %10s %11s\n", "path", "frames", "leaves", "visible", "lod ms", "lod p95", "render ms", "converging");
+    for (const BenchmarkPath& Path : GetBenchmarkPaths()) {
+        if (Path.Model && !HasModel) {
+            continue;
+        }
+        // The sample draws the model without displacement or Phong tessellation.
+        const SubdMesh& Mesh = Path.Model ? Model : Quad;
+        LodKernelDefines Defines;
+        Defines.Displace = !Path.Model;
+        RenderKernelContext Context;
+        Context.Mesh = &Mesh;
+        Context.SlopeMap = &SlopeMap;
+        Context.DisplacementFactor = Config.DisplacementFactor;
+        Context.PhongTessellation = !Path.Model;
+
+        SubdEngine Engine(Mesh, SubdBufferSize, &Pool);
+        Engine.LoadBuffer(Mesh.CreateRootKeys());
+        if (!Path.Model) {
+            Engine.SetHeightBounds(&Bounds);
+        }
+        std::vector<LeafVertexData> LeafVertices(SubdBufferSize);
+
+        BenchmarkRun Run;
+        Run.Name = Path.Name;
+        Run.Frames.resize(Path.GetFrameCount());
+        for (uint32_t Frame = 0; Frame < Run.Frames.size(); ++Frame) {
+            SubdCamera Camera = Path.Path.GetCamera(Path.GetFrameTime(Frame), Projection);
+            Engine.Update(Camera, Config, Defines);
+            auto Start = std::chrono::high_resolution_clock::now();
+            LeafVertexKernel(Context, Engine.GetSubdCulledOut(), Engine.GetSubdCulledOutCount(), LeafVertices.data(), Pool);
+            double RenderMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+
+            SubdStats Stats = GetSubdStats(Engine.GetReadback(), SubdBufferSize, Frame);
+            BenchmarkFrame& Record = Run.Frames[Frame];
+            Record.LodKernelMs = (float)Engine.GetPassTimings().LodKernelMs;
+            Record.IndirectBatcherKernelMs = (float)Engine.GetPassTimings().IndirectBatcherKernelMs;
+            Record.RenderMs = (float)RenderMs;
+            Record.LeafCount = Stats.LeafCount;
+            Record.VisibleCount = Stats.VisibleCount;
+            Record.CulledCount = Stats.CulledCount;
+            Record.ConvergenceIterations = Stats.ConvergenceIterations;
+            Record.Converged = Stats.Converged;
+        }
+
+        BenchmarkSummary Summary = GetBenchmarkSummary(Run);
+        printf("%-14s %7zu %10.0f %10.0f %10.3f %10.3f %10.3f %11u\n", Run.Name.c_str(), Run.Frames.size(), Summary.LeafCount.Mean, Summary.VisibleCount.Mean,
+            Summary.LodKernelMs.Mean, Summary.LodKernelMs.P95, Summary.RenderMs.Mean, Summary.ConvergenceFrames);
+        Report.Runs.push_back(std::move(Run));
+    }
+
+    // The saved report must read back into the same runs, metric for metric.
+    BenchmarkReport Saved;
+    if (!SaveBenchmarkReport(OutputPath, Report) || !LoadBenchmarkReport(OutputPath, Saved)) {
+        printf("could not write %s\n", OutputPath);
+        return 1;
+    }
+    BenchmarkTolerance Exact;
+    Exact.TimeRatio = Exact.MinTimeMs = Exact.CountRatio = 0.0;
+    Exact.ConvergenceFrames = 0;
+    if (Saved.Runs.size() != Report.Runs.size() || !CompareBenchmarkReports(Report, Saved, Exact).empty() || !CompareBenchmarkReports(Saved, Report, Exact).empty()) {
+        printf("%s does not read back\nFAILED\n", OutputPath);
+        return 1;
+    }
+    printf("saved %s\n", OutputPath);
+    return BaselinePath ? Compare(BaselinePath, OutputPath) : 0;
+}
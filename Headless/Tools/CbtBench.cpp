@@ -0,0 +1,86 @@
+// SubdEngine (ping-pong SubdIn / SubdOut buffers) against SubdCbtEngine (concurrent
+// binary tree) over a range of target pixel sizes: frame time once converged, memory,
+// key counts, overflow of the fixed buffers and how far the two key sets differ.
+//
+// CbtBench [frames] [cbt max depth] [threads] [target pixel sizes...]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Headless/SubdCbtEngine.h"
+
+using namespace Headless;
+
+static std::vector<uint64_t> SortedKeys(const PrimitiveData* inKeys, size_t inCount) {
+    std::vector<uint64_t> Keys(inCount);
+    for (size_t i = 0; i < inCount; ++i) {
+        Keys[i] = ((uint64_t)inKeys[i].PrimitiveIndex << 32) | inKeys[i].SubdBinaryKey;
+    }
+    std::sort(Keys.begin(), Keys.end());
+    return Keys;
+}
+
+int main(int argc, char** argv) {
+    int Frames = argc > 1 ? atoi(argv[1]) : 40;
+    uint32_t MaxDepth = argc > 2 ? (uint32_t)atoi(argv[2]) : CbtMaxDepth;
+    uint32_t Threads = argc > 3 ? (uint32_t)atoi(argv[3]) : 0;
+    std::vector<float> TargetPixelSizes = { 5.0f, 1.0f, 0.2f, 0.05f, 0.02f, 0.01f, 0.005f };
+    if (argc > 4) {
+        TargetPixelSizes.clear();
+        for (int i = 4; i < argc; ++i) {
+            TargetPixelSizes.push_back((float)atof(argv[i]));
+        }
+    }
+    const int TimedFrames = std::min(10, Frames);
+
+    ThreadPool Pool(Threads);
+    SubdMesh Mesh = SubdMesh::CreateQuad();
+    float FovY = 2.0f * std::atan(24.0f / 42.0f);
+    SubdCamera Camera;
+    Camera.PosW = float3(-0.9f, -0.9f, 0.05f);
+    Camera.ViewProjMat = CreateViewProjMat(Camera.PosW, float3(0.5f, 0.5f, 0.0f), float3(0.0f, 0.0f, 1.0f), FovY, 1920.0f / 1080.0f, 0.0001f, 95.0f);
+    LodKernelConfig Config;
+    Config.FovX = FovY * 1920.0f / 1080.0f;
+    Config.ScreenResolutionWidth = 1920;
+    Config.DisplacementFactor = 0.3f;
+    LodKernelDefines Defines;
+
+    size_t PingPongBytes = 3 * SubdBufferSize * sizeof(PrimitiveData);
+    printf("%u threads, ping-pong %zu keys (%.1f MB), CBT max depth %u\n", Pool.GetThreadCount(), SubdBufferSize, PingPongBytes / 1048576.0, MaxDepth);
+    printf("pixel   | ping-pong keys  culled   ms/frame  overflow | CBT leaves  culled   ms/frame  MB (tree + leaves) | keys only in one\n");
+
+    for (float TargetPixelSize : TargetPixelSizes) {
+        Config.TargetPixelSize = TargetPixelSize;
+
+        SubdEngine PingPong(Mesh, SubdBufferSize, &Pool);
+        SubdCbtEngine Cbt(Mesh, MaxDepth, &Pool);
+        double PingPongSeconds = 0.0, CbtSeconds = 0.0;
+        bool Overflow = false;
+        for (int Frame = 0; Frame < Frames; ++Frame) {
+            auto Start = std::chrono::high_resolution_clock::now();
+            PingPong.Update(Camera, Config, Defines);
+            auto Middle = std::chrono::high_resolution_clock::now();
+            Cbt.Update(Camera, Config, Defines);
+            auto End = std::chrono::high_resolution_clock::now();
+            if (Frame >= Frames - TimedFrames) {
+                PingPongSeconds += std::chrono::duration<double>(Middle - Start).count();
+                CbtSeconds += std::chrono::duration<double>(End - Middle).count();
+            }
+            Overflow |= PingPong.GetBufferCounter().SubdInCount > SubdBufferSize;
+        }
+
+        std::vector<uint64_t> PingPongKeys = SortedKeys(PingPong.GetSubdIn(), PingPong.GetSubdInCount());
+        std::vector<PrimitiveData> Leaves = Cbt.GetLeaves();
+        std::vector<uint64_t> CbtKeys = SortedKeys(Leaves.data(), Leaves.size());
+        std::vector<uint64_t> Difference;
+        std::set_symmetric_difference(PingPongKeys.begin(), PingPongKeys.end(), CbtKeys.begin(), CbtKeys.end(), std::back_inserter(Difference));
+
+        printf("%-7g | %14u  %7u  %8.2f  %-8s | %10u  %7u  %8.2f  %6.1f + %-10.1f | %zu\n", TargetPixelSize, PingPong.GetBufferCounter().SubdInCount,
+            PingPong.GetSubdCulledOutCount(), PingPongSeconds * 1e3 / TimedFrames, Overflow ? "yes" : "no", Cbt.GetLeafCount(), Cbt.GetSubdCulledOutCount(),
+            CbtSeconds * 1e3 / TimedFrames, Cbt.GetTreeByteSize() / 1048576.0, Cbt.GetLeafByteSize() / 1048576.0, Difference.size());
+    }
+    return 0;
+}
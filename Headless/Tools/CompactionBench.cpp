@@ -0,0 +1,105 @@
+// LodKernel with the atomic appends against the DeterministicCompaction count / scan /
+// scatter, from 1 thread up to the whole machine. Checks that both produce the same
+// key sets and that the compacted SubdOut / SubdCulledOut order never changes.
+//
+// CompactionBench [target pixel size] [repeats] [max threads]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "Headless/SubdEngine.h"
+
+using namespace Headless;
+
+static uint64_t HashKeys(const PrimitiveData* inKeys, uint32_t inCount, bool inSorted) {
+    std::vector<uint64_t> Keys(inCount);
+    for (uint32_t i = 0; i < inCount; ++i) {
+        Keys[i] = ((uint64_t)inKeys[i].PrimitiveIndex << 32) | inKeys[i].SubdBinaryKey;
+    }
+    if (inSorted) {
+        std::sort(Keys.begin(), Keys.end());
+    }
+    uint64_t Hash = 1469598103934665603ull;
+    for (uint64_t Key : Keys) {
+        Hash = (Hash ^ Key) * 1099511628211ull;
+    }
+    return Hash;
+}
+
+struct FrameHashes {
+    uint64_t SubdOutSet = 0, SubdOutOrder = 0;
+    uint64_t CulledSet = 0, CulledOrder = 0;
+};
+
+int main(int argc, char** argv) {
+    float TargetPixelSize = argc > 1 ? (float)atof(argv[1]) : 0.05f;
+    int Repeats = argc > 2 ? atoi(argv[2]) : 5;
+    uint32_t MaxThreads = argc > 3 ? (uint32_t)atoi(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+
+    SubdMesh Mesh = SubdMesh::CreateQuad();
+    float FovY = 2.0f * std::atan(24.0f / 42.0f);
+    SubdCamera Camera;
+    Camera.PosW = float3(-0.9f, -0.9f, 0.05f);
+    Camera.ViewProjMat = CreateViewProjMat(Camera.PosW, float3(0.5f, 0.5f, 0.0f), float3(0.0f, 0.0f, 1.0f), FovY, 1920.0f / 1080.0f, 0.0001f, 95.0f);
+    LodKernelConfig Config;
+    Config.FovX = FovY * 1920.0f / 1080.0f;
+    Config.TargetPixelSize = TargetPixelSize;
+    Config.ScreenResolutionWidth = 1920;
+    Config.DisplacementFactor = 0.3f;
+    LodKernelDefines Defines;
+
+    // Converge once, then time single frames over that SubdIn.
+    SubdEngine Warmup(Mesh);
+    for (int Frame = 0; Frame < 40; ++Frame) {
+        Warmup.Update(Camera, Config, Defines);
+    }
+    std::vector<PrimitiveData> SubdIn(Warmup.GetSubdIn(), Warmup.GetSubdIn() + Warmup.GetSubdInCount());
+    printf("SubdIn %zu keys, up to %u threads\n", SubdIn.size(), MaxThreads);
+
+    std::vector<uint32_t> ThreadCounts;
+    for (uint32_t Threads = 1; Threads < MaxThreads; Threads *= 2) {
+        ThreadCounts.push_back(Threads);
+    }
+    ThreadCounts.push_back(MaxThreads);
+
+    bool HaveReference[2] = { false, false };
+    FrameHashes Reference[2];
+    bool SetMismatch = false, OrderMismatch = false;
+    for (uint32_t Threads : ThreadCounts) {
+        ThreadPool Pool(Threads);
+        SubdEngine Engine(Mesh, SubdBufferSize, &Pool);
+        for (int Mode = 0; Mode < 2; ++Mode) {
+            Defines.DeterministicCompaction = Mode == 1;
+            double BestSeconds = 1e30;
+            FrameHashes Hashes;
+            for (int r = 0; r < Repeats; ++r) {
+                Engine.LoadBuffer(SubdIn);
+                auto Start = std::chrono::high_resolution_clock::now();
+                Engine.Update(Camera, Config, Defines);
+                BestSeconds = std::min(BestSeconds, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count());
+
+                Hashes.SubdOutSet = HashKeys(Engine.GetSubdIn(), Engine.GetSubdInCount(), true);
+                Hashes.SubdOutOrder = HashKeys(Engine.GetSubdIn(), Engine.GetSubdInCount(), false);
+                Hashes.CulledSet = HashKeys(Engine.GetSubdCulledOut(), Engine.GetSubdCulledOutCount(), true);
+                Hashes.CulledOrder = HashKeys(Engine.GetSubdCulledOut(), Engine.GetSubdCulledOutCount(), false);
+                if (!HaveReference[Mode]) {
+                    Reference[Mode] = Hashes;
+                    HaveReference[Mode] = true;
+                }
+                SetMismatch |= Hashes.SubdOutSet != Reference[0].SubdOutSet || Hashes.CulledSet != Reference[0].CulledSet;
+                if (Mode == 1) {
+                    OrderMismatch |= Hashes.SubdOutOrder != Reference[1].SubdOutOrder || Hashes.CulledOrder != Reference[1].CulledOrder;
+                }
+            }
+            printf("%-6s %2u thread(s)  %8.3f ms  %8.2f Mkeys/s  SubdOut %u  SubdCulledOut %u  order %016llx\n", Mode == 1 ? "scan" : "atomic", Threads,
+                BestSeconds * 1e3, SubdIn.size() / BestSeconds / 1e6, Engine.GetSubdInCount(), Engine.GetSubdCulledOutCount(),
+                (unsigned long long)(Hashes.SubdOutOrder ^ Hashes.CulledOrder));
+        }
+    }
+    printf("key sets %s, scan order %s\n", SetMismatch ? "DIFFER" : "match", OrderMismatch ? "CHANGED" : "stable");
+    return SetMismatch || OrderMismatch ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+// One LodKernel pass per frame against the "Converge In Frame" mode, starting from the
+// InitSubdBuffer roots and after a camera teleport: frames until the key set stops
+// changing, LodKernel passes per converging frame and their cost, for the ping-pong
+// buffers and the CBT. Checks that both modes settle on the same key set.
+//
+// ConvergenceBench [target pixel size] [max iterations] [threads]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Headless/SubdCbtEngine.h"
+
+using namespace Headless;
+
+static std::vector<uint64_t> SortedKeys(const PrimitiveData* inKeys, size_t inCount) {
+    std::vector<uint64_t> Keys(inCount);
+    for (size_t i = 0; i < inCount; ++i) {
+        Keys[i] = ((uint64_t)inKeys[i].PrimitiveIndex << 32) | inKeys[i].SubdBinaryKey;
+    }
+    std::sort(Keys.begin(), Keys.end());
+    return Keys;
+}
+
+static SubdCamera CreateCamera(const float3& inPosW, const float3& inTarget) {
+    float FovY = 2.0f * std::atan(24.0f / 42.0f);
+    SubdCamera Camera;
+    Camera.PosW = inPosW;
+    Camera.ViewProjMat = CreateViewProjMat(inPosW, inTarget, float3(0.0f, 0.0f, 1.0f), FovY, 1920.0f / 1080.0f, 0.0001f, 95.0f);
+    return Camera;
+}
+
+struct ConvergenceResult {
+    int Frames = 0;
+    uint32_t Passes = 0;
+    double Ms = 0.0;
+    std::vector<uint64_t> Keys;
+};
+
+// Runs frames until one leaves the key set unchanged; with inMaxIterations > 1 each frame
+// is a Converge call.
+template<typename EngineType, typename KeysFunc>
+static ConvergenceResult RunUntilStable(EngineType& ioEngine, const SubdCamera& inCamera, const LodKernelConfig& inConfig, uint32_t inMaxIterations,
+    KeysFunc&& inGetKeys) {
+    ConvergenceResult Result;
+    LodKernelDefines Defines;
+    std::vector<uint64_t> Previous = inGetKeys(ioEngine);
+    for (Result.Frames = 1; Result.Frames <= 200; ++Result.Frames) {
+        auto Start = std::chrono::high_resolution_clock::now();
+        Result.Passes += ioEngine.Converge(inCamera, inConfig, Defines, inMaxIterations);
+        Result.Ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+        std::vector<uint64_t> Keys = inGetKeys(ioEngine);
+        bool Stable = Keys == Previous;
+        Previous.swap(Keys);
+        if (Stable) {
+            break;
+        }
+    }
+    Result.Keys.swap(Previous);
+    return Result;
+}
+
+int main(int argc, char** argv) {
+    float TargetPixelSize = argc > 1 ? (float)atof(argv[1]) : 0.2f;
+    uint32_t MaxIterations = argc > 2 ? (uint32_t)atoi(argv[2]) : 32;
+    uint32_t Threads = argc > 3 ? (uint32_t)atoi(argv[3]) : 0;
+
+    ThreadPool Pool(Threads);
+    SubdMesh Mesh = SubdMesh::CreateQuad();
+    LodKernelConfig Config;
+    Config.FovX = 2.0f * std::atan(24.0f / 42.0f) * 1920.0f / 1080.0f;
+    Config.TargetPixelSize = TargetPixelSize;
+    Config.ScreenResolutionWidth = 1920;
+    Config.DisplacementFactor = 0.3f;
+
+    SubdCamera Start = CreateCamera(float3(-0.9f, -0.9f, 0.05f), float3(0.5f, 0.5f, 0.0f));
+    SubdCamera Teleport = CreateCamera(float3(0.9f, 0.8f, 0.03f), float3(-0.5f, -0.4f, 0.0f));
+
+    auto PingPongKeys = [](const SubdEngine& inEngine) { return SortedKeys(inEngine.GetSubdIn(), inEngine.GetSubdInCount()); };
+    auto CbtKeys = [](const SubdCbtEngine& inEngine) {
+        std::vector<PrimitiveData> Leaves = inEngine.GetLeaves();
+        return SortedKeys(Leaves.data(), Leaves.size());
+    };
+
+    printf("%u threads, target pixel size %g, at most %u passes per frame\n", Pool.GetThreadCount(), TargetPixelSize, MaxIterations);
+    printf("storage    case      | passes/frame  frames  passes  ms total  keys     | same keys as 1 pass/frame\n");
+    const char* Cases[2] = { "start", "teleport" };
+    for (int Storage = 0; Storage < 2; ++Storage) {
+        for (uint32_t Iterations : { 1u, MaxIterations }) {
+            SubdEngine PingPong(Mesh, SubdBufferSize, &Pool);
+            SubdCbtEngine Cbt(Mesh, CbtMaxDepth, &Pool);
+            for (int Case = 0; Case < 2; ++Case) {
+                const SubdCamera& Camera = Case == 0 ? Start : Teleport;
+                ConvergenceResult Result = Storage == 0 ? RunUntilStable(PingPong, Camera, Config, Iterations, PingPongKeys)
+                                                        : RunUntilStable(Cbt, Camera, Config, Iterations, CbtKeys);
+
+                // Reference: a fresh engine walked to the same camera one pass per frame.
+                SubdEngine RefPingPong(Mesh, SubdBufferSize, &Pool);
+                SubdCbtEngine RefCbt(Mesh, CbtMaxDepth, &Pool);
+                std::vector<uint64_t> RefKeys;
+                for (int RefCase = 0; RefCase <= Case; ++RefCase) {
+                    const SubdCamera& RefCamera = RefCase == 0 ? Start : Teleport;
+                    RefKeys = Storage == 0 ? RunUntilStable(RefPingPong, RefCamera, Config, 1, PingPongKeys).Keys
+                                           : RunUntilStable(RefCbt, RefCamera, Config, 1, CbtKeys).Keys;
+                }
+
+                printf("%-10s %-9s | %12u  %6d  %6u  %8.2f  %-8zu | %s\n", Storage == 0 ? "ping-pong" : "cbt", Cases[Case], Iterations, Result.Frames,
+                    Result.Passes, Result.Ms, Result.Keys.size(), Result.Keys == RefKeys ? "yes" : "no");
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+// Frustum culling of displaced leaves on a synthetic heightmap, from a fixed set of cameras:
+// the converged leaves are culled once with the former z range [0, DisplacementFactor] and
+// once with the HeightBoundsPyramid bounds under each leaf. Checks that the bounds hold every
+// bilinear height sample inside the leaf, and times the culling test with the frustum planes
+// rebuilt per leaf (as LodKernel did) against planes set once in LodKernelConfig.
+//
+// FrustumCullBench [heightmap size] [pixel size]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Headless/CameraPath.h"
+#include "Headless/SubdEngine.h"
+#include "Headless/SubdTexture.h"
+
+using namespace Headless;
+
+struct CullCamera {
+    const char* Name;
+    float3 PosW;
+    float3 Target;
+};
+
+// Rolling low ground with a few ridges: most of the map sits far below DisplacementFactor.
+static float GetTerrainHeight(float inX, float inY) {
+    float Ridge = std::max(0.0f, std::sin(6.2831853f * 1.5f * inX) * std::cos(6.2831853f * inY));
+    return 0.1f + 0.35f * Ridge * Ridge + 0.03f * std::sin(6.2831853f * 23.0f * (inX + inY));
+}
+
+// The former LodKernel: all six planes rebuilt for every leaf.
+static bool FrustumCullingTestPerLeaf(const float4x4& inViewProjMat, const float4& inMinPosition, const float4& inMaxPosition) {
+    LodKernelConfig Config;
+    SetFrustumPlanes(Config, inViewProjMat);
+    return FrustumCullingTest(Config, inMinPosition, inMaxPosition);
+}
+
+int main(int argc, char** argv) {
+    uint32_t Size = argc > 1 ? (uint32_t)atoi(argv[1]) : 1024;
+    float PixelSize = argc > 2 ? (float)atof(argv[2]) : 1.0f;
+
+    std::vector<uint16_t> Heights((size_t)Size * Size);
+    SubdTexture HeightMap;
+    HeightMap.Width = HeightMap.Height = Size;
+    HeightMap.ChannelCount = 1;
+    HeightMap.Texels.resize(Heights.size());
+    for (uint32_t j = 0; j < Size; ++j) {
+        for (uint32_t i = 0; i < Size; ++i) {
+            float z = GetTerrainHeight((float)i / Size, (float)j / Size);
+            Heights[(size_t)j * Size + i] = (uint16_t)(std::min(std::max(z, 0.0f), 1.0f) * 65535.0f);
+            HeightMap.Texels[(size_t)j * Size + i] = Heights[(size_t)j * Size + i] / 65535.0f;
+        }
+    }
+    ThreadPool Pool(0);
+    auto Start = std::chrono::high_resolution_clock::now();
+    HeightBoundsPyramid Pyramid;
+    Pyramid.Build(Heights.data(), Size, Size, Pool);
+    double BuildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+    printf("heightmap %u x %u, bounds pyramid %u levels in %.1f ms\n", Size, Size, Pyramid.GetLevelCount(), BuildMs);
+
+    const CullCamera Cameras[] = {
+        { "overview", float3(-0.95f, -0.95f, 0.60f), float3(0.0f, 0.0f, 0.0f) },
+        { "low across", float3(-0.90f, -0.90f, 0.06f), float3(0.5f, 0.5f, 0.02f) },
+        { "ground skim", float3(-0.10f, -0.05f, 0.02f), float3(0.6f, 0.5f, 0.0f) },
+        { "looking down", float3(0.00f, 0.00f, 0.50f), float3(0.1f, 0.1f, 0.0f) },
+        { "high above", float3(-0.40f, -0.40f, 1.20f), float3(0.0f, 0.2f, 0.0f) },
+        { "edge outward", float3(0.80f, 0.70f, 0.08f), float3(2.0f, 1.5f, 0.05f) },
+    };
+    CameraProjection Projection;
+    LodKernelConfig Config;
+    Config.FovX = Projection.GetFovX();
+    Config.TargetPixelSize = PixelSize;
+    Config.ScreenResolutionWidth = Projection.ScreenResolutionWidth;
+    Config.DisplacementFactor = 0.3f;
+    LodKernelDefines Defines;
+
+    uint32_t Failures = 0;
+    uint64_t TotalVisible[2] = {};
+    uint64_t TotalLeaves = 0;
+    double TestNs[2] = {};
+    uint32_t Sink = 0;
+    printf("%-14s %8s %10s %10s %8s\n", "camera", "leaves", "visible", "tight", "culled");
+    for (const CullCamera& Camera : Cameras) {
+        SubdCamera View;
+        View.PosW = Camera.PosW;
+        View.ViewProjMat = CreateViewProjMat(Camera.PosW, Camera.Target, float3(0.0f, 0.0f, 1.0f), Projection.FovY, Projection.AspectRatio, Projection.NearZ,
+            Projection.FarZ);
+        SubdEngine Engine(SubdMesh::CreateQuad(), SubdBufferSize, &Pool);
+        for (int Frame = 0; Frame < 16 && !Engine.GetBufferCounter().Converged; ++Frame) {
+            Engine.Converge(View, Config, Defines, 64);
+        }
+
+        LodKernelConfig FrameConfig = Config;
+        SetFrustumPlanes(FrameConfig, View.ViewProjMat);
+        uint32_t LeafCount = Engine.GetSubdInCount();
+        const PrimitiveData* Leaves = Engine.GetSubdIn();
+        uint32_t Visible[2] = {};
+        std::vector<float4> Boxes;
+        for (uint32_t i = 0; i < LeafCount; ++i) {
+            Visible[0] += EvaluateLodKernel(Engine.GetMesh(), Leaves[i], View, FrameConfig, Defines).Visible ? 1 : 0;
+            Visible[1] += EvaluateLodKernel(Engine.GetMesh(), Leaves[i], View, FrameConfig, Defines, LodKernelTextures{ &Pyramid, nullptr }).Visible ? 1 : 0;
+
+            // Every bilinear sample of the leaf lies within its bounds.
+            float4 InVertices[3], OutVertices[3];
+            Engine.GetMesh().GetPrimitiveVertices(Leaves[i].PrimitiveIndex, InVertices);
+            Subd(Leaves[i].SubdBinaryKey, InVertices, OutVertices);
+            float4 MinPosition = min(min(OutVertices[0], OutVertices[1]), OutVertices[2]);
+            float4 MaxPosition = max(max(OutVertices[0], OutVertices[1]), OutVertices[2]);
+            float2 Bounds = Pyramid.GetHeightBounds(float2(MinPosition.x * 0.5f + 0.5f, MinPosition.y * 0.5f + 0.5f),
+                float2(MaxPosition.x * 0.5f + 0.5f, MaxPosition.y * 0.5f + 0.5f));
+            for (int u = 0; u <= 8; ++u) {
+                for (int v = 0; u + v <= 8; ++v) {
+                    float4 Position = Berp(OutVertices, float2(u / 8.0f, v / 8.0f));
+                    float Height = HeightMap.SampleLevel(float2(Position.x * 0.5f + 0.5f, Position.y * 0.5f + 0.5f)).x;
+                    if (Height < Bounds.x - 1e-5f || Height > Bounds.y + 1e-5f) {
+                        if (Failures++ < 10) {
+                            printf("  leaf (%u, %08x): height %f outside [%f, %f]\n", Leaves[i].PrimitiveIndex, Leaves[i].SubdBinaryKey, Height, Bounds.x, Bounds.y);
+                        }
+                    }
+                }
+            }
+            MinPosition.z = 0.0f;
+            MaxPosition.z = Config.DisplacementFactor;
+            Boxes.push_back(MinPosition);
+            Boxes.push_back(MaxPosition);
+        }
+        if (Visible[1] > Visible[0]) {
+            printf("  tight bounds keep more leaves than the full range\n");
+            ++Failures;
+        }
+
+        Start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < Boxes.size(); i += 2) {
+            Sink += FrustumCullingTestPerLeaf(View.ViewProjMat, Boxes[i], Boxes[i + 1]) ? 1 : 0;
+        }
+        TestNs[0] += std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - Start).count();
+        Start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < Boxes.size(); i += 2) {
+            Sink += FrustumCullingTest(FrameConfig, Boxes[i], Boxes[i + 1]) ? 1 : 0;
+        }
+        TestNs[1] += std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - Start).count();
+
+        printf("%-14s %8u %10u %10u %7.1f%%\n", Camera.Name, LeafCount, Visible[0], Visible[1],
+            Visible[0] ? 100.0f * (Visible[0] - Visible[1]) / Visible[0] : 0.0f);
+        TotalLeaves += LeafCount;
+        TotalVisible[0] += Visible[0];
+        TotalVisible[1] += Visible[1];
+    }
+
+    printf("visible leaves: %llu with [0, DisplacementFactor], %llu with height bounds (%.1f%% fewer)\n", (unsigned long long)TotalVisible[0],
+        (unsigned long long)TotalVisible[1], 100.0 * (TotalVisible[0] - TotalVisible[1]) / std::max<uint64_t>(TotalVisible[0], 1));
+    volatile uint32_t KeepAlive = Sink;
+    (void)KeepAlive;
+    printf("culling test: %.1f ns per leaf with planes per leaf, %.1f ns with planes per frame\n", TestNs[0] / TotalLeaves, TestNs[1] / TotalLeaves);
+    printf("%s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,99 @@
+// Heightmap preprocessing of AdaptiveSubdivision::LoadTexture on a synthetic R16 heightmap:
+// the former single threaded slope loop against the tiled SSE2 ComputeSlopeRows, writing the
+// heightmap cache, and a warm start from the mapped cache. Checks all three give the same
+// slopes bit for bit.
+//
+// HeightmapBench [size] [cache file] [threads]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Headless/SubdHeightmap.h"
+
+using namespace Headless;
+
+static double MsSince(std::chrono::high_resolution_clock::time_point inStart) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - inStart).count();
+}
+
+// The slope map loop LoadTexture ran before the preprocessing stage.
+static std::vector<float> ComputeSlopeMapReference(const uint16_t* inHeights, int w, int h) {
+    std::vector<float> smap((size_t)w * h * 2);
+    for (int j = 0; j < h; ++j) {
+        for (int i = 0; i < w; ++i) {
+            int i1 = std::max(0, i - 1);
+            int i2 = std::min(w - 1, i + 1);
+            int j1 = std::max(0, j - 1);
+            int j2 = std::min(h - 1, j + 1);
+            float z_l = (float)inHeights[i1 + (size_t)w * j] / 65535.0f;
+            float z_r = (float)inHeights[i2 + (size_t)w * j] / 65535.0f;
+            float z_b = (float)inHeights[i + (size_t)w * j1] / 65535.0f;
+            float z_t = (float)inHeights[i + (size_t)w * j2] / 65535.0f;
+            smap[2 * (i + (size_t)w * j)] = (float)w * 0.5f * (z_r - z_l);
+            smap[1 + 2 * (i + (size_t)w * j)] = (float)h * 0.5f * (z_t - z_b);
+        }
+    }
+    return smap;
+}
+
+int main(int argc, char** argv) {
+    uint32_t Size = argc > 1 ? (uint32_t)atoi(argv[1]) : 8192;
+    const char* CachePath = argc > 2 ? argv[2] : "HeightmapBench.cache";
+    ThreadPool Pool(argc > 3 ? (uint32_t)atoi(argv[3]) : 0);
+
+    std::vector<uint16_t> Heights((size_t)Size * Size);
+    for (uint32_t j = 0; j < Size; ++j) {
+        for (uint32_t i = 0; i < Size; ++i) {
+            float x = (float)i / Size;
+            float y = (float)j / Size;
+            float z = 0.5f + 0.3f * std::sin(6.2831853f * 5.0f * x) * std::cos(6.2831853f * 3.0f * y) + 0.1f * std::sin(6.2831853f * 41.0f * (x + y));
+            Heights[(size_t)j * Size + i] = (uint16_t)(std::min(std::max(z, 0.0f), 1.0f) * 65535.0f);
+        }
+    }
+    size_t SlopeBytes = (size_t)Size * Size * 2 * sizeof(float);
+    printf("heightmap %u x %u  threads %u  slope map %.1f MB\n", Size, Size, Pool.GetThreadCount(), SlopeBytes / 1048576.0);
+
+    auto Start = std::chrono::high_resolution_clock::now();
+    std::vector<float> Reference = ComputeSlopeMapReference(Heights.data(), (int)Size, (int)Size);
+    printf("reference loop      %9.1f ms\n", MsSince(Start));
+
+    std::vector<float> Slopes(Reference.size());
+    Start = std::chrono::high_resolution_clock::now();
+    ComputeSlopeRows(Heights.data(), Size, Size, 0, Size, Slopes.data(), Pool);
+    double TiledMs = MsSince(Start);
+    bool TiledOk = memcmp(Slopes.data(), Reference.data(), SlopeBytes) == 0;
+    printf("tiled slopes        %9.1f ms  %s\n", TiledMs, TiledOk ? "identical" : "MISMATCH");
+    Slopes = std::vector<float>();
+
+    Start = std::chrono::high_resolution_clock::now();
+    bool Written = WriteHeightmapCache(CachePath, "", Heights.data(), Size, Size, Pool);
+    printf("write cache         %9.1f ms  %s\n", MsSince(Start), Written ? CachePath : "FAILED");
+
+    Start = std::chrono::high_resolution_clock::now();
+    HeightmapCache Cache;
+    bool Opened = Written && Cache.Open(CachePath);
+    double OpenMs = MsSince(Start);
+    // Touch every page, as the texture upload would.
+    Start = std::chrono::high_resolution_clock::now();
+    uint32_t Sink = 0;
+    if (Opened) {
+        const uint8_t* Bytes = (const uint8_t*)Cache.GetSlopes();
+        for (size_t Offset = 0; Offset < SlopeBytes; Offset += 4096) {
+            Sink += Bytes[Offset];
+        }
+    }
+    double TouchMs = MsSince(Start);
+    volatile uint32_t KeepAlive = Sink;
+    (void)KeepAlive;
+    bool CacheOk = Opened && memcmp(Cache.GetHeights(), Heights.data(), Heights.size() * sizeof(uint16_t)) == 0
+        && memcmp(Cache.GetSlopes(), Reference.data(), SlopeBytes) == 0;
+    printf("open cache          %9.3f ms  first touch %.1f ms  %s\n", OpenMs, TouchMs, CacheOk ? "identical" : "MISMATCH");
+
+    Cache.Close();
+    std::remove(CachePath);
+    return TiledOk && CacheOk ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+// Incremental lod (INCREMENTAL_LOD) against the full LodKernel evaluation, on a synthetic
+// displaced heightmap with frustum culling, height bounds and, in the second half, the
+// roughness metric. Two engines converge at the same point of the flyover path and then play
+// it side by side, one LodKernel pass per frame, at several playback speeds: the full engine
+// evaluates every key, the incremental one only the keys whose slack the camera travel used
+// up. Reports the share of keys sent to LodDirtyKernel and the time per frame of both, and
+// checks every frame that both hold the same leaves and cull the same ones.
+//
+// IncrementalLodBench [heightmap size] [pixel size] [frames]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Headless/CameraPath.h"
+#include "Headless/PatchGrid.h"
+#include "Headless/SubdEngine.h"
+#include "Headless/SubdIncremental.h"
+
+using namespace Headless;
+
+// Where on the flyover the runs start: the dive towards the ground plane.
+static const float StartTime = 5.0f;
+static const float FrameTime = 1.0f / 60.0f;
+
+// Rolling ground with ridges and a rough band across the middle.
+static float GetTerrainHeight(float inX, float inY) {
+    float Ridge = std::max(0.0f, std::sin(6.2831853f * 1.5f * inX) * std::cos(6.2831853f * inY));
+    float Band = std::exp(-(inY - 0.5f) * (inY - 0.5f) / 0.01f);
+    return 0.1f + 0.35f * Ridge * Ridge + 0.03f * Band * std::sin(6.2831853f * 23.0f * (inX + inY));
+}
+
+static std::vector<uint64_t> GetSortedKeys(const PrimitiveData* inKeys, uint32_t inCount) {
+    std::vector<uint64_t> Keys(inCount);
+    for (uint32_t i = 0; i < inCount; ++i) {
+        Keys[i] = (uint64_t)inKeys[i].PrimitiveIndex << 32 | inKeys[i].SubdBinaryKey;
+    }
+    std::sort(Keys.begin(), Keys.end());
+    return Keys;
+}
+
+int main(int argc, char** argv) {
+    uint32_t Size = argc > 1 ? (uint32_t)atoi(argv[1]) : 1024;
+    float PixelSize = argc > 2 ? (float)atof(argv[2]) : 1.0f;
+    uint32_t FrameCount = argc > 3 ? (uint32_t)atoi(argv[3]) : 60;
+
+    std::vector<uint16_t> Heights((size_t)Size * Size);
+    for (uint32_t j = 0; j < Size; ++j) {
+        for (uint32_t i = 0; i < Size; ++i) {
+            float z = GetTerrainHeight((float)i / Size, (float)j / Size);
+            Heights[(size_t)j * Size + i] = (uint16_t)(std::min(std::max(z, 0.0f), 1.0f) * 65535.0f);
+        }
+    }
+    ThreadPool Pool(0);
+    HeightBoundsPyramid Bounds;
+    Bounds.Build(Heights.data(), Size, Size, Pool);
+    RoughnessPyramid Roughness;
+    Roughness.Build(Heights.data(), Size, Size, Pool);
+    printf("heightmap %u x %u, %u frames per run from t = %.1f s of the flyover\n", Size, Size, FrameCount, StartTime);
+
+    CameraPath Path = CameraPath::CreateFlyover();
+    CameraProjection Projection;
+    LodKernelConfig Config = {};
+    Config.FovX = Projection.GetFovX();
+    Config.TargetPixelSize = PixelSize;
+    Config.ScreenResolutionWidth = Projection.ScreenResolutionWidth;
+    Config.DisplacementFactor = 0.3f;
+    SetRoughnessLod(Config, 1.0f, 2.0f, Size, DefaultPatchLevel);
+
+    // Playback speed of the path; 0 holds the camera still.
+    const float Speeds[] = { 0.0f, 0.25f, 1.0f, 4.0f };
+    uint32_t Failures = 0;
+    printf("%-10s %6s %9s %10s %8s %10s %10s %8s\n", "metric", "speed", "leaves", "travel", "dirty", "full ms", "incr ms", "speedup");
+    for (int Metric = 0; Metric < 2; ++Metric) {
+        LodKernelDefines Defines;
+        Defines.RoughnessLod = Metric == 1;
+        LodKernelDefines IncrementalDefines = Defines;
+        IncrementalDefines.IncrementalLod = true;
+
+        for (float Speed : Speeds) {
+            SubdEngine Full(SubdMesh::CreateQuad(), SubdBufferSize, &Pool);
+            SubdEngine Incremental(SubdMesh::CreateQuad(), SubdBufferSize, &Pool);
+            for (SubdEngine* Engine : { &Full, &Incremental }) {
+                Engine->SetHeightBounds(&Bounds);
+                Engine->SetRoughness(&Roughness);
+            }
+            LodTravelTracker Tracker;
+
+            SubdCamera View = Path.GetCamera(StartTime, Projection);
+            for (int Frame = 0; Frame < 16 && !Full.GetBufferCounter().Converged; ++Frame) {
+                Full.Converge(View, Config, Defines, 64);
+            }
+            for (int Frame = 0; Frame < 16 && !Incremental.GetBufferCounter().Converged; ++Frame) {
+                LodKernelConfig FrameConfig = Config;
+                Tracker.SetCameraTravel(FrameConfig, View.PosW);
+                Incremental.Converge(View, FrameConfig, IncrementalDefines, 64);
+            }
+
+            double Ms[2] = {};
+            uint64_t Leaves = 0;
+            uint64_t Dirty = 0;
+            float Travel = 0.0f;
+            float3 LastPosW = View.PosW;
+            for (uint32_t Frame = 1; Frame <= FrameCount; ++Frame) {
+                View = Path.GetCamera(StartTime + Speed * FrameTime * Frame, Projection);
+                Travel += length(View.PosW - LastPosW);
+                LastPosW = View.PosW;
+
+                uint32_t LeafCount = Incremental.GetSubdInCount();
+                auto Start = std::chrono::high_resolution_clock::now();
+                Full.Update(View, Config, Defines);
+                Ms[0] += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+                Start = std::chrono::high_resolution_clock::now();
+                LodKernelConfig FrameConfig = Config;
+                Tracker.SetCameraTravel(FrameConfig, View.PosW);
+                Incremental.Update(View, FrameConfig, IncrementalDefines);
+                Ms[1] += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+                Leaves += LeafCount;
+                Dirty += Incremental.GetBufferCounter().LastDirtyCount;
+
+                bool SameLeaves = GetSortedKeys(Full.GetSubdIn(), Full.GetSubdInCount()) ==
+                    GetSortedKeys(Incremental.GetSubdIn(), Incremental.GetSubdInCount());
+                bool SameCulled = GetSortedKeys(Full.GetSubdCulledOut(), Full.GetSubdCulledOutCount()) ==
+                    GetSortedKeys(Incremental.GetSubdCulledOut(), Incremental.GetSubdCulledOutCount());
+                if (!SameLeaves || !SameCulled) {
+                    if (Failures++ < 10) {
+                        printf("  frame %u at speed %.2f: %u / %u leaves, %u / %u culled\n", Frame, Speed, Full.GetSubdInCount(), Incremental.GetSubdInCount(),
+                            Full.GetSubdCulledOutCount(), Incremental.GetSubdCulledOutCount());
+                    }
+                }
+            }
+
+            printf("%-10s %5.2fx %9llu %10.5f %7.1f%% %10.2f %10.2f %7.2fx\n", Defines.RoughnessLod ? "roughness" : "distance", Speed,
+                (unsigned long long)(Leaves / std::max(FrameCount, 1u)), Travel / std::max(FrameCount, 1u), Leaves ? 100.0 * Dirty / Leaves : 0.0,
+                Ms[0] / std::max(FrameCount, 1u), Ms[1] / std::max(FrameCount, 1u), Ms[1] > 0.0 ? Ms[0] / Ms[1] : 0.0);
+        }
+    }
+
+    printf("%s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
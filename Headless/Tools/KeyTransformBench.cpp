@@ -0,0 +1,67 @@
+// Cost of KeyToTransform against key depth: the shader's bit walk on 4x4 matrices,
+// the same walk on 2x3 affines, and the chunk tables with 4 and 8 bit chunks.
+// Also checks every variant against the 4x4 walk.
+//
+// KeyTransformBench [keys per depth]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "Headless/SubdKeyTransform.h"
+#include "Headless/SubdUtils.h"
+
+using namespace Headless;
+
+template <typename Func>
+static double NsPerKey(const std::vector<uint32_t>& inKeys, Func&& inFunc) {
+    float Sink = 0.0f;
+    auto Start = std::chrono::high_resolution_clock::now();
+    for (uint32_t Key : inKeys) {
+        AffineTransform Affine = inFunc(Key);
+        Sink += Affine.Row2.x + Affine.Row0.y;
+    }
+    double Ns = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - Start).count();
+    volatile float KeepAlive = Sink;
+    (void)KeepAlive;
+    return Ns / inKeys.size();
+}
+
+static float MaxDifference(const AffineTransform& a, const AffineTransform& b) {
+    float d = 0.0f;
+    d = std::max(d, std::fabs(a.Row0.x - b.Row0.x));
+    d = std::max(d, std::fabs(a.Row0.y - b.Row0.y));
+    d = std::max(d, std::fabs(a.Row1.x - b.Row1.x));
+    d = std::max(d, std::fabs(a.Row1.y - b.Row1.y));
+    d = std::max(d, std::fabs(a.Row2.x - b.Row2.x));
+    d = std::max(d, std::fabs(a.Row2.y - b.Row2.y));
+    return d;
+}
+
+int main(int argc, char** argv) {
+    size_t KeysPerDepth = argc > 1 ? (size_t)atoll(argv[1]) : 1 << 18;
+    KeyTransformTable Table4(4), Table8(8);
+    std::mt19937 Rng(1234);
+
+    printf("depth   4x4 walk  2x3 walk  table4  table8   (ns/key)  max |diff| table4 table8\n");
+    for (int Depth = 1; Depth <= 30; ++Depth) {
+        std::vector<uint32_t> Keys(KeysPerDepth);
+        for (uint32_t& Key : Keys) {
+            Key = (1u << Depth) | (Rng() & ((1u << Depth) - 1u));
+        }
+
+        double Walk4x4 = NsPerKey(Keys, [](uint32_t k) { return ToAffine(KeyToTransform(k)); });
+        double Walk2x3 = NsPerKey(Keys, [](uint32_t k) { return KeyToAffine(k); });
+        double Lookup4 = NsPerKey(Keys, [&](uint32_t k) { return Table4.KeyToAffine(k); });
+        double Lookup8 = NsPerKey(Keys, [&](uint32_t k) { return Table8.KeyToAffine(k); });
+
+        float Diff4 = 0.0f, Diff8 = 0.0f;
+        for (size_t i = 0; i < std::min<size_t>(Keys.size(), 4096); ++i) {
+            AffineTransform Reference = ToAffine(KeyToTransform(Keys[i]));
+            Diff4 = std::max(Diff4, MaxDifference(Reference, Table4.KeyToAffine(Keys[i])));
+            Diff8 = std::max(Diff8, MaxDifference(Reference, Table8.KeyToAffine(Keys[i])));
+        }
+        printf("%5d  %9.2f %9.2f %7.2f %7.2f             %g %g\n", Depth, Walk4x4, Walk2x3, Lookup4, Lookup8, Diff4, Diff8);
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+// Morton-sorted leaves ("Sort Leaves", Headless/SubdLeafSort.h). For the middle of each
+// benchmark path, converges SubdEngine on a synthetic displaced heightmap (Suzanne.obj for
+// the orbit) and measures the locality of its SubdCulledOut list three ways: shuffled, the
+// bound of what the GPU's atomic appends leave once SubdIn went through many passes of
+// them; in the engine's own order, which keeps the tree order of the root keys; and sorted
+// by the Morton key of the leaf centroids. Locality is the distinct heightmap tiles and distinct
+// PrimitiveIndex per batch of consecutive instances. Then times the radix sort alone on
+// 2^20 random keys against std::stable_sort, and checks that every sort is a stable
+// permutation of its input.
+//
+// LeafSortBench [heightmap size] [pixel size] [batch size] [tile texels] [model obj]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "Headless/SubdBenchmark.h"
+#include "Headless/SubdEngine.h"
+#include "Headless/SubdLeafSort.h"
+#include "Headless/SubdObjLoader.h"
+
+using namespace Headless;
+
+static float GetTerrainHeight(float inX, float inY) {
+    float Ridge = std::max(0.0f, std::sin(6.2831853f * 1.5f * inX) * std::cos(6.2831853f * inY));
+    float Band = std::exp(-(inY - 0.5f) * (inY - 0.5f) / 0.01f);
+    return 0.1f + 0.35f * Ridge * Ridge + 0.03f * Band * std::sin(6.2831853f * 23.0f * (inX + inY));
+}
+
+static std::vector<uint64_t> GetSortedKeys(const PrimitiveData* inKeys, uint32_t inCount) {
+    std::vector<uint64_t> Keys(inCount);
+    for (uint32_t i = 0; i < inCount; ++i) {
+        Keys[i] = (uint64_t)inKeys[i].PrimitiveIndex << 32 | inKeys[i].SubdBinaryKey;
+    }
+    std::sort(Keys.begin(), Keys.end());
+    return Keys;
+}
+
+// The keys come out in order and, among equal keys, in input order: inLeaves carry their
+// input index in SubdBinaryKey.
+static bool IsStableSort(const std::vector<uint32_t>& inKeys, const std::vector<PrimitiveData>& inLeaves, const std::vector<uint32_t>& inInputKeys) {
+    std::vector<bool> Seen(inKeys.size(), false);
+    for (size_t i = 0; i < inKeys.size(); ++i) {
+        uint32_t Index = inLeaves[i].SubdBinaryKey;
+        if (Index >= inKeys.size() || Seen[Index] || inInputKeys[Index] != inKeys[i]) {
+            return false;
+        }
+        Seen[Index] = true;
+        if (i > 0 && (inKeys[i - 1] > inKeys[i] || (inKeys[i - 1] == inKeys[i] && inLeaves[i - 1].SubdBinaryKey > Index))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint32_t Size = argc > 1 ? (uint32_t)atoi(argv[1]) : 1024;
+    float PixelSize = argc > 2 ? (float)atof(argv[2]) : 1.0f;
+    uint32_t BatchSize = argc > 3 ? (uint32_t)atoi(argv[3]) : 64;
+    uint32_t TileTexels = argc > 4 ? (uint32_t)atoi(argv[4]) : 16;
+    const char* ModelPath = argc > 5 ? argv[5] : "Data/Suzanne.obj";
+
+    std::vector<uint16_t> Heights((size_t)Size * Size);
+    for (uint32_t j = 0; j < Size; ++j) {
+        for (uint32_t i = 0; i < Size; ++i) {
+            float z = GetTerrainHeight((float)i / Size, (float)j / Size);
+            Heights[(size_t)j * Size + i] = (uint16_t)(std::min(std::max(z, 0.0f), 1.0f) * 65535.0f);
+        }
+    }
+    ThreadPool Pool(0);
+    HeightBoundsPyramid Bounds;
+    Bounds.Build(Heights.data(), Size, Size, Pool);
+    SubdMesh Quad = SubdMesh::CreateQuad();
+    SubdMesh Model;
+    bool HasModel = LoadObjMesh(ModelPath, Model, ObjLoadConfig(), nullptr, Pool);
+    if (!HasModel) {
+        printf("could not read %s, skipping the model paths\n", ModelPath);
+    }
+    printf("heightmap %u x %u in %u texel tiles, batches of %u instances\n", Size, Size, TileTexels, BatchSize);
+
+    CameraProjection Projection;
+    LodKernelConfig Config = {};
+    Config.FovX = Projection.GetFovX();
+    Config.TargetPixelSize = PixelSize;
+    Config.ScreenResolutionWidth = Projection.ScreenResolutionWidth;
+    Config.DisplacementFactor = 0.3f;
+
+    uint32_t Failures = 0;
+    std::mt19937 Random(7);
+    printf("%-14s %8s %10s %10s %10s %9s %9s %9s %8s\n", "path", "leaves", "tiles shuf", "tiles tree", "tiles sort", "prim shuf", "prim tree", "prim sort", "sort ms");
+    for (const BenchmarkPath& Path : GetBenchmarkPaths()) {
+        if (Path.Model && !HasModel) {
+            continue;
+        }
+        const SubdMesh& Mesh = Path.Model ? Model : Quad;
+        LodKernelDefines Defines;
+        Defines.Displace = !Path.Model;
+        SubdEngine Engine(Mesh, SubdBufferSize, &Pool);
+        Engine.LoadBuffer(Mesh.CreateRootKeys());
+        if (!Path.Model) {
+            Engine.SetHeightBounds(&Bounds);
+        }
+        SubdCamera Camera = Path.Path.GetCamera(Path.Path.GetDuration() * 0.5f, Projection);
+        for (int Frame = 0; Frame < 16 && !Engine.GetBufferCounter().Converged; ++Frame) {
+            Engine.Converge(Camera, Config, Defines, 64);
+        }
+
+        std::vector<PrimitiveData> Engined(Engine.GetSubdCulledOut(), Engine.GetSubdCulledOut() + Engine.GetSubdCulledOutCount());
+        std::vector<PrimitiveData> Shuffled = Engined;
+        std::shuffle(Shuffled.begin(), Shuffled.end(), Random);
+        std::vector<PrimitiveData> Sorted = Shuffled;
+        LeafSortBounds SortBounds = GetLeafSortBounds(Mesh);
+        auto Start = std::chrono::high_resolution_clock::now();
+        SortLeaves(Mesh, SortBounds, Sorted.data(), (uint32_t)Sorted.size(), Pool);
+        double SortMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+
+        bool Permutation = GetSortedKeys(Sorted.data(), (uint32_t)Sorted.size()) == GetSortedKeys(Engined.data(), (uint32_t)Engined.size());
+        bool Ordered = true;
+        for (size_t i = 1; i < Sorted.size(); ++i) {
+            Ordered = Ordered && GetLeafSortKey(Mesh, SortBounds, Sorted[i - 1]) <= GetLeafSortKey(Mesh, SortBounds, Sorted[i]);
+        }
+        if (!Permutation || !Ordered) {
+            printf("  %s: sorted list %s\n", Path.Name.c_str(), Permutation ? "out of order" : "is not a permutation");
+            ++Failures;
+        }
+
+        LeafBatchLocality Locality[3] = {
+            GetLeafBatchLocality(Mesh, Shuffled.data(), (uint32_t)Shuffled.size(), BatchSize, Size, TileTexels, Pool),
+            GetLeafBatchLocality(Mesh, Engined.data(), (uint32_t)Engined.size(), BatchSize, Size, TileTexels, Pool),
+            GetLeafBatchLocality(Mesh, Sorted.data(), (uint32_t)Sorted.size(), BatchSize, Size, TileTexels, Pool),
+        };
+        printf("%-14s %8zu %10.1f %10.1f %10.1f %9.1f %9.1f %9.1f %8.2f\n", Path.Name.c_str(), Sorted.size(),
+            Locality[0].TilesPerBatch, Locality[1].TilesPerBatch, Locality[2].TilesPerBatch,
+            Locality[0].PrimitivesPerBatch, Locality[1].PrimitivesPerBatch, Locality[2].PrimitivesPerBatch, SortMs);
+    }
+
+    // The radix passes alone at the buffer's capacity, on keys with many duplicates.
+    const uint32_t Count = (uint32_t)SubdBufferSize;
+    std::vector<uint32_t> InputKeys(Count);
+    std::uniform_int_distribution<uint32_t> KeyDistribution(0, (1u << LeafSortKeyBits) - 1u);
+    for (uint32_t i = 0; i < Count; ++i) {
+        InputKeys[i] = KeyDistribution(Random) & ~0xfu;
+    }
+    std::vector<uint32_t> Keys = InputKeys;
+    std::vector<PrimitiveData> Leaves(Count);
+    for (uint32_t i = 0; i < Count; ++i) {
+        Leaves[i] = { 0u, i };
+    }
+    std::vector<double> PassMs;
+    auto Start = std::chrono::high_resolution_clock::now();
+    RadixSortLeaves(Keys.data(), Leaves.data(), Count, LeafSortKeyBits, Pool, &PassMs);
+    double RadixMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+    if (!IsStableSort(Keys, Leaves, InputKeys)) {
+        printf("  radix sort of %u keys is not a stable permutation\n", Count);
+        ++Failures;
+    }
+
+    std::vector<uint32_t> Order(Count);
+    std::iota(Order.begin(), Order.end(), 0u);
+    Start = std::chrono::high_resolution_clock::now();
+    std::stable_sort(Order.begin(), Order.end(), [&](uint32_t a, uint32_t b) { return InputKeys[a] < InputKeys[b]; });
+    double StableSortMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+    for (uint32_t i = 0; i < Count; ++i) {
+        if (Order[i] != Leaves[i].SubdBinaryKey) {
+            printf("  radix sort differs from std::stable_sort at %u\n", i);
+            ++Failures;
+            break;
+        }
+    }
+    printf("%u keys of %u bits: radix %.2f ms (", Count, LeafSortKeyBits, RadixMs);
+    for (size_t Pass = 0; Pass < PassMs.size(); ++Pass) {
+        printf("%s%.2f", Pass ? " + " : "", PassMs[Pass]);
+    }
+    printf(" per pass), std::stable_sort %.2f ms\n", StableSortMs);
+
+    printf("%s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+// RenderKernelVS vertex cost with and without the LEAF_VERTEX_PREPASS pre-pass, on the
+// SubdCulledOut leaves of a converged tree over a synthetic heightmap. Without it every
+// vertex of an instance re-runs Subd on its leaf; with it LeafVertexKernel runs once per
+// leaf and the vertices only interpolate. Per leaf costs are given for the distinct vertices
+// of the default patch and for all of its indices (no post-transform cache). Checks the
+// linear path is bit exact and reports how far the per-corner Phong normals move vertices.
+//
+// LeafVertexBench [target pixel size] [heightmap size]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Headless/PatchGrid.h"
+#include "Headless/SubdLeafVertex.h"
+
+using namespace Headless;
+
+static std::vector<uint16_t> CreateHeightMap(uint32_t inSize) {
+    std::vector<uint16_t> Heights((size_t)inSize * inSize);
+    for (uint32_t j = 0; j < inSize; ++j) {
+        for (uint32_t i = 0; i < inSize; ++i) {
+            float x = (float)i / inSize;
+            float y = (float)j / inSize;
+            float z = 0.5f + 0.25f * std::sin(6.2831853f * 3.0f * x) * std::cos(6.2831853f * 2.0f * y) + 0.15f * std::sin(6.2831853f * 17.0f * (x + 0.3f * y));
+            Heights[(size_t)j * inSize + i] = (uint16_t)(clamp(z, 0.0f, 1.0f) * 65535.0f);
+        }
+    }
+    return Heights;
+}
+
+// SubdInstanced vertices of the default patch.
+static std::vector<float2> CreateBerpUVs() {
+    const PatchLevelOffset& Offset = PatchGrids.PatchLevelOffsets[DefaultPatchLevel];
+    std::vector<float2> UVs;
+    for (uint32_t i = 0; i < Offset.VertexCount; ++i) {
+        const PatchVertex& Vertex = PatchGrids.Vertices[Offset.BaseVertexLocation + i];
+        UVs.push_back(float2(Vertex.BerpUV[0], Vertex.BerpUV[1]));
+    }
+    return UVs;
+}
+
+// Nanoseconds per leaf of inFunc, single threaded.
+template<typename Func>
+static double TimePerLeaf(uint32_t inLeafCount, Func&& inFunc) {
+    float Sink = 0.0f;
+    auto Start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < inLeafCount; ++i) {
+        Sink += inFunc(i);
+    }
+    double Ns = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - Start).count() / inLeafCount;
+    volatile float KeepAlive = Sink;
+    (void)KeepAlive;
+    return Ns;
+}
+
+int main(int argc, char** argv) {
+    float TargetPixelSize = argc > 1 ? (float)atof(argv[1]) : 0.5f;
+    uint32_t HeightMapSize = argc > 2 ? (uint32_t)atoi(argv[2]) : 1024;
+
+    std::vector<uint16_t> Heights = CreateHeightMap(HeightMapSize);
+    SubdTexture SlopeMap = CreateSlopeMap(Heights.data(), HeightMapSize, HeightMapSize);
+
+    float FovY = 2.0f * std::atan(24.0f / 42.0f);
+    SubdCamera Camera;
+    Camera.PosW = float3(1.0f, 1.0f, 1.0f);
+    Camera.ViewProjMat = CreateViewProjMat(Camera.PosW, float3(0.0f, 0.0f, 0.0f), float3(0.0f, 0.0f, 1.0f), FovY, 1920.0f / 1080.0f, 0.0001f, 95.0f);
+    LodKernelConfig Config;
+    Config.FovX = 1920.0f / 1080.0f * FovY;
+    Config.TargetPixelSize = TargetPixelSize;
+    Config.ScreenResolutionWidth = 1920;
+    Config.DisplacementFactor = 0.3f;
+
+    SubdMesh Mesh = SubdMesh::CreateQuad();
+    SubdEngine Engine(Mesh);
+    Engine.Converge(Camera, Config, LodKernelDefines(), 64);
+    uint32_t LeafCount = Engine.GetSubdCulledOutCount();
+    const PrimitiveData* Leaves = Engine.GetSubdCulledOut();
+    std::vector<float2> UVs = CreateBerpUVs();
+    printf("pixel size %.2f  heightmap %u  culled leaves %u  vertices per leaf %zu\n", TargetPixelSize, HeightMapSize, LeafCount,
+        UVs.size());
+
+    bool Ok = true;
+    for (int Phong = 0; Phong < 2; ++Phong) {
+        RenderKernelContext Context;
+        Context.Mesh = &Mesh;
+        Context.SlopeMap = &SlopeMap;
+        Context.DisplacementFactor = Config.DisplacementFactor;
+        Context.PhongTessellation = Phong != 0;
+
+        double Before = TimePerLeaf(LeafCount, [&](uint32_t i) {
+            float Sum = 0.0f;
+            for (const float2& UV : UVs) {
+                Sum += EvaluateRenderVertex(Context, Leaves[i], UV).z;
+            }
+            return Sum;
+        });
+        double Prepass = TimePerLeaf(LeafCount, [&](uint32_t i) {
+            return EvaluateLeafVertexKernel(Context, Leaves[i]).Position[0][2];
+        });
+        std::vector<LeafVertexData> LeafVertices(LeafCount);
+        LeafVertexKernel(Context, Leaves, LeafCount, LeafVertices.data());
+        double After = TimePerLeaf(LeafCount, [&](uint32_t i) {
+            float Sum = 0.0f;
+            for (const float2& UV : UVs) {
+                Sum += EvaluateLeafVertex(LeafVertices[i], UV, Context.PhongTessellation).z;
+            }
+            return Sum;
+        });
+
+        uint32_t Mismatches = 0;
+        float MaxDeviation = 0.0f;
+        for (uint32_t i = 0; i < LeafCount; ++i) {
+            for (const float2& UV : UVs) {
+                float4 Reference = EvaluateRenderVertex(Context, Leaves[i], UV);
+                float4 Vertex = EvaluateLeafVertex(LeafVertices[i], UV, Context.PhongTessellation);
+                Mismatches += memcmp(&Reference, &Vertex, sizeof(float4)) != 0;
+                MaxDeviation = std::max(MaxDeviation, length((Reference - Vertex).xyz()));
+            }
+        }
+
+        double VertexBefore = Before / UVs.size();
+        double VertexAfter = After / UVs.size();
+        double IndexCount = GetPatchIndexCount(DefaultPatchLevel);
+        printf("%-6s  vertex %6.1f -> %5.1f ns  pre-pass %6.1f ns/leaf  leaf(%zu) %7.0f -> %6.0f ns  leaf(%.0f) %7.0f -> %6.0f ns",
+            Phong ? "phong" : "linear", VertexBefore, VertexAfter, Prepass, UVs.size(), Before, Prepass + After, IndexCount, VertexBefore * IndexCount,
+            Prepass + VertexAfter * IndexCount);
+        if (Phong) {
+            printf("  max deviation %.3g\n", MaxDeviation);
+        }
+        else {
+            printf("  mismatches %u\n", Mismatches);
+            Ok = Ok && Mismatches == 0;
+        }
+    }
+    printf("%s\n", Ok ? "linear path bit exact" : "LINEAR PATH MISMATCH");
+    return Ok ? 0 : 1;
+}
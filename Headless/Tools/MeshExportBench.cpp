@@ -0,0 +1,239 @@
+// Streaming mesh export (Headless/SubdMeshExport.h). Exports two key sets over a synthetic
+// displaced heightmap: the SubdIn of the engine converged at the middle of the flyover, with
+// the default patch, and every key of one depth on both quad triangles, a multi-million leaf
+// set, with a small patch, both through the key transform table. Each set is written as
+// Binary on every thread and on one, with exact welding and as OBJ, reporting the size and
+// triangles per second. Checks that the Binary file reads back, that the thread count does
+// not change a byte, that the windowed weld only adds vertices, and that the uniform set
+// welds exactly into a watertight grid.
+//
+// MeshExportBench [heightmap size] [uniform depth] [uniform patch level] [pixel size]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Headless/MappedFile.h"
+#include "Headless/SubdBenchmark.h"
+#include "Headless/SubdEngine.h"
+#include "Headless/SubdKeyTransform.h"
+#include "Headless/SubdMeshExport.h"
+
+using namespace Headless;
+
+static float GetTerrainHeight(float inX, float inY) {
+    float Ridge = std::max(0.0f, std::sin(6.2831853f * 1.5f * inX) * std::cos(6.2831853f * inY));
+    float Band = std::exp(-(inY - 0.5f) * (inY - 0.5f) / 0.01f);
+    return 0.1f + 0.35f * Ridge * Ridge + 0.03f * Band * std::sin(6.2831853f * 23.0f * (inX + inY));
+}
+
+static bool IsSameFile(const std::string& inPathA, const std::string& inPathB) {
+    MappedFile A, B;
+    return A.Open(inPathA) && B.Open(inPathB) && A.GetSize() == B.GetSize() && memcmp(A.GetData(), B.GetData(), A.GetSize()) == 0;
+}
+
+// "v" and "f" lines of an OBJ file.
+static void CountObjLines(const std::string& inPath, uint64_t& outVertexCount, uint64_t& outFaceCount) {
+    outVertexCount = outFaceCount = 0;
+    MappedFile File;
+    if (!File.Open(inPath)) {
+        return;
+    }
+    const uint8_t* Data = File.GetData();
+    for (size_t i = 0; i + 1 < File.GetSize(); ++i) {
+        if ((i == 0 || Data[i - 1] == '\n') && Data[i + 1] == ' ') {
+            outVertexCount += Data[i] == 'v';
+            outFaceCount += Data[i] == 'f';
+        }
+    }
+}
+
+// Edges of a triangle list used by one triangle, and by more than two.
+static void CountOpenEdges(const std::vector<uint32_t>& inIndices, uint64_t& outOpenCount, uint64_t& outNonManifoldCount) {
+    std::vector<uint64_t> Edges(inIndices.size());
+    for (size_t i = 0; i < inIndices.size(); i += 3) {
+        for (int Corner = 0; Corner < 3; ++Corner) {
+            uint64_t A = inIndices[i + Corner];
+            uint64_t B = inIndices[i + (Corner + 1) % 3];
+            Edges[i + Corner] = std::min(A, B) << 32 | std::max(A, B);
+        }
+    }
+    std::sort(Edges.begin(), Edges.end());
+    outOpenCount = outNonManifoldCount = 0;
+    for (size_t Begin = 0; Begin < Edges.size();) {
+        size_t End = Begin;
+        while (End < Edges.size() && Edges[End] == Edges[Begin]) {
+            ++End;
+        }
+        outOpenCount += End - Begin == 1;
+        outNonManifoldCount += End - Begin > 2;
+        Begin = End;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t Size = argc > 1 ? (uint32_t)atoi(argv[1]) : 1024;
+    uint32_t UniformDepth = argc > 2 ? (uint32_t)atoi(argv[2]) : 20;
+    uint32_t UniformPatchLevel = argc > 3 ? (uint32_t)atoi(argv[3]) : 2;
+    float PixelSize = argc > 4 ? (float)atof(argv[4]) : 1.0f;
+
+    std::vector<uint16_t> Heights((size_t)Size * Size);
+    for (uint32_t j = 0; j < Size; ++j) {
+        for (uint32_t i = 0; i < Size; ++i) {
+            float z = GetTerrainHeight((float)i / Size, (float)j / Size);
+            Heights[(size_t)j * Size + i] = (uint16_t)(std::min(std::max(z, 0.0f), 1.0f) * 65535.0f);
+        }
+    }
+    ThreadPool Pool(0);
+    ThreadPool SinglePool(1);
+    HeightBoundsPyramid Bounds;
+    Bounds.Build(Heights.data(), Size, Size, Pool);
+    SubdTexture HeightMap = CreateHeightMap(Heights.data(), Size, Size);
+    SubdTexture SlopeMap = CreateSlopeMap(Heights.data(), Size, Size);
+    SubdMesh Quad = SubdMesh::CreateQuad();
+
+    CameraProjection Projection;
+    LodKernelConfig Config = {};
+    Config.FovX = Projection.GetFovX();
+    Config.TargetPixelSize = GetPatchTargetPixelSize(PixelSize, DefaultPatchLevel);
+    Config.ScreenResolutionWidth = Projection.ScreenResolutionWidth;
+    Config.DisplacementFactor = 0.3f;
+    LodKernelDefines Defines;
+    SubdEngine Engine(Quad, SubdBufferSize, &Pool);
+    Engine.LoadBuffer(Quad.CreateRootKeys());
+    Engine.SetHeightBounds(&Bounds);
+    std::vector<BenchmarkPath> Paths = GetBenchmarkPaths();
+    const BenchmarkPath& Flyover = Paths[0];
+    SubdCamera Camera = Flyover.Path.GetCamera(Flyover.Path.GetDuration() * 0.5f, Projection);
+    for (int Frame = 0; Frame < 16 && !Engine.GetBufferCounter().Converged; ++Frame) {
+        Engine.Converge(Camera, Config, Defines, 64);
+    }
+    std::vector<PrimitiveData> Converged(Engine.GetSubdIn(), Engine.GetSubdIn() + Engine.GetSubdInCount());
+
+    std::vector<PrimitiveData> Uniform;
+    Uniform.reserve((size_t)Quad.GetPrimitiveCount() << UniformDepth);
+    for (uint32_t PrimitiveIndex = 0; PrimitiveIndex < Quad.GetPrimitiveCount(); ++PrimitiveIndex) {
+        for (uint32_t Key = 1u << UniformDepth; Key < 2u << UniformDepth; ++Key) {
+            Uniform.push_back({ PrimitiveIndex, Key });
+        }
+    }
+
+    MeshExportConfig ExportConfig;
+    ExportConfig.Render.Mesh = &Quad;
+    ExportConfig.Render.SlopeMap = &SlopeMap;
+    ExportConfig.Render.DisplacementFactor = Config.DisplacementFactor;
+    ExportConfig.HeightMap = &HeightMap;
+    ExportConfig.Render.TransformTable = &KeyTransformTable::GetDefault();
+    const std::string BinaryPath = "MeshExportBench.bin";
+    const std::string SinglePath = "MeshExportBench.1t.bin";
+    const std::string ExactPath = "MeshExportBench.exact.bin";
+    const std::string ObjPath = "MeshExportBench.obj";
+    printf("heightmap %u x %u, chunks of %u leaves, weld window %u chunks, %u threads\n", Size, Size, ExportConfig.ChunkLeafCount,
+        ExportConfig.WeldWindowChunks, Pool.GetThreadCount());
+
+    struct KeySet {
+        const char* Name;
+        const std::vector<PrimitiveData>* Leaves;
+        uint32_t PatchLevel;
+    };
+    const KeySet KeySets[] = { { "converged", &Converged, DefaultPatchLevel }, { "uniform", &Uniform, UniformPatchLevel } };
+
+    uint32_t Failures = 0;
+    printf("%-10s %-12s %9s %10s %10s %9s %9s %10s %9s %9s %9s %12s\n", "set", "export", "leaves", "vertices", "triangles", "welded", "weld map",
+        "MB", "eval ms", "weld ms", "write ms", "Mtris/s");
+    for (const KeySet& Set : KeySets) {
+        MeshExportConfig SetConfig = ExportConfig;
+        SetConfig.PatchLevel = Set.PatchLevel;
+        MeshExportConfig ExactConfig = SetConfig;
+        ExactConfig.WeldWindowChunks = 0;
+        MeshExportConfig ObjConfig = SetConfig;
+        ObjConfig.Format = MeshExportFormat::Obj;
+        struct Export {
+            const char* Name;
+            const MeshExportConfig* Config;
+            std::string Path;
+            ThreadPool* Pool;
+            MeshExportStats Stats;
+        };
+        Export Exports[] = {
+            { "binary", &SetConfig, BinaryPath, &Pool, {} },
+            { "binary 1t", &SetConfig, SinglePath, &SinglePool, {} },
+            { "binary exact", &ExactConfig, ExactPath, &Pool, {} },
+            { "obj", &ObjConfig, ObjPath, &Pool, {} },
+        };
+        uint32_t LeafCount = (uint32_t)Set.Leaves->size();
+        for (Export& Run : Exports) {
+            if (!ExportSubdMesh(Run.Path, Set.Leaves->data(), LeafCount, *Run.Config, &Run.Stats, *Run.Pool)) {
+                printf("  %s: %s export failed\n", Set.Name, Run.Name);
+                ++Failures;
+            }
+            const MeshExportStats& Stats = Run.Stats;
+            printf("%-10s %-12s %9llu %10llu %10llu %9llu %9zu %10.1f %9.1f %9.1f %9.1f %12.2f\n", Set.Name, Run.Name, (unsigned long long)Stats.LeafCount,
+                (unsigned long long)Stats.VertexCount, (unsigned long long)Stats.TriangleCount, (unsigned long long)Stats.WeldedCount, Stats.PeakWeldEntries,
+                Stats.ByteCount / (double)(1 << 20), Stats.EvaluateMs, Stats.WeldMs, Stats.WriteMs, Stats.GetTrianglesPerSecond() * 1e-6);
+        }
+        const MeshExportStats& Windowed = Exports[0].Stats;
+        const MeshExportStats& Exact = Exports[2].Stats;
+
+        uint64_t ExpectedTriangles = (uint64_t)LeafCount * (GetPatchIndexCount(Set.PatchLevel) / 3);
+        if (Windowed.TriangleCount != ExpectedTriangles || Exact.TriangleCount != ExpectedTriangles) {
+            printf("  %s: %llu triangles written, %llu expected\n", Set.Name, (unsigned long long)Windowed.TriangleCount, (unsigned long long)ExpectedTriangles);
+            ++Failures;
+        }
+        if (!IsSameFile(BinaryPath, SinglePath)) {
+            printf("  %s: one thread wrote a different file\n", Set.Name);
+            ++Failures;
+        }
+        if (Windowed.VertexCount < Exact.VertexCount) {
+            printf("  %s: the weld window merged vertices exact welding keeps apart\n", Set.Name);
+            ++Failures;
+        }
+        printf("  %s: the weld window writes %.3f%% more vertices than exact welding\n", Set.Name,
+            100.0 * ((double)Windowed.VertexCount / std::max<uint64_t>(Exact.VertexCount, 1) - 1.0));
+
+        std::vector<float3> Vertices;
+        std::vector<uint32_t> Indices;
+        if (!ReadSubdMeshExport(BinaryPath, Vertices, Indices) || Vertices.size() != Windowed.VertexCount || Indices.size() != Windowed.TriangleCount * 3) {
+            printf("  %s: the binary file does not read back\n", Set.Name);
+            ++Failures;
+        }
+        uint64_t ObjVertices, ObjFaces;
+        CountObjLines(ObjPath, ObjVertices, ObjFaces);
+        if (ObjVertices != Windowed.VertexCount || ObjFaces != Windowed.TriangleCount) {
+            printf("  %s: the OBJ file has %llu vertices and %llu faces\n", Set.Name, (unsigned long long)ObjVertices, (unsigned long long)ObjFaces);
+            ++Failures;
+        }
+
+        // A uniform set has no T-junctions: exact welding gives the grid of the quad bisected
+        // depth + level + 1 times, (n + 1)^2 corners plus the n^2 centres at odd depths.
+        if (&Set == &KeySets[1]) {
+            uint32_t Depth = UniformDepth + Set.PatchLevel;
+            uint64_t n = 1ull << (Depth / 2);
+            uint64_t ExpectedVertices = (n + 1) * (n + 1) + (Depth % 2 ? n * n : 0);
+            if (Exact.VertexCount != ExpectedVertices) {
+                printf("  %s: exact welding wrote %llu vertices, the grid has %llu\n", Set.Name, (unsigned long long)Exact.VertexCount,
+                    (unsigned long long)ExpectedVertices);
+                ++Failures;
+            }
+            // Watertight: only the 4n edges along the sides of the quad are open.
+            uint64_t OpenEdges = 0, NonManifoldEdges = 0;
+            if (ReadSubdMeshExport(ExactPath, Vertices, Indices)) {
+                CountOpenEdges(Indices, OpenEdges, NonManifoldEdges);
+            }
+            if (OpenEdges != 4 * n || NonManifoldEdges) {
+                printf("  %s: the exact weld has %llu open edges (%llu on the sides) and %llu shared by more than two triangles\n", Set.Name,
+                    (unsigned long long)OpenEdges, (unsigned long long)(4 * n), (unsigned long long)NonManifoldEdges);
+                ++Failures;
+            }
+        }
+    }
+    for (const std::string& Path : { BinaryPath, SinglePath, ExactPath, ObjPath }) {
+        remove(Path.c_str());
+    }
+
+    printf("%s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+// Multi-view lod (MULTI_VIEW) against one LodKernel pass per view, on a synthetic displaced
+// heightmap with frustum culling and height bounds. Two set-ups of 1 to MaxLodViewCount views
+// follow the flyover path: a rig of cameras side by side (stereo at 2 views) and split screen,
+// players spread along the path. The multi-view engine converges once for all views
+// and walks its keys once per frame; the reference runs one engine per view. Reports the
+// leaves and the time per frame of both, and checks after every run that the converged tree
+// is fine enough for each view (a single-view pass over it splits nothing) and that each
+// view's list holds exactly the leaves of that tree inside its frustum.
+//
+// MultiViewBench [heightmap size] [pixel size] [frames]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "Headless/CameraPath.h"
+#include "Headless/SubdEngine.h"
+
+using namespace Headless;
+
+// Where on the flyover the runs start: the dive towards the ground plane.
+static const float StartTime = 5.0f;
+static const float FrameTime = 1.0f / 60.0f;
+// Distance between the rig cameras, and path time between split-screen players.
+static const float RigSpacing = 0.02f;
+static const float PlayerSpacing = 2.5f;
+
+static float GetTerrainHeight(float inX, float inY) {
+    float Ridge = std::max(0.0f, std::sin(6.2831853f * 1.5f * inX) * std::cos(6.2831853f * inY));
+    return 0.1f + 0.35f * Ridge * Ridge;
+}
+
+static std::vector<uint64_t> GetSortedKeys(const PrimitiveData* inKeys, uint32_t inCount) {
+    std::vector<uint64_t> Keys(inCount);
+    for (uint32_t i = 0; i < inCount; ++i) {
+        Keys[i] = (uint64_t)inKeys[i].PrimitiveIndex << 32 | inKeys[i].SubdBinaryKey;
+    }
+    std::sort(Keys.begin(), Keys.end());
+    return Keys;
+}
+
+static SubdView GetView(const CameraPath& inPath, const CameraProjection& inProjection, bool inSplitScreen, uint32_t inView, float inTime) {
+    SubdView View;
+    View.FovX = inProjection.GetFovX();
+    View.ScreenResolutionWidth = inProjection.ScreenResolutionWidth;
+    CameraPathKey Key = inPath.Evaluate(inSplitScreen ? inTime + PlayerSpacing * inView : inTime);
+    if (!inSplitScreen) {
+        float3 Offset = normalize(cross(Key.Target - Key.PosW, Key.Up)) * (RigSpacing * inView);
+        Key.PosW = Key.PosW + Offset;
+        Key.Target = Key.Target + Offset;
+    }
+    View.Camera.PosW = Key.PosW;
+    View.Camera.ViewProjMat = CreateViewProjMat(Key.PosW, Key.Target, Key.Up, inProjection.FovY, inProjection.AspectRatio, inProjection.NearZ, inProjection.FarZ);
+    return View;
+}
+
+int main(int argc, char** argv) {
+    uint32_t Size = argc > 1 ? (uint32_t)atoi(argv[1]) : 1024;
+    float PixelSize = argc > 2 ? (float)atof(argv[2]) : 1.0f;
+    uint32_t FrameCount = argc > 3 ? (uint32_t)atoi(argv[3]) : 30;
+
+    std::vector<uint16_t> Heights((size_t)Size * Size);
+    for (uint32_t j = 0; j < Size; ++j) {
+        for (uint32_t i = 0; i < Size; ++i) {
+            float z = GetTerrainHeight((float)i / Size, (float)j / Size);
+            Heights[(size_t)j * Size + i] = (uint16_t)(std::min(std::max(z, 0.0f), 1.0f) * 65535.0f);
+        }
+    }
+    ThreadPool Pool(0);
+    HeightBoundsPyramid Bounds;
+    Bounds.Build(Heights.data(), Size, Size, Pool);
+    printf("heightmap %u x %u, %u frames per run from t = %.1f s of the flyover\n", Size, Size, FrameCount, StartTime);
+
+    CameraPath Path = CameraPath::CreateFlyover();
+    CameraProjection Projection;
+    LodKernelConfig Config = {};
+    Config.FovX = Projection.GetFovX();
+    Config.TargetPixelSize = PixelSize;
+    Config.ScreenResolutionWidth = Projection.ScreenResolutionWidth;
+    Config.DisplacementFactor = 0.3f;
+
+    LodKernelDefines Defines;
+    LodKernelDefines MultiDefines = Defines;
+    MultiDefines.MultiView = true;
+    LodKernelDefines FrozenDefines = Defines;
+    FrozenDefines.FreezeSubdivision = true;
+
+    uint32_t Failures = 0;
+    printf("%-7s %5s %10s %10s %10s %10s %8s\n", "set-up", "views", "leaves", "N leaves", "multi ms", "N ms", "speedup");
+    for (int SplitScreen = 0; SplitScreen < 2; ++SplitScreen) {
+        for (uint32_t ViewCount = 1; ViewCount <= MaxLodViewCount; ++ViewCount) {
+            SubdEngine Multi(SubdMesh::CreateQuad(), SubdBufferSize, &Pool);
+            Multi.SetHeightBounds(&Bounds);
+            std::vector<std::unique_ptr<SubdEngine>> Singles;
+            for (uint32_t View = 0; View < ViewCount; ++View) {
+                Singles.push_back(std::make_unique<SubdEngine>(SubdMesh::CreateQuad(), SubdBufferSize, &Pool));
+                Singles.back()->SetHeightBounds(&Bounds);
+            }
+
+            SubdView Views[MaxLodViewCount];
+            LodKernelConfig ViewConfigs[MaxLodViewCount];
+            LodKernelConfig MultiConfig = Config;
+            auto SetViews = [&](float inTime) {
+                for (uint32_t View = 0; View < ViewCount; ++View) {
+                    Views[View] = GetView(Path, Projection, SplitScreen != 0, View, inTime);
+                    ViewConfigs[View] = Config;
+                    SetLodViews(ViewConfigs[View], &Views[View], 1);
+                }
+                SetLodViews(MultiConfig, Views, ViewCount);
+            };
+
+            SetViews(StartTime);
+            for (int Frame = 0; Frame < 16 && !Multi.GetBufferCounter().Converged; ++Frame) {
+                Multi.Converge(Views[0].Camera, MultiConfig, MultiDefines, 64);
+            }
+            for (uint32_t View = 0; View < ViewCount; ++View) {
+                for (int Frame = 0; Frame < 16 && !Singles[View]->GetBufferCounter().Converged; ++Frame) {
+                    Singles[View]->Converge(Views[View].Camera, ViewConfigs[View], Defines, 64);
+                }
+            }
+
+            double Ms[2] = {};
+            uint64_t Leaves[2] = {};
+            for (uint32_t Frame = 1; Frame <= FrameCount; ++Frame) {
+                SetViews(StartTime + FrameTime * Frame);
+                Leaves[0] += Multi.GetSubdInCount();
+                auto Start = std::chrono::high_resolution_clock::now();
+                Multi.Update(Views[0].Camera, MultiConfig, MultiDefines);
+                Ms[0] += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+                Start = std::chrono::high_resolution_clock::now();
+                for (uint32_t View = 0; View < ViewCount; ++View) {
+                    Leaves[1] += Singles[View]->GetSubdInCount();
+                    Singles[View]->Update(Views[View].Camera, ViewConfigs[View], Defines);
+                }
+                Ms[1] += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+            }
+
+            // Settle the last frame, then replay its tree through one single-view pass per
+            // view: subdividing for it must not split anything, freezing it must cull alike.
+            Multi.Converge(Views[0].Camera, MultiConfig, MultiDefines, 64);
+            std::vector<PrimitiveData> Tree(Multi.GetSubdIn(), Multi.GetSubdIn() + Multi.GetSubdInCount());
+            bool Converged = Multi.GetBufferCounter().Converged != 0;
+            uint32_t Splits = 0;
+            uint32_t ListMismatches = 0;
+            for (uint32_t View = 0; View < ViewCount; ++View) {
+                SubdEngine Probe(SubdMesh::CreateQuad(), SubdBufferSize, &Pool);
+                Probe.SetHeightBounds(&Bounds);
+                Probe.LoadBuffer(Tree);
+                Probe.Update(Views[View].Camera, ViewConfigs[View], Defines);
+                Splits += Probe.GetBufferCounter().SplitCount;
+
+                Probe.LoadBuffer(Tree);
+                Probe.Update(Views[View].Camera, ViewConfigs[View], FrozenDefines);
+                if (GetSortedKeys(Probe.GetSubdCulledOut(), Probe.GetSubdCulledOutCount()) !=
+                    GetSortedKeys(Multi.GetSubdCulledOut(View), Multi.GetSubdCulledOutCount(View))) {
+                    ++ListMismatches;
+                }
+            }
+            if (!Converged || Splits || ListMismatches) {
+                if (Failures++ < 10) {
+                    printf("  %s with %u views: %s, %u splits left, %u view lists differ\n", SplitScreen ? "split" : "rig", ViewCount,
+                        Converged ? "converged" : "not converged", Splits, ListMismatches);
+                }
+            }
+
+            printf("%-7s %5u %10llu %10llu %10.2f %10.2f %7.2fx\n", SplitScreen ? "split" : "rig", ViewCount,
+                (unsigned long long)(Leaves[0] / std::max(FrameCount, 1u)), (unsigned long long)(Leaves[1] / std::max(FrameCount, 1u)),
+                Ms[0] / std::max(FrameCount, 1u), Ms[1] / std::max(FrameCount, 1u), Ms[0] > 0.0 ? Ms[1] / Ms[0] : 0.0);
+        }
+    }
+
+    printf("%s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,163 @@
+// Load time of Headless/SubdObjLoader.h on a scaled-up Suzanne: every triangle of Suzanne.obj
+// is split into 4^levels triangles and written as its own patch, so the vertices on patch
+// borders are duplicated and have to be welded back. Times a single threaded getline /
+// strtof / unordered_map loader against LoadObjMesh, checks they give the same mesh, and
+// reports the weld counts with and without a snapping epsilon.
+//
+// ObjLoadBench [obj file] [levels] [threads]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Headless/SubdObjLoader.h"
+
+using namespace Headless;
+
+static double MsSince(std::chrono::high_resolution_clock::time_point inStart) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - inStart).count();
+}
+
+static bool WriteScaledObj(const char* inPath, const SubdMesh& inMesh, uint32_t inLevels, size_t& outPositionCount) {
+    FILE* File = fopen(inPath, "wb");
+    if (!File) {
+        return false;
+    }
+    uint32_t n = 1u << inLevels;
+    uint32_t PatchVertexCount = (n + 1) * (n + 2) / 2;
+    std::vector<uint32_t> Row(n + 2);
+    for (uint32_t j = 0, Offset = 0; j <= n + 1; Offset += n + 1 - j, ++j) {
+        Row[j] = Offset;
+    }
+    outPositionCount = 0;
+    std::string Text;
+    for (uint32_t t = 0; t < inMesh.GetPrimitiveCount(); ++t) {
+        float4 Corners[3];
+        inMesh.GetPrimitiveVertices(t, Corners);
+        Text.clear();
+        char Line[128];
+        for (uint32_t j = 0; j <= n; ++j) {
+            for (uint32_t i = 0; i + j <= n; ++i) {
+                float4 P = (Corners[0] * (float)(n - i - j) + Corners[1] * (float)i + Corners[2] * (float)j) / (float)n;
+                Text.append(Line, snprintf(Line, sizeof(Line), "v %.6f %.6f %.6f\n", P.x, P.y, P.z));
+            }
+        }
+        // Relative indices: -1 is the last position written.
+        auto Index = [&](uint32_t i, uint32_t j) { return (int)(Row[j] + i) - (int)PatchVertexCount; };
+        for (uint32_t j = 0; j < n; ++j) {
+            for (uint32_t i = 0; i + j < n; ++i) {
+                Text.append(Line, snprintf(Line, sizeof(Line), "f %d %d %d\n", Index(i, j), Index(i + 1, j), Index(i, j + 1)));
+                if (i + j + 1 < n) {
+                    Text.append(Line, snprintf(Line, sizeof(Line), "f %d %d %d\n", Index(i + 1, j), Index(i + 1, j + 1), Index(i, j + 1)));
+                }
+            }
+        }
+        outPositionCount += PatchVertexCount;
+        fwrite(Text.data(), 1, Text.size(), File);
+    }
+    return fclose(File) == 0;
+}
+
+// The straightforward loader: line by line, strtof, exact weld through a hash map.
+static bool LoadObjReference(const char* inPath, SubdMesh& outMesh) {
+    std::ifstream Stream(inPath);
+    if (!Stream) {
+        return false;
+    }
+    std::vector<uint32_t> Remap;
+    std::unordered_map<std::string, uint32_t> Welded;
+    outMesh = SubdMesh();
+    std::string Line;
+    while (std::getline(Stream, Line)) {
+        if (Line.size() > 2 && Line[0] == 'v' && Line[1] == ' ') {
+            char* Cursor = &Line[2];
+            float4 P;
+            P.x = strtof(Cursor, &Cursor);
+            P.y = strtof(Cursor, &Cursor);
+            P.z = strtof(Cursor, &Cursor);
+            P.w = 1.0f;
+            float Bits[3] = { P.x == 0.0f ? 0.0f : P.x, P.y == 0.0f ? 0.0f : P.y, P.z == 0.0f ? 0.0f : P.z };
+            auto Inserted = Welded.emplace(std::string((const char*)Bits, sizeof(Bits)), (uint32_t)outMesh.VertexData.size());
+            if (Inserted.second) {
+                outMesh.VertexData.push_back(P);
+            }
+            Remap.push_back(Inserted.first->second);
+        } else if (Line.size() > 2 && Line[0] == 'f' && Line[1] == ' ') {
+            std::vector<uint32_t> Corners;
+            char* Cursor = &Line[2];
+            for (;;) {
+                char* Next = nullptr;
+                long Index = strtol(Cursor, &Next, 10);
+                if (Next == Cursor) {
+                    break;
+                }
+                Corners.push_back(Remap[Index > 0 ? Index - 1 : (long)Remap.size() + Index]);
+                Cursor = Next;
+                while (*Cursor && *Cursor != ' ') {
+                    ++Cursor;
+                }
+            }
+            for (size_t c = 2; c < Corners.size(); ++c) {
+                uint32_t Triangle[3] = { Corners[0], Corners[c - 1], Corners[c] };
+                if (Triangle[0] != Triangle[1] && Triangle[1] != Triangle[2] && Triangle[2] != Triangle[0]) {
+                    outMesh.IndexData.insert(outMesh.IndexData.end(), Triangle, Triangle + 3);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* SourcePath = argc > 1 ? argv[1] : "Data/Suzanne.obj";
+    uint32_t Levels = argc > 2 ? (uint32_t)atoi(argv[2]) : 5;
+    ThreadPool Pool(argc > 3 ? (uint32_t)atoi(argv[3]) : 0);
+    const char* ScaledPath = "ObjLoadBench.obj";
+
+    SubdMesh Suzanne;
+    ObjLoadStats Stats;
+    if (!LoadObjMesh(SourcePath, Suzanne, ObjLoadConfig(), &Stats, Pool)) {
+        printf("could not load %s\n", SourcePath);
+        return 1;
+    }
+    printf("%s: %u positions, %u faces -> %u vertices, %u triangles\n", SourcePath, Stats.PositionCount, Stats.FaceCount, Stats.VertexCount,
+        Stats.TriangleCount);
+
+    size_t ScaledPositions = 0;
+    if (!WriteScaledObj(ScaledPath, Suzanne, Levels, ScaledPositions)) {
+        printf("could not write %s\n", ScaledPath);
+        return 1;
+    }
+
+    auto Start = std::chrono::high_resolution_clock::now();
+    SubdMesh Reference;
+    LoadObjReference(ScaledPath, Reference);
+    double ReferenceMs = MsSince(Start);
+
+    Start = std::chrono::high_resolution_clock::now();
+    SubdMesh Mesh;
+    bool Loaded = LoadObjMesh(ScaledPath, Mesh, ObjLoadConfig(), &Stats, Pool);
+    double LoadMs = MsSince(Start);
+    bool Same = Loaded && Mesh.IndexData == Reference.IndexData && Mesh.VertexData.size() == Reference.VertexData.size()
+        && memcmp(Mesh.VertexData.data(), Reference.VertexData.data(), Mesh.VertexData.size() * sizeof(float4)) == 0;
+
+    printf("scaled x%u: %.1f MB, %zu positions, %u triangles, %u threads\n", 1u << (2 * Levels), Stats.FileBytes / 1048576.0, ScaledPositions,
+        Stats.TriangleCount, Pool.GetThreadCount());
+    printf("reference loader    %9.1f ms  %zu vertices\n", ReferenceMs, Reference.VertexData.size());
+    printf("LoadObjMesh         %9.1f ms  %u vertices  %.0f MB/s  %s\n", LoadMs, Stats.VertexCount, Stats.FileBytes / 1048576.0 / (LoadMs / 1000.0),
+        Same ? "same mesh" : "MISMATCH");
+
+    ObjLoadConfig Snap;
+    Snap.WeldEpsilon = 1e-5f;
+    Start = std::chrono::high_resolution_clock::now();
+    Loaded = LoadObjMesh(ScaledPath, Mesh, Snap, &Stats, Pool) && Loaded;
+    printf("weld epsilon 1e-5   %9.1f ms  %u vertices, %u degenerate triangles removed\n", MsSince(Start), Stats.VertexCount,
+        Stats.DegenerateTriangleCount);
+
+    std::remove(ScaledPath);
+    return Same && Loaded ? 0 : 1;
+}
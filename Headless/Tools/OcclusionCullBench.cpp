@@ -0,0 +1,258 @@
+// Hi-Z occlusion culling of the subdivision leaves against a software-rasterized depth
+// buffer (Headless/SubdOcclusion.h), over a synthetic mountain range. Each frame the drawn
+// leaves are rasterized as small displaced grids into a coarse depth buffer, its max
+// pyramid is built, and the next frame's LodKernel culls the leaves hidden behind it, as
+// the sample does with OCCLUSION_CULLING.
+//
+// For a set of still cameras, reports the frustum-visible leaves and how many of them the
+// pyramid culls, and checks that none of the culled leaves has a pixel in front of the
+// depth of all frustum-visible leaves. Then flies CameraPath::CreateFlyover and reports the
+// leaves culled on the previous frame's depth that turn out visible (they pop in one frame
+// late). Also checks the occluded counter against a recount.
+//
+// OcclusionCullBench [heightmap size] [pixel size] [depth width] [flyover fps]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Headless/CameraPath.h"
+#include "Headless/SubdEngine.h"
+#include "Headless/SubdTexture.h"
+
+using namespace Headless;
+
+// Grid steps along each edge of a rasterized leaf.
+static const int LeafGridSize = 4;
+
+struct OcclusionCamera {
+    const char* Name;
+    float3 PosW;
+    float3 Target;
+};
+
+// Ridges crossing the map at up to 0.85 of the displacement, with valleys in between.
+static float GetTerrainHeight(float inX, float inY) {
+    float A = std::sin(6.2831853f * (2.0f * inX + 0.4f * std::sin(6.2831853f * inY)));
+    float B = std::sin(6.2831853f * 1.5f * inY + 1.0f);
+    float Ridge = std::max(0.0f, A * B);
+    return 0.05f + 0.8f * Ridge * Ridge + 0.02f * std::sin(6.2831853f * 17.0f * (inX - inY));
+}
+
+// Calls inFn(clip[3]) for each triangle of the leaf's displaced LeafGridSize grid, the
+// vertices placed like RenderKernelVS places the patch vertices (without Phong).
+template<typename Fn>
+static void ForEachLeafTriangle(const SubdMesh& inMesh, const PrimitiveData& inLeaf, const SubdTexture& inHeightMap, float inDisplacementFactor,
+    const float4x4& inViewProjMat, Fn&& inFn) {
+    float4 InVertices[3], OutVertices[3];
+    inMesh.GetPrimitiveVertices(inLeaf.PrimitiveIndex, InVertices);
+    Subd(inLeaf.SubdBinaryKey, InVertices, OutVertices);
+
+    float4 Clip[LeafGridSize + 1][LeafGridSize + 1];
+    for (int j = 0; j <= LeafGridSize; ++j) {
+        for (int i = 0; i + j <= LeafGridSize; ++i) {
+            float4 Position = Berp(OutVertices, float2((float)i / LeafGridSize, (float)j / LeafGridSize));
+            Position.z += inHeightMap.SampleLevel(float2(Position.x * 0.5f + 0.5f, Position.y * 0.5f + 0.5f)).x * inDisplacementFactor;
+            Clip[j][i] = mul(Position, inViewProjMat);
+        }
+    }
+    for (int j = 0; j < LeafGridSize; ++j) {
+        for (int i = 0; i + j < LeafGridSize; ++i) {
+            float4 Lower[3] = { Clip[j][i], Clip[j][i + 1], Clip[j + 1][i] };
+            inFn(Lower);
+            if (i + j < LeafGridSize - 1) {
+                float4 Upper[3] = { Clip[j][i + 1], Clip[j + 1][i + 1], Clip[j + 1][i] };
+                inFn(Upper);
+            }
+        }
+    }
+}
+
+static void RasterizeLeaves(SoftwareDepthBuffer& ioDepth, const SubdMesh& inMesh, const std::vector<PrimitiveData>& inLeaves, const SubdTexture& inHeightMap,
+    float inDisplacementFactor, const float4x4& inViewProjMat) {
+    ioDepth.Clear();
+    for (const PrimitiveData& Leaf : inLeaves) {
+        ForEachLeafTriangle(inMesh, Leaf, inHeightMap, inDisplacementFactor, inViewProjMat, [&](const float4 inClip[3]) { ioDepth.RasterizeTriangle(inClip); });
+    }
+}
+
+// Leaves of SubdIn by what one more LodKernel pass would do with them.
+struct LeafClasses {
+    std::vector<PrimitiveData> Drawn;
+    std::vector<PrimitiveData> Occluded;
+    std::vector<PrimitiveData> FrustumVisible;
+};
+
+static LeafClasses ClassifyLeaves(const SubdEngine& inEngine, const SubdCamera& inCamera, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines,
+    const LodKernelTextures& inTextures) {
+    LodKernelConfig Config = inConfig;
+    SetFrustumPlanes(Config, inCamera.ViewProjMat);
+    LeafClasses Classes;
+    for (uint32_t i = 0; i < inEngine.GetSubdInCount(); ++i) {
+        const PrimitiveData& Leaf = inEngine.GetSubdIn()[i];
+        LodKernelResult Result = EvaluateLodKernel(inEngine.GetMesh(), Leaf, inCamera, Config, inDefines, inTextures);
+        if (Result.Visible) {
+            Classes.Drawn.push_back(Leaf);
+        }
+        if (Result.Occluded) {
+            Classes.Occluded.push_back(Leaf);
+        }
+        if (Result.Visible || Result.Occluded) {
+            Classes.FrustumVisible.push_back(Leaf);
+        }
+    }
+    return Classes;
+}
+
+int main(int argc, char** argv) {
+    uint32_t Size = argc > 1 ? (uint32_t)atoi(argv[1]) : 1024;
+    float PixelSize = argc > 2 ? (float)atof(argv[2]) : 1.0f;
+    uint32_t DepthWidth = argc > 3 ? (uint32_t)atoi(argv[3]) : 320;
+    float Fps = argc > 4 ? (float)atof(argv[4]) : 30.0f;
+
+    std::vector<uint16_t> Heights((size_t)Size * Size);
+    SubdTexture HeightMap;
+    HeightMap.Width = HeightMap.Height = Size;
+    HeightMap.ChannelCount = 1;
+    HeightMap.Texels.resize(Heights.size());
+    for (uint32_t j = 0; j < Size; ++j) {
+        for (uint32_t i = 0; i < Size; ++i) {
+            float z = GetTerrainHeight((float)i / Size, (float)j / Size);
+            Heights[(size_t)j * Size + i] = (uint16_t)(std::min(std::max(z, 0.0f), 1.0f) * 65535.0f);
+            HeightMap.Texels[(size_t)j * Size + i] = Heights[(size_t)j * Size + i] / 65535.0f;
+        }
+    }
+    ThreadPool Pool(0);
+    HeightBoundsPyramid Bounds;
+    Bounds.Build(Heights.data(), Size, Size, Pool);
+
+    CameraProjection Projection;
+    uint32_t DepthHeight = std::max((uint32_t)(DepthWidth / Projection.AspectRatio + 0.5f), 1u);
+    LodKernelConfig Config;
+    Config.FovX = Projection.GetFovX();
+    Config.TargetPixelSize = PixelSize;
+    Config.ScreenResolutionWidth = Projection.ScreenResolutionWidth;
+    Config.DisplacementFactor = 0.3f;
+    LodKernelDefines Defines;
+    Defines.OcclusionCulling = true;
+    LodKernelDefines FrustumDefines;
+
+    SoftwareDepthBuffer Depth;
+    Depth.Resize(DepthWidth, DepthHeight);
+    SoftwareDepthBuffer Reference;
+    Reference.Resize(DepthWidth, DepthHeight);
+    HiZPyramid HiZ;
+    printf("heightmap %u x %u, depth %u x %u, pixel size %.1f\n", Size, Size, DepthWidth, DepthHeight, PixelSize);
+
+    const OcclusionCamera Cameras[] = {
+        { "valley floor", float3(-0.80f, -0.60f, 0.06f), float3(0.80f, 0.50f, 0.05f) },
+        { "behind ridge", float3(-0.95f, -0.95f, 0.18f), float3(0.50f, 0.50f, 0.05f) },
+        { "low across", float3(-0.95f, -0.95f, 0.30f), float3(0.50f, 0.50f, 0.05f) },
+        { "ridge line", float3(0.00f, -0.90f, 0.30f), float3(0.00f, 0.90f, 0.00f) },
+        { "overview", float3(-0.95f, -0.95f, 0.80f), float3(0.00f, 0.00f, 0.00f) },
+        { "looking down", float3(0.00f, 0.00f, 0.60f), float3(0.10f, 0.10f, 0.00f) },
+    };
+
+    uint32_t Failures = 0;
+    uint64_t TotalFrustumVisible = 0;
+    uint64_t TotalOccluded = 0;
+    double BuildMs = 0.0;
+    uint32_t BuildCount = 0;
+    printf("%-14s %8s %10s %10s %8s %8s\n", "camera", "leaves", "frustum", "occluded", "culled", "false");
+    for (const OcclusionCamera& Camera : Cameras) {
+        SubdCamera View;
+        View.PosW = Camera.PosW;
+        View.ViewProjMat = CreateViewProjMat(Camera.PosW, Camera.Target, float3(0.0f, 0.0f, 1.0f), Projection.FovY, Projection.AspectRatio, Projection.NearZ,
+            Projection.FarZ);
+        SubdEngine Engine(SubdMesh::CreateQuad(), SubdBufferSize, &Pool);
+        Engine.SetHeightBounds(&Bounds);
+        Engine.SetHiZ(&HiZ);
+        SetHiZView(Config, View.ViewProjMat, 0, 0);
+
+        // Converge with occlusion, drawing each frame into the depth the next one culls with.
+        for (int Frame = 0; Frame < 24; ++Frame) {
+            Engine.Converge(View, Config, Defines, 64);
+            std::vector<PrimitiveData> Drawn(Engine.GetSubdCulledOut(), Engine.GetSubdCulledOut() + Engine.GetSubdCulledOutCount());
+            RasterizeLeaves(Depth, Engine.GetMesh(), Drawn, HeightMap, Config.DisplacementFactor, View.ViewProjMat);
+            auto Start = std::chrono::high_resolution_clock::now();
+            HiZ.Build(Depth.GetDepth(), DepthWidth, DepthHeight, Pool);
+            BuildMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+            ++BuildCount;
+            SetHiZView(Config, View.ViewProjMat, DepthWidth, DepthHeight);
+        }
+
+        LeafClasses Classes = ClassifyLeaves(Engine, View, Config, Defines, LodKernelTextures{ &Bounds, &HiZ });
+        if (Engine.GetBufferCounter().Converged && Classes.Occluded.size() != Engine.GetBufferCounter().LastOccludedCount) {
+            printf("  occluded counter %u, recount %zu\n", Engine.GetBufferCounter().LastOccludedCount, Classes.Occluded.size());
+            ++Failures;
+        }
+        LeafClasses Frustum = ClassifyLeaves(Engine, View, Config, FrustumDefines, LodKernelTextures{ &Bounds, nullptr });
+        if (Frustum.Drawn.size() != Classes.FrustumVisible.size()) {
+            printf("  frustum-visible leaves differ: %zu without occlusion, %zu with\n", Frustum.Drawn.size(), Classes.FrustumVisible.size());
+            ++Failures;
+        }
+
+        // A culled leaf must lie behind everything the frustum keeps.
+        RasterizeLeaves(Reference, Engine.GetMesh(), Classes.FrustumVisible, HeightMap, Config.DisplacementFactor, View.ViewProjMat);
+        uint32_t FalseCulls = 0;
+        for (const PrimitiveData& Leaf : Classes.Occluded) {
+            uint32_t Pixels = 0;
+            ForEachLeafTriangle(Engine.GetMesh(), Leaf, HeightMap, Config.DisplacementFactor, View.ViewProjMat,
+                [&](const float4 inClip[3]) { Pixels += Reference.CountVisiblePixels(inClip, 1e-6f); });
+            FalseCulls += Pixels ? 1 : 0;
+        }
+        Failures += FalseCulls;
+
+        printf("%-14s %8u %10zu %10zu %7.1f%% %8u\n", Camera.Name, Engine.GetSubdInCount(), Classes.FrustumVisible.size(), Classes.Occluded.size(),
+            Classes.FrustumVisible.empty() ? 0.0f : 100.0f * Classes.Occluded.size() / Classes.FrustumVisible.size(), FalseCulls);
+        TotalFrustumVisible += Classes.FrustumVisible.size();
+        TotalOccluded += Classes.Occluded.size();
+    }
+    printf("still cameras: %llu of %llu frustum-visible leaves occluded (%.1f%%), pyramid build %.2f ms\n", (unsigned long long)TotalOccluded,
+        (unsigned long long)TotalFrustumVisible, 100.0 * TotalOccluded / std::max<uint64_t>(TotalFrustumVisible, 1), BuildMs / std::max(BuildCount, 1u));
+
+    // Flyover: the pyramid and its view are always the previous frame's.
+    CameraPath Path = CameraPath::CreateFlyover();
+    SubdEngine Engine(SubdMesh::CreateQuad(), SubdBufferSize, &Pool);
+    Engine.SetHeightBounds(&Bounds);
+    Engine.SetHiZ(&HiZ);
+    SetHiZView(Config, float4x4::Identity(), 0, 0);
+    uint64_t FlyFrustumVisible = 0;
+    uint64_t FlyOccluded = 0;
+    uint64_t LateLeaves = 0;
+    uint64_t LatePixels = 0;
+    uint32_t LateFrames = 0;
+    uint32_t FrameCount = (uint32_t)(Path.GetDuration() * Fps) + 1;
+    for (uint32_t Frame = 0; Frame < FrameCount; ++Frame) {
+        SubdCamera View = Path.GetCamera(Frame / Fps, Projection);
+        Engine.Converge(View, Config, Defines, 16);
+
+        // What this frame hid that the frame's own depth shows.
+        LeafClasses Classes = ClassifyLeaves(Engine, View, Config, Defines, LodKernelTextures{ &Bounds, &HiZ });
+        RasterizeLeaves(Reference, Engine.GetMesh(), Classes.FrustumVisible, HeightMap, Config.DisplacementFactor, View.ViewProjMat);
+        uint32_t FrameLate = 0;
+        for (const PrimitiveData& Leaf : Classes.Occluded) {
+            uint32_t Pixels = 0;
+            ForEachLeafTriangle(Engine.GetMesh(), Leaf, HeightMap, Config.DisplacementFactor, View.ViewProjMat,
+                [&](const float4 inClip[3]) { Pixels += Reference.CountVisiblePixels(inClip, 1e-6f); });
+            FrameLate += Pixels ? 1 : 0;
+            LatePixels += Pixels;
+        }
+        LateLeaves += FrameLate;
+        LateFrames += FrameLate ? 1 : 0;
+        FlyFrustumVisible += Classes.FrustumVisible.size();
+        FlyOccluded += Classes.Occluded.size();
+
+        std::vector<PrimitiveData> Drawn(Engine.GetSubdCulledOut(), Engine.GetSubdCulledOut() + Engine.GetSubdCulledOutCount());
+        RasterizeLeaves(Depth, Engine.GetMesh(), Drawn, HeightMap, Config.DisplacementFactor, View.ViewProjMat);
+        HiZ.Build(Depth.GetDepth(), DepthWidth, DepthHeight, Pool);
+        SetHiZView(Config, View.ViewProjMat, DepthWidth, DepthHeight);
+    }
+    printf("flyover, %u frames: %.1f%% of frustum-visible leaves occluded, %llu leaves late in %u frames (%.3f%% of the pixels)\n", FrameCount,
+        100.0 * FlyOccluded / std::max<uint64_t>(FlyFrustumVisible, 1), (unsigned long long)LateLeaves, LateFrames,
+        100.0 * LatePixels / ((double)FrameCount * DepthWidth * DepthHeight));
+
+    printf("%s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
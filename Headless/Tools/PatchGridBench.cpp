@@ -0,0 +1,68 @@
+// Instance count against vertex count for every patch level of Headless/PatchGrid.h at the
+// same triangle density: converges the tree at the TargetPixelSize GetPatchTargetPixelSize
+// gives each level and reports the leaves drawn, the triangles and vertices they expand to
+// and the per-frame draw argument and SubdCulledOut traffic. Also checks every generated
+// patch triangle against the corners Subd gives its key.
+//
+// PatchGridBench [target pixel size]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "Headless/PatchGrid.h"
+#include "Headless/SubdEngine.h"
+
+using namespace Headless;
+
+// Each triangle of a level inLevel patch must be Subd's leaf (1 << inLevel) | k on the unit triangle.
+static bool CheckPatchGrid(uint32_t inLevel) {
+    const PatchLevelOffset& Offset = PatchGrids.PatchLevelOffsets[inLevel];
+    const float4 UnitTriangle[3] = { float4(0.0f, 0.0f, 0.0f, 1.0f), float4(1.0f, 0.0f, 0.0f, 1.0f), float4(0.0f, 1.0f, 0.0f, 1.0f) };
+    for (uint32_t Triangle = 0; Triangle < (1u << inLevel); ++Triangle) {
+        float4 Corners[3];
+        Subd((1u << inLevel) | Triangle, UnitTriangle, Corners);
+        for (uint32_t i = 0; i < 3; ++i) {
+            uint16_t Index = PatchGrids.Indices[Offset.StartIndexLocation + Triangle * 3 + i];
+            const PatchVertex& Vertex = PatchGrids.Vertices[Offset.BaseVertexLocation + Index];
+            if (Index >= Offset.VertexCount || Vertex.BerpUV[0] != Corners[i].x || Vertex.BerpUV[1] != Corners[i].y) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    float TargetPixelSize = argc > 1 ? (float)atof(argv[1]) : 2.0f;
+
+    bool Ok = true;
+    for (uint32_t Level = PatchGridMinLevel; Level <= PatchGridMaxLevel; ++Level) {
+        Ok = CheckPatchGrid(Level) && Ok;
+    }
+    printf("patch grids %s, %u vertices and %u indices for levels %u-%u\n", Ok ? "match Subd" : "DO NOT MATCH Subd", PatchGridSet::VertexCount,
+        PatchGridSet::IndexCount, PatchGridMinLevel, PatchGridMaxLevel);
+
+    float FovY = 2.0f * std::atan(24.0f / 42.0f);
+    SubdCamera Camera;
+    Camera.PosW = float3(1.0f, 1.0f, 1.0f);
+    Camera.ViewProjMat = CreateViewProjMat(Camera.PosW, float3(0.0f, 0.0f, 0.0f), float3(0.0f, 0.0f, 1.0f), FovY, 1920.0f / 1080.0f, 0.0001f, 95.0f);
+    LodKernelConfig Config;
+    Config.FovX = 1920.0f / 1080.0f * FovY;
+    Config.ScreenResolutionWidth = 1920;
+    Config.DisplacementFactor = 0.3f;
+
+    printf("level  pixel size  instances  triangles    vertices  culled+args bytes\n");
+    for (uint32_t Level = PatchGridMinLevel; Level <= PatchGridMaxLevel; ++Level) {
+        Config.TargetPixelSize = GetPatchTargetPixelSize(TargetPixelSize, Level);
+        SubdEngine Engine(SubdMesh::CreateQuad());
+        Engine.Converge(Camera, Config, LodKernelDefines(), 64);
+        uint64_t Instances = Engine.GetSubdCulledOutCount();
+        const PatchLevelOffset& Offset = PatchGrids.PatchLevelOffsets[Level];
+        uint64_t Triangles = Instances * (Offset.IndexCountPerInstance / 3);
+        uint64_t Vertices = Instances * Offset.VertexCount;
+        uint64_t Traffic = Instances * sizeof(PrimitiveData) + sizeof(IndirectDrawArgs);
+        printf("%5u  %10.3f  %9llu  %9llu  %10llu  %17llu%s\n", Level, Config.TargetPixelSize, (unsigned long long)Instances,
+            (unsigned long long)Triangles, (unsigned long long)Vertices, (unsigned long long)Traffic, Level == DefaultPatchLevel ? "  (default)" : "");
+    }
+    return Ok ? 0 : 1;
+}
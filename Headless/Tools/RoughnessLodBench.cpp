@@ -0,0 +1,294 @@
+// Roughness-aware lod (ROUGHNESS_LOD) against the distance-only metric, on a synthetic
+// heightmap of flat plains, a cliff and a rough mountain. For a set of still cameras the
+// quad is converged once with each metric, and the leaves that pass frustum culling are
+// measured: every triangle of their DefaultPatchLevel patch is compared with the bilinear
+// heightmap it displaces, and the largest height gap is divided by the world size of a
+// pixel at its distance. Reports the triangle count and max screen-space error of both, the
+// share of leaves over the screen error the roughness metric was given, and how many
+// triangles the distance metric needs, one pixel size step at a time, to be as accurate.
+// Both triangle counts are also given for the smooth leaves alone, those whose footprint only
+// holds the curvature of 16-bit rounding. Checks that the pyramid lookup under each leaf
+// covers every texel curvature it reads.
+//
+// RoughnessLodBench [heightmap size] [pixel size] [max screen error] [max lod offset]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Headless/CameraPath.h"
+#include "Headless/PatchGrid.h"
+#include "Headless/SubdEngine.h"
+#include "Headless/SubdTexture.h"
+
+using namespace Headless;
+
+struct RoughnessCamera {
+    const char* Name;
+    float3 PosW;
+    float3 Target;
+};
+
+// Per-leaf error on a barycentric grid of this many steps per patch triangle edge.
+static const int ErrorGridSize = 3;
+// Largest texel curvature of a smooth footprint: what rounding the heights to 16 bits leaves
+// on the plains and the far slopes of the mountain.
+static const uint16_t SmoothCurvature = 2;
+
+static float SmoothStep(float inEdge0, float inEdge1, float inX) {
+    float t = std::min(std::max((inX - inEdge0) / (inEdge1 - inEdge0), 0.0f), 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// Plains at 0.1, a plateau 0.15 higher behind a winding cliff, and a mountain with a rough
+// flank in the far corner. Most of the map is flat.
+static float GetTerrainHeight(float inX, float inY) {
+    float CliffY = 0.62f + 0.04f * std::sin(6.2831853f * 2.0f * inX);
+    float Cliff = 0.15f * SmoothStep(CliffY - 0.004f, CliffY + 0.004f, inY);
+    float Dx = inX - 0.75f;
+    float Dy = inY - 0.25f;
+    float Mountain = std::exp(-(Dx * Dx + Dy * Dy) / 0.015f);
+    float Rough = 0.5f + 0.5f * std::sin(6.2831853f * 19.0f * inX) * std::sin(6.2831853f * 23.0f * inY);
+    return 0.1f + Cliff + Mountain * (0.45f + 0.08f * Rough);
+}
+
+// Largest screen-space error of the leaf's patch triangles, in pixels of inPixelScale *
+// distance world units.
+static float GetLeafScreenError(const SubdMesh& inMesh, const PrimitiveData& inLeaf, const SubdTexture& inHeightMap, float inDisplacementFactor,
+    const float3& inCameraPosW, float inPixelScale) {
+    float4 InVertices[3], OutVertices[3];
+    inMesh.GetPrimitiveVertices(inLeaf.PrimitiveIndex, InVertices);
+    Subd(inLeaf.SubdBinaryKey, InVertices, OutVertices);
+
+    auto GetHeight = [&](const float4& inPosition) {
+        return inHeightMap.SampleLevel(float2(inPosition.x * 0.5f + 0.5f, inPosition.y * 0.5f + 0.5f)).x * inDisplacementFactor;
+    };
+    const PatchLevelOffset& Offset = PatchGrids.PatchLevelOffsets[DefaultPatchLevel];
+    float MaxError = 0.0f;
+    for (uint32_t Triangle = 0; Triangle < Offset.IndexCountPerInstance / 3; ++Triangle) {
+        float4 Corners[3];
+        float CornerHeights[3];
+        for (uint32_t i = 0; i < 3; ++i) {
+            const PatchVertex& Vertex = PatchGrids.Vertices[Offset.BaseVertexLocation + PatchGrids.Indices[Offset.StartIndexLocation + Triangle * 3 + i]];
+            Corners[i] = Berp(OutVertices, float2(Vertex.BerpUV[0], Vertex.BerpUV[1]));
+            CornerHeights[i] = GetHeight(Corners[i]);
+        }
+        for (int j = 0; j <= ErrorGridSize; ++j) {
+            for (int i = 0; i + j <= ErrorGridSize; ++i) {
+                float B1 = (float)i / ErrorGridSize;
+                float B2 = (float)j / ErrorGridSize;
+                float B0 = 1.0f - B1 - B2;
+                float4 Position = Corners[0] * B0 + Corners[1] * B1 + Corners[2] * B2;
+                float Height = GetHeight(Position);
+                float Interpolated = CornerHeights[0] * B0 + CornerHeights[1] * B1 + CornerHeights[2] * B2;
+                Position.z += Height;
+                float Distance = std::max(distance(Position, float4(inCameraPosW, 1.0f)), 1e-4f);
+                MaxError = std::max(MaxError, std::fabs(Height - Interpolated) / (Distance * inPixelScale));
+            }
+        }
+    }
+    return MaxError;
+}
+
+// Largest texel curvature of the heightmap, as RoughnessPyramid level 0 computes it.
+static std::vector<uint16_t> GetTexelCurvatures(const std::vector<uint16_t>& inHeights, uint32_t inSize) {
+    std::vector<uint16_t> Curvatures(inHeights.size());
+    for (uint32_t y = 0; y < inSize; ++y) {
+        for (uint32_t x = 0; x < inSize; ++x) {
+            auto Height = [&](int inDx, int inDy) {
+                uint32_t X = (uint32_t)std::min(std::max((int)x + inDx, 0), (int)inSize - 1);
+                uint32_t Y = (uint32_t)std::min(std::max((int)y + inDy, 0), (int)inSize - 1);
+                return (int)inHeights[(size_t)Y * inSize + X];
+            };
+            int Center = 2 * Height(0, 0);
+            int Curvature = std::max(std::abs(Height(-1, 0) + Height(1, 0) - Center), std::abs(Height(0, -1) + Height(0, 1) - Center));
+            Curvature = std::max(Curvature, std::abs(Height(-1, -1) + Height(1, 1) - Center) / 2);
+            Curvature = std::max(Curvature, std::abs(Height(1, -1) + Height(-1, 1) - Center) / 2);
+            Curvatures[(size_t)y * inSize + x] = (uint16_t)std::min(Curvature, 0xffff);
+        }
+    }
+    return Curvatures;
+}
+
+// Texels bilinear sampling reads inside the leaf's box, and the box in UV.
+static void GetLeafTexels(const SubdMesh& inMesh, const PrimitiveData& inLeaf, uint32_t inSize, float2& outMinUV, float2& outMaxUV, uint32_t outTexel0[2],
+    uint32_t outTexel1[2]) {
+    float4 InVertices[3], OutVertices[3];
+    inMesh.GetPrimitiveVertices(inLeaf.PrimitiveIndex, InVertices);
+    Subd(inLeaf.SubdBinaryKey, InVertices, OutVertices);
+    float4 MinPosition = min(min(OutVertices[0], OutVertices[1]), OutVertices[2]);
+    float4 MaxPosition = max(max(OutVertices[0], OutVertices[1]), OutVertices[2]);
+    outMinUV = float2(MinPosition.x * 0.5f + 0.5f, MinPosition.y * 0.5f + 0.5f);
+    outMaxUV = float2(MaxPosition.x * 0.5f + 0.5f, MaxPosition.y * 0.5f + 0.5f);
+
+    float MaxTexel = (float)(inSize - 1);
+    outTexel0[0] = (uint32_t)std::min(std::max(std::floor(outMinUV.x * inSize - 0.5f), 0.0f), MaxTexel);
+    outTexel0[1] = (uint32_t)std::min(std::max(std::floor(outMinUV.y * inSize - 0.5f), 0.0f), MaxTexel);
+    outTexel1[0] = (uint32_t)std::min(std::max(std::floor(outMaxUV.x * inSize - 0.5f) + 1.0f, 0.0f), MaxTexel);
+    outTexel1[1] = (uint32_t)std::min(std::max(std::floor(outMaxUV.y * inSize - 0.5f) + 1.0f, 0.0f), MaxTexel);
+}
+
+// Largest texel curvature of the leaf's bilinear footprint.
+static uint16_t GetLeafCurvature(const SubdMesh& inMesh, const PrimitiveData& inLeaf, const std::vector<uint16_t>& inCurvatures, uint32_t inSize) {
+    float2 MinUV, MaxUV;
+    uint32_t Texel0[2], Texel1[2];
+    GetLeafTexels(inMesh, inLeaf, inSize, MinUV, MaxUV, Texel0, Texel1);
+    uint16_t Curvature = 0;
+    for (uint32_t y = Texel0[1]; y <= Texel1[1]; ++y) {
+        for (uint32_t x = Texel0[0]; x <= Texel1[0]; ++x) {
+            Curvature = std::max(Curvature, inCurvatures[(size_t)y * inSize + x]);
+        }
+    }
+    return Curvature;
+}
+
+// Whether the pyramid lookup under the leaf covers every texel curvature of its bilinear
+// footprint.
+static bool CheckLeafRoughness(const SubdMesh& inMesh, const PrimitiveData& inLeaf, const RoughnessPyramid& inRoughness, const std::vector<uint16_t>& inCurvatures,
+    uint32_t inSize) {
+    float2 MinUV, MaxUV;
+    uint32_t Texel0[2], Texel1[2];
+    GetLeafTexels(inMesh, inLeaf, inSize, MinUV, MaxUV, Texel0, Texel1);
+    return GetLeafCurvature(inMesh, inLeaf, inCurvatures, inSize) / 65535.0f <= inRoughness.GetRoughness(MinUV, MaxUV);
+}
+
+struct MetricResult {
+    uint32_t Visible = 0;
+    float MaxError = 0.0f;
+    // Visible leaves off by more than the screen error given to SetRoughnessLod.
+    uint32_t OverError = 0;
+    // Visible leaves over a smooth footprint, see SmoothCurvature.
+    uint32_t Smooth = 0;
+    std::vector<PrimitiveData> Leaves;
+};
+
+static MetricResult RunMetric(const SubdCamera& inView, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, const HeightBoundsPyramid& inBounds,
+    const RoughnessPyramid& inRoughness, const SubdTexture& inHeightMap, const std::vector<uint16_t>& inCurvatures, float inMaxScreenError, ThreadPool& inPool) {
+    SubdEngine Engine(SubdMesh::CreateQuad(), SubdBufferSize, &inPool);
+    Engine.SetHeightBounds(&inBounds);
+    Engine.SetRoughness(&inRoughness);
+    for (int Frame = 0; Frame < 16 && !Engine.GetBufferCounter().Converged; ++Frame) {
+        Engine.Converge(inView, inConfig, inDefines, 64);
+    }
+    // One more frame so SubdCulledOut holds the converged leaves.
+    Engine.Update(inView, inConfig, inDefines);
+
+    MetricResult Result;
+    Result.Visible = Engine.GetSubdCulledOutCount();
+    Result.Leaves.assign(Engine.GetSubdCulledOut(), Engine.GetSubdCulledOut() + Result.Visible);
+    float PixelScale = 2.0f * std::tan(inConfig.FovX / 2) / (float)inConfig.ScreenResolutionWidth;
+    std::vector<float> Errors(Result.Visible);
+    inPool.ParallelFor(Result.Visible, 64, [&](size_t inBegin, size_t inEnd) {
+        for (size_t i = inBegin; i < inEnd; ++i) {
+            Errors[i] = GetLeafScreenError(Engine.GetMesh(), Result.Leaves[i], inHeightMap, inConfig.DisplacementFactor, inView.PosW, PixelScale);
+        }
+    });
+    for (float Error : Errors) {
+        Result.MaxError = std::max(Result.MaxError, Error);
+        Result.OverError += Error > inMaxScreenError ? 1 : 0;
+    }
+    for (const PrimitiveData& Leaf : Result.Leaves) {
+        Result.Smooth += GetLeafCurvature(Engine.GetMesh(), Leaf, inCurvatures, inHeightMap.Width) <= SmoothCurvature ? 1 : 0;
+    }
+    return Result;
+}
+
+int main(int argc, char** argv) {
+    uint32_t Size = argc > 1 ? (uint32_t)atoi(argv[1]) : 1024;
+    float PixelSize = argc > 2 ? (float)atof(argv[2]) : 1.0f;
+    float MaxScreenError = argc > 3 ? (float)atof(argv[3]) : 1.0f;
+    float MaxLodOffset = argc > 4 ? (float)atof(argv[4]) : 4.0f;
+
+    std::vector<uint16_t> Heights((size_t)Size * Size);
+    SubdTexture HeightMap;
+    HeightMap.Width = HeightMap.Height = Size;
+    HeightMap.ChannelCount = 1;
+    HeightMap.Texels.resize(Heights.size());
+    for (uint32_t j = 0; j < Size; ++j) {
+        for (uint32_t i = 0; i < Size; ++i) {
+            float z = GetTerrainHeight((float)i / Size, (float)j / Size);
+            Heights[(size_t)j * Size + i] = (uint16_t)(std::min(std::max(z, 0.0f), 1.0f) * 65535.0f);
+            HeightMap.Texels[(size_t)j * Size + i] = Heights[(size_t)j * Size + i] / 65535.0f;
+        }
+    }
+    ThreadPool Pool(0);
+    HeightBoundsPyramid Bounds;
+    Bounds.Build(Heights.data(), Size, Size, Pool);
+    auto Start = std::chrono::high_resolution_clock::now();
+    RoughnessPyramid Roughness;
+    Roughness.Build(Heights.data(), Size, Size, Pool);
+    double BuildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+    printf("heightmap %u x %u, roughness pyramid %u levels in %.1f ms\n", Size, Size, Roughness.GetLevelCount(), BuildMs);
+    std::vector<uint16_t> Curvatures = GetTexelCurvatures(Heights, Size);
+
+    const RoughnessCamera Cameras[] = {
+        { "plains", float3(-0.60f, -0.80f, 0.12f), float3(0.0f, 0.0f, 0.03f) },
+        { "toward cliff", float3(-0.20f, -0.10f, 0.10f), float3(0.0f, 0.5f, 0.05f) },
+        { "mountain", float3(0.10f, -0.90f, 0.20f), float3(0.5f, -0.5f, 0.12f) },
+        { "overview", float3(-0.95f, -0.95f, 0.60f), float3(0.0f, 0.0f, 0.0f) },
+        { "looking down", float3(0.00f, 0.00f, 0.50f), float3(0.1f, 0.1f, 0.0f) },
+    };
+    CameraProjection Projection;
+    LodKernelConfig Config;
+    Config.FovX = Projection.GetFovX();
+    Config.TargetPixelSize = PixelSize;
+    Config.ScreenResolutionWidth = Projection.ScreenResolutionWidth;
+    Config.DisplacementFactor = 0.3f;
+    SetRoughnessLod(Config, MaxScreenError, MaxLodOffset, Size, DefaultPatchLevel);
+    LodKernelDefines DistanceDefines;
+    LodKernelDefines RoughnessDefines;
+    RoughnessDefines.RoughnessLod = true;
+    uint32_t TrianglesPerLeaf = GetPatchIndexCount(DefaultPatchLevel) / 3;
+
+    uint32_t Failures = 0;
+    uint64_t TotalVisible[3] = {};
+    uint64_t TotalSmooth[2] = {};
+    float MaxError[2] = {};
+    printf("screen error %.2f px, lod within %.1f levels of the distance lod, %u triangles per leaf\n", MaxScreenError, MaxLodOffset, TrianglesPerLeaf);
+    printf("%-14s | %32s | %41s | %23s\n", "", "distance only", "roughness aware", "distance, same max px");
+    printf("%-14s | %10s %10s %10s | %10s %10s %9s %9s | %10s %12s\n", "camera", "triangles", "smooth", "max px", "triangles", "smooth", "max px", "over",
+        "triangles", "pixel size");
+    for (const RoughnessCamera& Camera : Cameras) {
+        SubdCamera View;
+        View.PosW = Camera.PosW;
+        View.ViewProjMat = CreateViewProjMat(Camera.PosW, Camera.Target, float3(0.0f, 0.0f, 1.0f), Projection.FovY, Projection.AspectRatio, Projection.NearZ,
+            Projection.FarZ);
+        MetricResult Distance = RunMetric(View, Config, DistanceDefines, Bounds, Roughness, HeightMap, Curvatures, MaxScreenError, Pool);
+        MetricResult Rough = RunMetric(View, Config, RoughnessDefines, Bounds, Roughness, HeightMap, Curvatures, MaxScreenError, Pool);
+        for (const PrimitiveData& Leaf : Rough.Leaves) {
+            if (!CheckLeafRoughness(SubdMesh::CreateQuad(), Leaf, Roughness, Curvatures, Size)) {
+                if (Failures++ < 10) {
+                    printf("  leaf (%u, %08x): the pyramid misses a texel curvature of its footprint\n", Leaf.PrimitiveIndex, Leaf.SubdBinaryKey);
+                }
+            }
+        }
+
+        // The distance lod refined one level at a time until it is as accurate.
+        LodKernelConfig EqualConfig = Config;
+        MetricResult Equal = Distance;
+        for (int Step = 0; Step < 16 && Equal.MaxError > Rough.MaxError; ++Step) {
+            EqualConfig.TargetPixelSize *= 0.70710678f;
+            Equal = RunMetric(View, EqualConfig, DistanceDefines, Bounds, Roughness, HeightMap, Curvatures, MaxScreenError, Pool);
+        }
+
+        printf("%-14s | %10u %10u %10.3f | %10u %10u %9.3f %8.1f%% | %10u %12.3f\n", Camera.Name, Distance.Visible * TrianglesPerLeaf,
+            Distance.Smooth * TrianglesPerLeaf, Distance.MaxError, Rough.Visible * TrianglesPerLeaf, Rough.Smooth * TrianglesPerLeaf, Rough.MaxError,
+            100.0f * Rough.OverError / std::max(Rough.Visible, 1u), Equal.Visible * TrianglesPerLeaf, EqualConfig.TargetPixelSize);
+        TotalVisible[0] += Distance.Visible;
+        TotalVisible[1] += Rough.Visible;
+        TotalVisible[2] += Equal.Visible;
+        TotalSmooth[0] += Distance.Smooth;
+        TotalSmooth[1] += Rough.Smooth;
+        MaxError[0] = std::max(MaxError[0], Distance.MaxError);
+        MaxError[1] = std::max(MaxError[1], Rough.MaxError);
+    }
+
+    printf("visible triangles: %llu distance only (max %.3f px), %llu roughness aware (max %.3f px), %llu distance only at the same max error\n",
+        (unsigned long long)TotalVisible[0] * TrianglesPerLeaf, MaxError[0], (unsigned long long)TotalVisible[1] * TrianglesPerLeaf, MaxError[1],
+        (unsigned long long)TotalVisible[2] * TrianglesPerLeaf);
+    printf("smooth triangles: %llu distance only, %llu roughness aware\n", (unsigned long long)TotalSmooth[0] * TrianglesPerLeaf,
+        (unsigned long long)TotalSmooth[1] * TrianglesPerLeaf);
+    printf("%s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+// The shader permutation table of the sample (Headless/ShaderPermutation.h): versions per
+// program, what the warm-up queues after a toggle, and the per-frame CPU cost of the former
+// addDefine / removeDefine calls (replayed on a std::map define list like Falcor's) against
+// comparing permutation keys. Checks that every key maps to its own define list and back,
+// and that the usage cache round-trips.
+//
+// ShaderPermutationBench [frames]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
+#include "Headless/ShaderPermutation.h"
+
+using namespace Headless;
+
+using DefineMap = std::map<std::string, std::string>;
+
+// Falcor's Program::addDefine / removeDefine: a map lookup per call, dirty on change.
+static bool AddDefine(DefineMap& ioDefines, const std::string& inName, const std::string& inValue = "") {
+    auto It = ioDefines.find(inName);
+    if (It != ioDefines.end() && It->second == inValue) {
+        return false;
+    }
+    ioDefines[inName] = inValue;
+    return true;
+}
+
+static bool RemoveDefine(DefineMap& ioDefines, const std::string& inName) {
+    return ioDefines.erase(inName) != 0;
+}
+
+static uint32_t ParseToggles(const ShaderDefineList& inDefines) {
+    uint32_t Toggles = 0;
+    for (const auto& Define : inDefines) {
+        for (uint32_t Bit = 0; Bit < ShaderToggleCount; ++Bit) {
+            if (Define.first == GetShaderToggleDefine(1u << Bit)) {
+                Toggles |= 1u << Bit;
+            }
+        }
+    }
+    return Toggles;
+}
+
+int main(int argc, char** argv) {
+    uint32_t FrameCount = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+    const uint32_t PrimitiveBits = 1;
+
+    // Same sets as AdaptiveSubdivision::LoadShaderPermutations.
+    const ShaderPermutationSet Sets[] = {
+        ShaderPermutationSet("LodKernel", ShaderToggleFreezeSubdivision | ShaderToggleFrustumCulling | ShaderToggleDisplace | ShaderToggleKeyTransformTable
+            | ShaderToggleDeterministicCompaction | ShaderToggleCbtStorage | ShaderToggleOcclusionCulling
+            | ShaderToggleRoughnessLod | ShaderToggleIncrementalLod | ShaderToggleMultiView, true),
+        ShaderPermutationSet("LodDirtyKernel", ShaderToggleFrustumCulling | ShaderToggleDisplace | ShaderToggleKeyTransformTable | ShaderToggleOcclusionCulling
+            | ShaderToggleRoughnessLod | ShaderToggleMultiView, false),
+        ShaderPermutationSet("RenderKernel", ShaderToggleDisplace | ShaderToggleKeyTransformTable | ShaderToggleLeafVertexPrepass | ShaderTogglePhongTessellation
+            | ShaderToggleMeshShading | ShaderToggleShadingMask | ShaderToggleSlopeFromHeightMap, false),
+        ShaderPermutationSet("LeafVertexKernel", ShaderToggleKeyTransformTable | ShaderTogglePhongTessellation | ShaderToggleSlopeFromHeightMap, false),
+        ShaderPermutationSet("LeafSortKeyKernel", ShaderToggleKeyTransformTable, false),
+        ShaderPermutationSet("IndirectBatcherKernel", ShaderToggleCbtStorage, false),
+        ShaderPermutationSet("ConvergenceResetKernel", ShaderToggleCbtStorage, false),
+        ShaderPermutationSet("CbtSumReductionKernel", 0, true),
+    };
+
+    uint32_t Failures = 0;
+    size_t TotalKeys = 0;
+    ShaderPermutationCache Cache;
+    printf("program                  versions  neighbours\n");
+    for (const ShaderPermutationSet& Set : Sets) {
+        std::vector<uint32_t> Keys = Set.EnumerateKeys(PrimitiveBits);
+        std::set<std::string> DefineStrings;
+        for (uint32_t Key : Keys) {
+            ShaderDefineList Defines = Set.GetDefines(Key);
+            std::string Joined;
+            for (const auto& Define : Defines) {
+                Joined += Define.first + "=" + Define.second + ";";
+            }
+            if (!DefineStrings.insert(Joined).second || Set.GetKey(ParseToggles(Defines), PrimitiveBits) != Key) {
+                printf("  %s: key %08x does not round-trip\n", Set.GetProgramName().c_str(), Key);
+                ++Failures;
+            }
+            Cache.Add(Set.GetProgramName(), Key);
+        }
+        uint32_t DefaultKey = Set.GetKey(ShaderToggleFrustumCulling | ShaderToggleDisplace | ShaderToggleLeafVertexPrepass | ShaderTogglePhongTessellation
+            | ShaderToggleShadingDiffuse, PrimitiveBits);
+        printf("%-24s %8zu  %10zu\n", Set.GetProgramName().c_str(), Keys.size(), Set.GetNeighbourKeys(DefaultKey).size());
+        TotalKeys += Keys.size();
+    }
+
+    const char* CachePath = "ShaderPermutationBench.txt";
+    ShaderPermutationCache Loaded;
+    if (!Cache.Save(CachePath) || !Loaded.Load(CachePath) || Loaded.GetKeyCount() != TotalKeys) {
+        printf("usage cache does not round-trip\n");
+        ++Failures;
+    }
+    std::remove(CachePath);
+
+    // The former defines block: every define of every program re-applied each frame, with
+    // one toggle flipped every 600 frames.
+    uint32_t Toggles = ShaderToggleFrustumCulling | ShaderToggleDisplace | ShaderToggleLeafVertexPrepass | ShaderTogglePhongTessellation | ShaderToggleShadingDiffuse;
+    std::vector<DefineMap> DefineMaps(sizeof(Sets) / sizeof(Sets[0]));
+    std::vector<std::vector<std::pair<std::string, uint32_t>>> ToggleDefines(DefineMaps.size());
+    for (size_t i = 0; i < DefineMaps.size(); ++i) {
+        for (uint32_t Bit = 0; Bit < ShaderToggleCount; ++Bit) {
+            if (Sets[i].GetToggleMask() & (1u << Bit)) {
+                ToggleDefines[i].emplace_back(GetShaderToggleDefine(1u << Bit), 1u << Bit);
+            }
+        }
+    }
+    uint32_t Dirty = 0;
+    auto Start = std::chrono::high_resolution_clock::now();
+    for (uint32_t Frame = 0; Frame < FrameCount; ++Frame) {
+        uint32_t FrameToggles = Frame / 600 % 2 ? Toggles ^ ShaderToggleKeyTransformTable : Toggles;
+        for (size_t i = 0; i < DefineMaps.size(); ++i) {
+            for (const auto& Define : ToggleDefines[i]) {
+                Dirty += (FrameToggles & Define.second) ? AddDefine(DefineMaps[i], Define.first) : RemoveDefine(DefineMaps[i], Define.first);
+            }
+            if (Sets[i].GetKey(0, PrimitiveBits)) {
+                Dirty += AddDefine(DefineMaps[i], "CBT_PRIMITIVE_BITS", std::to_string(PrimitiveBits));
+            }
+        }
+    }
+    double DefineNs = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - Start).count() / FrameCount;
+
+    std::vector<uint32_t> ActiveKeys(DefineMaps.size(), ~0u);
+    uint32_t Switches = 0;
+    Start = std::chrono::high_resolution_clock::now();
+    for (uint32_t Frame = 0; Frame < FrameCount; ++Frame) {
+        uint32_t FrameToggles = Frame / 600 % 2 ? Toggles ^ ShaderToggleKeyTransformTable : Toggles;
+        for (size_t i = 0; i < ActiveKeys.size(); ++i) {
+            uint32_t Key = Sets[i].GetKey(FrameToggles, PrimitiveBits);
+            if (Key != ActiveKeys[i]) {
+                ActiveKeys[i] = Key;
+                ++Switches;
+            }
+        }
+    }
+    double KeyNs = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - Start).count() / FrameCount;
+
+    printf("%zu versions in total\n", TotalKeys);
+    printf("per frame: define lists %.0f ns (%u changes), permutation keys %.1f ns (%u switches)\n", DefineNs, Dirty, KeyNs, Switches);
+    printf("%s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
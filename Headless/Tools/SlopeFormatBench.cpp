@@ -0,0 +1,149 @@
+// Slope map formats ("Slope Map Format", Headless/SubdSlopeFormat.h). Encodes the slope map
+// of a synthetic heightmap in every format and reports its size, the saving against
+// RG32Float and the encode time. The normal error is the angle between the slope-map normal
+// of RenderKernelPS read from the format and from the RG32Float reference, at random points
+// with bilinear filtering, at the given displacement factor. Also checks each texel against
+// the bound of its format, and the half conversion on every half.
+//
+// SlopeFormatBench [heightmap size] [samples] [displacement factor]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "Headless/SubdLeafVertex.h"
+#include "Headless/SubdSlopeFormat.h"
+
+using namespace Headless;
+
+static float GetTerrainHeight(float inX, float inY) {
+    float Ridge = std::max(0.0f, std::sin(6.2831853f * 1.5f * inX) * std::cos(6.2831853f * inY));
+    float Band = std::exp(-(inY - 0.5f) * (inY - 0.5f) / 0.01f);
+    return 0.1f + 0.35f * Ridge * Ridge + 0.03f * Band * std::sin(6.2831853f * 23.0f * (inX + inY));
+}
+
+// Largest difference of a decoded texel from the reference over what its format allows.
+static float GetTexelBoundRatio(const SubdTexture& inReference, const SubdTexture& inDecoded, const EncodedSlopeMap& inSlopeMap) {
+    float Ratio = 0.0f;
+    for (size_t i = 0; i < inReference.Texels.size(); ++i) {
+        float Reference = inReference.Texels[i];
+        float Bound = 0.0f;
+        switch (inSlopeMap.Format) {
+        case SlopeFormat::RG16Float: Bound = std::max(std::fabs(Reference) * 0.00048828125f, 2.98e-8f); break;
+        case SlopeFormat::RG16Snorm: Bound = inSlopeMap.Scale * 0.5f / 32767.0f; break;
+        // The largest step between palette values, over the whole scale.
+        case SlopeFormat::BC5Snorm: Bound = inSlopeMap.Scale * 2.0f / 7.0f; break;
+        default: break;
+        }
+        // With room for the float rounding of the decode.
+        float Error = std::fabs(inDecoded.Texels[i] - Reference);
+        Ratio = std::max(Ratio, Bound > 0.0f ? Error / (Bound + (std::fabs(Reference) + inSlopeMap.Scale) * 1e-6f) : (Error > 0.0f ? 2.0f : 0.0f));
+    }
+    return Ratio;
+}
+
+int main(int argc, char** argv) {
+    uint32_t Size = argc > 1 ? (uint32_t)atoi(argv[1]) : 2048;
+    uint32_t SampleCount = argc > 2 ? (uint32_t)atoi(argv[2]) : 1u << 20;
+    float DisplacementFactor = argc > 3 ? (float)atof(argv[3]) : 0.3f;
+
+    std::vector<uint16_t> Heights((size_t)Size * Size);
+    for (uint32_t j = 0; j < Size; ++j) {
+        for (uint32_t i = 0; i < Size; ++i) {
+            float z = GetTerrainHeight((float)i / Size, (float)j / Size);
+            Heights[(size_t)j * Size + i] = (uint16_t)(std::min(std::max(z, 0.0f), 1.0f) * 65535.0f);
+        }
+    }
+    ThreadPool Pool(0);
+    SubdTexture HeightMap = CreateHeightMap(Heights.data(), Size, Size);
+    SubdTexture Reference = CreateSlopeMap(Heights.data(), Size, Size);
+    RenderKernelContext ReferenceContext;
+    ReferenceContext.SlopeMap = &Reference;
+    ReferenceContext.DisplacementFactor = DisplacementFactor;
+
+    std::mt19937 Random(5);
+    std::uniform_real_distribution<float> Unit(-1.0f, 1.0f);
+    std::vector<float3> Positions(SampleCount);
+    for (float3& Position : Positions) {
+        Position = float3(Unit(Random), Unit(Random), 0.0f);
+    }
+    // Two texels in from the border, where SLOPE_FROM_HEIGHTMAP clamps differently.
+    float Interior = 1.0f - 4.0f / Size;
+
+    uint32_t Failures = 0;
+    double HeightMapMB = Size * (double)Size * 2.0 / (1 << 20);
+    printf("heightmap %u x %u (R16, %.1f MB), %u samples, displacement factor %.2f\n", Size, Size, HeightMapMB, SampleCount, DisplacementFactor);
+    printf("%-10s %8s %7s %10s %10s %10s %9s\n", "format", "MB", "saved", "encode ms", "max deg", "mean deg", "max bound");
+    double ReferenceMB = Size * (double)Size * GetSlopeFormatTexelBytes(SlopeFormat::RG32Float) / (1 << 20);
+    for (uint32_t FormatIndex = 0; FormatIndex < SlopeFormatCount; ++FormatIndex) {
+        SlopeFormat Format = (SlopeFormat)FormatIndex;
+        auto Start = std::chrono::high_resolution_clock::now();
+        EncodedSlopeMap SlopeMap = EncodeSlopeMap(Reference.Texels.data(), Size, Size, Format, Pool);
+        double EncodeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+        SubdTexture Decoded = DecodeSlopeMap(SlopeMap);
+        double MB = SlopeMap.Data.size() / (double)(1 << 20);
+        if (MB != Size * (double)Size * GetSlopeFormatTexelBytes(Format) / (1 << 20)) {
+            printf("  %s: %zu bytes encoded\n", GetSlopeFormatName(Format), SlopeMap.Data.size());
+            ++Failures;
+        }
+        float BoundRatio = Format == SlopeFormat::HeightMap ? 0.0f : GetTexelBoundRatio(Reference, Decoded, SlopeMap);
+        if (BoundRatio > 1.0f) {
+            printf("  %s: a texel is %.2f times its bound off\n", GetSlopeFormatName(Format), BoundRatio);
+            ++Failures;
+        }
+
+        RenderKernelContext Context = ReferenceContext;
+        Context.SlopeMap = Format == SlopeFormat::HeightMap ? nullptr : &Decoded;
+        Context.SlopeHeightMap = Format == SlopeFormat::HeightMap ? &HeightMap : nullptr;
+        std::vector<double> MaxDegrees(Pool.GetThreadCount() * 64, 0.0);
+        std::vector<double> SumDegrees(MaxDegrees.size(), 0.0);
+        std::vector<double> MaxInteriorDegrees(MaxDegrees.size(), 0.0);
+        size_t Grain = (SampleCount + MaxDegrees.size() - 1) / MaxDegrees.size();
+        Pool.ParallelFor(SampleCount, Grain, [&](size_t inBegin, size_t inEnd) {
+            size_t Slot = inBegin / Grain;
+            for (size_t i = inBegin; i < inEnd; ++i) {
+                float3 Expected = GetSlopeNormal(ReferenceContext, Positions[i]);
+                float3 Normal = GetSlopeNormal(Context, Positions[i]);
+                float3 Cross = cross(Expected, Normal);
+                double Degrees = std::atan2(length(Cross), dot(Expected, Normal)) * 57.29577951308232;
+                MaxDegrees[Slot] = std::max(MaxDegrees[Slot], Degrees);
+                SumDegrees[Slot] += Degrees;
+                if (std::fabs(Positions[i].x) < Interior && std::fabs(Positions[i].y) < Interior) {
+                    MaxInteriorDegrees[Slot] = std::max(MaxInteriorDegrees[Slot], Degrees);
+                }
+            }
+        });
+        double MaxDegree = *std::max_element(MaxDegrees.begin(), MaxDegrees.end());
+        double MeanDegree = 0.0;
+        for (double Sum : SumDegrees) {
+            MeanDegree += Sum / SampleCount;
+        }
+        // Away from the border the differences of the filtered heights are the filtered
+        // differences: only float rounding remains.
+        double MaxInteriorDegree = *std::max_element(MaxInteriorDegrees.begin(), MaxInteriorDegrees.end());
+        if (Format == SlopeFormat::HeightMap && MaxInteriorDegree > 0.01) {
+            printf("  %s: %.4f degrees off inside the border\n", GetSlopeFormatName(Format), MaxInteriorDegree);
+            ++Failures;
+        }
+        printf("%-10s %8.2f %6.1f%% %10.2f %10.4f %10.5f %9.3f\n", GetSlopeFormatName(Format), MB, 100.0 * (1.0 - MB / ReferenceMB), EncodeMs,
+            MaxDegree, MeanDegree, BoundRatio);
+    }
+
+    // Every finite half survives the round trip through float.
+    for (uint32_t Half = 0; Half < 0x10000u; ++Half) {
+        if ((Half & 0x7c00u) == 0x7c00u) {
+            continue;
+        }
+        if (FloatToHalf(HalfToFloat((uint16_t)Half)) != Half) {
+            printf("  half %04x does not round-trip\n", Half);
+            ++Failures;
+            break;
+        }
+    }
+
+    printf("%s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+// Round trip and load time of SubdSnapshot files on million-key sets: a uniform
+// partition at depth 19, a converged SubdIn from the engine and random keys (the worst
+// case for the slot-gap encoding). Reports size against raw PrimitiveData, encode /
+// save / mapped load times and whether the loaded key set matches.
+//
+// SnapshotBench [snapshot path] [repeats]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "Headless/SubdCbtEngine.h"
+#include "Headless/SubdSnapshot.h"
+
+using namespace Headless;
+
+static std::vector<uint64_t> SortedKeys(const std::vector<PrimitiveData>& inKeys) {
+    std::vector<uint64_t> Keys(inKeys.size());
+    for (size_t i = 0; i < inKeys.size(); ++i) {
+        Keys[i] = ((uint64_t)inKeys[i].PrimitiveIndex << 32) | inKeys[i].SubdBinaryKey;
+    }
+    std::sort(Keys.begin(), Keys.end());
+    return Keys;
+}
+
+static double MsSince(std::chrono::high_resolution_clock::time_point inStart) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - inStart).count();
+}
+
+int main(int argc, char** argv) {
+    std::string Path = argc > 1 ? argv[1] : "SubdSnapshot.bin";
+    int Repeats = argc > 2 ? atoi(argv[2]) : 5;
+
+    std::vector<std::pair<const char*, std::vector<PrimitiveData>>> Cases;
+
+    std::vector<PrimitiveData> Uniform;
+    for (uint32_t PrimitiveIndex = 0; PrimitiveIndex < 2; ++PrimitiveIndex) {
+        for (uint32_t Key = 1u << 19; Key < 1u << 20; ++Key) {
+            Uniform.push_back({ PrimitiveIndex, Key });
+        }
+    }
+    std::shuffle(Uniform.begin(), Uniform.end(), std::mt19937(1));
+    Cases.push_back({ "uniform depth 19", Uniform });
+
+    {
+        float FovY = 2.0f * std::atan(24.0f / 42.0f);
+        SubdCamera Camera;
+        Camera.PosW = float3(-0.9f, -0.9f, 0.05f);
+        Camera.ViewProjMat = CreateViewProjMat(Camera.PosW, float3(0.5f, 0.5f, 0.0f), float3(0.0f, 0.0f, 1.0f), FovY, 1920.0f / 1080.0f, 0.0001f, 95.0f);
+        LodKernelConfig Config;
+        Config.FovX = FovY * 1920.0f / 1080.0f;
+        Config.TargetPixelSize = 0.002f;
+        Config.ScreenResolutionWidth = 1920;
+        Config.DisplacementFactor = 0.3f;
+        SubdCbtEngine Engine(SubdMesh::CreateQuad());
+        Engine.Converge(Camera, Config, LodKernelDefines(), 64);
+        Cases.push_back({ "converged subd", Engine.GetLeaves() });
+    }
+
+    std::vector<PrimitiveData> Random(1 << 20);
+    std::mt19937 Generator(7);
+    for (PrimitiveData& Data : Random) {
+        uint32_t Depth = 1 + (uint32_t)Generator() % 30;
+        Data = { (uint32_t)Generator() % 2, (1u << Depth) | ((uint32_t)Generator() & ((1u << Depth) - 1u)) };
+    }
+    Cases.push_back({ "random keys", Random });
+
+    printf("case              | keys      raw MB  file MB  bytes/key | encode ms  save ms  load ms | round trip\n");
+    for (auto& Case : Cases) {
+        const std::vector<PrimitiveData>& Keys = Case.second;
+        double EncodeMs = 0.0, SaveMs = 0.0, LoadMs = 0.0;
+        size_t FileSize = 0;
+        std::vector<PrimitiveData> Loaded;
+        bool Ok = true;
+        for (int Repeat = 0; Repeat < Repeats; ++Repeat) {
+            auto Start = std::chrono::high_resolution_clock::now();
+            FileSize = EncodeSubdSnapshot(Keys.data(), Keys.size()).size();
+            EncodeMs += MsSince(Start);
+
+            Start = std::chrono::high_resolution_clock::now();
+            Ok &= SaveSubdSnapshot(Path, Keys.data(), Keys.size());
+            SaveMs += MsSince(Start);
+
+            Start = std::chrono::high_resolution_clock::now();
+            Ok &= LoadSubdSnapshot(Path, Loaded);
+            LoadMs += MsSince(Start);
+        }
+        Ok &= SortedKeys(Keys) == SortedKeys(Loaded);
+        printf("%-17s | %-8zu  %6.2f  %7.2f  %9.2f | %9.2f  %7.2f  %7.2f | %s\n", Case.first, Keys.size(), Keys.size() * sizeof(PrimitiveData) / 1048576.0,
+            FileSize / 1048576.0, (double)FileSize / std::max<size_t>(Keys.size(), 1), EncodeMs / Repeats, SaveMs / Repeats, LoadMs / Repeats, Ok ? "ok" : "FAILED");
+    }
+    remove(Path.c_str());
+    return 0;
+}
@@ -0,0 +1,81 @@
+// Throughput of EvaluateSubdBatch on the scalar, SSE and AVX2 paths, single
+// threaded and on the whole pool, and a bitwise comparison against the scalar path.
+//
+// SubdBatchBench [key count] [min depth] [max depth]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include "Headless/SubdBatch.h"
+
+using namespace Headless;
+
+static size_t CountMismatches(const SubdBatchOutput& a, const SubdBatchOutput& b) {
+    size_t Mismatches = 0;
+    size_t Count = a.Op.size();
+    for (size_t i = 0; i < Count; ++i) {
+        bool Same = a.Op[i] == b.Op[i] && a.TargetLod[i] == b.TargetLod[i] && a.ParentLod[i] == b.ParentLod[i];
+        for (int v = 0; v < 3 && Same; ++v) {
+            Same = memcmp(&a.VertexX[v][i], &b.VertexX[v][i], 4) == 0 && memcmp(&a.VertexY[v][i], &b.VertexY[v][i], 4) == 0 &&
+                memcmp(&a.VertexZ[v][i], &b.VertexZ[v][i], 4) == 0 && memcmp(&a.ParentVertexX[v][i], &b.ParentVertexX[v][i], 4) == 0 &&
+                memcmp(&a.ParentVertexY[v][i], &b.ParentVertexY[v][i], 4) == 0 && memcmp(&a.ParentVertexZ[v][i], &b.ParentVertexZ[v][i], 4) == 0;
+        }
+        Mismatches += Same ? 0 : 1;
+    }
+    return Mismatches;
+}
+
+int main(int argc, char** argv) {
+    size_t KeyCount = argc > 1 ? (size_t)atoll(argv[1]) : 1 << 22;
+    int MinDepth = argc > 2 ? atoi(argv[2]) : 8;
+    int MaxDepth = argc > 3 ? atoi(argv[3]) : 28;
+
+    SubdMesh Mesh = SubdMesh::CreateQuad();
+    SubdKeyStream Keys;
+    Keys.Resize(KeyCount);
+    std::mt19937 Rng(7);
+    for (size_t i = 0; i < KeyCount; ++i) {
+        int Depth = MinDepth + (int)(Rng() % (uint32_t)(MaxDepth - MinDepth + 1));
+        Keys.PrimitiveIndex[i] = Rng() & 1u;
+        Keys.SubdBinaryKey[i] = (1u << Depth) | (Rng() & ((1u << Depth) - 1u));
+    }
+
+    float3 CameraPosW(0.1f, -0.2f, 0.05f);
+    LodKernelConfig Config;
+    Config.FovX = 1.0f;
+    Config.TargetPixelSize = 5.0f;
+    Config.ScreenResolutionWidth = 1920;
+    Config.DisplacementFactor = 0.3f;
+    LodKernelDefines Defines;
+
+    ThreadPool SingleThread(1);
+    ThreadPool& AllThreads = ThreadPool::GetDefault();
+    printf("keys %zu, depth %d-%d, best isa %s, %u threads\n", KeyCount, MinDepth, MaxDepth, GetSubdBatchIsaName(GetSubdBatchIsa()), AllThreads.GetThreadCount());
+
+    SubdBatchOutput Reference;
+    EvaluateSubdBatch(Mesh, Keys, CameraPosW, Config, Defines, Reference, SubdBatchIsa::Scalar, &AllThreads);
+
+    SubdBatchIsa IsaList[] = { SubdBatchIsa::Scalar, SubdBatchIsa::Sse, SubdBatchIsa::Avx2 };
+    double ScalarMKeys = 0.0;
+    for (SubdBatchIsa Isa : IsaList) {
+        if (Isa == SubdBatchIsa::Avx2 && GetSubdBatchIsa() != SubdBatchIsa::Avx2) {
+            continue;
+        }
+        for (ThreadPool* Pool : { &SingleThread, &AllThreads }) {
+            SubdBatchOutput Result;
+            Result.Resize(KeyCount);
+            auto Start = std::chrono::high_resolution_clock::now();
+            EvaluateSubdBatch(Mesh, Keys, CameraPosW, Config, Defines, Result, Isa, Pool);
+            double Seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count();
+            double MKeys = KeyCount / Seconds / 1e6;
+            if (Isa == SubdBatchIsa::Scalar && Pool == &SingleThread) {
+                ScalarMKeys = MKeys;
+            }
+            printf("%-6s %2u thread(s)  %8.2f Mkeys/s  %5.2fx  mismatches %zu\n", GetSubdBatchIsaName(Isa), Pool->GetThreadCount(), MKeys,
+                MKeys / ScalarMKeys, CountMismatches(Reference, Result));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+// Simulates the budget governor (Headless/SubdBudget.h) over a camera path: SubdEngine runs
+// one LodKernel pass per frame, the stats reach the governor through the same readback ring
+// as in the sample (three frames late), and the frame time is modelled from the leaf count.
+// Reports how far and how often the leaves run past the budget, and how often the pixel
+// size turns around, for a fixed pixel size, the leaf budget with and without hysteresis,
+// and the frame time budget.
+//
+// SubdBudgetSim [leaf budget] [frame time budget ms] [base pixel size] [camera path file]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Headless/CameraPath.h"
+#include "Headless/SubdBudget.h"
+#include "Headless/SubdEngine.h"
+
+using namespace Headless;
+
+// Stand-in for the GPU: a fixed cost plus a cost per leaf.
+static float ModelFrameTimeMs(const SubdStats& inStats) {
+    return 1.0f + inStats.LeafCount / 4096.0f;
+}
+
+struct BudgetRun {
+    uint32_t MaxLeaves = 0;
+    float MaxFrameMs = 0.0f;
+    uint32_t FramesOverLeaves = 0;
+    uint32_t FramesOverTime = 0;
+    uint32_t Reversals = 0;
+    uint64_t Changes = 0;
+    float MinPixelSize = 1e9f;
+    float MaxPixelSize = 0.0f;
+};
+
+static BudgetRun RunPath(const CameraPath& inPath, float inBasePixelSize, const SubdBudgetConfig* inBudget, ThreadPool& inThreadPool) {
+    CameraProjection Projection;
+    LodKernelConfig Config;
+    Config.FovX = Projection.GetFovX();
+    Config.ScreenResolutionWidth = Projection.ScreenResolutionWidth;
+    Config.DisplacementFactor = 0.3f;
+    LodKernelDefines Defines;
+
+    const float FrameTime = 1.0f / 60.0f;
+    uint32_t FrameCount = (uint32_t)(inPath.GetDuration() / FrameTime) + 1;
+    SubdEngine Engine(SubdMesh::CreateQuad(), SubdBufferSize, &inThreadPool);
+    SubdBudgetGovernor Governor(inBudget ? *inBudget : SubdBudgetConfig());
+    ReadbackRing Ring(4);
+    std::vector<SubdReadback> Slots(Ring.GetSlotCount());
+    std::vector<float> FrameMs(FrameCount);
+
+    BudgetRun Run;
+    SubdStats LateStats;
+    float LastFrameMs = 0.0f;
+    float LastStep = 0.0f;
+    float PixelSize = inBasePixelSize;
+    for (uint32_t Frame = 0; Frame < FrameCount; ++Frame) {
+        if (inBudget) {
+            float Previous = PixelSize;
+            PixelSize = Governor.Update(Frame, inBasePixelSize, LateStats, LastFrameMs);
+            float Step = PixelSize - Previous;
+            if (Step != 0.0f) {
+                Run.Reversals += LastStep != 0.0f && (Step > 0.0f) != (LastStep > 0.0f) ? 1 : 0;
+                LastStep = Step;
+            }
+        }
+        Config.TargetPixelSize = PixelSize;
+        Engine.Update(inPath.GetCamera(Frame * FrameTime), Config, Defines);
+
+        SubdStats Stats = GetSubdStats(Engine.GetReadback(), Engine.GetSubdBufferSize(), Frame);
+        FrameMs[Frame] = ModelFrameTimeMs(Stats);
+        LastFrameMs = FrameMs[Frame];
+        Slots[Ring.GetWriteSlot(Frame)] = Engine.GetReadback();
+        uint32_t ReadSlot = 0;
+        if (Ring.GetReadSlot(Frame, ReadSlot)) {
+            LateStats = GetSubdStats(Slots[ReadSlot], Engine.GetSubdBufferSize(), Frame - Ring.GetLatency());
+            // The frame time is known as late as the counters.
+            LastFrameMs = FrameMs[Frame - Ring.GetLatency()];
+        }
+
+        Run.MaxLeaves = std::max(Run.MaxLeaves, Stats.LeafCount);
+        Run.MaxFrameMs = std::max(Run.MaxFrameMs, FrameMs[Frame]);
+        if (inBudget) {
+            Run.FramesOverLeaves += inBudget->LeafBudget > 0 && Stats.LeafCount > inBudget->LeafBudget ? 1 : 0;
+            Run.FramesOverTime += inBudget->FrameTimeBudgetMs > 0.0f && FrameMs[Frame] > inBudget->FrameTimeBudgetMs ? 1 : 0;
+        }
+        Run.Changes += Stats.SplitCount + Stats.MergeCount;
+        Run.MinPixelSize = std::min(Run.MinPixelSize, PixelSize);
+        Run.MaxPixelSize = std::max(Run.MaxPixelSize, PixelSize);
+    }
+    return Run;
+}
+
+static void PrintRun(const char* inName, const BudgetRun& inRun, uint32_t inFrameCount) {
+    printf("%-28s %9u %9.2f %8.1f%% %8.1f%% %9u %10llu  %.2f - %.2f\n", inName, inRun.MaxLeaves, inRun.MaxFrameMs, 100.0f * inRun.FramesOverLeaves / inFrameCount,
+        100.0f * inRun.FramesOverTime / inFrameCount, inRun.Reversals, (unsigned long long)inRun.Changes, inRun.MinPixelSize, inRun.MaxPixelSize);
+}
+
+int main(int argc, char** argv) {
+    uint32_t LeafBudget = argc > 1 ? (uint32_t)atoi(argv[1]) : 8000;
+    float FrameTimeBudgetMs = argc > 2 ? (float)atof(argv[2]) : 2.5f;
+    float BasePixelSize = argc > 3 ? (float)atof(argv[3]) : 0.1f;
+    const char* PathFile = argc > 4 ? argv[4] : nullptr;
+
+    CameraPath Path = CameraPath::CreateFlyover();
+    if (PathFile && *PathFile && !Path.Load(PathFile)) {
+        printf("could not read %s\n", PathFile);
+        return 1;
+    }
+    ThreadPool Pool(0);
+    uint32_t FrameCount = (uint32_t)(Path.GetDuration() * 60.0f) + 1;
+
+    printf("%u frames, base pixel size %.2f, leaf budget %u, frame time budget %.2f ms (modelled: 1 ms + 1 ms per 4096 leaves)\n", FrameCount,
+        BasePixelSize, LeafBudget, FrameTimeBudgetMs);
+    printf("%-28s %9s %9s %9s %9s %9s %10s  %s\n", "", "max leaf", "max ms", "> leaves", "> time", "reversals", "splits+mrg", "pixel size");
+
+    PrintRun("fixed pixel size", RunPath(Path, BasePixelSize, nullptr, Pool), FrameCount);
+
+    SubdBudgetConfig Leaves;
+    Leaves.LeafBudget = LeafBudget;
+    BudgetRun LeafRun = RunPath(Path, BasePixelSize, &Leaves, Pool);
+    PrintRun("leaf budget", LeafRun, FrameCount);
+
+    SubdBudgetConfig NoHysteresis = Leaves;
+    NoHysteresis.Hysteresis = 0.0f;
+    NoHysteresis.MaxDecreasePerFrame = NoHysteresis.MaxIncreasePerFrame;
+    PrintRun("leaf budget, no hysteresis", RunPath(Path, BasePixelSize, &NoHysteresis, Pool), FrameCount);
+
+    SubdBudgetConfig Time;
+    Time.LeafBudget = 0;
+    Time.FrameTimeBudgetMs = FrameTimeBudgetMs;
+    BudgetRun TimeRun = RunPath(Path, BasePixelSize, &Time, Pool);
+    PrintRun("frame time budget", TimeRun, FrameCount);
+
+    // Held: the overshoot while a correction is in flight stays within the slack the
+    // readback latency and one split level per frame allow.
+    bool Held = LeafRun.MaxLeaves <= LeafBudget * 1.25f && TimeRun.MaxFrameMs <= FrameTimeBudgetMs * 1.25f;
+    printf("%s\n", Held ? "budgets held" : "BUDGET EXCEEDED");
+    return Held ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+// Runs the headless LodKernel / IndirectBatcherKernel loop for a fixed camera and
+// prints the key set after every frame, so GPU captures can be diffed against it.
+//
+// SubdReference [frames] [px py pz] [tx ty tz] [target pixel size] [dump file]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include "Headless/SubdEngine.h"
+
+using namespace Headless;
+
+static uint64_t HashKeySet(const PrimitiveData* inData, uint32_t inCount) {
+    std::vector<uint64_t> Keys(inCount);
+    for (uint32_t i = 0; i < inCount; ++i) {
+        Keys[i] = ((uint64_t)inData[i].PrimitiveIndex << 32) | inData[i].SubdBinaryKey;
+    }
+    std::sort(Keys.begin(), Keys.end());
+    uint64_t Hash = 1469598103934665603ull;
+    for (uint64_t Key : Keys) {
+        Hash = (Hash ^ Key) * 1099511628211ull;
+    }
+    return Hash;
+}
+
+int main(int argc, char** argv) {
+    int FrameCount = argc > 1 ? atoi(argv[1]) : 32;
+    float3 PosW(1.0f, 1.0f, 1.0f);
+    float3 Target(0.0f, 0.0f, 0.0f);
+    if (argc > 7) {
+        PosW = float3((float)atof(argv[2]), (float)atof(argv[3]), (float)atof(argv[4]));
+        Target = float3((float)atof(argv[5]), (float)atof(argv[6]), (float)atof(argv[7]));
+    }
+    float TargetPixelSize = argc > 8 ? (float)atof(argv[8]) : 5.0f;
+    const char* DumpFile = argc > 9 ? argv[9] : nullptr;
+
+    const uint32_t Width = 1920, Height = 1080;
+    const float FovY = 2.0f * std::atan(24.0f / (2.0f * 21.0f));
+
+    SubdCamera Camera;
+    Camera.PosW = PosW;
+    Camera.ViewProjMat = CreateViewProjMat(PosW, Target, float3(0.0f, 0.0f, 1.0f), FovY, (float)Width / Height, 0.0001f, 95.0f);
+
+    LodKernelConfig Config;
+    Config.FovX = (float)Width / Height * FovY;
+    Config.TargetPixelSize = TargetPixelSize;
+    Config.ScreenResolutionWidth = Width;
+    Config.DisplacementFactor = 0.3f;
+    LodKernelDefines Defines;
+
+    SubdEngine Engine(SubdMesh::CreateQuad());
+    printf("threads %u\n", ThreadPool::GetDefault().GetThreadCount());
+    for (int Frame = 0; Frame < FrameCount; ++Frame) {
+        auto Start = std::chrono::high_resolution_clock::now();
+        Engine.Update(Camera, Config, Defines);
+        double Ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+        printf("frame %3d  subd %8u  culled %8u  hash %016llx  %.3f ms\n", Frame, Engine.GetSubdInCount(), Engine.GetSubdCulledOutCount(),
+            (unsigned long long)HashKeySet(Engine.GetSubdIn(), Engine.GetSubdInCount()), Ms);
+    }
+
+    if (DumpFile) {
+        FILE* File = fopen(DumpFile, "w");
+        if (!File) {
+            fprintf(stderr, "Could not open %s\n", DumpFile);
+            return 1;
+        }
+        std::vector<PrimitiveData> Keys(Engine.GetSubdIn(), Engine.GetSubdIn() + Engine.GetSubdInCount());
+        std::sort(Keys.begin(), Keys.end(), [](const PrimitiveData& a, const PrimitiveData& b) {
+            return a.PrimitiveIndex != b.PrimitiveIndex ? a.PrimitiveIndex < b.PrimitiveIndex : a.SubdBinaryKey < b.SubdBinaryKey;
+        });
+        for (const PrimitiveData& Data : Keys) {
+            fprintf(File, "%u %u\n", Data.PrimitiveIndex, Data.SubdBinaryKey);
+        }
+        fclose(File);
+    }
+    return 0;
+}
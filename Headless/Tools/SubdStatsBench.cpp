@@ -0,0 +1,104 @@
+// Fills SubdStats (Headless/SubdStats.h) along the camera path the way the sample does: every
+// frame copies the SubdEngine's BufferCounter and indirect arguments into a ring of staging
+// slots and decodes the slot written GetLatency() frames earlier. Checks that the late
+// stats are the ones of their frame, that the leaf count moves by splits minus merges, and
+// that the visible count matches SubdCulledOut, for both compaction modes.
+//
+// SubdStatsBench [target pixel size] [ring slots] [threads] [camera path file]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Headless/CameraPath.h"
+#include "Headless/SubdEngine.h"
+
+using namespace Headless;
+
+static bool SameStats(const SubdStats& inA, const SubdStats& inB) {
+    return inA.Frame == inB.Frame && inA.LeafCount == inB.LeafCount && inA.VisibleCount == inB.VisibleCount && inA.CulledCount == inB.CulledCount
+        && inA.OccludedCount == inB.OccludedCount && inA.SplitCount == inB.SplitCount && inA.MergeCount == inB.MergeCount && inA.ConvergenceIterations == inB.ConvergenceIterations
+        && inA.Converged == inB.Converged && inA.BufferCapacity == inB.BufferCapacity;
+}
+
+// Returns the number of failed checks.
+static uint32_t RunPath(const CameraPath& inPath, const LodKernelConfig& inConfig, const LodKernelDefines& inDefines, uint32_t inSlotCount,
+    ThreadPool& inThreadPool, bool inPrint) {
+    const float FrameTime = 1.0f / 60.0f;
+    uint32_t FrameCount = (uint32_t)(inPath.GetDuration() / FrameTime) + 1;
+    SubdEngine Engine(SubdMesh::CreateQuad(), SubdBufferSize, &inThreadPool);
+    ReadbackRing Ring(inSlotCount);
+    std::vector<SubdReadback> Slots(Ring.GetSlotCount());
+    std::vector<SubdStats> History(FrameCount);
+
+    uint32_t Failures = 0;
+    uint64_t SplitTotal = 0;
+    uint64_t MergeTotal = 0;
+    uint32_t MaxLeaves = 0;
+    for (uint32_t Frame = 0; Frame < FrameCount; ++Frame) {
+        uint32_t LeavesBefore = Engine.GetBufferCounter().SubdInCount;
+        Engine.Update(inPath.GetCamera(Frame * FrameTime), inConfig, inDefines);
+
+        Slots[Ring.GetWriteSlot(Frame)] = Engine.GetReadback();
+        History[Frame] = GetSubdStats(Engine.GetReadback(), Engine.GetSubdBufferSize(), Frame);
+        const SubdStats& Current = History[Frame];
+        if (!Current.IsOverflowing() && Current.LeafCount != LeavesBefore + Current.SplitCount - Current.MergeCount) {
+            printf("  frame %u: %u leaves, expected %u + %u splits - %u merges\n", Frame, Current.LeafCount, LeavesBefore, Current.SplitCount,
+                Current.MergeCount);
+            ++Failures;
+        }
+        if (Current.VisibleCount != Engine.GetSubdCulledOutCount()) {
+            printf("  frame %u: %u visible, SubdCulledOut holds %u\n", Frame, Current.VisibleCount, Engine.GetSubdCulledOutCount());
+            ++Failures;
+        }
+
+        uint32_t ReadSlot = 0;
+        if (Ring.GetReadSlot(Frame, ReadSlot)) {
+            uint64_t ReadFrame = Frame - Ring.GetLatency();
+            SubdStats Late = GetSubdStats(Slots[ReadSlot], Engine.GetSubdBufferSize(), ReadFrame);
+            if (!SameStats(Late, History[ReadFrame])) {
+                printf("  frame %u: slot %u does not hold frame %llu\n", Frame, ReadSlot, (unsigned long long)ReadFrame);
+                ++Failures;
+            }
+            if (inPrint && ReadFrame % 120 == 0) {
+                printf("  %5.1f s  %8u leaves  %8u visible  %8u culled  %6u splits  %6u merges  %5.1f%% of SubdBufferSize\n", ReadFrame * FrameTime,
+                    Late.LeafCount, Late.VisibleCount, Late.CulledCount, Late.SplitCount, Late.MergeCount, Late.GetOccupancy() * 100.0f);
+            }
+        }
+        SplitTotal += Current.SplitCount;
+        MergeTotal += Current.MergeCount;
+        MaxLeaves = std::max(MaxLeaves, Current.LeafCount);
+    }
+    printf("  %u frames, stats %u frames late, %llu splits, %llu merges, at most %u leaves: %s\n", FrameCount, Ring.GetLatency(),
+        (unsigned long long)SplitTotal, (unsigned long long)MergeTotal, MaxLeaves, Failures ? "FAILED" : "ok");
+    return Failures;
+}
+
+int main(int argc, char** argv) {
+    float TargetPixelSize = argc > 1 ? (float)atof(argv[1]) : 1.0f;
+    uint32_t SlotCount = argc > 2 ? (uint32_t)atoi(argv[2]) : 4;
+    ThreadPool Pool(argc > 3 ? (uint32_t)atoi(argv[3]) : 0);
+    const char* PathFile = argc > 4 ? argv[4] : nullptr;
+
+    CameraPath Path = CameraPath::CreateFlyover();
+    if (PathFile && *PathFile && !Path.Load(PathFile)) {
+        printf("could not read %s\n", PathFile);
+        return 1;
+    }
+    CameraProjection Projection;
+    LodKernelConfig Config;
+    Config.FovX = Projection.GetFovX();
+    Config.TargetPixelSize = TargetPixelSize;
+    Config.ScreenResolutionWidth = Projection.ScreenResolutionWidth;
+    Config.DisplacementFactor = 0.3f;
+
+    uint32_t Failures = 0;
+    LodKernelDefines Defines;
+    printf("atomic appends, %u ring slots:\n", SlotCount);
+    Failures += RunPath(Path, Config, Defines, SlotCount, Pool, true);
+    Defines.DeterministicCompaction = true;
+    printf("deterministic compaction, %u ring slots:\n", SlotCount);
+    Failures += RunPath(Path, Config, Defines, SlotCount, Pool, false);
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+// Batched height and ray queries (Headless/SubdSurfaceQuery.h). Plays the terrain paths of
+// the benchmark suite on a synthetic displaced heightmap and moves a SubdSurfaceQuery to
+// SubdIn after every frame, timing the update and counting the frames that refit the tree
+// against those that rebuilt it. At the end of each path, checks the refit tree against a
+// fresh one and against brute force, then times batches of random height queries and of
+// random rays cast from the camera, on every thread and on one.
+//
+// SurfaceQueryBench [heightmap size] [pixel size] [queries per batch] [max frames]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "Headless/SubdBenchmark.h"
+#include "Headless/SubdEngine.h"
+#include "Headless/SubdSurfaceQuery.h"
+
+using namespace Headless;
+
+static float GetTerrainHeight(float inX, float inY) {
+    float Ridge = std::max(0.0f, std::sin(6.2831853f * 1.5f * inX) * std::cos(6.2831853f * inY));
+    float Band = std::exp(-(inY - 0.5f) * (inY - 0.5f) / 0.01f);
+    return 0.1f + 0.35f * Ridge * Ridge + 0.03f * Band * std::sin(6.2831853f * 23.0f * (inX + inY));
+}
+
+static bool IsSameHit(const SurfaceHit& inA, const SurfaceHit& inB) {
+    if (inA.IsHit() != inB.IsHit()) {
+        return false;
+    }
+    return !inA.IsHit() || std::fabs(inA.Distance - inB.Distance) <= 1e-4f * std::max(1.0f, inA.Distance);
+}
+
+// Queries per second of inQuery over the batch, best of a few runs.
+template <typename QueryFunc>
+static double GetQueriesPerSecond(uint32_t inCount, QueryFunc inQuery) {
+    double BestMs = 1e30;
+    for (int Run = 0; Run < 3; ++Run) {
+        auto Start = std::chrono::high_resolution_clock::now();
+        inQuery();
+        BestMs = std::min(BestMs, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count());
+    }
+    return inCount / (BestMs * 1e-3);
+}
+
+int main(int argc, char** argv) {
+    uint32_t Size = argc > 1 ? (uint32_t)atoi(argv[1]) : 1024;
+    float PixelSize = argc > 2 ? (float)atof(argv[2]) : 1.0f;
+    uint32_t QueryCount = argc > 3 ? (uint32_t)atoi(argv[3]) : 65536;
+    uint32_t MaxFrames = argc > 4 ? (uint32_t)atoi(argv[4]) : 240;
+
+    std::vector<uint16_t> Heights((size_t)Size * Size);
+    for (uint32_t j = 0; j < Size; ++j) {
+        for (uint32_t i = 0; i < Size; ++i) {
+            float z = GetTerrainHeight((float)i / Size, (float)j / Size);
+            Heights[(size_t)j * Size + i] = (uint16_t)(std::min(std::max(z, 0.0f), 1.0f) * 65535.0f);
+        }
+    }
+    ThreadPool Pool(0);
+    ThreadPool SinglePool(1);
+    HeightBoundsPyramid Bounds;
+    Bounds.Build(Heights.data(), Size, Size, Pool);
+    SubdTexture HeightMap = CreateHeightMap(Heights.data(), Size, Size);
+    SubdTexture SlopeMap = CreateSlopeMap(Heights.data(), Size, Size);
+    SubdMesh Quad = SubdMesh::CreateQuad();
+
+    CameraProjection Projection;
+    LodKernelConfig Config = {};
+    Config.FovX = Projection.GetFovX();
+    Config.TargetPixelSize = GetPatchTargetPixelSize(PixelSize, DefaultPatchLevel);
+    Config.ScreenResolutionWidth = Projection.ScreenResolutionWidth;
+    Config.DisplacementFactor = 0.3f;
+    LodKernelDefines Defines;
+
+    SurfaceQueryContext Context;
+    Context.Render.Mesh = &Quad;
+    Context.Render.SlopeMap = &SlopeMap;
+    Context.Render.DisplacementFactor = Config.DisplacementFactor;
+    Context.HeightMap = &HeightMap;
+    printf("heightmap %u x %u, batches of %u queries, %u threads\n", Size, Size, QueryCount, Pool.GetThreadCount());
+
+    uint32_t Failures = 0;
+    std::mt19937 Random(11);
+    std::uniform_real_distribution<float> Unit(-1.0f, 1.0f);
+    printf("%-10s %7s %8s %8s %9s %9s %9s %12s %12s %12s %12s\n", "path", "frames", "leaves", "rebuilds", "update ms", "upd max", "build ms",
+        "heights/s", "heights/s 1t", "rays/s", "rays/s 1t");
+    for (const BenchmarkPath& Path : GetBenchmarkPaths()) {
+        if (Path.Model) {
+            continue;
+        }
+        SubdEngine Engine(Quad, SubdBufferSize, &Pool);
+        Engine.LoadBuffer(Quad.CreateRootKeys());
+        Engine.SetHeightBounds(&Bounds);
+        SubdSurfaceQuery Query(Context);
+
+        uint32_t FrameCount = std::min(Path.GetFrameCount(), MaxFrames);
+        uint32_t Rebuilds = 0;
+        double UpdateMs = 0.0;
+        double UpdateMaxMs = 0.0;
+        SubdCamera Camera;
+        for (uint32_t Frame = 0; Frame < FrameCount; ++Frame) {
+            Camera = Path.Path.GetCamera(Path.GetFrameTime(Frame), Projection);
+            Engine.Update(Camera, Config, Defines);
+            SurfaceQueryUpdate Update = Query.Update(Engine.GetSubdIn(), Engine.GetSubdInCount(), Pool);
+            // The first frame always builds.
+            if (Frame > 0) {
+                Rebuilds += Update.Rebuilt;
+                UpdateMs += Update.Ms;
+                UpdateMaxMs = std::max(UpdateMaxMs, Update.Ms);
+            }
+        }
+
+        SubdSurfaceQuery Fresh(Context);
+        double BuildMs = Fresh.Update(Engine.GetSubdIn(), Engine.GetSubdInCount(), Pool).Ms;
+        if (Fresh.GetLeafCount() != Query.GetLeafCount()) {
+            printf("  %s: %u leaves after the updates, %u in a fresh build\n", Path.Name.c_str(), Query.GetLeafCount(), Fresh.GetLeafCount());
+            ++Failures;
+        }
+
+        std::vector<float2> Points(QueryCount);
+        std::vector<SurfaceRay> Rays(QueryCount);
+        for (uint32_t i = 0; i < QueryCount; ++i) {
+            Points[i] = float2(Unit(Random) * 0.999f, Unit(Random) * 0.999f);
+            // Towards a random point of the surface, so every ray hits: the low cameras fly
+            // under the ridges, where rays to z = 0 would leave the terrain from below.
+            float2 Target(Unit(Random), Unit(Random));
+            Rays[i].Origin = Camera.PosW;
+            Rays[i].Direction = float3(Target.x, Target.y, GetTerrainHeight(Target.x * 0.5f + 0.5f, Target.y * 0.5f + 0.5f) * Config.DisplacementFactor) - Camera.PosW;
+        }
+        std::vector<SurfaceHit> HeightHits(QueryCount);
+        std::vector<SurfaceHit> RayHits(QueryCount);
+        double HeightRate = GetQueriesPerSecond(QueryCount, [&]() { Query.QueryHeights(Points.data(), QueryCount, HeightHits.data(), Pool); });
+        double HeightRateSingle = GetQueriesPerSecond(QueryCount, [&]() { Query.QueryHeights(Points.data(), QueryCount, HeightHits.data(), SinglePool); });
+        double RayRate = GetQueriesPerSecond(QueryCount, [&]() { Query.CastRays(Rays.data(), QueryCount, RayHits.data(), Pool); });
+        double RayRateSingle = GetQueriesPerSecond(QueryCount, [&]() { Query.CastRays(Rays.data(), QueryCount, RayHits.data(), SinglePool); });
+
+        // The quad covers every point: a miss is a crack between triangles or a broken tree.
+        uint32_t Misses = 0;
+        for (const SurfaceHit& Hit : HeightHits) {
+            Misses += !Hit.IsHit();
+        }
+        if (Misses * 1000u > QueryCount) {
+            printf("  %s: %u of %u height queries missed\n", Path.Name.c_str(), Misses, QueryCount);
+            ++Failures;
+        }
+        uint32_t FreshMismatches = 0;
+        uint32_t BruteMismatches = 0;
+        for (uint32_t i = 0; i < QueryCount; i += 64) {
+            FreshMismatches += !IsSameHit(RayHits[i], Fresh.CastRay(Rays[i]));
+            BruteMismatches += !IsSameHit(RayHits[i], Query.CastRayBruteForce(Rays[i]));
+        }
+        if (FreshMismatches || BruteMismatches) {
+            printf("  %s: %u rays differ from a fresh tree, %u from brute force\n", Path.Name.c_str(), FreshMismatches, BruteMismatches);
+            ++Failures;
+        }
+
+        uint32_t Updates = std::max(FrameCount, 2u) - 1u;
+        printf("%-10s %7u %8u %8u %9.3f %9.3f %9.3f %12.0f %12.0f %12.0f %12.0f\n", Path.Name.c_str(), FrameCount, Query.GetLeafCount(), Rebuilds,
+            UpdateMs / Updates, UpdateMaxMs, BuildMs, HeightRate, HeightRateSingle, RayRate, RayRateSingle);
+    }
+
+    printf("%s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,124 @@
+// Replays a camera path over a tiled terrain (Headless/SubdTerrainTiles.h): each frame runs
+// the subdivision, hands the SubdCulledOut leaves to TerrainResidency and reports the tile
+// requests, hit rate, bytes read, evictions and resident memory, for several memory budgets.
+// Checks that every resident mip 0 tile holds the source heights.
+//
+// TerrainStreamBench [size] [tile size] [target pixel size] [camera path file, "" = flyover] [io threads]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Headless/CameraPath.h"
+#include "Headless/SubdTerrainResidency.h"
+
+using namespace Headless;
+
+static double MsSince(std::chrono::high_resolution_clock::time_point inStart) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - inStart).count();
+}
+
+// Compares a resident mip 0 tile, apron included, with the source heights.
+static bool CheckTile(const TerrainTileFile& inFile, const uint8_t* inPayload, uint32_t inTileIndex, const std::vector<uint16_t>& inHeights) {
+    const TerrainTileHeader& Header = inFile.GetHeader();
+    uint32_t Mip, TileX, TileY;
+    inFile.GetTileCoord(inTileIndex, Mip, TileX, TileY);
+    if (Mip != 0) {
+        return true;
+    }
+    const uint16_t* Heights = (const uint16_t*)inPayload;
+    uint32_t TileWidth = Header.TileSize + 2 * TerrainTileBorder;
+    for (uint32_t y = 0; y < TileWidth; ++y) {
+        for (uint32_t x = 0; x < TileWidth; ++x) {
+            int64_t Row = std::min<int64_t>(std::max<int64_t>((int64_t)TileY * Header.TileSize + y - TerrainTileBorder, 0), Header.Height - 1);
+            int64_t Column = std::min<int64_t>(std::max<int64_t>((int64_t)TileX * Header.TileSize + x - TerrainTileBorder, 0), Header.Width - 1);
+            if (Heights[y * TileWidth + x] != inHeights[(size_t)Row * Header.Width + Column]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint32_t Size = argc > 1 ? (uint32_t)atoi(argv[1]) : 8192;
+    uint32_t TileSize = argc > 2 ? (uint32_t)atoi(argv[2]) : 256;
+    float TargetPixelSize = argc > 3 ? (float)atof(argv[3]) : 0.3f;
+    const char* PathFile = argc > 4 ? argv[4] : nullptr;
+    uint32_t IoThreads = argc > 5 ? (uint32_t)atoi(argv[5]) : 2;
+    const char* TilePath = "TerrainStreamBench.tiles";
+
+    CameraPath Path = CameraPath::CreateFlyover();
+    if (PathFile && *PathFile && !Path.Load(PathFile)) {
+        printf("could not read camera path %s\n", PathFile);
+        return 1;
+    }
+
+    std::vector<uint16_t> Heights((size_t)Size * Size);
+    for (uint32_t j = 0; j < Size; ++j) {
+        for (uint32_t i = 0; i < Size; ++i) {
+            float x = (float)i / Size;
+            float y = (float)j / Size;
+            float z = 0.5f + 0.3f * std::sin(6.2831853f * 5.0f * x) * std::cos(6.2831853f * 3.0f * y) + 0.1f * std::sin(6.2831853f * 41.0f * (x + y));
+            Heights[(size_t)j * Size + i] = (uint16_t)(std::min(std::max(z, 0.0f), 1.0f) * 65535.0f);
+        }
+    }
+
+    auto Start = std::chrono::high_resolution_clock::now();
+    TerrainTileFile File;
+    if (!WriteTerrainTiles(TilePath, Heights.data(), Size, Size, TileSize) || !File.Open(TilePath)) {
+        printf("could not write %s\n", TilePath);
+        return 1;
+    }
+    const TerrainTileHeader& Header = File.GetHeader();
+    double WholeMB = (double)Header.TileCount * Header.GetTileBytes() / 1048576.0;
+    printf("heightmap %u x %u  tiles %u (%u mips, %u texels + apron, %.1f KB each)  all tiles %.1f MB  written in %.1f ms\n", Size, Size,
+        Header.TileCount, Header.MipCount, TileSize, Header.GetTileBytes() / 1024.0, WholeMB, MsSince(Start));
+
+    // The path is replayed at 60 frames per second.
+    CameraProjection Projection;
+    LodKernelConfig Config;
+    Config.FovX = Projection.GetFovX();
+    Config.TargetPixelSize = TargetPixelSize;
+    Config.ScreenResolutionWidth = Projection.ScreenResolutionWidth;
+    Config.DisplacementFactor = 0.3f;
+    LodKernelDefines Defines;
+    int FrameCount = (int)std::ceil(Path.GetDuration() * 60.0f) + 1;
+    printf("camera path %.1f s, %d frames, target pixel size %g, %u io threads\n", Path.GetDuration(), FrameCount, TargetPixelSize, IoThreads);
+    printf("budget MB | requests/frame  hit rate  loaded  evicted  deferred  read MB  resident MB | residency ms/frame | tiles ok\n");
+
+    SubdMesh Mesh = SubdMesh::CreateQuad();
+    for (size_t BudgetMB : { 2, 4, 8, 64 }) {
+        TerrainResidencyConfig ResidencyConfig;
+        ResidencyConfig.MemoryBudget = BudgetMB << 20;
+        ResidencyConfig.IoThreadCount = IoThreads;
+        TerrainResidency Residency(File, ResidencyConfig);
+        SubdEngine Engine(Mesh);
+        double ResidencyMs = 0.0;
+        size_t PeakResident = 0;
+        for (int Frame = 0; Frame < FrameCount; ++Frame) {
+            Engine.Update(Path.GetCamera(Frame / 60.0f, Projection), Config, Defines);
+            Start = std::chrono::high_resolution_clock::now();
+            Residency.Update(Mesh, Engine.GetSubdCulledOut(), Engine.GetSubdCulledOutCount());
+            ResidencyMs += MsSince(Start);
+            PeakResident = std::max(PeakResident, Residency.GetResidentBytes());
+        }
+        Residency.Flush();
+
+        bool TilesOk = true;
+        for (uint32_t Tile = 0; Tile < Header.TileCount; ++Tile) {
+            const uint8_t* Payload = Residency.GetTileData(Tile);
+            TilesOk = TilesOk && (!Payload || CheckTile(File, Payload, Tile, Heights));
+        }
+        const TerrainResidencyStats& Stats = Residency.GetStats();
+        printf("%9zu | %14.1f  %7.1f%%  %6llu  %7llu  %8llu  %7.1f  %11.1f | %18.3f | %s\n", BudgetMB, (double)Stats.Requests / Stats.Frames,
+            100.0 * Stats.GetHitRate(), (unsigned long long)Stats.TilesLoaded, (unsigned long long)Stats.TilesEvicted, (unsigned long long)Stats.Deferred,
+            Stats.BytesRead / 1048576.0, PeakResident / 1048576.0, ResidencyMs / FrameCount, TilesOk ? "yes" : "NO");
+    }
+
+    File.Close();
+    std::remove(TilePath);
+    return 0;
+}